@@ -0,0 +1,810 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/VersionedDataContainer.hpp>
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
+
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Common/Tracer.hpp>
+
+#include <Common/Pack.hpp>
+
+#include <atomic>
+#include <limits>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Битовая маска строк колоночного хранилища.
+ * \ingroup NewUiServer
+ */
+class RowBitmap
+{
+    static constexpr size_t WordSize = 64;
+
+    Basis::Vector<uint64_t> mWords;
+    size_t mSize = 0;
+
+public:
+    void Assign(size_t aSize)
+    {
+        mSize = aSize;
+        mWords.assign((aSize + WordSize - 1) / WordSize, 0);
+    }
+
+    void Truncate(size_t aSize)
+    {
+        assert(aSize <= mSize);
+        mSize = aSize;
+        mWords.resize((aSize + WordSize - 1) / WordSize);
+        if (aSize % WordSize)
+        {
+            mWords.back() &= (uint64_t { 1 } << (aSize % WordSize)) - 1;
+        }
+    }
+
+    void PushBack(bool aValue)
+    {
+        if (mSize % WordSize == 0)
+        {
+            mWords.push_back(0);
+        }
+        Set(mSize++, aValue);
+    }
+
+    void Set(size_t aPos, bool aValue)
+    {
+        assert(aPos < mSize);
+        const auto mask = uint64_t { 1 } << (aPos % WordSize);
+        if (aValue)
+        {
+            mWords[aPos / WordSize] |= mask;
+        }
+        else
+        {
+            mWords[aPos / WordSize] &= ~mask;
+        }
+    }
+
+    bool Test(size_t aPos) const
+    {
+        assert(aPos < mSize);
+        return mWords[aPos / WordSize] & (uint64_t { 1 } << (aPos % WordSize));
+    }
+
+    /**
+     * \brief Позиция первого установленного бита начиная с aFrom.
+     * Если такого бита нет, возвращает Size().
+     */
+    size_t FindNext(size_t aFrom) const
+    {
+        if (aFrom >= mSize)
+        {
+            return mSize;
+        }
+        size_t word = aFrom / WordSize;
+        uint64_t bits = mWords[word] & (~uint64_t { 0 } << (aFrom % WordSize));
+        while (!bits)
+        {
+            if (++word == mWords.size())
+            {
+                return mSize;
+            }
+            bits = mWords[word];
+        }
+        return std::min(mSize, word * WordSize + static_cast<size_t>(__builtin_ctzll(bits)));
+    }
+
+    size_t Count() const
+    {
+        size_t result = 0;
+        for (auto word : mWords)
+        {
+            result += static_cast<size_t>(__builtin_popcountll(word));
+        }
+        return result;
+    }
+
+    size_t Size() const
+    {
+        return mSize;
+    }
+
+    void Clear()
+    {
+        mWords.clear();
+        mSize = 0;
+    }
+};
+
+/**
+ * \brief Пул строк колоночного хранилища.
+ * \ingroup NewUiServer
+ * Каждой уникальной строке назначается постоянный идентификатор.
+ * Идентификатор NullId зарезервирован под незаполненное значение.
+ */
+class StringPool
+{
+public:
+    using TStringId = uint32_t;
+
+    static constexpr TStringId NullId = 0;
+
+private:
+    Basis::UnorderedMap<std::string, TStringId> mIds;
+    /// Указатели на ключи mIds, индекс - идентификатор строки.
+    Basis::Vector<const std::string*> mStrings { nullptr };
+
+public:
+    TStringId Intern(const std::string& aValue)
+    {
+        auto [it, inserted] = mIds.emplace(aValue, static_cast<TStringId>(mStrings.size()));
+        if (inserted)
+        {
+            mStrings.push_back(&it->first);
+        }
+        return it->second;
+    }
+
+    std::optional<TStringId> Find(const std::string& aValue) const
+    {
+        auto it = mIds.find(aValue);
+        if (it == mIds.cend())
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    const std::string& Get(TStringId aId) const
+    {
+        assert(aId != NullId && aId < mStrings.size());
+        return *mStrings[aId];
+    }
+
+    size_t Size() const
+    {
+        return mIds.size();
+    }
+
+    void Clear()
+    {
+        mIds.clear();
+        mStrings.assign(1, nullptr);
+    }
+};
+
+/**
+ * \brief Колоночный снимок версионированных данных.
+ * \ingroup NewUiServer
+ * Хранится рядом с BaseMultiIndexContainer и повторяет все его изменения.
+ * Для каждой колонки из TTableSetup::FieldList хранится типизированный массив значений
+ * (int64, Basis::Real или идентификаторы строк из StringPool) и маска заполненности.
+ * Для каждой строки хранятся версия и версия, которой строка перезаписана,
+ * что позволяет получить маску видимых строк для любой живой версии.
+ *
+ * Строки только добавляются в конец. Строки, удаленные через ErasePrevious,
+ * физически вычищаются, только когда их не меньше половины и нет активных сканирований,
+ * так как уплотнение меняет номера строк.
+ */
+template <typename TTableSetup, typename TData>
+class ColumnarSnapshot
+{
+public:
+    using TId = typename TData::TId;
+    using TColumnType = typename TData::TColumnType;
+    using TUiColumnType = TradingSerialization::Table::TColumnType;
+    using TValueType = TradingSerialization::Table::FilterValueType;
+    using TStringId = StringPool::TStringId;
+    using TRow = size_t;
+
+    static constexpr TDataVersion NotRewrited = std::numeric_limits<TDataVersion>::max();
+
+    struct Column
+    {
+        TUiColumnType Id;
+        TValueType Type;
+
+        /// Заполняется только массив, соответствующий типу колонки.
+        Basis::Vector<int64_t> Ints;
+        Basis::Vector<Basis::Real> Floats;
+        Basis::Vector<TStringId> Strings;
+
+        RowBitmap HasValue;
+    };
+
+private:
+    Basis::Vector<Column> mColumns;
+    /// Номер колонки в mColumns по номеру колонки таблицы, -1 если колонки нет.
+    Basis::Vector<int> mSlots;
+
+    StringPool mStrings;
+
+    Basis::Vector<Basis::SPtr<TData>> mItems;
+    Basis::Vector<TDataVersion> mVersions;
+    Basis::Vector<TDataVersion> mRewritedBy;
+
+    /// Последняя строка для каждого id.
+    Basis::UnorderedMap<TId, TRow> mLastRows;
+
+    /// Количество перезаписанных строк по версиям, которые еще не стали мусором.
+    Basis::Map<TDataVersion, size_t> mRewritedRows;
+    /// Строки, перезаписанные версиями до mErasedBefore, больше никому не видны.
+    TDataVersion mErasedBefore = 0;
+    size_t mErasableRows = 0;
+
+    /// Сканирования могут идти из нескольких потоков (SubscriptionsContainer::SetWorkerPool),
+    /// уплотнение (TryCompact) - только из потока реактора.
+    mutable std::atomic<size_t> mActiveScans { 0 };
+
+    Basis::Tracer& mTracer;
+
+public:
+    ColumnarSnapshot(Basis::Tracer& aTracer)
+        : mTracer(aTracer)
+    {
+        for (const auto& info : TTableSetup::FieldList)
+        {
+            auto column = static_cast<TUiColumnType>(info.Column);
+            assert(column >= 0);
+            if (mSlots.size() <= static_cast<size_t>(column))
+            {
+                mSlots.resize(static_cast<size_t>(column) + 1, -1);
+            }
+            mSlots[static_cast<size_t>(column)] = static_cast<int>(mColumns.size());
+            mColumns.push_back(Column { column, info.Type, {}, {}, {}, {} });
+        }
+    }
+
+    void Append(const Basis::SPtr<TData>& aData, TDataVersion aVersion)
+    {
+        const auto row = mItems.size();
+
+        auto [it, inserted] = mLastRows.emplace(aData->GetId(), row);
+        if (!inserted)
+        {
+            SetRewrited(it->second, aVersion);
+            it->second = row;
+        }
+
+        mItems.push_back(aData);
+        mVersions.push_back(aVersion);
+        mRewritedBy.push_back(NotRewrited);
+
+        for (auto& column : mColumns)
+        {
+            if (!AppendValue(column, aData->GetValue(static_cast<TColumnType>(column.Id))))
+            {
+                mTracer.ErrorSlow("ColumnarSnapshot.Append: invalid value type, column: ", column.Id, ", item: ", aData);
+            }
+        }
+    }
+
+    void MarkRewrited(const TId& aId, TDataVersion aVersion)
+    {
+        auto it = mLastRows.find(aId);
+        if (it == mLastRows.cend())
+        {
+            return;
+        }
+        SetRewrited(it->second, aVersion);
+    }
+
+    void ErasePrevious(TDataVersion aVersion)
+    {
+        if (aVersion <= mErasedBefore)
+        {
+            return;
+        }
+        mErasedBefore = aVersion;
+
+        auto end = mRewritedRows.lower_bound(aVersion);
+        for (auto it = mRewritedRows.begin(); it != end; ++it)
+        {
+            mErasableRows += it->second;
+        }
+        mRewritedRows.erase(mRewritedRows.begin(), end);
+    }
+
+    /**
+     * \brief Уплотнить строки, если не меньше половины из них удалены и нет активных сканирований.
+     * Номера строк меняются, поэтому вызывается только потоком реактора, когда на пуле потоков
+     * не выполняется обработка подписок. Отложенное из-за сканирований уплотнение
+     * выполняется следующим вызовом.
+     */
+    bool TryCompact()
+    {
+        if (mActiveScans != 0 || !mErasableRows || mErasableRows * 2 < mItems.size())
+        {
+            return false;
+        }
+        Compact();
+        return true;
+    }
+
+    void Clear()
+    {
+        for (auto& column : mColumns)
+        {
+            column.Ints.clear();
+            column.Floats.clear();
+            column.Strings.clear();
+            column.HasValue.Clear();
+        }
+        mStrings.Clear();
+        mItems.clear();
+        mVersions.clear();
+        mRewritedBy.clear();
+        mLastRows.clear();
+        mRewritedRows.clear();
+        mErasedBefore = 0;
+        mErasableRows = 0;
+    }
+
+    size_t RowsCount() const
+    {
+        return mItems.size();
+    }
+
+    bool IsVisible(TRow aRow, TDataVersion aVersion) const
+    {
+        return mVersions[aRow] <= aVersion && mRewritedBy[aRow] > aVersion;
+    }
+
+    /**
+     * \brief Маска строк, видимых в версии aVersion.
+     */
+    void BuildValidityBitmap(TDataVersion aVersion, RowBitmap& outBitmap) const
+    {
+        outBitmap.Assign(mItems.size());
+        for (TRow row = 0; row < mItems.size(); ++row)
+        {
+            if (IsVisible(row, aVersion))
+            {
+                outBitmap.Set(row, true);
+            }
+        }
+    }
+
+    const Basis::SPtr<TData>& GetItem(TRow aRow) const
+    {
+        return mItems[aRow];
+    }
+
+    const Column* FindColumn(TUiColumnType aColumn) const
+    {
+        if (aColumn < 0 || static_cast<size_t>(aColumn) >= mSlots.size() || mSlots[static_cast<size_t>(aColumn)] < 0)
+        {
+            return nullptr;
+        }
+        return &mColumns[static_cast<size_t>(mSlots[static_cast<size_t>(aColumn)])];
+    }
+
+    const StringPool& GetStrings() const
+    {
+        return mStrings;
+    }
+
+    TradingSerialization::Table::TInt GetInt(const Column& aColumn, TRow aRow) const
+    {
+        assert(aColumn.Type == TValueType::Int);
+        if (!aColumn.HasValue.Test(aRow))
+        {
+            return std::nullopt;
+        }
+        return aColumn.Ints[aRow];
+    }
+
+    TradingSerialization::Table::TFloat GetFloat(const Column& aColumn, TRow aRow) const
+    {
+        assert(aColumn.Type == TValueType::Float);
+        if (!aColumn.HasValue.Test(aRow))
+        {
+            return std::nullopt;
+        }
+        return aColumn.Floats[aRow];
+    }
+
+    /**
+     * \brief Строковое значение без копирования.
+     * Возвращает nullptr для незаполненного значения.
+     */
+    const std::string* GetString(const Column& aColumn, TRow aRow) const
+    {
+        assert(aColumn.Type == TValueType::String);
+        const auto id = aColumn.Strings[aRow];
+        if (id == StringPool::NullId)
+        {
+            return nullptr;
+        }
+        return &mStrings.Get(id);
+    }
+
+    TradingSerialization::Table::TCellVariant GetValue(const Column& aColumn, TRow aRow) const
+    {
+        using namespace TradingSerialization::Table;
+
+        switch (aColumn.Type)
+        {
+        case TValueType::Int:
+            return GetInt(aColumn, aRow);
+        case TValueType::Float:
+            return GetFloat(aColumn, aRow);
+        case TValueType::String:
+        {
+            const auto* value = GetString(aColumn, aRow);
+            return value ? TString { *value } : TString {};
+        }
+        default:
+            assert(false);
+            break;
+        }
+        return TInt {};
+    }
+
+    /**
+     * \brief Регистрация сканирования.
+     * Пока есть активные сканирования, номера строк не меняются.
+     */
+    void AcquireScan() const
+    {
+        ++mActiveScans;
+    }
+
+    void ReleaseScan() const
+    {
+        assert(mActiveScans);
+        --mActiveScans;
+    }
+
+private:
+    void SetRewrited(TRow aRow, TDataVersion aVersion)
+    {
+        if (mRewritedBy[aRow] != NotRewrited)
+        {
+            return;
+        }
+        mRewritedBy[aRow] = aVersion;
+        if (aVersion < mErasedBefore)
+        {
+            ++mErasableRows;
+        }
+        else
+        {
+            ++mRewritedRows[aVersion];
+        }
+    }
+
+    bool AppendValue(Column& outColumn, const TradingSerialization::Table::TCellVariant& aValue)
+    {
+        using namespace TradingSerialization::Table;
+
+        switch (outColumn.Type)
+        {
+        case TValueType::Int:
+        {
+            const auto* value = boost::get<TInt>(&aValue);
+            const bool hasValue = value && *value;
+            outColumn.Ints.push_back(hasValue ? **value : 0);
+            outColumn.HasValue.PushBack(hasValue);
+            return value;
+        }
+        case TValueType::Float:
+        {
+            const auto* value = boost::get<TFloat>(&aValue);
+            const bool hasValue = value && *value;
+            outColumn.Floats.push_back(hasValue ? **value : Basis::Real { 0.0 });
+            outColumn.HasValue.PushBack(hasValue);
+            return value;
+        }
+        case TValueType::String:
+        {
+            const auto* value = boost::get<TString>(&aValue);
+            const bool hasValue = value && *value;
+            outColumn.Strings.push_back(hasValue ? mStrings.Intern(**value) : StringPool::NullId);
+            outColumn.HasValue.PushBack(hasValue);
+            return value;
+        }
+        default:
+            assert(false);
+            break;
+        }
+        return false;
+    }
+
+    bool IsErased(TRow aRow) const
+    {
+        return mRewritedBy[aRow] < mErasedBefore;
+    }
+
+    void Compact()
+    {
+        mTracer.InfoSlow("ColumnarSnapshot.Compact: rows: ", mItems.size(), ", erased: ", mErasableRows);
+
+        for (auto it = mLastRows.begin(); it != mLastRows.end();)
+        {
+            if (IsErased(it->second))
+            {
+                it = mLastRows.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        /// Относительный порядок строк сохраняется, поэтому новые номера монотонны.
+        Basis::Vector<TRow> newRows(mItems.size());
+        TRow target = 0;
+        for (TRow row = 0; row < mItems.size(); ++row)
+        {
+            newRows[row] = target;
+            if (IsErased(row))
+            {
+                continue;
+            }
+            if (target != row)
+            {
+                mItems[target] = std::move(mItems[row]);
+                mVersions[target] = mVersions[row];
+                mRewritedBy[target] = mRewritedBy[row];
+                for (auto& column : mColumns)
+                {
+                    MoveValue(column, row, target);
+                }
+            }
+            ++target;
+        }
+
+        for (auto& column : mColumns)
+        {
+            TruncateColumn(column, target);
+        }
+        mItems.erase(mItems.begin() + static_cast<std::ptrdiff_t>(target), mItems.end());
+        mVersions.erase(mVersions.begin() + static_cast<std::ptrdiff_t>(target), mVersions.end());
+        mRewritedBy.erase(mRewritedBy.begin() + static_cast<std::ptrdiff_t>(target), mRewritedBy.end());
+
+        for (auto& [id, row] : mLastRows)
+        {
+            row = newRows[row];
+        }
+
+        mErasableRows = 0;
+    }
+
+    static void MoveValue(Column& outColumn, TRow aFrom, TRow aTo)
+    {
+        switch (outColumn.Type)
+        {
+        case TValueType::Int:
+            outColumn.Ints[aTo] = outColumn.Ints[aFrom];
+            break;
+        case TValueType::Float:
+            outColumn.Floats[aTo] = outColumn.Floats[aFrom];
+            break;
+        case TValueType::String:
+            outColumn.Strings[aTo] = outColumn.Strings[aFrom];
+            break;
+        default:
+            assert(false);
+            break;
+        }
+        outColumn.HasValue.Set(aTo, outColumn.HasValue.Test(aFrom));
+    }
+
+    static void TruncateColumn(Column& outColumn, size_t aSize)
+    {
+        const auto from = static_cast<std::ptrdiff_t>(aSize);
+        switch (outColumn.Type)
+        {
+        case TValueType::Int:
+            outColumn.Ints.erase(outColumn.Ints.begin() + from, outColumn.Ints.end());
+            break;
+        case TValueType::Float:
+            outColumn.Floats.erase(outColumn.Floats.begin() + from, outColumn.Floats.end());
+            break;
+        case TValueType::String:
+            outColumn.Strings.erase(outColumn.Strings.begin() + from, outColumn.Strings.end());
+            break;
+        default:
+            assert(false);
+            break;
+        }
+        outColumn.HasValue.Truncate(aSize);
+    }
+};
+
+/**
+ * \brief Заглушка колоночного снимка для контейнеров, которым он не нужен.
+ * \ingroup NewUiServer
+ */
+template <typename TData>
+struct NoColumnarSnapshot
+{
+    NoColumnarSnapshot(Basis::Tracer&)
+    {
+    }
+
+    void Append(const Basis::SPtr<TData>&, TDataVersion)
+    {
+    }
+
+    void MarkRewrited(const typename TData::TId&, TDataVersion)
+    {
+    }
+
+    void ErasePrevious(TDataVersion)
+    {
+    }
+
+    bool TryCompact()
+    {
+        return false;
+    }
+
+    void Clear()
+    {
+    }
+};
+
+template <typename TContainerSetup, bool = HasColumnarSnapshot<TContainerSetup>::value>
+struct ColumnarSnapshotOf
+{
+    using Type = NoColumnarSnapshot<typename TContainerSetup::TData>;
+};
+
+template <typename TContainerSetup>
+struct ColumnarSnapshotOf<TContainerSetup, true>
+{
+    using Type = typename TContainerSetup::TColumnarSnapshot;
+};
+
+/**
+ * \brief Последовательный проход по строкам колоночного снимка.
+ * \ingroup NewUiServer
+ * Возвращает строки, видимые в заданной версии, в порядке их хранения.
+ * Номер последней возвращенной строки доступен через GetCurrentRow.
+ * TInit строится так же, как параметры диапазонов хранилища, поэтому обработчик подписки может
+ * обходить снимок вместо индексов. Инкременты по снимку не строятся, Init с IncrementAction
+ * возвращает false.
+ * \implements IDataRanges
+ */
+template <typename TSetup>
+class ColumnarRanges
+{
+public:
+    using TData = typename TSetup::TData;
+    using TColumns = typename TSetup::TColumnarSnapshot;
+    using TRow = typename TColumns::TRow;
+
+    using TUiFilters = TradingSerialization::Table::FilterGroup;
+
+    struct TInit
+    {
+        const TColumns& Columns;
+        std::optional<Model::ActionType> IncrementAction;
+        TDataVersion Version;
+
+        TInit(
+            const TColumns& aColumns,
+            TDataVersion aVersion)
+            : Columns(aColumns)
+            , Version(aVersion)
+        {}
+
+        /**
+         * \brief Параметры в виде параметров диапазонов хранилища aMap.
+         * Фильтры применяет фильтрация, диапазоны их не используют.
+         */
+        template <typename TMap>
+        TInit(
+            const TMap& aMap,
+            const TUiFilters& /* aFilterExpression */,
+            std::optional<Model::ActionType> aIncrementAction,
+            TDataVersion aVersion)
+            : Columns(aMap.GetColumns())
+            , IncrementAction(aIncrementAction)
+            , Version(aVersion)
+        {}
+    };
+
+private:
+    const TColumns* mColumns = nullptr;
+    TDataVersion mVersion { 0 };
+    TRow mNextRow = 0;
+
+    Basis::Tracer& mTracer;
+
+public:
+    ColumnarRanges(Basis::Tracer& aTracer)
+        : mTracer(aTracer)
+    {
+    }
+
+    ~ColumnarRanges()
+    {
+        Reset();
+    }
+
+    bool IsInitialized() const
+    {
+        return mColumns;
+    }
+
+    bool Init(const TInit& aInit)
+    {
+        assert(!IsInitialized());
+
+        if (aInit.IncrementAction)
+        {
+            mTracer.Error("ColumnarRanges.Init: increments are not supported");
+            return false;
+        }
+
+        mColumns = &aInit.Columns;
+        mVersion = aInit.Version;
+        mNextRow = 0;
+        mColumns->AcquireScan();
+
+        mTracer.InfoSlow("ColumnarRanges.Init: version: ", mVersion, ", rows: ", mColumns->RowsCount());
+        return true;
+    }
+
+    void Reset()
+    {
+        if (mColumns)
+        {
+            mColumns->ReleaseScan();
+        }
+        mColumns = nullptr;
+        mNextRow = 0;
+    }
+
+    Basis::SPtr<TData> GetNext()
+    {
+        assert(IsInitialized());
+
+        const auto rowsCount = mColumns->RowsCount();
+        for (; mNextRow < rowsCount; ++mNextRow)
+        {
+            if (mColumns->IsVisible(mNextRow, mVersion))
+            {
+                return mColumns->GetItem(mNextRow++);
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * \brief Номер строки, возвращенной последним вызовом GetNext.
+     */
+    TRow GetCurrentRow() const
+    {
+        assert(mNextRow);
+        return mNextRow - 1;
+    }
+
+    const TColumns& GetColumns() const
+    {
+        assert(IsInitialized());
+        return *mColumns;
+    }
+};
+
+/**
+ * \brief Признак прохода по колоночному снимку.
+ * \ingroup NewUiServer
+ * Позволяет фильтрации читать значения прямо из колонок текущей строки.
+ */
+template <typename TDataRanges>
+struct IsColumnarRanges : std::false_type
+{
+};
+
+template <typename TSetup>
+struct IsColumnarRanges<ColumnarRanges<TSetup>> : std::true_type
+{
+};
+
+}
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/LocalStoreUtils.hpp>
+#include <NewUiServer/UiLocalStore/TableUtils.hpp>
+#include <NewUiServer/UiLocalStore/InFilterEvaluator.hpp>
+
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Common/Collections.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Скомпилированная группа фильтров.
+ * \ingroup NewUiServer
+ * Строится один раз из FilterGroup и применяется к строкам без выделения памяти:
+ * - колонки проверяются при компиляции;
+ * - значения фильтров заранее приводятся к типу фильтра;
+ * - списки оператора In собираются в InFilterEvaluator;
+ * - для каждой строки остается только выбор оператора и типизированное сравнение.
+ * Семантика совпадает с LocalStoreUtils::CheckDataByFilter, в том числе для незаполненных значений
+ * и для сравнения Basis::Real.
+ * Фильтры, значения которых нельзя привести к одному типу, проверяются через LocalStoreUtils::CheckOperation
+ * по заранее подготовленному списку значений.
+ */
+template <typename TTableSetup>
+class CompiledFilterGroup
+{
+public:
+    using TUiColumnType = TradingSerialization::Table::TColumnType;
+    using TUiFilter = TradingSerialization::Table::Filter;
+    using TUiFilters = TradingSerialization::Table::FilterGroup;
+    using TUiFilterValues = TradingSerialization::Table::TFilterValues;
+    using TFilterOperator = TradingSerialization::Table::FilterOperator;
+    using TValueType = TradingSerialization::Table::FilterValueType;
+    using TCellVariant = TradingSerialization::Table::TCellVariant;
+
+private:
+    enum class FilterKind
+    {
+        Typed,
+        Interpreted,
+        InvalidColumn
+    };
+
+    template <typename T>
+    struct TypedValues
+    {
+        /// Граница для операторов сравнения.
+        std::optional<T> Bound;
+        /// Значения оператора In.
+        InFilterEvaluator<T> InValues;
+
+        const T* GetBound() const
+        {
+            return Bound ? &*Bound : nullptr;
+        }
+
+        bool Contains(const T* aValue) const
+        {
+            return InValues.Contains(aValue);
+        }
+    };
+
+    struct CompiledFilter
+    {
+        TUiColumnType Column;
+        TFilterOperator Operator;
+        FilterKind Kind = FilterKind::Typed;
+        TValueType Type = TValueType::Unknown;
+
+        TypedValues<std::string> Strings;
+        TypedValues<int64_t> Ints;
+        TypedValues<Basis::Real> Floats;
+
+        /// Значения для проверки через LocalStoreUtils::CheckOperation.
+        TUiFilterValues Values;
+    };
+
+    Basis::Vector<CompiledFilter> mFilters;
+    bool mIsCompiled = false;
+    bool mIsValid = false;
+
+public:
+    CompiledFilterGroup() = default;
+
+    explicit CompiledFilterGroup(const TUiFilters& aFilters)
+    {
+        Compile(aFilters);
+    }
+
+    void Compile(const TUiFilters& aFilters)
+    {
+        using namespace TradingSerialization::Table;
+
+        mFilters.clear();
+        mIsCompiled = true;
+        mIsValid = aFilters.Relation == FilterRelation::And;
+
+        for (const auto& filter : aFilters.Filters)
+        {
+            CompiledFilter compiled;
+            compiled.Column = filter.Column;
+            compiled.Operator = filter.Operator;
+            if (!TableUtils<TTableSetup>::ColumnTypeIsValid(filter.Column))
+            {
+                compiled.Kind = FilterKind::InvalidColumn;
+            }
+            else if (!CompileValues(filter, compiled))
+            {
+                compiled.Kind = FilterKind::Interpreted;
+                compiled.Values = filter.Values.GetAllValues();
+            }
+            mFilters.push_back(std::move(compiled));
+        }
+    }
+
+    bool IsCompiled() const
+    {
+        return mIsCompiled;
+    }
+
+    /**
+     * \brief Проверить объект на соответствие фильтрам.
+     * outOk - принимает false в случае ошибок применения фильтров.
+     */
+    template <typename TData>
+    bool Check(const TData& aData, bool& outOk) const
+    {
+        assert(mIsCompiled);
+        if (!mIsValid)
+        {
+            outOk = false;
+            return false;
+        }
+
+        for (const auto& filter : mFilters)
+        {
+            if (filter.Kind == FilterKind::InvalidColumn)
+            {
+                outOk = false;
+                return false;
+            }
+
+            const auto value = aData.GetValue(static_cast<typename TData::TColumnType>(filter.Column));
+            if (!CheckValue(filter, value, outOk) || !outOk)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * \brief Проверить строку колоночного снимка на соответствие фильтрам.
+     * Значения читаются из типизированных колонок без построения variant.
+     */
+    template <typename TColumns>
+    bool CheckRow(const TColumns& aColumns, typename TColumns::TRow aRow, bool& outOk) const
+    {
+        assert(mIsCompiled);
+        if (!mIsValid)
+        {
+            outOk = false;
+            return false;
+        }
+
+        for (const auto& filter : mFilters)
+        {
+            const auto* column = filter.Kind == FilterKind::InvalidColumn
+                ? nullptr
+                : aColumns.FindColumn(filter.Column);
+            if (!column)
+            {
+                outOk = false;
+                return false;
+            }
+
+            if (!CheckColumnValue(filter, aColumns, *column, aRow, outOk) || !outOk)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static bool CompileValues(const TUiFilter& aFilter, CompiledFilter& outFilter)
+    {
+        const auto& values = aFilter.Values;
+        const auto groups = !values.StringValues.empty() + !values.IntValues.empty() + !values.FloatValues.empty();
+        if (groups != 1)
+        {
+            return false;
+        }
+        if (aFilter.Operator != TFilterOperator::In && values.Size() != 1)
+        {
+            return false;
+        }
+
+        if (!values.StringValues.empty())
+        {
+            outFilter.Type = TValueType::String;
+            FillTypedValues(aFilter.Operator, values.StringValues, outFilter.Strings);
+        }
+        else if (!values.IntValues.empty())
+        {
+            outFilter.Type = TValueType::Int;
+            FillTypedValues(aFilter.Operator, values.IntValues, outFilter.Ints);
+        }
+        else
+        {
+            outFilter.Type = TValueType::Float;
+            FillTypedValues(aFilter.Operator, values.FloatValues, outFilter.Floats);
+        }
+        return true;
+    }
+
+    template <typename TOptionals, typename T>
+    static void FillTypedValues(TFilterOperator aOperator, const TOptionals& aValues, TypedValues<T>& outValues)
+    {
+        if (aOperator != TFilterOperator::In)
+        {
+            outValues.Bound = aValues.front();
+            return;
+        }
+
+        Basis::Vector<T> values;
+        bool hasNull = false;
+        for (const auto& value : aValues)
+        {
+            if (value)
+            {
+                values.push_back(*value);
+            }
+            else
+            {
+                hasNull = true;
+            }
+        }
+        outValues.InValues.Init(std::move(values), hasNull);
+    }
+
+    /// Незаполненное значение меньше любого заполненного, как у std::optional.
+    template <typename T>
+    static bool IsLess(const T* aLhs, const T* aRhs)
+    {
+        if (!aRhs)
+        {
+            return false;
+        }
+        if (!aLhs)
+        {
+            return true;
+        }
+        return *aLhs < *aRhs;
+    }
+
+    template <typename T>
+    static bool CheckTyped(TFilterOperator aOperator, const TypedValues<T>& aValues, const T* aField)
+    {
+        switch (aOperator)
+        {
+        case TFilterOperator::In:
+            return aValues.Contains(aField);
+        case TFilterOperator::GreaterEq:
+            return !IsLess(aField, aValues.GetBound());
+        case TFilterOperator::LessEq:
+            return !IsLess(aValues.GetBound(), aField);
+        case TFilterOperator::Greater:
+            return IsLess(aValues.GetBound(), aField);
+        case TFilterOperator::Less:
+            return IsLess(aField, aValues.GetBound());
+        }
+        return false;
+    }
+
+    template <typename TOptional>
+    static auto GetPointer(const TOptional& aValue)
+    {
+        return aValue ? &*aValue : nullptr;
+    }
+
+    static bool CheckValue(const CompiledFilter& aFilter, const TCellVariant& aValue, bool& outOk)
+    {
+        using namespace TradingSerialization::Table;
+
+        if (aFilter.Kind == FilterKind::Interpreted)
+        {
+            return LocalStoreUtils::CheckOperation(aFilter.Values, aValue, aFilter.Operator, outOk);
+        }
+
+        switch (aFilter.Type)
+        {
+        case TValueType::String:
+            if (const auto* value = boost::get<TString>(&aValue))
+            {
+                return CheckTyped(aFilter.Operator, aFilter.Strings, GetPointer(*value));
+            }
+            break;
+        case TValueType::Int:
+            if (const auto* value = boost::get<TInt>(&aValue))
+            {
+                return CheckTyped(aFilter.Operator, aFilter.Ints, GetPointer(*value));
+            }
+            break;
+        case TValueType::Float:
+            if (const auto* value = boost::get<TFloat>(&aValue))
+            {
+                return CheckTyped(aFilter.Operator, aFilter.Floats, GetPointer(*value));
+            }
+            break;
+        default:
+            break;
+        }
+
+        outOk = false;
+        return false;
+    }
+
+    template <typename TColumns>
+    static bool CheckColumnValue(
+        const CompiledFilter& aFilter,
+        const TColumns& aColumns,
+        const typename TColumns::Column& aColumn,
+        typename TColumns::TRow aRow,
+        bool& outOk)
+    {
+        if (aFilter.Kind == FilterKind::Interpreted)
+        {
+            return LocalStoreUtils::CheckOperation(aFilter.Values, aColumns.GetValue(aColumn, aRow), aFilter.Operator, outOk);
+        }
+
+        if (aColumn.Type != aFilter.Type)
+        {
+            outOk = false;
+            return false;
+        }
+
+        switch (aFilter.Type)
+        {
+        case TValueType::String:
+            return CheckTyped(aFilter.Operator, aFilter.Strings, aColumns.GetString(aColumn, aRow));
+        case TValueType::Int:
+        {
+            const auto value = aColumns.GetInt(aColumn, aRow);
+            return CheckTyped(aFilter.Operator, aFilter.Ints, GetPointer(value));
+        }
+        case TValueType::Float:
+        {
+            const auto value = aColumns.GetFloat(aColumn, aRow);
+            return CheckTyped(aFilter.Operator, aFilter.Floats, GetPointer(value));
+        }
+        default:
+            break;
+        }
+
+        outOk = false;
+        return false;
+    }
+};
+
+}
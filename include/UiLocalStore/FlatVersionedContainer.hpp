@@ -0,0 +1,786 @@
+#pragma once
+
+#include "UiLocalStore/VersionedDataContainer.hpp"
+#include "UiLocalStore/ColumnarSnapshot.hpp"
+#include "UiLocalStore/SetupTraits.hpp"
+#include "UiLocalStore/VersionDeltaCache.hpp"
+
+#include <Common/Collections.hpp>
+#include <Common/Tracer.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Хеш-таблица с открытой адресацией из id в номер ячейки.
+ * \ingroup NewUiServer
+ * Записи хранятся в одном массиве, коллизии разрешаются линейным пробированием.
+ * Удаление выполняется сдвигом следующих записей, поэтому надгробия не нужны.
+ */
+template <typename TId, typename THasher>
+class FlatIdIndex
+{
+public:
+    using TSlot = uint32_t;
+    static constexpr TSlot NoSlot = std::numeric_limits<TSlot>::max();
+
+private:
+    static constexpr size_t MinCapacity = 16;
+
+    struct Entry
+    {
+        TId Id {};
+        TSlot Slot = NoSlot;
+    };
+
+    Basis::Vector<Entry> mEntries;
+    size_t mSize = 0;
+    size_t mMask = 0;
+    int mShift = 64;
+
+public:
+    TSlot Find(const TId& aId) const
+    {
+        if (mEntries.empty())
+        {
+            return NoSlot;
+        }
+        for (auto position = GetHome(aId); ; position = (position + 1) & mMask)
+        {
+            const auto& entry = mEntries[position];
+            if (entry.Slot == NoSlot)
+            {
+                return NoSlot;
+            }
+            if (entry.Id == aId)
+            {
+                return entry.Slot;
+            }
+        }
+    }
+
+    /**
+     * \brief Добавить id, которого еще нет в таблице.
+     */
+    void Insert(const TId& aId, TSlot aSlot)
+    {
+        assert(aSlot != NoSlot);
+        assert(Find(aId) == NoSlot);
+
+        if ((mSize + 1) * 4 > mEntries.size() * 3)
+        {
+            Rehash(std::max(MinCapacity, mEntries.size() * 2));
+        }
+        InsertInternal(aId, aSlot);
+        ++mSize;
+    }
+
+    void Erase(const TId& aId)
+    {
+        if (mEntries.empty())
+        {
+            return;
+        }
+
+        auto position = GetHome(aId);
+        while (mEntries[position].Slot != NoSlot && !(mEntries[position].Id == aId))
+        {
+            position = (position + 1) & mMask;
+        }
+        if (mEntries[position].Slot == NoSlot)
+        {
+            return;
+        }
+
+        /// Сдвигаем назад записи, которые были смещены из-за удаляемой.
+        auto next = position;
+        while (true)
+        {
+            next = (next + 1) & mMask;
+            if (mEntries[next].Slot == NoSlot)
+            {
+                break;
+            }
+            const auto home = GetHome(mEntries[next].Id);
+            const auto isInPlace = position <= next
+                ? (position < home && home <= next)
+                : (position < home || home <= next);
+            if (!isInPlace)
+            {
+                mEntries[position] = std::move(mEntries[next]);
+                position = next;
+            }
+        }
+        mEntries[position] = Entry {};
+        --mSize;
+    }
+
+    size_t Size() const
+    {
+        return mSize;
+    }
+
+    void Clear()
+    {
+        mEntries.clear();
+        mSize = 0;
+        mMask = 0;
+        mShift = 64;
+    }
+
+private:
+    size_t GetHome(const TId& aId) const
+    {
+        /// Перемешивание Фибоначчи: std::hash для целых чисел не меняет значение.
+        const auto hash = static_cast<uint64_t>(THasher {}(aId));
+        return static_cast<size_t>((hash * 11400714819323198485ull) >> mShift);
+    }
+
+    void InsertInternal(const TId& aId, TSlot aSlot)
+    {
+        auto position = GetHome(aId);
+        while (mEntries[position].Slot != NoSlot)
+        {
+            position = (position + 1) & mMask;
+        }
+        mEntries[position] = Entry { aId, aSlot };
+    }
+
+    void Rehash(size_t aCapacity)
+    {
+        auto entries = std::move(mEntries);
+        mEntries.assign(aCapacity, Entry {});
+        mMask = aCapacity - 1;
+        mShift = 64;
+        for (auto capacity = aCapacity; capacity > 1; capacity >>= 1)
+        {
+            --mShift;
+        }
+
+        for (const auto& entry : entries)
+        {
+            if (entry.Slot != NoSlot)
+            {
+                InsertInternal(entry.Id, entry.Slot);
+            }
+        }
+    }
+};
+
+/**
+ * \brief Версионированное хранилище на плоской хеш-таблице.
+ * \ingroup NewUiServer
+ * Альтернатива BaseMultiIndexContainer с тем же интерфейсом TMap:
+ * - id отображается в ячейку открытой хеш-таблицей FlatIdIndex;
+ * - ячейка хранит цепочку версий элемента, ячейки не перемещаются и переиспользуются после удаления;
+ * - вместо индексов по версии и по IsRewritedBy ведутся журналы добавленных и удаленных ячеек по версиям.
+ * Вставка не выделяет узлов деревьев, поэтому быстрее и требует меньше памяти на строку.
+ * Диапазоны возвращают элементы в том же порядке, что и BaseMultiIndexContainer:
+ * снапшот по id, инкремент по версиям и по id внутри версии. Для этого номера ячеек сортируются по id
+ * при инициализации диапазона.
+ * Пользовательских индексов нет: все фильтры проверяются построчно.
+ * Аллокатор узлов (TNodeAllocator) не поддерживается, так как узлов нет.
+ */
+template <typename TContainerSetup>
+class FlatVersionedContainer
+{
+public:
+    using TData = typename TContainerSetup::TData;
+    using TId = typename TData::TId;
+    using TDataItem = VersionedItem<TData>;
+    using TIdHasher = typename IdHasherOf<TContainerSetup, TId>::Type;
+    using TIdIndex = FlatIdIndex<TId, TIdHasher>;
+    using TSlot = typename TIdIndex::TSlot;
+
+    /// Колоночный снимок ведется, только если он объявлен в TContainerSetup.
+    using TColumns = typename ColumnarSnapshotOf<TContainerSetup>::Type;
+    /// Кэш изменений по версиям ведется, только если он объявлен в TContainerSetup.
+    using TVersionDeltas = typename VersionDeltaCacheOf<TContainerSetup>::Type;
+    static constexpr bool UseVersionDeltas = HasVersionDeltaCache<TContainerSetup>::value;
+
+    static_assert(std::is_same_v<typename NodeAllocatorOf<TContainerSetup, TDataItem>::Type, std::allocator<TDataItem>>,
+        "FlatVersionedContainer does not allocate nodes, TNodeAllocator is not supported");
+
+private:
+    struct Slot
+    {
+        TId Id {};
+        /// Версии элемента по возрастанию.
+        Basis::Vector<TDataItem> Versions;
+    };
+
+    /// Ячейки, затронутые одной версией.
+    struct VersionLog
+    {
+        Basis::Vector<TSlot> Added;
+        Basis::Vector<TSlot> Deleted;
+    };
+
+    /// Ячейка из журнала версии Version.
+    struct LogPosition
+    {
+        TSlot Slot;
+        TDataVersion Version;
+    };
+
+    using TPositions = Basis::Vector<LogPosition>;
+
+    TIdIndex mIndex;
+    Basis::Vector<Slot> mSlots;
+    Basis::Vector<TSlot> mFreeSlots;
+
+    Basis::Deque<VersionLog> mLogs;
+    TDataVersion mFirstLogVersion { 0 };
+
+    size_t mItemsCount = 0;
+
+    Basis::Tracer& mTracer;
+
+    TColumns mColumns;
+    TVersionDeltas mDeltas;
+
+    Basis::DateTime mStartTime;
+
+public:
+    FlatVersionedContainer(Basis::Tracer& aTracer)
+        : mTracer(aTracer)
+        , mColumns(aTracer)
+        , mDeltas(aTracer)
+    {}
+
+    void Emplace(const Basis::SPtr<TData>& aData, TDataVersion aVersion)
+    {
+        auto slot = mIndex.Find(aData->GetId());
+        if (slot == TIdIndex::NoSlot)
+        {
+            slot = AllocateSlot(aData->GetId());
+        }
+
+        auto& versions = mSlots[slot].Versions;
+        if (!versions.empty())
+        {
+            auto& previous = versions.back();
+            assert(previous.Version < aVersion);
+            if (previous.Version >= aVersion)
+            {
+                return;
+            }
+            if (previous.IsRewritedBy != aVersion)
+            {
+                GetLog(aVersion).Deleted.push_back(slot);
+            }
+            previous.IsRewritedBy = aVersion;
+        }
+
+        versions.emplace_back(aData, aVersion);
+        GetLog(aVersion).Added.push_back(slot);
+        ++mItemsCount;
+        mColumns.Append(aData, aVersion);
+    }
+
+    void Erase(TId aId, TDataVersion aVersion)
+    {
+        const auto slot = mIndex.Find(aId);
+        if (slot == TIdIndex::NoSlot)
+        {
+            mTracer.InfoSlow("Erase failed:", aId);
+            return;
+        }
+
+        auto& versions = mSlots[slot].Versions;
+        auto& last = versions.back();
+        /// Ячейка уже в журнале, если эта же версия перезаписала предыдущий элемент.
+        const auto isLogged = last.IsRewritedBy == aVersion
+            || (versions.size() > 1 && versions[versions.size() - 2].IsRewritedBy == aVersion);
+        if (!isLogged)
+        {
+            GetLog(aVersion).Deleted.push_back(slot);
+        }
+        last.IsRewritedBy = aVersion;
+        mColumns.MarkRewrited(aId, aVersion);
+    }
+
+    /**
+     * \brief Удалить элементы, перезаписанные версиями до aVersion.
+     * Проходятся только ячейки из журналов удаления этих версий.
+     */
+    void ErasePrevious(TDataVersion aVersion)
+    {
+        mTracer.InfoSlow("Erase previous:", aVersion);
+
+        while (!mLogs.empty() && mFirstLogVersion < aVersion)
+        {
+            for (const auto slot : mLogs.front().Deleted)
+            {
+                ErasePreviousInSlot(slot, aVersion);
+            }
+            mLogs.pop_front();
+            ++mFirstLogVersion;
+        }
+        mColumns.ErasePrevious(aVersion);
+        mColumns.TryCompact();
+        mDeltas.ErasePrevious(aVersion);
+    }
+
+    /**
+     * \brief Выполнить отложенное уплотнение колоночного снимка.
+     */
+    void CompactColumns()
+    {
+        mColumns.TryCompact();
+    }
+
+    size_t Size() const
+    {
+        return mItemsCount;
+    }
+
+    void Clear()
+    {
+        mIndex.Clear();
+        mSlots.clear();
+        mFreeSlots.clear();
+        mLogs.clear();
+        mFirstLogVersion = 0;
+        mItemsCount = 0;
+        mColumns.Clear();
+        mDeltas.Clear();
+        mStartTime = Basis::DateTime {};
+    }
+
+    Basis::DateTime GetMinTime() const
+    {
+        return mStartTime;
+    }
+
+    /**
+     * \brief Загрузить пакет элементов одной версии.
+     */
+    void BulkLoad(Basis::Vector<Basis::SPtr<TData>>&& aItems, TDataVersion aVersion)
+    {
+        for (const auto& item : aItems)
+        {
+            Emplace(item, aVersion);
+        }
+    }
+
+    void ProcessInitialPack() {}
+
+    /**
+     * \brief Версия aVersion применена полностью.
+     * Если ведется кэш изменений, строки из журналов этой версии собираются один раз в порядке id.
+     * Первая версия содержит весь снимок, поэтому инкремент к ней строится по журналам без копирования.
+     */
+    void CommitVersion(TDataVersion aVersion)
+    {
+        if constexpr (UseVersionDeltas)
+        {
+            if (aVersion <= 1)
+            {
+                return;
+            }
+
+            typename TVersionDeltas::TDataPack added;
+            typename TVersionDeltas::TDataPack deleted;
+            if (const auto* log = FindLog(aVersion))
+            {
+                for (const auto& position : MakeSortedPositions(log->Added, aVersion))
+                {
+                    CollectItems(position, &IsAddedBy, added);
+                }
+                for (const auto& position : MakeSortedPositions(log->Deleted, aVersion))
+                {
+                    CollectItems(position, &IsRewritedBy, deleted);
+                }
+            }
+
+            mDeltas.Commit(aVersion, std::move(added), std::move(deleted));
+        }
+    }
+
+    const TVersionDeltas& GetVersionDeltas() const
+    {
+        return mDeltas;
+    }
+
+    const TColumns& GetColumns() const
+    {
+        return mColumns;
+    }
+
+    /**
+     * \brief Диапазоны данных хранилища.
+     * \implements IDataRanges
+     * Инициализируются так же, как диапазоны BaseMultiIndexContainer.
+     */
+    template <typename TSetup>
+    class IndexRanges
+    {
+    public:
+        using TMap = FlatVersionedContainer;
+        using TUiFilters = TradingSerialization::Table::FilterGroup;
+
+        /**
+         * \brief Параметры диапазонов.
+         * Инкремент (IncrementAction) строится по версиям [FromVersion, Version], по умолчанию по одной версии Version.
+         */
+        struct TInit
+        {
+            const TMap& Map;
+            const TUiFilters& FilterExpression;
+            std::optional<Model::ActionType> IncrementAction;
+            TDataVersion Version;
+            TDataVersion FromVersion;
+
+            TInit(
+                const TMap& aMap,
+                const TUiFilters& aFilterExpression,
+                std::optional<Model::ActionType> aIncrementAction,
+                TDataVersion aVersion)
+                : TInit(aMap, aFilterExpression, aIncrementAction, aVersion, aVersion)
+            {}
+
+            TInit(
+                const TMap& aMap,
+                const TUiFilters& aFilterExpression,
+                std::optional<Model::ActionType> aIncrementAction,
+                TDataVersion aVersion,
+                TDataVersion aFromVersion)
+                : Map(aMap)
+                , FilterExpression(aFilterExpression)
+                , IncrementAction(aIncrementAction)
+                , Version(aVersion)
+                , FromVersion(aFromVersion)
+            {}
+        };
+
+    private:
+        enum class RangeType
+        {
+            Id,
+            Added,
+            Deleted,
+            Delta,
+            Nothing
+        };
+
+        const TMap* mMap = nullptr;
+        RangeType mRangeType = RangeType::Nothing;
+        TDataVersion mVersion { 0 };
+        /// Первая версия инкремента.
+        TDataVersion mFromVersion { 0 };
+
+        /// Ячейки диапазона в порядке выдачи и позиция в цепочке версий текущей ячейки.
+        TPositions mPositions;
+        size_t mPosition = 0;
+        size_t mItemPosition = 0;
+
+        /// Изменения версии из кэша хранилища, если они там есть.
+        typename TVersionDeltas::TDeltaPtr mDelta;
+        const Basis::Pack<TData>* mDeltaRows = nullptr;
+        size_t mDeltaPosition = 0;
+
+        Basis::Tracer& mTracer;
+
+    public:
+        IndexRanges(Basis::Tracer& aTracer)
+            : mTracer(aTracer)
+        {}
+
+        bool IsInitialized() const
+        {
+            return mRangeType != RangeType::Nothing;
+        }
+
+        bool Init(const TInit& aInit)
+        {
+            assert(!IsInitialized());
+
+            mMap = &aInit.Map;
+            mVersion = aInit.Version;
+            mFromVersion = aInit.FromVersion;
+            assert(mFromVersion <= mVersion);
+            mPositions.clear();
+            mPosition = 0;
+            mItemPosition = 0;
+
+            if (!aInit.IncrementAction)
+            {
+                InitIdRange();
+                return true;
+            }
+
+            if (aInit.IncrementAction == Model::ActionType::New)
+            {
+                InitLogRange(RangeType::Added, &VersionLog::Added, &VersionDelta<TData>::Added);
+                mTracer.InfoSlow("FlatVersionedContainer.Init added by versions", mFromVersion, "-", mVersion);
+                return true;
+            }
+
+            if (aInit.IncrementAction == Model::ActionType::Delete)
+            {
+                InitLogRange(RangeType::Deleted, &VersionLog::Deleted, &VersionDelta<TData>::Deleted);
+                mTracer.InfoSlow("FlatVersionedContainer.Init deleted by versions:", mFromVersion, "-", mVersion);
+                return true;
+            }
+
+            assert(false);
+            return false;
+        }
+
+        void Reset()
+        {
+            mMap = nullptr;
+            mRangeType = RangeType::Nothing;
+            mPositions.clear();
+            mPosition = 0;
+            mItemPosition = 0;
+            mDelta = nullptr;
+            mDeltaRows = nullptr;
+            mDeltaPosition = 0;
+        }
+
+        Basis::SPtr<TData> GetNext()
+        {
+            switch (mRangeType)
+            {
+            case RangeType::Id:
+                return GetNextById();
+            case RangeType::Added:
+                return GetNextByLog([this](const TDataItem& aItem, TDataVersion aVersion)
+                {
+                    /// Из нескольких изменений строки за интервал версий берется последнее.
+                    return IsAddedBy(aItem, aVersion)
+                        && (mFromVersion == mVersion || !aItem.IsRewritedBy || *aItem.IsRewritedBy > mVersion);
+                });
+            case RangeType::Deleted:
+                return GetNextByLog([this](const TDataItem& aItem, TDataVersion aVersion)
+                {
+                    /// Строки, добавленные и перезаписанные внутри интервала, подписке не известны.
+                    return IsRewritedBy(aItem, aVersion)
+                        && (mFromVersion == mVersion || aItem.Version < mFromVersion);
+                });
+            case RangeType::Delta:
+                if (mDeltaPosition >= mDeltaRows->size())
+                {
+                    return nullptr;
+                }
+                return (*mDeltaRows)[mDeltaPosition++];
+            default:
+                mTracer.Error("FlatVersionedContainer.GetNext uninitialized");
+                assert(false);
+                break;
+            }
+            return nullptr;
+        }
+
+    private:
+        void InitIdRange()
+        {
+            const auto& slots = mMap->mSlots;
+            mPositions.reserve(slots.size() - mMap->mFreeSlots.size());
+            for (TSlot slot = 0; slot < slots.size(); ++slot)
+            {
+                if (!slots[slot].Versions.empty())
+                {
+                    mPositions.push_back(LogPosition { slot, mVersion });
+                }
+            }
+            mMap->SortById(mPositions, 0);
+            mRangeType = RangeType::Id;
+            mTracer.InfoSlow("FlatVersionedContainer.Init by id: ", mPositions.size());
+        }
+
+        /**
+         * \brief Ячейки из журналов версий [mFromVersion, mVersion], внутри версии в порядке id.
+         * Изменения одной версии берутся из кэша хранилища, если они там есть.
+         */
+        void InitLogRange(
+            RangeType aRangeType,
+            Basis::Vector<TSlot> VersionLog::* aSlots,
+            Basis::Pack<TData> VersionDelta<TData>::* aRows)
+        {
+            if (mFromVersion == mVersion)
+            {
+                mDelta = mMap->mDeltas.Find(mVersion);
+                if (mDelta)
+                {
+                    mDeltaRows = &((*mDelta).*aRows);
+                    mDeltaPosition = 0;
+                    mRangeType = RangeType::Delta;
+                    return;
+                }
+            }
+
+            for (auto version = mFromVersion; version <= mVersion; ++version)
+            {
+                if (const auto* log = mMap->FindLog(version))
+                {
+                    const auto begin = mPositions.size();
+                    for (const auto slot : log->*aSlots)
+                    {
+                        mPositions.push_back(LogPosition { slot, version });
+                    }
+                    mMap->SortById(mPositions, begin);
+                }
+            }
+            mRangeType = aRangeType;
+        }
+
+        Basis::SPtr<TData> GetNextById()
+        {
+            const auto& slots = mMap->mSlots;
+            while (mPosition < mPositions.size())
+            {
+                for (const auto& item : slots[mPositions[mPosition++].Slot].Versions)
+                {
+                    if (!item.IsRewritedBy || *item.IsRewritedBy > mVersion)
+                    {
+                        return item.Item;
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * \brief Следующий элемент ячеек журнала.
+         * Одна ячейка может отдать несколько элементов, например, перезаписанный и удаленный одной версией.
+         */
+        template <typename TCheck>
+        Basis::SPtr<TData> GetNextByLog(const TCheck& aCheck)
+        {
+            const auto& slots = mMap->mSlots;
+            while (mPosition < mPositions.size())
+            {
+                const auto& position = mPositions[mPosition];
+                const auto& versions = slots[position.Slot].Versions;
+                while (mItemPosition < versions.size())
+                {
+                    const auto& item = versions[mItemPosition++];
+                    if (aCheck(item, position.Version))
+                    {
+                        return item.Item;
+                    }
+                }
+                ++mPosition;
+                mItemPosition = 0;
+            }
+            return nullptr;
+        }
+    };
+
+private:
+    TSlot AllocateSlot(const TId& aId)
+    {
+        TSlot slot;
+        if (!mFreeSlots.empty())
+        {
+            slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<TSlot>(mSlots.size());
+            mSlots.emplace_back();
+        }
+        mSlots[slot].Id = aId;
+        mIndex.Insert(aId, slot);
+        return slot;
+    }
+
+    void ErasePreviousInSlot(TSlot aSlot, TDataVersion aVersion)
+    {
+        auto& slot = mSlots[aSlot];
+        const auto size = slot.Versions.size();
+        slot.Versions.erase(
+            std::remove_if(slot.Versions.begin(), slot.Versions.end(), [aVersion](const TDataItem& aItem)
+            {
+                return aItem.IsRewritedBy && *aItem.IsRewritedBy < aVersion;
+            }),
+            slot.Versions.end());
+        mItemsCount -= size - slot.Versions.size();
+
+        if (slot.Versions.empty() && size)
+        {
+            mIndex.Erase(slot.Id);
+            slot.Versions.shrink_to_fit();
+            mFreeSlots.push_back(aSlot);
+        }
+    }
+
+    static bool IsAddedBy(const TDataItem& aItem, TDataVersion aVersion)
+    {
+        return aItem.Version == aVersion;
+    }
+
+    static bool IsRewritedBy(const TDataItem& aItem, TDataVersion aVersion)
+    {
+        return aItem.IsRewritedBy == aVersion;
+    }
+
+    /**
+     * \brief Упорядочить по id ячейки, начиная с позиции aBegin.
+     */
+    void SortById(TPositions& outPositions, size_t aBegin) const
+    {
+        std::sort(outPositions.begin() + aBegin, outPositions.end(), [this](const auto& aLhs, const auto& aRhs)
+        {
+            return mSlots[aLhs.Slot].Id < mSlots[aRhs.Slot].Id;
+        });
+    }
+
+    TPositions MakeSortedPositions(const Basis::Vector<TSlot>& aSlots, TDataVersion aVersion) const
+    {
+        TPositions positions;
+        positions.reserve(aSlots.size());
+        for (const auto slot : aSlots)
+        {
+            positions.push_back(LogPosition { slot, aVersion });
+        }
+        SortById(positions, 0);
+        return positions;
+    }
+
+    template <typename TCheck>
+    void CollectItems(const LogPosition& aPosition, const TCheck& aCheck, Basis::Pack<TData>& outItems) const
+    {
+        for (const auto& item : mSlots[aPosition.Slot].Versions)
+        {
+            if (aCheck(item, aPosition.Version))
+            {
+                outItems.push_back(item.Item);
+            }
+        }
+    }
+
+    VersionLog& GetLog(TDataVersion aVersion)
+    {
+        if (mLogs.empty())
+        {
+            mFirstLogVersion = aVersion;
+        }
+        assert(aVersion >= mFirstLogVersion);
+        const auto index = static_cast<size_t>(aVersion - mFirstLogVersion);
+        if (index >= mLogs.size())
+        {
+            mLogs.resize(index + 1);
+        }
+        return mLogs[index];
+    }
+
+    const VersionLog* FindLog(TDataVersion aVersion) const
+    {
+        if (aVersion < mFirstLogVersion
+            || aVersion - mFirstLogVersion >= static_cast<TDataVersion>(mLogs.size()))
+        {
+            return nullptr;
+        }
+        return &mLogs[static_cast<size_t>(aVersion - mFirstLogVersion)];
+    }
+};
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
+
 #include <Common/Interface.hpp>
 #include <Common/InterfaceGenerator.hpp>
 
@@ -31,4 +33,22 @@ struct IFairOperation
     };
 };
 
+/**
+ * \brief Число строк, просмотренных последним вызовом Process операции.
+ * \ingroup NewUiServer
+ * Операция сообщает его методом GetSliceRows, для остальных операций - 0.
+ */
+template <typename TImpl, typename TPerformer>
+size_t GetSliceRows(TPerformer& aOperation)
+{
+    if constexpr (HasSliceRows<TImpl>::value)
+    {
+        return aOperation.Get().GetSliceRows();
+    }
+    else
+    {
+        return 0;
+    }
+}
+
 }
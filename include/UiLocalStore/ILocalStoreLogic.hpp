@@ -28,9 +28,17 @@ struct ILocalStoreLogic
             const TUiSubscription::TId& /* aRequestId */,
             const TUiSubscription& /* aSubscription */)
 
+        API_METHOD_RETURN(std::optional<TableProcessorRejectType>, ModifySubscription,
+            const TUiSubscription::TId& /* aRequestId */,
+            const TUiSubscription& /* aSubscription */)
+
         API_METHOD(ProcessUnsubscription,
             const TUiSubscription::TId& /* aRequestId */)
 
+        API_METHOD(ProcessRowWindow,
+            const TUiSubscription::TId& /* aRequestId */,
+            const TradingSerialization::Table::RowRange& /* aRows */)
+
         API_METHOD_RETURN(Basis::Vector<TUiSubscription::TId>, Clear)
         API_METHOD_RETURN(Basis::Vector<TUiSubscription::TId>, GetRejectedSubscriptions)
 
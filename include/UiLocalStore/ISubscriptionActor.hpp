@@ -31,6 +31,8 @@ struct ISubscriptionActor
 
         API_METHOD_RETURN(bool, Process)
         API_METHOD(IncreaseVersion)
+        API_METHOD(SkipVersion)
+        API_METHOD(JumpToVersion, TDataVersion /* aVersion */)
         API_METHOD_RETURN(bool, ProcessGetNext)
     };
 };
@@ -37,6 +37,8 @@ struct ISubscriptionStateMachine
         RawDataUpdated,     ///< Подписка готова к обработке после обновления.
         IncrementMade,      ///< Инкремент создан.
         IncrementApplied,   ///< Инкремент применен.
+        SubscriptionModified,///< Изменены фильтры или порядок сортировки.
+        RowWindowChanged,   ///< Окно строк нужно досортировать или отправить заново.
         ErrorOccured,       ///< Произошла ошибка.
     };
 
@@ -161,6 +163,10 @@ inline std::ostream& operator<<(std::ostream& out, ISubscriptionStateMachine::Ta
         return out << "IncrementMade";
     case ISubscriptionStateMachine::TableEvent::IncrementApplied:
         return out << "IncrementApplied";
+    case ISubscriptionStateMachine::TableEvent::SubscriptionModified:
+        return out << "SubscriptionModified";
+    case ISubscriptionStateMachine::TableEvent::RowWindowChanged:
+        return out << "RowWindowChanged";
     case ISubscriptionStateMachine::TableEvent::ErrorOccured:
         return out << "ErrorOccured";
     default:
@@ -4,6 +4,7 @@
 #include <NewUiServer/UiLocalStore/ITableProcessorApi.hpp>
 #include <NewUiServer/UiLocalStore/ISubscriptionActor.hpp>
 
+#include "UiLocalStore/SubscriptionKey.hpp"
 #include "UiLocalStore/VersionedDataContainer.hpp"
 
 #include <Common/Collections.hpp>
@@ -23,8 +24,13 @@ struct ISubscriptionsContainer
         bool Processed = false;
         ISubscriptionActor::ResultState ResultState = ISubscriptionActor::ResultState::NoResult;
         std::optional<TSubscriptionId> SubscriptionId;
+        /// Другие подписки, которым отправляется тот же результат.
+        Basis::Vector<TSubscriptionId> SharedSubscriptionIds;
         Basis::SPtrPack<TData> Result;
         Basis::Vector<int64_t> DeletedIds;
+        /// Если задано, Result содержит только строки этого окна из RowCount строк результата.
+        std::optional<TradingSerialization::Table::RowRange> Rows;
+        int64_t RowCount = 0;
 
         bool IsOk() const
         {
@@ -46,12 +52,41 @@ struct ISubscriptionsContainer
         API_METHOD_TEMPLATE_TYPE_RETURN(TSubscriptionPtr, bool, EmplaceSubscription,
             const TSubscriptionPtr& /* aSubscription */)
 
+        API_METHOD_TEMPLATE_TYPE_RETURN(TSubscriptionPtr, bool, EmplaceSharedSubscription,
+            const TSubscriptionPtr& /* aSubscription */,
+            const SubscriptionKey& /* aKey */)
+
+        API_METHOD_RETURN(bool, ShareSubscription,
+            const TSubscriptionId& /* aRequestId */,
+            const SubscriptionKey& /* aKey */)
+
+        API_METHOD_TEMPLATE_TYPE_RETURN(TSubscriptionPtr, bool, SeedSubscription,
+            const TSubscriptionPtr& /* aSubscription */,
+            TDataVersion /* aVersion */)
+
+        API_METHOD_RETURN(bool, ModifySubscription,
+            const TSubscriptionId& /* aRequestId */,
+            const TradingSerialization::Table::SubscribeBase& /* aSubscription */)
+
+        API_METHOD_RETURN(bool, SetRowWindow,
+            const TSubscriptionId& /* aRequestId */,
+            const TradingSerialization::Table::RowRange& /* aRows */)
+
         API_METHOD(EraseSubscription,
             const TSubscriptionId& /* aRequestId */)
 
+        API_METHOD_RETURN(bool, TransferOwnership,
+            const TSubscriptionId& /* aRequestId */)
+
         API_METHOD_RETURN(Basis::Vector<TSubscriptionId>, Clear)
         API_METHOD_RETURN(Basis::Vector<TSubscriptionId>, GetRejectedSubscriptions)
 
+        API_METHOD_TEMPLATE_TYPE(
+            TDeltaPtr,
+            AddVersionDelta,
+            TDataVersion /* aVersion */,
+            const TDeltaPtr& /* aDelta */)
+
 
         API_METHOD_RETURN(bool, UpdateSubscriptions, TDataVersion /*aCurrentVersion*/)
         API_METHOD_TEMPLATE_SPEC_TYPE_RETURN(
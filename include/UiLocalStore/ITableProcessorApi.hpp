@@ -1,6 +1,7 @@
 #pragma once
 
 #include <NewUiServer/UiSession.hpp>
+#include <TradingSerialization/Table/RowRange.hpp>
 #include <TradingSerialization/Table/Subscription.hpp>
 
 #include <Trading/Model/ActionType.hpp>
@@ -135,6 +136,12 @@ struct ITableProcessorApi
             const TQueryId& /* aRequestId */,
             const TDataSPtrPack& /* aData */)
 
+        API_METHOD(SendRowWindowSnapshot,
+            const TQueryId& /* aRequestId */,
+            const TradingSerialization::Table::RowRange& /* aRows */,
+            int64_t /* aRowCount */,
+            const TDataSPtrPack& /* aData */)
+
         API_METHOD(SendChunkSnapshot,
             const TQueryId& /* aRequestId */,
             const TDataSPtrPack& /* aData */,
@@ -162,6 +169,12 @@ struct ITableProcessorApi
             const Basis::SPtr<Model::Login>& /* aSessionLogin */,
             SubscriptionType /* aType */)
         API_METHOD(ProcessUnsubscription, const TQueryId& /* aRequestId */)
+        API_METHOD(ProcessModifySubscription,
+            const TQueryId& /* aRequestId */,
+            const TradingSerialization::Table::SubscribeBase& /* aSubscription */)
+        API_METHOD(ProcessRowWindow,
+            const TQueryId& /* aRequestId */,
+            const TradingSerialization::Table::RowRange& /* aRows */)
         API_METHOD(ProcessGetNext, const TQueryId& /* aRequestId */)
 
         API_METHOD(ProcessRecall, const Basis::DateTime& /* aNow */)
@@ -184,6 +197,12 @@ struct ITableProcessorApi
             SubscriptionType /* aType */)
         API_METHOD_RETURN(bool, Unsubscribe,
             const TQueryId& /* aRequestId */)
+        API_METHOD_RETURN(bool, ModifySubscription,
+            const TQueryId& /* aRequestId */,
+            const TradingSerialization::Table::SubscribeBase& /* aSubscription */)
+        API_METHOD_RETURN(bool, RequestRowWindow,
+            const TQueryId& /* aRequestId */,
+            const TradingSerialization::Table::RowRange& /* aRows */)
 
         API_METHOD(GetNext, const TQueryId& /* aRequestId */)
         API_METHOD(RecallSubscription, const TQueryId& /* aRequestId */)
@@ -201,6 +220,12 @@ struct ITableProcessorApi
             const TQueryId& /* aRequestId */,
             const TDataSPtrPack& /* aData */)
 
+        API_METHOD(ProcessRowWindowSnapshot,
+            const TQueryId& /* aRequestId */,
+            const TradingSerialization::Table::RowRange& /* aRows */,
+            int64_t /* aRowCount */,
+            const TDataSPtrPack& /* aData */)
+
         API_METHOD(ProcessChunkSnapshot,
             const TQueryId& /* aRequestId */,
             const TDataSPtrPack& /* aData */,
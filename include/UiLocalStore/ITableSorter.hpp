@@ -12,6 +12,9 @@ namespace NTPro::Ecn::NewUiServer
  * - на первом этапе весь массив данных разбивается на части фиксированного размера.
  * Каждая часть сортируется отдельно.
  * - на втором этапе выполняется последовательная сортировка слиянием всех частей массива.
+ * Сортировка по ключам (KeyedTableSorter) добавляет этапы извлечения ключей перед сортировкой
+ * и перестановки элементов после нее.
+ * Поразрядная сортировка (TableSorter с UseRadixSort) проходит этапы KeyExtraction, RadixSort и Permutation.
  */
 
 enum class TableSorterState
@@ -20,7 +23,10 @@ enum class TableSorterState
     PartSort,
     MergeSort,
     Completed,
-    Error
+    Error,
+    KeyExtraction,
+    Permutation,
+    RadixSort
 };
 
 using ITableSorter = IFairOperation<TableSorterState>;
@@ -39,6 +45,12 @@ inline std::ostream& operator<<(std::ostream& out, TableSorterState value)
         return out << "Completed";
     case TableSorterState::Error:
         return out << "Error";
+    case TableSorterState::KeyExtraction:
+        return out << "KeyExtraction";
+    case TableSorterState::Permutation:
+        return out << "Permutation";
+    case TableSorterState::RadixSort:
+        return out << "RadixSort";
     default:
         return out << "???";
     }
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Common/Collections.hpp>
+#include <Common/Real.hpp>
+
+#include <algorithm>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Проверка вхождения значения в список оператора In.
+ * \ingroup NewUiServer
+ * Строится один раз для подписки:
+ * - целые числа хранятся в отсортированном массиве без повторов и ищутся бинарным поиском;
+ * - строки хранятся в хеш-множестве;
+ * - короткие списки проверяются линейно, это быстрее поиска.
+ * Вещественные числа всегда проверяются линейно: сравнение Basis::Real выполняется с точностью
+ * и не допускает ни сортировки, ни хеширования без изменения семантики.
+ * Незаполненное значение входит в список, только если в списке есть незаполненное значение.
+ */
+template <typename T>
+class InFilterEvaluator
+{
+public:
+    /// Размер списка, до которого линейный проход быстрее поиска.
+    static constexpr size_t LinearScanLimit = 8;
+
+private:
+    static constexpr bool IsSorted = std::is_integral<T>::value;
+    static constexpr bool IsHashed = std::is_same<T, std::string>::value;
+
+    Basis::Vector<T> mValues;
+    /// Используется только для строк.
+    Basis::UnorderedSet<std::string> mHashedValues;
+    bool mHasNull = false;
+    bool mUseSearch = false;
+
+public:
+    void Init(Basis::Vector<T> aValues, bool aHasNull)
+    {
+        mValues = std::move(aValues);
+        mHashedValues.clear();
+        mHasNull = aHasNull;
+
+        if constexpr (IsSorted)
+        {
+            std::sort(mValues.begin(), mValues.end());
+            mValues.erase(std::unique(mValues.begin(), mValues.end()), mValues.end());
+        }
+        mUseSearch = (IsSorted || IsHashed) && mValues.size() > LinearScanLimit;
+
+        if constexpr (IsHashed)
+        {
+            if (mUseSearch)
+            {
+                mHashedValues.insert(std::make_move_iterator(mValues.begin()), std::make_move_iterator(mValues.end()));
+                mValues.clear();
+            }
+        }
+    }
+
+    /**
+     * \brief Проверить значение, nullptr означает незаполненное значение.
+     */
+    bool Contains(const T* aValue) const
+    {
+        if (!aValue)
+        {
+            return mHasNull;
+        }
+
+        if (mUseSearch)
+        {
+            if constexpr (IsSorted)
+            {
+                return std::binary_search(mValues.cbegin(), mValues.cend(), *aValue);
+            }
+            else if constexpr (IsHashed)
+            {
+                return mHashedValues.find(*aValue) != mHashedValues.cend();
+            }
+        }
+        return std::find(mValues.cbegin(), mValues.cend(), *aValue) != mValues.cend();
+    }
+
+    size_t Size() const
+    {
+        return mValues.size() + mHashedValues.size();
+    }
+};
+
+}
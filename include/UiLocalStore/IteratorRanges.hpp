@@ -7,6 +7,8 @@
 
 #include <Common/Pack.hpp>
 
+#include <algorithm>
+
 namespace NTPro::Ecn::NewUiServer
 {
 
@@ -79,4 +81,78 @@ private:
     }
 };
 
+/**
+ * \brief Наборы данных, сливаемые в общий порядок.
+ * \ingroup NewUiServer
+ * Каждый диапазон должен быть упорядочен по TLess, элементы всех диапазонов возвращаются в порядке TLess.
+ * Головы диапазонов хранятся в куче, поэтому Next выполняется за логарифм от числа диапазонов.
+ */
+template <typename TIterator, typename TLess>
+class MergedIteratorRanges
+{
+public:
+    /// Элементы возвращаются в порядке TLess, а не по очереди диапазонов.
+    static constexpr bool IsMerged = true;
+
+private:
+    /// Куча диапазонов, в начале - диапазон с наименьшей головой.
+    Basis::Vector<TIteratorRange<TIterator>> mRanges;
+    bool mIsStarted = false;
+
+public:
+    void Reset()
+    {
+        *this = MergedIteratorRanges {};
+    }
+
+    void Add(const TIteratorRange<TIterator>& aRange)
+    {
+        if (aRange.first == aRange.second)
+        {
+            return;
+        }
+        mRanges.push_back(aRange);
+        if (mIsStarted)
+        {
+            std::push_heap(mRanges.begin(), mRanges.end(), &MergedIteratorRanges::IsHeadGreater);
+        }
+    }
+
+    std::optional<TIterator> Next()
+    {
+        if (!mIsStarted)
+        {
+            std::make_heap(mRanges.begin(), mRanges.end(), &MergedIteratorRanges::IsHeadGreater);
+            mIsStarted = true;
+        }
+        else if (!mRanges.empty())
+        {
+            /// Продвигается диапазон, голова которого была возвращена последней.
+            std::pop_heap(mRanges.begin(), mRanges.end(), &MergedIteratorRanges::IsHeadGreater);
+            auto& range = mRanges.back();
+            if (++range.first == range.second)
+            {
+                mRanges.pop_back();
+            }
+            else
+            {
+                std::push_heap(mRanges.begin(), mRanges.end(), &MergedIteratorRanges::IsHeadGreater);
+            }
+        }
+
+        if (mRanges.empty())
+        {
+            Reset();
+            return std::nullopt;
+        }
+        return mRanges.front().first;
+    }
+
+private:
+    static bool IsHeadGreater(const TIteratorRange<TIterator>& aLhs, const TIteratorRange<TIterator>& aRhs)
+    {
+        return TLess()(*aRhs.first, *aLhs.first);
+    }
+};
+
 }
@@ -0,0 +1,402 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/ITableSorter.hpp>
+#include <NewUiServer/UiLocalStore/TableSorter.hpp>
+#include <NewUiServer/UiLocalStore/TableUtils.hpp>
+
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Common/Tracer.hpp>
+
+#include <Common/Pack.hpp>
+
+#include <algorithm>
+#include <optional>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Табличный сортировальщик по извлеченным ключам.
+ * \ingroup NewUiServer
+ * Значения колонок порядка сортировки извлекаются из каждого элемента один раз
+ * и хранятся в типизированных массивах по колонкам.
+ * Сортировка и слияние выполняются над номерами строк и сравнивают значения из этих массивов,
+ * без построения вариантов на каждом сравнении.
+ * В конце массив элементов переставляется в полученном порядке.
+ * Этапы: KeyExtraction, PartSort, MergeSort, Permutation.
+ * Каждый вызов Process обрабатывает не больше MaxCount строк, их число возвращает GetSliceRows.
+ * Инициализируется так же, как TableSorter.
+ */
+template <typename TSetup>
+class KeyedTableSorter
+{
+public:
+    static constexpr int MaxCount = TSetup::MaxCount;
+
+    using TData = typename TSetup::TData;
+    using TTableSetup = typename TSetup::TTableSetup;
+
+    using TDataPack = Basis::Pack<TData>;
+    using State = TableSorterState;
+
+    using TTableColumnType = typename TTableSetup::TTableColumnType;
+
+    using TSortOrder = TradingSerialization::Table::TSortOrder;
+    using TInit = typename TableSorter<TSetup>::TInit;
+
+private:
+    using TRow = uint32_t;
+    using TRows = Basis::Vector<TRow>;
+
+    using TCellVariant = TradingSerialization::Table::TCellVariant;
+    using TString = TradingSerialization::Table::TString;
+    using TInt = TradingSerialization::Table::TInt;
+    using TFloat = TradingSerialization::Table::TFloat;
+
+    /**
+     * \brief Значения одной колонки порядка сортировки.
+     * Тип колонки определяется по первому элементу.
+     * Заполняется только массив, соответствующий типу.
+     */
+    struct KeyColumn
+    {
+        TTableColumnType Column;
+        std::optional<int> Which;
+        Basis::Vector<TString> Strings;
+        Basis::Vector<TInt> Ints;
+        Basis::Vector<TFloat> Floats;
+    };
+
+    /**
+     * \brief Сравнение строк по извлеченным ключам.
+     * Незаполненное значение меньше любого заполненного, как и в SortOrderComparator.
+     */
+    struct KeyComparator
+    {
+        const Basis::Vector<KeyColumn>* Columns;
+
+        bool operator ()(TRow aLhs, TRow aRhs) const
+        {
+            for (const auto& column : *Columns)
+            {
+                int result = 0;
+                switch (*column.Which)
+                {
+                case 0:
+                    result = Compare(column.Strings[aLhs], column.Strings[aRhs]);
+                    break;
+                case 1:
+                    result = Compare(column.Ints[aLhs], column.Ints[aRhs]);
+                    break;
+                case 2:
+                    result = Compare(column.Floats[aLhs], column.Floats[aRhs]);
+                    break;
+                }
+                if (result != 0)
+                {
+                    return result < 0;
+                }
+            }
+            return false;
+        }
+
+        template <typename T>
+        static int Compare(const std::optional<T>& aLhs, const std::optional<T>& aRhs)
+        {
+            if (!aLhs || !aRhs)
+            {
+                return static_cast<int>(aLhs.has_value()) - static_cast<int>(aRhs.has_value());
+            }
+            if constexpr (std::is_same<T, std::string>::value)
+            {
+                return aLhs->compare(*aRhs);
+            }
+            else
+            {
+                if (*aLhs == *aRhs)
+                {
+                    return 0;
+                }
+                return *aLhs < *aRhs ? -1 : 1;
+            }
+        }
+    };
+
+    /**
+     * \brief Состояние слияния отсортированных частей.
+     */
+    struct MergeInfo
+    {
+        /// Размер сливаемых частей.
+        size_t Width = MaxCount;
+        /// Начало текущей пары частей.
+        size_t Begin = 0;
+        /// Текущие позиции в левой и правой частях, если слияние пары начато.
+        std::optional<std::pair<size_t, size_t>> Positions;
+        /// Позиция записи в целевой массив.
+        size_t Target = 0;
+    };
+
+    State mState = State::Initializing;
+
+    const TSortOrder* mSortOrder = nullptr;
+    TDataPack* mResult = nullptr;
+    TDataPack* mTmpBuffer = nullptr;
+
+    Basis::Vector<KeyColumn> mKeys;
+    TRows mRows;
+    TRows mTmpRows;
+    /// Позиция обработки на этапах KeyExtraction, PartSort и Permutation.
+    size_t mPosition = 0;
+    MergeInfo mMergeInfo;
+    /// Число строк, обработанных последним вызовом Process.
+    size_t mSliceRows = 0;
+
+    Basis::Tracer& mTracer;
+
+public:
+    KeyedTableSorter(Basis::Tracer& aTracer)
+        : mTracer(aTracer)
+    {
+    }
+
+    bool IsInitialized() const
+    {
+        return mState != State::Initializing;
+    }
+
+    void Init(const TInit& aInit)
+    {
+        assert(!IsInitialized());
+
+        mSortOrder = &aInit.SortOrder;
+        mResult = &aInit.Result;
+        mTmpBuffer = &aInit.TmpBuffer;
+
+        auto sortOrderError = TableUtils<TTableSetup>::CheckSortOrder(*mSortOrder);
+        if (!sortOrderError.empty())
+        {
+            mState = State::Error;
+            mTracer.ErrorSlow("KeyedTableSorter:", sortOrderError, ", ", *mSortOrder);
+            return;
+        }
+
+        const auto size = mResult->size();
+        mKeys.resize(mSortOrder->size());
+        for (size_t i = 0; i < mKeys.size(); ++i)
+        {
+            mKeys[i].Column = static_cast<TTableColumnType>((*mSortOrder)[i]);
+        }
+        mRows.reserve(size);
+        mTmpRows.resize(size);
+        mTmpBuffer->resize(size);
+        mState = State::KeyExtraction;
+    }
+
+    void Reset()
+    {
+        mSortOrder = nullptr;
+        mResult = nullptr;
+        mTmpBuffer = nullptr;
+
+        mKeys.clear();
+        mRows.clear();
+        mTmpRows.clear();
+        mPosition = 0;
+        mMergeInfo = MergeInfo {};
+        mSliceRows = 0;
+
+        mState = State::Initializing;
+    }
+
+    State Process()
+    {
+        mSliceRows = 0;
+        switch (mState)
+        {
+        case State::KeyExtraction:
+            ProcessKeyExtraction();
+            break;
+        case State::PartSort:
+            ProcessPartSort();
+            break;
+        case State::MergeSort:
+            ProcessMergeSort();
+            break;
+        case State::Permutation:
+            ProcessPermutation();
+            break;
+        default:
+            mTracer.ErrorSlow("KeyedSorter.Process: state is invalid:", mState);
+            mState = State::Error;
+            break;
+        }
+        return mState;
+    }
+
+    State GetState() const
+    {
+        return mState;
+    }
+
+    size_t GetSliceRows() const
+    {
+        return mSliceRows;
+    }
+
+private:
+    KeyComparator GetComparator() const
+    {
+        return KeyComparator { &mKeys };
+    }
+
+    void ProcessKeyExtraction()
+    {
+        const auto end = std::min(mResult->size(), mPosition + MaxCount);
+        mSliceRows = end - mPosition;
+        for (; mPosition < end; ++mPosition)
+        {
+            const auto& item = (*mResult)[mPosition];
+            for (auto& key : mKeys)
+            {
+                if (!AppendKey(key, item->GetValue(key.Column)))
+                {
+                    mState = State::Error;
+                    mTracer.ErrorSlow("KeyedSorter: column type mismatch:", key.Column);
+                    return;
+                }
+            }
+            mRows.push_back(static_cast<TRow>(mPosition));
+        }
+
+        if (mPosition == mResult->size())
+        {
+            mPosition = 0;
+            mState = State::PartSort;
+        }
+    }
+
+    static bool AppendKey(KeyColumn& outKey, TCellVariant&& aValue)
+    {
+        const auto which = aValue.which();
+        if (!outKey.Which)
+        {
+            outKey.Which = which;
+        }
+        else if (*outKey.Which != which)
+        {
+            return false;
+        }
+
+        switch (which)
+        {
+        case 0:
+            outKey.Strings.push_back(std::move(boost::get<TString>(aValue)));
+            break;
+        case 1:
+            outKey.Ints.push_back(boost::get<TInt>(aValue));
+            break;
+        case 2:
+            outKey.Floats.push_back(boost::get<TFloat>(aValue));
+            break;
+        }
+        return true;
+    }
+
+    void ProcessPartSort()
+    {
+        const auto end = std::min(mRows.size(), mPosition + MaxCount);
+        mSliceRows = end - mPosition;
+        std::sort(mRows.begin() + mPosition, mRows.begin() + end, GetComparator());
+        mPosition = end;
+
+        if (mPosition == mRows.size())
+        {
+            mPosition = 0;
+            mState = State::MergeSort;
+            TryFinishMerge();
+        }
+    }
+
+    /**
+     * \brief Очередная итерация слияния.
+     * Сливает пары соседних частей размера Width в mTmpRows, не больше MaxCount строк за вызов.
+     * Когда пройден весь массив, размер частей удваивается.
+     */
+    void ProcessMergeSort()
+    {
+        const auto size = mRows.size();
+        const auto comparator = GetComparator();
+        auto& info = mMergeInfo;
+
+        int counter = 0;
+        while (counter < MaxCount)
+        {
+            const auto middle = std::min(size, info.Begin + info.Width);
+            const auto end = std::min(size, info.Begin + 2 * info.Width);
+            if (!info.Positions)
+            {
+                info.Positions = std::make_pair(info.Begin, middle);
+                info.Target = info.Begin;
+            }
+
+            auto& [left, right] = *info.Positions;
+            for (; counter < MaxCount && info.Target < end; ++counter, ++info.Target)
+            {
+                if (left < middle && (right == end || !comparator(mRows[right], mRows[left])))
+                {
+                    mTmpRows[info.Target] = mRows[left++];
+                }
+                else
+                {
+                    mTmpRows[info.Target] = mRows[right++];
+                }
+                ++mSliceRows;
+            }
+
+            if (info.Target < end)
+            {
+                return;
+            }
+
+            info.Positions = std::nullopt;
+            info.Begin = end;
+            if (info.Begin == size)
+            {
+                std::swap(mRows, mTmpRows);
+                info.Begin = 0;
+                info.Width <<= 1;
+                TryFinishMerge();
+                return;
+            }
+        }
+    }
+
+    void TryFinishMerge()
+    {
+        if (mMergeInfo.Width >= mRows.size())
+        {
+            mState = State::Permutation;
+        }
+    }
+
+    void ProcessPermutation()
+    {
+        const auto end = std::min(mRows.size(), mPosition + MaxCount);
+        mSliceRows = end - mPosition;
+        for (; mPosition < end; ++mPosition)
+        {
+            (*mTmpBuffer)[mPosition] = std::move((*mResult)[mRows[mPosition]]);
+        }
+
+        if (mPosition == mRows.size())
+        {
+            std::swap(*mTmpBuffer, *mResult);
+            mKeys.clear();
+            mState = State::Completed;
+        }
+    }
+};
+
+}
@@ -1,12 +1,21 @@
 #pragma once
 
 #include "UiLocalStore/VersionedDataContainer.hpp"
+#include "UiLocalStore/ColumnarSnapshot.hpp"
+#include "UiLocalStore/IteratorRanges.hpp"
+#include "UiLocalStore/SetupTraits.hpp"
+#include "UiLocalStore/VersionDeltaCache.hpp"
+#include "UiLocalStore/VersionEpochArena.hpp"
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/composite_key.hpp>
 
+#include <algorithm>
+#include <array>
+#include <functional>
+
 namespace NTPro::Ecn::NewUiServer
 {
 
@@ -20,6 +29,17 @@ public:
 
     using ById = typename TContainerSetup::ById;
 
+    /// Колоночный снимок ведется, только если он объявлен в TContainerSetup.
+    using TColumns = typename ColumnarSnapshotOf<TContainerSetup>::Type;
+    /// Кэш изменений по версиям ведется, только если он объявлен в TContainerSetup.
+    using TVersionDeltas = typename VersionDeltaCacheOf<TContainerSetup>::Type;
+    static constexpr bool UseVersionDeltas = HasVersionDeltaCache<TContainerSetup>::value;
+
+    /// Аллокатор узлов, по умолчанию std::allocator.
+    using TNodeAllocator = typename NodeAllocatorOf<TContainerSetup, TDataItem>::Type;
+    /// Узлы размещаются в арене по версиям, если аллокатор сетапа ее использует.
+    static constexpr bool UseEpochArena = std::is_constructible<TNodeAllocator, VersionEpochArena*>::value;
+
 public:
     struct ByVersion
     {
@@ -56,6 +76,19 @@ public:
     {
     };
 
+    /**
+     * \brief Порядок элементов по id и версии.
+     * В этом порядке идут элементы диапазона BySomethingAndId с одним ключом,
+     * по нему сливаются диапазоны нескольких ключей (MergedIteratorRanges).
+     */
+    struct IdAndVersionLess
+    {
+        bool operator()(const TDataItem& aLhs, const TDataItem& aRhs) const
+        {
+            return std::make_tuple(ById()(aLhs), aLhs.Version) < std::make_tuple(ById()(aRhs), aRhs.Version);
+        }
+    };
+
     template <typename TIndex>
     using TCustomIndex = boost::multi_index::ordered_non_unique<
         boost::multi_index::tag<BySomethingAndId<TIndex>>,
@@ -65,10 +98,7 @@ public:
             ById,
             ByVersion>>;
 
-    using Type = Basis::MultiIndex
-    <
-        TDataItem,
-        boost::multi_index::indexed_by
+    using TIndexList = boost::multi_index::indexed_by
         <
         boost::multi_index::ordered_unique<
             boost::multi_index::tag<ByIdAndVersion>,
@@ -89,8 +119,12 @@ public:
                 ByIsRewrited,
                 ById>>,
         TCustomIndex<TIndices>...
-        >
-    >;
+        >;
+
+    using Type = std::conditional_t<
+        std::is_same<TNodeAllocator, std::allocator<TDataItem>>::value,
+        Basis::MultiIndex<TDataItem, TIndexList>,
+        boost::multi_index_container<TDataItem, TIndexList, TNodeAllocator>>;
 
     using TIdIndex = typename Type::template index<ByIdAndVersion>::type;
     using TIdIterator = typename TIdIndex::iterator;
@@ -105,16 +139,24 @@ public:
     using TRewritedConstIterator = typename TRewritedIndex::const_iterator;
 
     BaseMultiIndexContainer(Basis::Tracer& aTracer)
-        : mTracer(aTracer)
+        : mContainer(CreateContainer())
+        , mTracer(aTracer)
+        , mColumns(aTracer)
+        , mDeltas(aTracer)
     {}
 
     void Emplace(const Basis::SPtr<TData>& aData, TDataVersion aVersion)
     {
+        if constexpr (UseEpochArena)
+        {
+            mArena.BeginEpoch(aVersion);
+        }
         auto& index = mContainer.template get<ByIdAndVersion>();
         auto [iter, res] = index.emplace(aData, aVersion);
         assert(res);
         if (res)
         {
+            mColumns.Append(aData, aVersion);
             if (iter == index.cbegin())
             {
                 return;
@@ -139,6 +181,7 @@ public:
         }
         --it2;
         index.modify(it2, [aVersion](TDataItem& aItem) { aItem.IsRewritedBy = aVersion; });
+        mColumns.MarkRewrited(aId, aVersion);
     }
 
     void ErasePrevious(TDataVersion aVersion)
@@ -152,6 +195,17 @@ public:
         /// Выбираем все элементы, которые были перезаписаны версиями до текущей aVersion
         auto itEnd = index.lower_bound(std::make_tuple(TIsRewrited {aVersion}));
         index.erase(itBegin, itEnd);
+        mColumns.ErasePrevious(aVersion);
+        mColumns.TryCompact();
+        mDeltas.ErasePrevious(aVersion);
+    }
+
+    /**
+     * \brief Выполнить отложенное уплотнение колоночного снимка.
+     */
+    void CompactColumns()
+    {
+        mColumns.TryCompact();
     }
 
     size_t Size() const
@@ -162,6 +216,8 @@ public:
     void Clear()
     {
         mContainer.clear();
+        mColumns.Clear();
+        mDeltas.Clear();
         mStartTime = Basis::DateTime {};
     }
 
@@ -170,13 +226,127 @@ public:
         return mStartTime;
     }
 
+    /**
+     * \brief Загрузить пакет элементов одной версии.
+     * В пустое хранилище элементы вставляются отсортированными по id с подсказкой конца индекса.
+     * Для элементов одной версии порядок ByIdAndVersion, ByVersionAndId и ByIsRewritedAndId совпадает,
+     * поэтому каждая вставка идет в правый край деревьев без случайных обращений к памяти.
+     * Из элементов с одинаковым id остается первый, как и при вставке по одному.
+     */
+    void BulkLoad(Basis::Vector<Basis::SPtr<TData>>&& aItems, TDataVersion aVersion)
+    {
+        if (!mContainer.empty())
+        {
+            for (const auto& item : aItems)
+            {
+                Emplace(item, aVersion);
+            }
+            return;
+        }
+
+        if constexpr (UseEpochArena)
+        {
+            mArena.BeginEpoch(aVersion);
+        }
+
+        std::stable_sort(aItems.begin(), aItems.end(), [](const auto& aLhs, const auto& aRhs)
+        {
+            return aLhs->GetId() < aRhs->GetId();
+        });
+        aItems.erase(std::unique(aItems.begin(), aItems.end(), [](const auto& aLhs, const auto& aRhs)
+        {
+            return aLhs->GetId() == aRhs->GetId();
+        }), aItems.end());
+
+        auto& index = mContainer.template get<ByIdAndVersion>();
+        for (const auto& item : aItems)
+        {
+            index.emplace_hint(index.end(), item, aVersion);
+            mColumns.Append(item, aVersion);
+        }
+    }
+
     void ProcessInitialPack() {}
 
+    /**
+     * \brief Версия aVersion применена полностью.
+     * Если ведется кэш изменений, строки, добавленные и перезаписанные этой версией, собираются один раз.
+     * Первая версия содержит весь снимок, поэтому инкремент к ней строится по индексам без копирования.
+     */
+    void CommitVersion(TDataVersion aVersion)
+    {
+        if constexpr (UseVersionDeltas)
+        {
+            if (aVersion <= 1)
+            {
+                return;
+            }
+
+            using TIsRewrited = std::optional<TDataVersion>;
+            typename TVersionDeltas::TDataPack added;
+            typename TVersionDeltas::TDataPack deleted;
+
+            const auto& versionIndex = mContainer.template get<ByVersionAndId>();
+            const auto [addedBegin, addedEnd] = versionIndex.equal_range(std::make_tuple(aVersion));
+            for (auto it = addedBegin; it != addedEnd; ++it)
+            {
+                added.push_back(it->Item);
+            }
+
+            const auto& rewritedIndex = mContainer.template get<ByIsRewritedAndId>();
+            const auto [deletedBegin, deletedEnd] = rewritedIndex.equal_range(std::make_tuple(TIsRewrited {aVersion}));
+            for (auto it = deletedBegin; it != deletedEnd; ++it)
+            {
+                deleted.push_back(it->Item);
+            }
+
+            mDeltas.Commit(aVersion, std::move(added), std::move(deleted));
+        }
+    }
+
+    const TVersionDeltas& GetVersionDeltas() const
+    {
+        return mDeltas;
+    }
+
+    const TColumns& GetColumns() const
+    {
+        return mColumns;
+    }
+
+    const VersionEpochArena& GetArena() const
+    {
+        return mArena;
+    }
+
+private:
+    /**
+     * \brief Контейнер без арены создается как раньше, по умолчанию.
+     */
+    Type CreateContainer()
+    {
+        if constexpr (UseEpochArena)
+        {
+            return Type(typename Type::ctor_args_list(), TNodeAllocator(&mArena));
+        }
+        else
+        {
+            return Type();
+        }
+    }
+
 protected:
+    /// Объявлена до контейнера, чтобы пережить все его узлы.
+    VersionEpochArena mArena;
+
     Type mContainer;
 
     Basis::Tracer& mTracer;
 
+    TColumns mColumns;
+
+    TVersionDeltas mDeltas;
+
     Basis::DateTime mStartTime;
     
     template <typename TSetup, typename TRangeDerived>
@@ -186,6 +356,7 @@ protected:
         using TData = typename TSetup::TData;
         using TMap = TDerived;
         using TDataId = typename TMap::TId;
+        using TDataItem = typename TMap::TDataItem;
 
         using TIdRanges = typename TSetup::TIdRanges;
         using TAddedRanges = typename TSetup::TAddedRanges;
@@ -204,25 +375,42 @@ protected:
             Added,
             Deleted,
             Custom,
+            Intersection,
+            Delta,
             Nothing
         };
 
+        /**
+         * \brief Параметры диапазонов.
+         * Инкремент (IncrementAction) строится по версиям [FromVersion, Version], по умолчанию по одной версии Version.
+         */
         struct TInit
         {
             const TMap& Map;
             const TUiFilters& FilterExpression;
             std::optional<Model::ActionType> IncrementAction;
             TDataVersion Version;
+            TDataVersion FromVersion;
 
             TInit(
                 const TMap& aMap,
                 const TUiFilters& aFilterExpression,
                 std::optional<Model::ActionType> aIncrementAction,
                 TDataVersion aVersion)
+                : TInit(aMap, aFilterExpression, aIncrementAction, aVersion, aVersion)
+            {}
+
+            TInit(
+                const TMap& aMap,
+                const TUiFilters& aFilterExpression,
+                std::optional<Model::ActionType> aIncrementAction,
+                TDataVersion aVersion,
+                TDataVersion aFromVersion)
                 : Map(aMap)
                 , FilterExpression(aFilterExpression)
                 , IncrementAction(aIncrementAction)
                 , Version(aVersion)
+                , FromVersion(aFromVersion)
             {}
         };
 
@@ -233,6 +421,23 @@ protected:
             Error
         };
 
+        /**
+         * \brief Ключи поиска в пользовательском индексе BySomethingAndId<TIndex>.
+         * Используются для пересечения диапазонов нескольких индексов.
+         */
+        template <typename TIndex>
+        struct IndexProbe
+        {
+            using TKey = std::decay_t<typename TIndex::result_type>;
+
+            Basis::Vector<TKey> Keys;
+        };
+
+        /// Предел подсчета элементов при оценке размера диапазонов индекса.
+        static constexpr size_t EstimateLimit = 1 << 16;
+        /// Индекс участвует в пересечении, если его диапазоны не более чем во столько раз больше ведущих.
+        static constexpr size_t IntersectionFactor = 4;
+
         IIdRanges IdRanges;
         IAddedRanges AddedRanges;
         IDeletedRanges DeletedRanges;
@@ -247,9 +452,21 @@ protected:
         BaseRangeType mRangeType = BaseRangeType::Nothing;
 
         TDataVersion mVersion{0};
+        /// Первая версия инкремента.
+        TDataVersion mFromVersion{0};
 
         std::optional<TDataId> mPreviousId;
 
+        /// Ведущие диапазоны пересечения.
+        std::function<const TDataItem*()> mIntersectionDriver;
+        /// Отсортированные id, видимые в остальных индексах пересечения.
+        Basis::Vector<Basis::Vector<TDataId>> mIntersectionIds;
+
+        /// Изменения версии из кэша хранилища, если они там есть.
+        typename TMap::TVersionDeltas::TDeltaPtr mDelta;
+        const Basis::Pack<TData>* mDeltaRows = nullptr;
+        size_t mDeltaPosition = 0;
+
         Basis::Tracer& mTracer;
 
     public:
@@ -274,6 +491,8 @@ protected:
             mMap = &aInit.Map;
             mFilterExpression = &aInit.FilterExpression;
             mVersion = aInit.Version;
+            mFromVersion = aInit.FromVersion;
+            assert(mFromVersion <= mVersion);
 
             if (aInit.IncrementAction)
             {
@@ -298,7 +517,10 @@ protected:
             auto res = mDerived->InitCustom();
             if (res.has_value())
             {
-                mRangeType = BaseRangeType::Custom;
+                if (mRangeType != BaseRangeType::Intersection)
+                {
+                    mRangeType = BaseRangeType::Custom;
+                }
                 return *res;
             }
             return InitIdRange();
@@ -310,6 +532,11 @@ protected:
             AddedRanges.Reset();
             DeletedRanges.Reset();
             mDerived->ResetCustom();
+            mIntersectionDriver = nullptr;
+            mIntersectionIds.clear();
+            mDelta = nullptr;
+            mDeltaRows = nullptr;
+            mDeltaPosition = 0;
 
             mMap = nullptr;
             mFilterExpression = nullptr;
@@ -325,11 +552,23 @@ protected:
             case BaseRangeType::Id:
                 return GetNext(IdRanges);
             case BaseRangeType::Added:
-                return GetVersionedNext(AddedRanges);
+                return GetVersionedNext(AddedRanges, [this](const TDataItem& aItem)
+                {
+                    /// Из нескольких изменений строки за интервал версий берется последнее.
+                    return !aItem.IsRewritedBy || *aItem.IsRewritedBy > mVersion;
+                });
             case BaseRangeType::Deleted:
-                return GetVersionedNext(DeletedRanges);
+                return GetVersionedNext(DeletedRanges, [this](const TDataItem& aItem)
+                {
+                    /// Строки, добавленные и перезаписанные внутри интервала, подписке не известны.
+                    return aItem.Version < mFromVersion;
+                });
             case BaseRangeType::Custom:
                 return mDerived->CustomGetNext();
+            case BaseRangeType::Intersection:
+                return GetIntersectionNext();
+            case BaseRangeType::Delta:
+                return GetDeltaNext();
             default:
                 mTracer.Error("BaseIndexRanges.GetNext uninitialized");
                 assert(false);
@@ -339,21 +578,70 @@ protected:
         }
 
     protected:
+        /**
+         * \brief Строки, добавленные версиями [mFromVersion, mVersion].
+         * Для интервала из нескольких версий берутся только строки, не перезаписанные до mVersion включительно.
+         */
         void InitAddedRange()
         {
+            if (InitDeltaRange(&VersionDelta<TData>::Added))
+            {
+                mTracer.InfoSlow("MultiIndexContainer.Init added by cached delta", mVersion);
+                return;
+            }
             const auto& index = mMap->mContainer.template get<typename TMap::ByVersionAndId>();
-            AddedRanges.Add(index.equal_range(std::make_tuple(mVersion)));
+            AddedRanges.Add(std::make_pair(
+                index.lower_bound(std::make_tuple(mFromVersion)),
+                index.upper_bound(std::make_tuple(mVersion))));
             mRangeType = BaseRangeType::Added;
-            mTracer.InfoSlow("MultiIndexContainer.Init added by version", mVersion);
+            mTracer.InfoSlow("MultiIndexContainer.Init added by versions", mFromVersion, "-", mVersion);
         }
 
+        /**
+         * \brief Строки, перезаписанные версиями [mFromVersion, mVersion].
+         * Для интервала из нескольких версий берутся только строки, существовавшие до mFromVersion.
+         */
         void InitDeletedRange()
         {
+            if (InitDeltaRange(&VersionDelta<TData>::Deleted))
+            {
+                mTracer.InfoSlow("MultiIndexContainer.Init deleted by cached delta:", mVersion);
+                return;
+            }
             using TIsRewrited = std::optional<TDataVersion>;
             const auto& index = mMap->mContainer.template get<typename TMap::ByIsRewritedAndId>();
-            DeletedRanges.Add(index.equal_range(std::make_tuple(TIsRewrited {mVersion})));
+            DeletedRanges.Add(std::make_pair(
+                index.lower_bound(std::make_tuple(TIsRewrited {mFromVersion})),
+                index.upper_bound(std::make_tuple(TIsRewrited {mVersion}))));
             mRangeType = BaseRangeType::Deleted;
-            mTracer.InfoSlow("MultiIndexContainer.Init deleted by version:", mVersion);
+            mTracer.InfoSlow("MultiIndexContainer.Init deleted by versions:", mFromVersion, "-", mVersion);
+        }
+
+        /// Кэш хранит изменения отдельных версий, интервал читается по индексам.
+        bool InitDeltaRange(Basis::Pack<TData> VersionDelta<TData>::* aRows)
+        {
+            if (mFromVersion != mVersion)
+            {
+                return false;
+            }
+            mDelta = mMap->mDeltas.Find(mVersion);
+            if (!mDelta)
+            {
+                return false;
+            }
+            mDeltaRows = &((*mDelta).*aRows);
+            mDeltaPosition = 0;
+            mRangeType = BaseRangeType::Delta;
+            return true;
+        }
+
+        Basis::SPtr<TData> GetDeltaNext()
+        {
+            if (mDeltaPosition >= mDeltaRows->size())
+            {
+                return nullptr;
+            }
+            return (*mDeltaRows)[mDeltaPosition++];
         }
 
         bool InitIdRange()
@@ -403,18 +691,153 @@ protected:
             return (*it)->Item;
         }
 
-        template <typename TRanges>
-        Basis::SPtr<TData> GetVersionedNext(TRanges& outRanges)
+        /**
+         * \brief Следующая строка версий инкремента.
+         * Для одной версии возвращаются все строки диапазона, для интервала - только подходящие под aIsNet.
+         */
+        template <typename TRanges, typename TIsNet>
+        Basis::SPtr<TData> GetVersionedNext(TRanges& outRanges, const TIsNet& aIsNet)
         {
             using TIterator = decltype(outRanges.Next());
-            if (TIterator it = outRanges.Next())
+            while (TIterator it = outRanges.Next())
             {
-                return (*it)->Item;
+                if (mFromVersion == mVersion || aIsNet(**it))
+                {
+                    return (*it)->Item;
+                }
             }
 
             return nullptr;
         }
 
+        /**
+         * \brief Пересечь диапазоны нескольких пользовательских индексов.
+         * Ведущим выбирается индекс с наименьшей оценкой размера диапазонов, по нему идет проход.
+         * Из остальных индексов, сравнимых по размеру с ведущим, собираются отсортированные id видимых элементов.
+         * Элемент ведущего индекса возвращается, только если его id есть во всех собранных наборах.
+         * Индексы, которые намного больше ведущего, не собираются, их фильтры проверяются построчно.
+         */
+        template <typename... TProbeIndices>
+        bool InitIntersection(const IndexProbe<TProbeIndices>&... aProbes)
+        {
+            static_assert(sizeof...(TProbeIndices) > 0);
+
+            const std::array<size_t, sizeof...(TProbeIndices)> estimates { EstimateProbe(aProbes)... };
+            const auto driver = static_cast<size_t>(
+                std::min_element(estimates.cbegin(), estimates.cend()) - estimates.cbegin());
+
+            mIntersectionIds.clear();
+            size_t index = 0;
+            const auto addProbe = [&](const auto& aProbe)
+            {
+                const auto current = index++;
+                AddIntersectionProbe(aProbe, current == driver, estimates[current], estimates[driver]);
+            };
+            (addProbe(aProbes), ...);
+
+            std::sort(mIntersectionIds.begin(), mIntersectionIds.end(), [](const auto& aLhs, const auto& aRhs)
+            {
+                return aLhs.size() < aRhs.size();
+            });
+
+            mRangeType = BaseRangeType::Intersection;
+            mTracer.InfoSlow("MultiIndexContainer.Init intersection, driver:", driver,
+                ", estimate:", estimates[driver], ", intersected:", mIntersectionIds.size());
+            return true;
+        }
+
+        template <typename TIndex>
+        size_t EstimateProbe(const IndexProbe<TIndex>& aProbe) const
+        {
+            const auto& index = mMap->mContainer.template get<typename TMap::template BySomethingAndId<TIndex>>();
+            size_t estimate = 0;
+            for (const auto& key : aProbe.Keys)
+            {
+                auto [it, end] = index.equal_range(std::make_tuple(key));
+                for (; it != end && estimate < EstimateLimit; ++it)
+                {
+                    ++estimate;
+                }
+            }
+            return estimate;
+        }
+
+        template <typename TIndex>
+        void AddIntersectionProbe(
+            const IndexProbe<TIndex>& aProbe,
+            bool aIsDriver,
+            size_t aEstimate,
+            size_t aDriverEstimate)
+        {
+            using TIndexTag = typename TMap::template BySomethingAndId<TIndex>;
+            using TIterator = typename TMap::Type::template index<TIndexTag>::type::const_iterator;
+
+            const auto& index = mMap->mContainer.template get<TIndexTag>();
+            if (aIsDriver)
+            {
+                /// Диапазоны ключей сливаются по id, чтобы версии одной строки шли подряд.
+                auto ranges = std::make_shared<MergedIteratorRanges<TIterator, typename TMap::IdAndVersionLess>>();
+                for (const auto& key : GetUniqueKeys(aProbe.Keys))
+                {
+                    ranges->Add(index.equal_range(std::make_tuple(key)));
+                }
+                mIntersectionDriver = [ranges]() -> const TDataItem*
+                {
+                    auto it = ranges->Next();
+                    return it ? &**it : nullptr;
+                };
+                return;
+            }
+
+            if (aEstimate > aDriverEstimate * IntersectionFactor)
+            {
+                return;
+            }
+
+            auto& ids = mIntersectionIds.emplace_back();
+            for (const auto& key : aProbe.Keys)
+            {
+                auto [it, end] = index.equal_range(std::make_tuple(key));
+                for (; it != end; ++it)
+                {
+                    if (IsVisible(*it))
+                    {
+                        ids.push_back(it->Item->GetId());
+                    }
+                }
+            }
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        }
+
+        bool IsVisible(const TDataItem& aItem) const
+        {
+            return !aItem.IsRewritedBy || *aItem.IsRewritedBy > mVersion;
+        }
+
+        Basis::SPtr<TData> GetIntersectionNext()
+        {
+            while (const auto* item = mIntersectionDriver())
+            {
+                const auto id = item->Item->GetId();
+                if (id == mPreviousId || !IsVisible(*item))
+                {
+                    continue;
+                }
+                mPreviousId = id;
+
+                const auto isIntersected = std::all_of(mIntersectionIds.cbegin(), mIntersectionIds.cend(), [&id](const auto& aIds)
+                {
+                    return std::binary_search(aIds.cbegin(), aIds.cend(), id);
+                });
+                if (isIntersected)
+                {
+                    return item->Item;
+                }
+            }
+            return nullptr;
+        }
+
         template <typename TIndex, typename TRanges>
         bool InitFilterIteratorRangeByKey(
             const TradingSerialization::Table::TInt& aFieldFilter,
@@ -431,6 +854,50 @@ protected:
             return true;
         }
 
+        /**
+         * \brief Добавить диапазоны индекса для каждого ключа из списка оператора In.
+         * Ключи сортируются и очищаются от повторов, поэтому каждый элемент попадает в диапазоны один раз.
+         * Версии одной строки могут быть в диапазонах разных ключей, поэтому диапазоны должны сливаться
+         * по id и версии (MergedIteratorRanges с IdAndVersionLess): тогда версии строки идут подряд
+         * и проверка mPreviousId в GetNext остается корректной.
+         * Незаполненный ключ в индексе не найти, в этом случае возвращается false.
+         */
+        template <typename TIndex, typename TRanges>
+        bool InitFilterIteratorRangeByKeys(
+            const TradingSerialization::Table::TIntValues& aKeys,
+            TRanges& outRanges)
+        {
+            static_assert(TRanges::IsMerged, "Ranges of several keys must be merged by id");
+
+            Basis::Vector<int64_t> keys;
+            keys.reserve(aKeys.size());
+            for (const auto& key : aKeys)
+            {
+                if (!key)
+                {
+                    mTracer.Error("InitFilterIteratorRangeByKeys: key value is not initialized");
+                    return false;
+                }
+                keys.push_back(*key);
+            }
+
+            const auto& index = mMap->mContainer.template get<TIndex>();
+            for (const auto key : GetUniqueKeys(keys))
+            {
+                outRanges.Add(index.equal_range(key));
+            }
+            mTracer.InfoSlow("InitFilterIteratorRangeByKeys: keys:", aKeys.size());
+            return true;
+        }
+
+        template <typename TKey>
+        static Basis::Vector<TKey> GetUniqueKeys(Basis::Vector<TKey> aKeys)
+        {
+            std::sort(aKeys.begin(), aKeys.end());
+            aKeys.erase(std::unique(aKeys.begin(), aKeys.end()), aKeys.end());
+            return aKeys;
+        }
+
         template <typename TIndex, typename TRanges>
         bool InitFilterIteratorRangeByBounds(
             const TradingSerialization::Table::TInt& aLowBound,
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <Common/Collections.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Упорядоченное дерево с размерами поддеревьев.
+ * \ingroup NewUiServer
+ * Декартово дерево (treap) по компаратору порядка сортировки.
+ * Вставка и удаление за O(log N), доступ к строке по номеру за O(log N),
+ * обход окна строк [aFrom, aTo) за O(log N + aTo - aFrom).
+ * Компаратор передается в каждую операцию, так как SortOrderComparator хранит ссылки на
+ * порядок сортировки и флаг ошибки. Компаратор должен задавать строгий порядок:
+ * порядок сортировки подписки всегда содержит колонку Id.
+ * Узлы хранятся в одном массиве, освобожденные узлы переиспользуются.
+ */
+template <typename TValue>
+class OrderStatisticTree
+{
+    using TIndex = uint32_t;
+    static constexpr TIndex Null = std::numeric_limits<TIndex>::max();
+
+    struct Node
+    {
+        TValue Value;
+        TIndex Left = Null;
+        TIndex Right = Null;
+        TIndex Size = 1;
+        uint32_t Priority = 0;
+    };
+
+    Basis::Vector<Node> mNodes;
+    Basis::Vector<TIndex> mFree;
+    TIndex mRoot = Null;
+    uint64_t mSeed = 0x9E3779B97F4A7C15ull;
+
+public:
+    size_t Size() const
+    {
+        return GetSize(mRoot);
+    }
+
+    bool Empty() const
+    {
+        return mRoot == Null;
+    }
+
+    void Clear()
+    {
+        mNodes.clear();
+        mFree.clear();
+        mRoot = Null;
+    }
+
+    /**
+     * \brief Построить дерево из упорядоченного диапазона за O(N).
+     * Элементы диапазона должны быть уникальны относительно компаратора.
+     */
+    template <typename TIt>
+    void Build(TIt aBegin, TIt aEnd)
+    {
+        Clear();
+        const auto size = static_cast<size_t>(std::distance(aBegin, aEnd));
+        assert(size < Null);
+        mNodes.reserve(size);
+
+        uint32_t height = 0;
+        while ((size_t { 1 } << height) <= size)
+        {
+            ++height;
+        }
+        /// Приоритет узла определяется его высотой, чтобы построенное дерево было кучей по приоритетам.
+        const uint32_t step = std::numeric_limits<uint32_t>::max() / (height + 1);
+        mRoot = BuildRange(aBegin, 0, size, height, step);
+    }
+
+    /**
+     * \brief Вставить элемент или заменить равный ему.
+     * Возвращает true, если элемент вставлен.
+     */
+    template <typename TComparator>
+    bool InsertOrAssign(const TValue& aValue, const TComparator& aComparator)
+    {
+        for (auto node = mRoot; node != Null;)
+        {
+            auto& current = mNodes[node];
+            if (aComparator(aValue, current.Value))
+            {
+                node = current.Left;
+            }
+            else if (aComparator(current.Value, aValue))
+            {
+                node = current.Right;
+            }
+            else
+            {
+                current.Value = aValue;
+                return false;
+            }
+        }
+        mRoot = Insert(mRoot, Allocate(aValue, NextPriority()), aComparator);
+        return true;
+    }
+
+    /**
+     * \brief Удалить элемент, равный aValue.
+     * Возвращает false, если такого элемента нет.
+     */
+    template <typename TComparator>
+    bool Erase(const TValue& aValue, const TComparator& aComparator)
+    {
+        bool erased = false;
+        mRoot = Erase(mRoot, aValue, aComparator, erased);
+        return erased;
+    }
+
+    /**
+     * \brief Элемент с номером aRank.
+     */
+    const TValue& At(size_t aRank) const
+    {
+        assert(aRank < Size());
+        auto node = mRoot;
+        while (true)
+        {
+            const auto& current = mNodes[node];
+            const auto leftSize = GetSize(current.Left);
+            if (aRank < leftSize)
+            {
+                node = current.Left;
+            }
+            else if (aRank == leftSize)
+            {
+                return current.Value;
+            }
+            else
+            {
+                aRank -= leftSize + 1;
+                node = current.Right;
+            }
+        }
+    }
+
+    /**
+     * \brief Количество элементов, меньших aValue.
+     */
+    template <typename TComparator>
+    size_t LowerBound(const TValue& aValue, const TComparator& aComparator) const
+    {
+        size_t rank = 0;
+        for (auto node = mRoot; node != Null;)
+        {
+            const auto& current = mNodes[node];
+            if (aComparator(current.Value, aValue))
+            {
+                rank += GetSize(current.Left) + 1;
+                node = current.Right;
+            }
+            else
+            {
+                node = current.Left;
+            }
+        }
+        return rank;
+    }
+
+    /**
+     * \brief Обойти элементы с номерами [aFrom, aTo) по порядку.
+     */
+    template <typename TFunc>
+    void ForEach(size_t aFrom, size_t aTo, TFunc&& aFunc) const
+    {
+        aTo = std::min(aTo, Size());
+        if (aFrom >= aTo)
+        {
+            return;
+        }
+
+        /// Путь до первого элемента: в стеке остаются узлы, к которым обход еще вернется.
+        Basis::Vector<TIndex> stack;
+        auto node = mRoot;
+        auto rank = aFrom;
+        while (node != Null)
+        {
+            const auto& current = mNodes[node];
+            const auto leftSize = GetSize(current.Left);
+            if (rank < leftSize)
+            {
+                stack.push_back(node);
+                node = current.Left;
+            }
+            else if (rank == leftSize)
+            {
+                stack.push_back(node);
+                break;
+            }
+            else
+            {
+                rank -= leftSize + 1;
+                node = current.Right;
+            }
+        }
+
+        for (auto count = aTo - aFrom; count > 0; --count)
+        {
+            assert(!stack.empty());
+            node = stack.back();
+            stack.pop_back();
+            aFunc(mNodes[node].Value);
+            for (node = mNodes[node].Right; node != Null; node = mNodes[node].Left)
+            {
+                stack.push_back(node);
+            }
+        }
+    }
+
+    template <typename TFunc>
+    void ForEach(TFunc&& aFunc) const
+    {
+        ForEach(0, Size(), std::forward<TFunc>(aFunc));
+    }
+
+private:
+    TIndex GetSize(TIndex aNode) const
+    {
+        return aNode == Null ? 0 : mNodes[aNode].Size;
+    }
+
+    void Update(TIndex aNode)
+    {
+        auto& node = mNodes[aNode];
+        node.Size = GetSize(node.Left) + GetSize(node.Right) + 1;
+    }
+
+    uint32_t NextPriority()
+    {
+        /// xorshift64*
+        mSeed ^= mSeed >> 12;
+        mSeed ^= mSeed << 25;
+        mSeed ^= mSeed >> 27;
+        return static_cast<uint32_t>((mSeed * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+
+    TIndex Allocate(const TValue& aValue, uint32_t aPriority)
+    {
+        TIndex index;
+        if (!mFree.empty())
+        {
+            index = mFree.back();
+            mFree.pop_back();
+            mNodes[index] = Node {};
+        }
+        else
+        {
+            assert(mNodes.size() < Null);
+            index = static_cast<TIndex>(mNodes.size());
+            mNodes.emplace_back();
+        }
+        mNodes[index].Value = aValue;
+        mNodes[index].Priority = aPriority;
+        return index;
+    }
+
+    void Free(TIndex aNode)
+    {
+        mNodes[aNode].Value = TValue {};
+        mFree.push_back(aNode);
+    }
+
+    template <typename TIt>
+    TIndex BuildRange(TIt aBegin, size_t aFrom, size_t aTo, uint32_t aHeight, uint32_t aStep)
+    {
+        if (aFrom == aTo)
+        {
+            return Null;
+        }
+        const auto middle = aFrom + (aTo - aFrom) / 2;
+        const auto node = Allocate(*std::next(aBegin, middle), aHeight * aStep + NextPriority() % aStep);
+        const auto left = BuildRange(aBegin, aFrom, middle, aHeight - 1, aStep);
+        const auto right = BuildRange(aBegin, middle + 1, aTo, aHeight - 1, aStep);
+        mNodes[node].Left = left;
+        mNodes[node].Right = right;
+        Update(node);
+        return node;
+    }
+
+    /**
+     * \brief Разделить поддерево на элементы, меньшие aValue, и остальные.
+     */
+    template <typename TComparator>
+    std::pair<TIndex, TIndex> Split(TIndex aNode, const TValue& aValue, const TComparator& aComparator)
+    {
+        if (aNode == Null)
+        {
+            return { Null, Null };
+        }
+        if (aComparator(mNodes[aNode].Value, aValue))
+        {
+            const auto [left, right] = Split(mNodes[aNode].Right, aValue, aComparator);
+            mNodes[aNode].Right = left;
+            Update(aNode);
+            return { aNode, right };
+        }
+        const auto [left, right] = Split(mNodes[aNode].Left, aValue, aComparator);
+        mNodes[aNode].Left = right;
+        Update(aNode);
+        return { left, aNode };
+    }
+
+    /**
+     * \brief Объединить поддеревья, все элементы aLeft меньше элементов aRight.
+     */
+    TIndex Merge(TIndex aLeft, TIndex aRight)
+    {
+        if (aLeft == Null)
+        {
+            return aRight;
+        }
+        if (aRight == Null)
+        {
+            return aLeft;
+        }
+        if (mNodes[aLeft].Priority > mNodes[aRight].Priority)
+        {
+            mNodes[aLeft].Right = Merge(mNodes[aLeft].Right, aRight);
+            Update(aLeft);
+            return aLeft;
+        }
+        mNodes[aRight].Left = Merge(aLeft, mNodes[aRight].Left);
+        Update(aRight);
+        return aRight;
+    }
+
+    template <typename TComparator>
+    TIndex Insert(TIndex aNode, TIndex aNew, const TComparator& aComparator)
+    {
+        if (aNode == Null)
+        {
+            return aNew;
+        }
+        if (mNodes[aNew].Priority > mNodes[aNode].Priority)
+        {
+            const auto [left, right] = Split(aNode, mNodes[aNew].Value, aComparator);
+            mNodes[aNew].Left = left;
+            mNodes[aNew].Right = right;
+            Update(aNew);
+            return aNew;
+        }
+        if (aComparator(mNodes[aNew].Value, mNodes[aNode].Value))
+        {
+            const auto left = Insert(mNodes[aNode].Left, aNew, aComparator);
+            mNodes[aNode].Left = left;
+        }
+        else
+        {
+            const auto right = Insert(mNodes[aNode].Right, aNew, aComparator);
+            mNodes[aNode].Right = right;
+        }
+        Update(aNode);
+        return aNode;
+    }
+
+    template <typename TComparator>
+    TIndex Erase(TIndex aNode, const TValue& aValue, const TComparator& aComparator, bool& outErased)
+    {
+        if (aNode == Null)
+        {
+            return Null;
+        }
+        if (aComparator(aValue, mNodes[aNode].Value))
+        {
+            const auto left = Erase(mNodes[aNode].Left, aValue, aComparator, outErased);
+            mNodes[aNode].Left = left;
+        }
+        else if (aComparator(mNodes[aNode].Value, aValue))
+        {
+            const auto right = Erase(mNodes[aNode].Right, aValue, aComparator, outErased);
+            mNodes[aNode].Right = right;
+        }
+        else
+        {
+            outErased = true;
+            const auto merged = Merge(mNodes[aNode].Left, mNodes[aNode].Right);
+            Free(aNode);
+            return merged;
+        }
+        Update(aNode);
+        return aNode;
+    }
+};
+
+}
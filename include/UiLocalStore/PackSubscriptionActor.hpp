@@ -47,6 +47,7 @@ public:
     using TFiltermanImpl = typename TSetup::TTableIndexFilterman;
     using TFiltermanInit = typename TSetup::TTableIndexFiltermanInit;
     using IFilterman = ITableFilterman::Performer<TFiltermanImpl>;
+    using TCompiledFilters = typename TFiltermanInit::TCompiledFilters;
 
     using IRanges = typename IDataRanges<TData>::template Ranges<typename TSetup::TIndexedDataRanges>;
     using IRangesInit = typename TSetup::TIndexedDataRangesInit;
@@ -58,6 +59,8 @@ private:
 
     TUiSubscription::TId mRequestId;
     TUiSubscription mSubscription;
+    /// Фильтры подписки компилируются один раз и используются при каждой фильтрации.
+    TCompiledFilters mCompiledFilters;
 
     const TMap& mRawData;
 
@@ -88,6 +91,7 @@ public:
         : mTracer(aTracer)
         , mRequestId(aRequestId)
         , mSubscription(aSubscription)
+        , mCompiledFilters(mSubscription.FilterExpression)
         , mRawData(aRawData)
         , mVersion(aVersion)
         , State(mTracer)
@@ -266,7 +270,8 @@ private:
             {
                 mSubscription.FilterExpression,
                 mProcessedResult,
-                Ranges.Get()
+                Ranges.Get(),
+                &mCompiledFilters
             });
         }
     }
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/ITableSorter.hpp>
+#include <NewUiServer/UiLocalStore/SortOrderComparator.hpp>
+#include <NewUiServer/UiLocalStore/TableSorter.hpp>
+#include <NewUiServer/UiLocalStore/TableUtils.hpp>
+#include <NewUiServer/UiLocalStore/WorkerPool.hpp>
+
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Common/Tracer.hpp>
+
+#include <Common/Pack.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Табличный сортировальщик на пуле потоков.
+ * \ingroup NewUiServer
+ * Сортировка частей и каждый проход слияния выполняются задачами пула,
+ * реактор в Process только проверяет завершение этапа и ставит задачи следующего.
+ * Пул берется из TSetup::GetWorkerPool().
+ * На время сортировки данные переносятся в общее с задачами состояние и возвращаются в
+ * результирующий массив при завершении или ошибке сравнения, поэтому Reset и удаление сортировальщика
+ * безопасны при незавершенных задачах.
+ * Небольшие массивы (до MaxCount элементов) сортируются сразу на реакторе.
+ * Без пула сортировка выполняется TableSorter порциями по MaxCount элементов за вызов Process.
+ * GetSliceRows учитывает только строки, обработанные на реакторе: работа задач пула его не занимает.
+ * Строки сравниваются одновременно в нескольких потоках пула, поэтому чтение значений колонок
+ * строк (GetValue) должно быть безопасно при одновременных вызовах и не должно менять строку.
+ */
+template <typename TSetup>
+class ParallelTableSorter
+{
+public:
+    static constexpr int MaxCount = TSetup::MaxCount;
+
+    using TData = typename TSetup::TData;
+    using TTableSetup = typename TSetup::TTableSetup;
+
+    using TDataPack = Basis::Pack<TData>;
+    using State = TableSorterState;
+
+    using TTableColumnType = typename TTableSetup::TTableColumnType;
+
+    using TSortOrder = TradingSerialization::Table::TSortOrder;
+    using TComparator = SortOrderComparator<TData, TTableColumnType>;
+    using TInit = typename TableSorter<TSetup>::TInit;
+
+private:
+    /**
+     * \brief Состояние, общее с задачами пула.
+     * Границы частей меняются только реактором, когда задач этапа не осталось.
+     */
+    struct Job
+    {
+        TSortOrder SortOrder;
+        TDataPack Data;
+        TDataPack Buffer;
+        /// Границы отсортированных частей: [Bounds[i], Bounds[i + 1]).
+        Basis::Vector<size_t> Bounds;
+        bool UsePool = false;
+        std::atomic<size_t> Pending { 0 };
+        std::atomic<bool> Failed { false };
+    };
+
+    State mState = State::Initializing;
+    TDataPack* mResult = nullptr;
+    std::shared_ptr<Job> mJob;
+    std::shared_ptr<WorkerPool> mWorkerPool;
+    /// Сортировальщик порциями для работы без пула.
+    TableSorter<TSetup> mSlicedSorter;
+    /// Число строк, отсортированных на реакторе последним вызовом Process.
+    size_t mSliceRows = 0;
+
+    Basis::Tracer& mTracer;
+
+public:
+    ParallelTableSorter(Basis::Tracer& aTracer)
+        : mWorkerPool(TSetup::GetWorkerPool())
+        , mSlicedSorter(aTracer)
+        , mTracer(aTracer)
+    {
+    }
+
+    bool IsInitialized() const
+    {
+        return mState != State::Initializing;
+    }
+
+    void Init(const TInit& aInit)
+    {
+        assert(!IsInitialized());
+
+        if (!mWorkerPool)
+        {
+            mSlicedSorter.Init(aInit);
+            mState = mSlicedSorter.GetState();
+            return;
+        }
+
+        mResult = &aInit.Result;
+
+        auto sortOrderError = TableUtils<TTableSetup>::CheckSortOrder(aInit.SortOrder);
+        if (!sortOrderError.empty())
+        {
+            mState = State::Error;
+            mTracer.ErrorSlow("ParallelTableSorter:", sortOrderError, ", ", aInit.SortOrder);
+            return;
+        }
+
+        mJob = std::make_shared<Job>();
+        mJob->SortOrder = aInit.SortOrder;
+        std::swap(mJob->Data, *mResult);
+
+        const auto size = mJob->Data.size();
+        if (size <= static_cast<size_t>(MaxCount))
+        {
+            /// Не используем пул: сортируем на реакторе за один вызов Process.
+            mJob->Bounds = { 0, size };
+            mState = State::PartSort;
+            return;
+        }
+
+        mJob->UsePool = true;
+        mJob->Buffer.resize(size);
+        const auto partsCount = std::min(2 * mWorkerPool->GetThreadsCount(), size / MaxCount);
+        for (size_t i = 0; i < partsCount; ++i)
+        {
+            mJob->Bounds.push_back(size * i / partsCount);
+        }
+        mJob->Bounds.push_back(size);
+
+        PostPartSort();
+        mState = State::PartSort;
+    }
+
+    void Reset()
+    {
+        /// Незавершенные задачи держат свою копию состояния.
+        mJob.reset();
+        mSlicedSorter.Reset();
+        mResult = nullptr;
+        mState = State::Initializing;
+        mSliceRows = 0;
+    }
+
+    State Process()
+    {
+        mSliceRows = 0;
+        if (!mWorkerPool)
+        {
+            mState = mSlicedSorter.Process();
+            return mState;
+        }
+
+        switch (mState)
+        {
+        case State::PartSort:
+        case State::MergeSort:
+            ProcessJob();
+            break;
+        default:
+            mTracer.ErrorSlow("ParallelSorter.Process: state is invalid:", mState);
+            mState = State::Error;
+            break;
+        }
+        return mState;
+    }
+
+    State GetState() const
+    {
+        return mState;
+    }
+
+    size_t GetSliceRows() const
+    {
+        return mWorkerPool ? mSliceRows : mSlicedSorter.GetSliceRows();
+    }
+
+private:
+    void ProcessJob()
+    {
+        if (mJob->Pending.load(std::memory_order_acquire) != 0)
+        {
+            return;
+        }
+
+        if (!mJob->UsePool)
+        {
+            bool ok = true;
+            std::sort(mJob->Data.begin(), mJob->Data.end(), TComparator(mJob->SortOrder, ok));
+            mJob->Failed = !ok;
+            mSliceRows = mJob->Data.size();
+        }
+
+        if (mJob->Failed)
+        {
+            /// Задач этапа не осталось, все строки в данных задания: возвращаем их в результат.
+            std::swap(*mResult, mJob->Data);
+            mJob.reset();
+            mState = State::Error;
+            mTracer.Error("ParallelSorter: sorting failed");
+            return;
+        }
+
+        if (mJob->Bounds.size() <= 2)
+        {
+            std::swap(*mResult, mJob->Data);
+            mJob.reset();
+            mState = State::Completed;
+            return;
+        }
+
+        PostMergePass();
+        mState = State::MergeSort;
+    }
+
+    void PostPartSort()
+    {
+        const auto partsCount = mJob->Bounds.size() - 1;
+        mJob->Pending = partsCount;
+        for (size_t i = 0; i < partsCount; ++i)
+        {
+            mWorkerPool->Post([job = mJob, i]()
+            {
+                bool ok = true;
+                std::sort(
+                    job->Data.begin() + job->Bounds[i],
+                    job->Data.begin() + job->Bounds[i + 1],
+                    TComparator(job->SortOrder, ok));
+                Finish(*job, ok);
+            });
+        }
+    }
+
+    /**
+     * \brief Поставить задачи очередного прохода слияния.
+     * Соседние части сливаются попарно в буфер. Непарная последняя часть переносится в буфер в той же задаче.
+     * После прохода буфер и данные меняются местами.
+     */
+    void PostMergePass()
+    {
+        auto& job = *mJob;
+        std::swap(job.Data, job.Buffer);
+
+        Basis::Vector<size_t> bounds;
+        for (size_t i = 0; i + 1 < job.Bounds.size(); i += 2)
+        {
+            bounds.push_back(job.Bounds[i]);
+        }
+        bounds.push_back(job.Bounds.back());
+
+        const auto tasksCount = bounds.size() - 1;
+        job.Pending = tasksCount;
+        for (size_t i = 0; i < tasksCount; ++i)
+        {
+            const auto begin = job.Bounds[2 * i];
+            const auto middle = job.Bounds[std::min(2 * i + 1, job.Bounds.size() - 1)];
+            const auto end = bounds[i + 1];
+            mWorkerPool->Post([job = mJob, begin, middle, end]()
+            {
+                /// Источник - буфер, так как данные и буфер уже поменяны местами.
+                auto& source = job->Buffer;
+                bool ok = true;
+                std::merge(
+                    std::make_move_iterator(source.begin() + begin),
+                    std::make_move_iterator(source.begin() + middle),
+                    std::make_move_iterator(source.begin() + middle),
+                    std::make_move_iterator(source.begin() + end),
+                    job->Data.begin() + begin,
+                    TComparator(job->SortOrder, ok));
+                Finish(*job, ok);
+            });
+        }
+        job.Bounds = std::move(bounds);
+    }
+
+    static void Finish(Job& aJob, bool aOk)
+    {
+        if (!aOk)
+        {
+            aJob.Failed = true;
+        }
+        aJob.Pending.fetch_sub(1, std::memory_order_release);
+    }
+};
+
+}
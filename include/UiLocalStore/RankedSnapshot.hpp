@@ -0,0 +1,184 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/ITableIncrementApplicator.hpp>
+#include <NewUiServer/UiLocalStore/OrderStatisticTree.hpp>
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
+#include <NewUiServer/UiLocalStore/SortOrderComparator.hpp>
+#include <NewUiServer/UiLocalStore/TableUtils.hpp>
+
+#include "TradingSerialization/Table/Columns.hpp"
+#include "TradingSerialization/Table/RowRange.hpp"
+
+#include <Common/Tracer.hpp>
+
+#include <Common/Pack.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Результат табличной подписки в упорядоченном дереве.
+ * \ingroup NewUiServer
+ * Альтернатива пересборке отсортированного массива при каждом обновлении:
+ * инкремент применяется к дереву за O(k log N), по MaxCount изменений за вызов ApplyIncrement,
+ * а окно строк (RowWindowRequest) выдается по номерам строк без обхода всего результата.
+ * Полный массив строк собирается только по запросу, за O(N) без сравнений.
+ */
+template <typename TSetup>
+class RankedSnapshot
+{
+public:
+    static constexpr int MaxCount = TSetup::MaxCount;
+
+    using TData = typename TSetup::TData;
+    using TTableSetup = typename TSetup::TTableSetup;
+
+    using TTableColumnType = typename TTableSetup::TTableColumnType;
+    using TDataPack = Basis::Pack<TData>;
+    using TSortOrder = TradingSerialization::Table::TSortOrder;
+    using TRowRange = TradingSerialization::Table::RowRange;
+    using TComparator = SortOrderComparator<TData, TTableColumnType>;
+
+private:
+    OrderStatisticTree<Basis::SPtr<TData>> mTree;
+
+    /// Позиция применения инкремента: сначала удаленные элементы, затем добавленные.
+    size_t mDeletedPosition = 0;
+    size_t mAddedPosition = 0;
+    size_t mSliceRows = 0;
+
+    Basis::Tracer& mTracer;
+
+public:
+    RankedSnapshot(Basis::Tracer& aTracer)
+        : mTracer(aTracer)
+    {
+    }
+
+    /**
+     * \brief Заполнить дерево отсортированным результатом подписки.
+     */
+    void Build(const TDataPack& aSorted)
+    {
+        mTree.Build(aSorted.cbegin(), aSorted.cend());
+        ResetIncrement();
+    }
+
+    void Clear()
+    {
+        mTree.Clear();
+        ResetIncrement();
+    }
+
+    size_t Size() const
+    {
+        return mTree.Size();
+    }
+
+    /**
+     * \brief Применить очередную порцию инкремента.
+     * Равный по порядку сортировки элемент заменяется добавленным,
+     * поэтому удаленные элементы применяются раньше добавленных.
+     */
+    TableIncrementApplicatorState ApplyIncrement(
+        const TSortOrder& aSortOrder,
+        const TDataPack& aDeletedIncrement,
+        const TDataPack& aAddedIncrement)
+    {
+        bool ok = true;
+        const TComparator comparator(aSortOrder, ok);
+
+        int counter = 0;
+        for (; counter < MaxCount && mDeletedPosition < aDeletedIncrement.size(); ++counter)
+        {
+            mTree.Erase(aDeletedIncrement[mDeletedPosition++], comparator);
+        }
+        for (; counter < MaxCount && mAddedPosition < aAddedIncrement.size(); ++counter)
+        {
+            mTree.InsertOrAssign(aAddedIncrement[mAddedPosition++], comparator);
+        }
+        mSliceRows = counter;
+
+        if (!ok)
+        {
+            mTracer.Error("RankedSnapshot: increment applying failed");
+            ResetIncrement();
+            return TableIncrementApplicatorState::Error;
+        }
+        if (mDeletedPosition == aDeletedIncrement.size() && mAddedPosition == aAddedIncrement.size())
+        {
+            ResetIncrement();
+            return TableIncrementApplicatorState::Completed;
+        }
+        return TableIncrementApplicatorState::Processing;
+    }
+
+    /**
+     * \brief Количество изменений, примененных последним вызовом ApplyIncrement.
+     */
+    size_t GetSliceRows() const
+    {
+        return mSliceRows;
+    }
+
+    /**
+     * \brief Строки окна [Top, Bottom].
+     */
+    void CopyRows(const TRowRange& aRows, TDataPack& outRows) const
+    {
+        outRows.clear();
+        if (aRows.Top < 0 || aRows.Bottom < aRows.Top)
+        {
+            return;
+        }
+        const auto from = static_cast<size_t>(aRows.Top);
+        const auto to = std::min(static_cast<size_t>(aRows.Bottom) + 1, Size());
+        outRows.reserve(to > from ? to - from : 0);
+        mTree.ForEach(from, to, [&](const auto& aItem)
+        {
+            outRows.push_back(aItem);
+        });
+    }
+
+    /**
+     * \brief Все строки результата по порядку.
+     */
+    void CopyAll(TDataPack& outRows) const
+    {
+        outRows.clear();
+        outRows.reserve(Size());
+        mTree.ForEach([&](const auto& aItem)
+        {
+            outRows.push_back(aItem);
+        });
+    }
+
+private:
+    void ResetIncrement()
+    {
+        mDeletedPosition = 0;
+        mAddedPosition = 0;
+    }
+};
+
+template <typename TData>
+struct NoRankedSnapshot
+{
+    NoRankedSnapshot(Basis::Tracer&)
+    {
+    }
+};
+
+template <typename TSetup, bool = HasRankedSnapshot<TSetup>::value>
+struct RankedSnapshotOf
+{
+    using Type = NoRankedSnapshot<typename TSetup::TData>;
+};
+
+template <typename TSetup>
+struct RankedSnapshotOf<TSetup, true>
+{
+    using Type = typename TSetup::TRankedSnapshot;
+};
+
+}
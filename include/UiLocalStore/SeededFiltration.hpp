@@ -0,0 +1,130 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/IteratorRanges.hpp>
+#include <NewUiServer/UiLocalStore/PackRanges.hpp>
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
+#include <NewUiServer/UiLocalStore/TableFilterman.hpp>
+
+#include <Common/Tracer.hpp>
+
+#include <Common/Pack.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Фильтрация отсортированного результата другой подписки.
+ * \ingroup NewUiServer
+ * Если подписка уточняет другую подписку с тем же порядком сортировки (SubscriptionContainment),
+ * ее результат получается фильтрацией результата этой подписки: строки обходятся через PackRanges,
+ * фильтрация сохраняет порядок, поэтому сортировка не нужна.
+ * Результат исходной подписки удерживается до завершения фильтрации.
+ */
+template <typename TSetup>
+class SeededFiltration
+{
+public:
+    using TData = typename TSetup::TData;
+    using TDataPack = Basis::Pack<TData>;
+    using TSeed = Basis::SPtrPack<TData>;
+    using TUiFilters = TradingSerialization::Table::FilterGroup;
+
+    struct TRangesSetup
+    {
+        using TData = typename TSetup::TData;
+        using TDataPack = Basis::Pack<TData>;
+        using TPackIterator = typename TDataPack::const_iterator;
+        using TPackRanges = IteratorRanges<TPackIterator>;
+    };
+
+    using TRanges = PackRanges<TRangesSetup>;
+    using TFilterman = TableFilterman<TSetup, TRanges>;
+    using TCompiledFilters = typename TFilterman::TCompiledFilters;
+
+private:
+    TSeed mSeed;
+    TRanges mRanges;
+    TFilterman mFilterman;
+
+public:
+    SeededFiltration(Basis::Tracer& aTracer)
+        : mRanges(aTracer)
+        , mFilterman(aTracer)
+    {
+    }
+
+    /**
+     * \brief Запомнить отсортированный результат исходной подписки.
+     */
+    void Seed(const TSeed& aSeed)
+    {
+        assert(!IsInitialized());
+        mSeed = aSeed;
+    }
+
+    bool IsSeeded() const
+    {
+        return mSeed.HasValue();
+    }
+
+    bool IsInitialized() const
+    {
+        return mFilterman.IsInitialized();
+    }
+
+    void Init(const TUiFilters& aFilters, TDataPack& outResult, const TCompiledFilters* aCompiledFilters)
+    {
+        assert(IsSeeded());
+        outResult.reserve(mSeed->size());
+        mRanges.Init(*mSeed);
+        mFilterman.Init(typename TFilterman::TInit { aFilters, outResult, mRanges, aCompiledFilters });
+    }
+
+    TableFiltermanState Process()
+    {
+        return mFilterman.Process();
+    }
+
+    size_t GetSliceRows() const
+    {
+        return mFilterman.GetSliceRows();
+    }
+
+    /**
+     * \brief Освободить результат исходной подписки.
+     */
+    void Reset()
+    {
+        if (mFilterman.IsInitialized())
+        {
+            mFilterman.Reset();
+        }
+        if (mRanges.IsInitialized())
+        {
+            mRanges.Reset();
+        }
+        mSeed = TSeed {};
+    }
+};
+
+template <typename TData>
+struct NoSeededFiltration
+{
+    NoSeededFiltration(Basis::Tracer&)
+    {
+    }
+};
+
+template <typename TSetup, bool = HasSeededFiltration<TSetup>::value>
+struct SeededFiltrationOf
+{
+    using Type = NoSeededFiltration<typename TSetup::TData>;
+};
+
+template <typename TSetup>
+struct SeededFiltrationOf<TSetup, true>
+{
+    using Type = typename TSetup::TSeededFiltration;
+};
+
+}
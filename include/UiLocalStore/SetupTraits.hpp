@@ -0,0 +1,445 @@
+#pragma once
+
+#include <Common/Collections.hpp>
+#include <Common/SPtr.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Проверки необязательных параметров сетапов.
+ * \ingroup NewUiServer
+ * Дополнительные возможности хранилища включаются только для тех сетапов,
+ * в которых они явно объявлены. Остальные сетапы не требуют изменений.
+ */
+template <typename TSetup, typename = void>
+struct HasColumnarSnapshot : std::false_type
+{
+};
+
+template <typename TSetup>
+struct HasColumnarSnapshot<TSetup, std::void_t<typename TSetup::TColumnarSnapshot>> : std::true_type
+{
+};
+
+/**
+ * \brief Собираются ли изменения каждой версии хранилища один раз для всех подписок (TSetup::TVersionDeltaCache).
+ * \ingroup NewUiServer
+ */
+template <typename TSetup, typename = void>
+struct HasVersionDeltaCache : std::false_type
+{
+};
+
+template <typename TSetup>
+struct HasVersionDeltaCache<TSetup, std::void_t<typename TSetup::TVersionDeltaCache>> : std::true_type
+{
+};
+
+/**
+ * \brief Хешер id элементов хранилища.
+ * \ingroup NewUiServer
+ * Берется из TSetup::TIdHasher, если он объявлен, иначе используется std::hash.
+ */
+template <typename TSetup, typename TId, typename = void>
+struct IdHasherOf
+{
+    using Type = std::hash<TId>;
+};
+
+template <typename TSetup, typename TId>
+struct IdHasherOf<TSetup, TId, std::void_t<typename TSetup::TIdHasher>>
+{
+    using Type = typename TSetup::TIdHasher;
+};
+
+/**
+ * \brief Аллокатор узлов хранилища.
+ * \ingroup NewUiServer
+ * Берется из шаблона TSetup::TNodeAllocator, если он объявлен, иначе используется std::allocator.
+ */
+template <typename TSetup, typename T, typename = void>
+struct NodeAllocatorOf
+{
+    using Type = std::allocator<T>;
+};
+
+template <typename TSetup, typename T>
+struct NodeAllocatorOf<TSetup, T, std::void_t<typename TSetup::template TNodeAllocator<T>>>
+{
+    using Type = typename TSetup::template TNodeAllocator<T>;
+};
+
+/**
+ * \brief Бюджет времени на применение входящих данных за один рекол.
+ * \ingroup NewUiServer
+ * Берется из TSetup::IncomingTimeBudget, если он объявлен.
+ * Иначе данные применяются порциями фиксированного размера.
+ */
+template <typename TSetup, typename = void>
+struct IncomingTimeBudgetOf
+{
+    static constexpr std::optional<std::chrono::microseconds> Value = std::nullopt;
+};
+
+template <typename TSetup>
+struct IncomingTimeBudgetOf<TSetup, std::void_t<decltype(TSetup::IncomingTimeBudget)>>
+{
+    static constexpr std::optional<std::chrono::microseconds> Value = std::chrono::microseconds { TSetup::IncomingTimeBudget };
+};
+
+/**
+ * \brief Разрешена ли поразрядная сортировка в TableSorter.
+ * \ingroup NewUiServer
+ * Берется из TSetup::UseRadixSort, если он объявлен.
+ */
+template <typename TSetup, typename = void>
+struct UseRadixSortOf : std::false_type
+{
+};
+
+template <typename TSetup>
+struct UseRadixSortOf<TSetup, std::void_t<decltype(TSetup::UseRadixSort)>>
+    : std::integral_constant<bool, TSetup::UseRadixSort>
+{
+};
+
+/**
+ * \brief Обрабатываются ли одинаковые подписки одним обработчиком.
+ * \ingroup NewUiServer
+ * Берется из TSetup::ShareIdenticalSubscriptions, если он объявлен.
+ */
+template <typename TSetup, typename = void>
+struct ShareIdenticalSubscriptionsOf : std::false_type
+{
+};
+
+template <typename TSetup>
+struct ShareIdenticalSubscriptionsOf<TSetup, std::void_t<decltype(TSetup::ShareIdenticalSubscriptions)>>
+    : std::integral_constant<bool, TSetup::ShareIdenticalSubscriptions>
+{
+};
+
+/**
+ * \brief Выполняются ли шаги табличных подписок на пуле потоков контейнера подписок.
+ * \ingroup NewUiServer
+ * Берется из TSetup::ProcessSubscriptionsInParallel, если он объявлен. Объявляя его, сетап подтверждает,
+ * что трейсер и обработчики подписок допускают вызовы из нескольких потоков одновременно.
+ */
+template <typename TSetup, typename = void>
+struct ProcessSubscriptionsInParallelOf : std::false_type
+{
+};
+
+template <typename TSetup>
+struct ProcessSubscriptionsInParallelOf<TSetup, std::void_t<decltype(TSetup::ProcessSubscriptionsInParallel)>>
+    : std::integral_constant<bool, TSetup::ProcessSubscriptionsInParallel>
+{
+};
+
+/**
+ * \brief Заполняются ли новые подписки из результата более широкой подписки.
+ * \ingroup NewUiServer
+ * Берется из TSetup::SeedNarrowerSubscriptions, если он объявлен.
+ */
+template <typename TSetup, typename = void>
+struct SeedNarrowerSubscriptionsOf : std::false_type
+{
+};
+
+template <typename TSetup>
+struct SeedNarrowerSubscriptionsOf<TSetup, std::void_t<decltype(TSetup::SeedNarrowerSubscriptions)>>
+    : std::integral_constant<bool, TSetup::SeedNarrowerSubscriptions>
+{
+};
+
+/**
+ * \brief Будятся ли при обновлении только подписки, которые могут затронуть изменения версии.
+ * \ingroup NewUiServer
+ * Берется из TSetup::RouteUpdatesByPredicates, если он объявлен.
+ */
+template <typename TSetup, typename = void>
+struct RouteUpdatesByPredicatesOf : std::false_type
+{
+};
+
+template <typename TSetup>
+struct RouteUpdatesByPredicatesOf<TSetup, std::void_t<decltype(TSetup::RouteUpdatesByPredicates)>>
+    : std::integral_constant<bool, TSetup::RouteUpdatesByPredicates>
+{
+};
+
+/**
+ * \brief Есть ли у контейнера подписок обратный индекс фильтров (TSetup::TSubscriptionPredicateIndex).
+ * \ingroup NewUiServer
+ */
+template <typename TSetup, typename = void>
+struct HasSubscriptionPredicateIndex : std::false_type
+{
+};
+
+template <typename TSetup>
+struct HasSubscriptionPredicateIndex<TSetup, std::void_t<typename TSetup::TSubscriptionPredicateIndex>>
+    : std::true_type
+{
+};
+
+/**
+ * \brief Переводятся ли отставшие подписки сразу на текущую версию одним инкрементом.
+ * \ingroup NewUiServer
+ * Берется из TSetup::CoalesceVersions, если он объявлен.
+ */
+template <typename TSetup, typename = void>
+struct CoalesceVersionsOf : std::false_type
+{
+};
+
+template <typename TSetup>
+struct CoalesceVersionsOf<TSetup, std::void_t<decltype(TSetup::CoalesceVersions)>>
+    : std::integral_constant<bool, TSetup::CoalesceVersions>
+{
+};
+
+/**
+ * \brief Строит ли расчет инкремента инкремент по интервалу версий (TMaker::SupportsVersionInterval).
+ * \ingroup NewUiServer
+ */
+template <typename TMaker, typename = void>
+struct SupportsVersionIntervalOf : std::false_type
+{
+};
+
+template <typename TMaker>
+struct SupportsVersionIntervalOf<TMaker, std::void_t<decltype(TMaker::SupportsVersionInterval)>>
+    : std::integral_constant<bool, TMaker::SupportsVersionInterval>
+{
+};
+
+/**
+ * \brief Есть ли у контейнера подписок планировщик обработки (TSetup::TSubscriptionScheduler).
+ * \ingroup NewUiServer
+ */
+template <typename TSetup, typename = void>
+struct HasSubscriptionScheduler : std::false_type
+{
+};
+
+template <typename TSetup>
+struct HasSubscriptionScheduler<TSetup, std::void_t<typename TSetup::TSubscriptionScheduler>> : std::true_type
+{
+};
+
+/**
+ * \brief Сообщает ли обработчик подписки число обработанных строк (GetProcessedRows).
+ * \ingroup NewUiServer
+ */
+template <typename TActor, typename = void>
+struct HasProcessedRows : std::false_type
+{
+};
+
+template <typename TActor>
+struct HasProcessedRows<TActor, std::void_t<decltype(std::declval<const TActor&>().GetProcessedRows())>>
+    : std::true_type
+{
+};
+
+/**
+ * \brief Сообщает ли операция число строк, просмотренных последним вызовом Process (GetSliceRows).
+ * \ingroup NewUiServer
+ */
+template <typename TOperation, typename = void>
+struct HasSliceRows : std::false_type
+{
+};
+
+template <typename TOperation>
+struct HasSliceRows<TOperation, std::void_t<decltype(std::declval<const TOperation&>().GetSliceRows())>>
+    : std::true_type
+{
+};
+
+/**
+ * \brief Сообщает ли обработчик подписки самую старую версию, строки которой ему нужны (GetOldestReadVersion).
+ * \ingroup NewUiServer
+ */
+template <typename TActor, typename = void>
+struct HasOldestReadVersion : std::false_type
+{
+};
+
+template <typename TActor>
+struct HasOldestReadVersion<TActor, std::void_t<decltype(std::declval<const TActor&>().GetOldestReadVersion())>>
+    : std::true_type
+{
+};
+
+/**
+ * \brief Задан ли в сетапе пул потоков (TSetup::GetWorkerPool()).
+ * \ingroup NewUiServer
+ */
+template <typename TSetup, typename = void>
+struct HasWorkerPool : std::false_type
+{
+};
+
+template <typename TSetup>
+struct HasWorkerPool<TSetup, std::void_t<decltype(TSetup::GetWorkerPool())>> : std::true_type
+{
+};
+
+/**
+ * \brief Принимает ли контейнер подписок пул потоков (SetWorkerPool).
+ * \ingroup NewUiServer
+ */
+template <typename TContainer, typename = void>
+struct HasSetWorkerPool : std::false_type
+{
+};
+
+template <typename TContainer>
+struct HasSetWorkerPool<TContainer, std::void_t<decltype(std::declval<TContainer&>().SetWorkerPool(nullptr))>>
+    : std::true_type
+{
+};
+
+/**
+ * \brief Тип строк результата обработчика подписки (TActor::TData), void - если не объявлен.
+ * \ingroup NewUiServer
+ */
+template <typename TActor, typename = void>
+struct ActorDataOf
+{
+    using Type = void;
+};
+
+template <typename TActor>
+struct ActorDataOf<TActor, std::void_t<typename TActor::TData>>
+{
+    using Type = typename TActor::TData;
+};
+
+/**
+ * \brief Поддерживает ли хранилище загрузку первой версии одним пакетом.
+ * \ingroup NewUiServer
+ */
+template <typename TMap, typename TData, typename = void>
+struct HasBulkLoad : std::false_type
+{
+};
+
+template <typename TMap, typename TData>
+struct HasBulkLoad<TMap, TData, std::void_t<decltype(std::declval<TMap&>().BulkLoad(
+    std::declval<Basis::Vector<Basis::SPtr<TData>>&&>(),
+    std::declval<int64_t>()))>> : std::true_type
+{
+};
+
+/**
+ * \brief Нужно ли сообщать хранилищу о фиксации версии.
+ * \ingroup NewUiServer
+ */
+template <typename TMap, typename = void>
+struct HasCommitVersion : std::false_type
+{
+};
+
+template <typename TMap>
+struct HasCommitVersion<TMap, std::void_t<decltype(std::declval<TMap&>().CommitVersion(std::declval<int64_t>()))>>
+    : std::true_type
+{
+};
+
+/**
+ * \brief Упорядочивает ли табличная подписка только запрошенное окно строк (TSetup::TWindowedTableSorter).
+ * \ingroup NewUiServer
+ */
+template <typename TSetup, typename = void>
+struct HasWindowedTableSorter : std::false_type
+{
+};
+
+template <typename TSetup>
+struct HasWindowedTableSorter<TSetup, std::void_t<typename TSetup::TWindowedTableSorter>> : std::true_type
+{
+};
+
+/**
+ * \brief Принимает ли обработчик подписки окно строк (SetRowWindow).
+ * \ingroup NewUiServer
+ */
+template <typename TActor, typename TRowRange, typename = void>
+struct HasRowWindow : std::false_type
+{
+};
+
+template <typename TActor, typename TRowRange>
+struct HasRowWindow<TActor, TRowRange, std::void_t<decltype(std::declval<TActor&>().SetRowWindow(
+    std::declval<const TRowRange&>()))>> : std::true_type
+{
+};
+
+/**
+ * \brief Хранит ли табличная подписка результат в упорядоченном дереве (TSetup::TRankedSnapshot).
+ * \ingroup NewUiServer
+ */
+template <typename TSetup, typename = void>
+struct HasRankedSnapshot : std::false_type
+{
+};
+
+template <typename TSetup>
+struct HasRankedSnapshot<TSetup, std::void_t<typename TSetup::TRankedSnapshot>> : std::true_type
+{
+};
+
+/**
+ * \brief Может ли обработчик подписки отправить только строки окна (GetRowWindowResult).
+ * \ingroup NewUiServer
+ */
+template <typename TActor, typename = void>
+struct HasRowWindowResult : std::false_type
+{
+};
+
+template <typename TActor>
+struct HasRowWindowResult<TActor, std::void_t<decltype(std::declval<const TActor&>().GetRowWindowResult())>>
+    : std::true_type
+{
+};
+
+/**
+ * \brief Может ли табличная подписка фильтровать результат другой подписки (TSetup::TSeededFiltration).
+ * \ingroup NewUiServer
+ */
+template <typename TSetup, typename = void>
+struct HasSeededFiltration : std::false_type
+{
+};
+
+template <typename TSetup>
+struct HasSeededFiltration<TSetup, std::void_t<typename TSetup::TSeededFiltration>> : std::true_type
+{
+};
+
+/**
+ * \brief Есть ли у умного указателя счетчик ссылок.
+ * \ingroup NewUiServer
+ */
+template <typename TPtr, typename = void>
+struct HasUseCount : std::false_type
+{
+};
+
+template <typename TPtr>
+struct HasUseCount<TPtr, std::void_t<decltype(std::declval<const TPtr&>().use_count())>> : std::true_type
+{
+};
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <Common/Collections.hpp>
+#include <Common/Pack.hpp>
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Пул временных буферов сортировки.
+ * \ingroup NewUiServer
+ * Общий для всех подписок одного хранилища, владеет им UiCacheLogic.
+ * Подписка берет буфер на время сортировки и возвращает его после завершения.
+ * Буферы хранятся по классам размеров (степени двойки), класс определяется по емкости буфера,
+ * поэтому возвращать можно любой буфер, в том числе обменянный сортировальщиком с результатом.
+ * Возвращенный буфер очищается и не держит элементы данных.
+ * Подписки, обрабатываемые на пуле потоков (SubscriptionsContainer::SetWorkerPool), берут и возвращают
+ * буферы параллельно, поэтому операции пула выполняются под мьютексом.
+ */
+template <typename TData>
+class SortBufferPool
+{
+public:
+    using TDataPack = Basis::Pack<TData>;
+
+    /// Минимальный класс размера. Меньшие буферы не хранятся.
+    static constexpr size_t MinClassSize = 1024;
+    static constexpr size_t ClassesCount = 24;
+    /// Сколько свободных буферов хранится в одном классе.
+    static constexpr size_t MaxBuffersPerClass = 4;
+
+    /**
+     * \brief Метрики пула.
+     */
+    struct Stats
+    {
+        /// Сколько раз буфер был выдан.
+        size_t AcquireCount = 0;
+        /// Сколько раз был выдан ранее возвращенный буфер.
+        size_t ReuseCount = 0;
+        /// Сколько возвращенных буферов не поместилось в пул.
+        size_t DropCount = 0;
+        /// Сколько буферов выдано и не возвращено.
+        size_t BorrowedCount = 0;
+        size_t PeakBorrowedCount = 0;
+        /// Суммарная емкость свободных буферов в элементах.
+        size_t PooledElements = 0;
+        size_t PeakPooledElements = 0;
+    };
+
+private:
+    mutable std::mutex mMutex;
+    std::array<Basis::Vector<TDataPack>, ClassesCount> mClasses;
+    Stats mStats;
+
+public:
+    /**
+     * \brief Взять буфер емкостью не меньше aSize.
+     */
+    TDataPack Acquire(size_t aSize)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mStats.AcquireCount;
+        ++mStats.BorrowedCount;
+        mStats.PeakBorrowedCount = std::max(mStats.PeakBorrowedCount, mStats.BorrowedCount);
+
+        const auto index = GetClassIndex(aSize);
+        if (index >= ClassesCount)
+        {
+            TDataPack result;
+            result.reserve(aSize);
+            return result;
+        }
+
+        auto& buffers = mClasses[index];
+        if (!buffers.empty())
+        {
+            auto result = std::move(buffers.back());
+            buffers.pop_back();
+            mStats.PooledElements -= result.capacity();
+            ++mStats.ReuseCount;
+            return result;
+        }
+
+        TDataPack result;
+        result.reserve(GetClassSize(index));
+        return result;
+    }
+
+    /**
+     * \brief Вернуть буфер в пул.
+     */
+    void Release(TDataPack&& aBuffer)
+    {
+        aBuffer.clear();
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mStats.BorrowedCount > 0)
+        {
+            --mStats.BorrowedCount;
+        }
+
+        const auto capacity = aBuffer.capacity();
+        if (capacity < MinClassSize)
+        {
+            return;
+        }
+
+        /// Класс, емкость которого гарантированно обеспечивается буфером.
+        auto index = GetClassIndex(capacity);
+        if (index >= ClassesCount || GetClassSize(index) > capacity)
+        {
+            --index;
+        }
+        index = std::min(index, ClassesCount - 1);
+
+        auto& buffers = mClasses[index];
+        if (buffers.size() >= MaxBuffersPerClass)
+        {
+            ++mStats.DropCount;
+            return;
+        }
+        buffers.push_back(std::move(aBuffer));
+        mStats.PooledElements += capacity;
+        mStats.PeakPooledElements = std::max(mStats.PeakPooledElements, mStats.PooledElements);
+    }
+
+    /**
+     * \brief Освободить все свободные буферы.
+     */
+    void Shrink()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& buffers : mClasses)
+        {
+            buffers.clear();
+        }
+        mStats.PooledElements = 0;
+    }
+
+    Stats GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+private:
+    static constexpr size_t GetClassSize(size_t aIndex)
+    {
+        return MinClassSize << aIndex;
+    }
+
+    /**
+     * \brief Наименьший класс, вмещающий aSize элементов.
+     */
+    static size_t GetClassIndex(size_t aSize)
+    {
+        size_t index = 0;
+        while (index < ClassesCount && GetClassSize(index) < aSize)
+        {
+            ++index;
+        }
+        return index;
+    }
+};
+
+}
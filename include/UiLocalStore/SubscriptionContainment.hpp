@@ -0,0 +1,44 @@
+#pragma once
+
+#include "TradingSerialization/Table/Columns.hpp"
+#include "TradingSerialization/Table/Subscription.hpp"
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Вложенность результатов табличных подписок.
+ * \ingroup NewUiServer
+ * Подписка уточняет другую, если каждая ее строка входит в результат другой подписки,
+ * а порядок сортировки совпадает. Тогда ее результат можно получить фильтрацией
+ * отсортированного результата другой подписки, без обхода хранилища и без сортировки.
+ * Проверка консервативна: если вложенность не удается доказать по фильтрам, возвращается false.
+ */
+class SubscriptionContainment
+{
+public:
+    /**
+     * \brief Уточняет ли aChild подписку aParent.
+     * Каждый фильтр aParent должен следовать из какого-либо фильтра aChild.
+     */
+    static bool IsRefinement(
+        const TradingSerialization::Table::SubscribeBase& aParent,
+        const TradingSerialization::Table::SubscribeBase& aChild);
+
+    /**
+     * \brief Входит ли каждая строка, проходящая aChild, в строки, проходящие aParent.
+     */
+    static bool IsFilterRefinement(
+        const TradingSerialization::Table::FilterGroup& aParent,
+        const TradingSerialization::Table::FilterGroup& aChild);
+
+    /**
+     * \brief Следует ли aOther из aFilter: любое значение, проходящее aFilter, проходит aOther.
+     * Поддерживаются вложенные списки In, сужение границ и список In внутри границы.
+     */
+    static bool Implies(
+        const TradingSerialization::Table::Filter& aFilter,
+        const TradingSerialization::Table::Filter& aOther);
+};
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "TradingSerialization/Table/Columns.hpp"
+#include "TradingSerialization/Table/Subscription.hpp"
+
+#include <string>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Канонический ключ табличной подписки.
+ * \ingroup NewUiServer
+ * Подписки с равными ключами дают одинаковый результат и могут обрабатываться одним обработчиком.
+ * Ключ строится из порядка сортировки и нормализованной группы фильтров:
+ * - значения фильтра In упорядочиваются, повторы удаляются;
+ * - фильтры упорядочиваются по колонке, затем по оператору и значениям.
+ * Порядок колонок сортировки сохраняется.
+ * Вещественные значения записываются с точностью, достаточной для восстановления double, поэтому разные
+ * значения дают разные ключи, даже если Basis::Real считает их равными. Строки записываются с длиной.
+ */
+class SubscriptionKey
+{
+    std::string mValue;
+    size_t mHash = 0;
+
+public:
+    struct Hasher
+    {
+        size_t operator()(const SubscriptionKey& aKey) const
+        {
+            return aKey.mHash;
+        }
+    };
+
+    SubscriptionKey() = default;
+
+    static SubscriptionKey Make(const TradingSerialization::Table::SubscribeBase& aSubscription);
+
+    const std::string& GetValue() const
+    {
+        return mValue;
+    }
+
+    friend bool operator ==(const SubscriptionKey& aLhs, const SubscriptionKey& aRhs)
+    {
+        return aLhs.mHash == aRhs.mHash && aLhs.mValue == aRhs.mValue;
+    }
+
+    friend bool operator !=(const SubscriptionKey& aLhs, const SubscriptionKey& aRhs)
+    {
+        return !(aLhs == aRhs);
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const SubscriptionKey& aKey)
+    {
+        return out << aKey.mValue;
+    }
+};
+
+}
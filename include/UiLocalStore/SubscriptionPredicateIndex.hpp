@@ -0,0 +1,444 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
+#include <NewUiServer/UiLocalStore/TableUtils.hpp>
+#include <NewUiServer/UiLocalStore/VersionDeltaCache.hpp>
+
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Common/Collections.hpp>
+
+#include <boost/mpl/size.hpp>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Обратный индекс фильтров табличных подписок.
+ * \ingroup NewUiServer
+ * По изменениям версии хранилища находит подписки, результат которых может измениться.
+ * Для каждой подписки индексируется один ключевой фильтр группы And:
+ * - оператор In по строковой или целой колонке - по значениям;
+ * - иначе операторы сравнения по одной строковой или целой колонке - как отрезок с включенными границами.
+ * Остальные фильтры подписки не проверяются, поэтому индекс может вернуть лишнюю подписку, но не пропустит нужную.
+ * Подписки без подходящего фильтра (другое отношение, только дробные или некорректные колонки)
+ * считаются затронутыми любым изменением.
+ * Строка, значение которой имеет другой тип, чем значение фильтра, затрагивает все подписки по этой колонке:
+ * такую строку подписка должна обработать сама.
+ *
+ * Индекс хранит изменения версий, еще нужных подпискам (AddVersionDelta),
+ * и один раз на версию вычисляет затронутые ими подписки.
+ * Если изменения версии неизвестны, затронутыми считаются все подписки.
+ */
+template <typename TTableSetup, typename TData, typename TKey, typename TKeyHasher = std::hash<TKey>>
+class SubscriptionPredicateIndex
+{
+public:
+    using TUiColumnType = TradingSerialization::Table::TColumnType;
+    using TUiFilter = TradingSerialization::Table::Filter;
+    using TUiFilters = TradingSerialization::Table::FilterGroup;
+    using TFilterOperator = TradingSerialization::Table::FilterOperator;
+    using TCellVariant = TradingSerialization::Table::TCellVariant;
+
+    using TDelta = VersionDelta<TData>;
+    using TDeltaPtr = std::shared_ptr<const TDelta>;
+    using TKeys = Basis::UnorderedSet<TKey, TKeyHasher>;
+
+private:
+    static constexpr size_t TypesCount = boost::mpl::size<TCellVariant::types>::value;
+
+    struct Predicate
+    {
+        TUiColumnType Column;
+        /// Номер типа значений фильтра в TCellVariant.
+        size_t Type = 0;
+        /// Значения оператора In.
+        Basis::Vector<TCellVariant> Values;
+        /// Границы отрезка для операторов сравнения.
+        std::optional<TCellVariant> Lower;
+        std::optional<TCellVariant> Upper;
+    };
+
+    struct ColumnPredicates
+    {
+        /// Подписки по значениям оператора In.
+        Basis::Map<TCellVariant, TKeys> ByValue;
+        /// Подписки с отрезком по колонке.
+        TKeys Ranges;
+        /// Все подписки по колонке по типу значений фильтра.
+        std::array<TKeys, TypesCount> ByType;
+    };
+
+    Basis::UnorderedMap<TKey, Predicate, TKeyHasher> mPredicates;
+    Basis::Map<TUiColumnType, ColumnPredicates> mColumns;
+    /// Подписки, затрагиваемые любым изменением.
+    TKeys mAlwaysAffected;
+
+    struct VersionRoute
+    {
+        TDeltaPtr Delta;
+        /// Затронутые подписки, вычисляются при первом запросе.
+        std::optional<TKeys> Affected;
+    };
+
+    Basis::Map<TDataVersion, VersionRoute> mVersions;
+
+public:
+    /**
+     * \brief Добавить подписку aKey с фильтрами aFilters.
+     * Прежние фильтры подписки с тем же ключом заменяются.
+     */
+    void Add(const TKey& aKey, const TUiFilters& aFilters)
+    {
+        Remove(aKey);
+        ResetAffected();
+
+        auto predicate = MakePredicate(aFilters);
+        if (!predicate)
+        {
+            mAlwaysAffected.insert(aKey);
+            return;
+        }
+
+        auto& column = mColumns[predicate->Column];
+        for (const auto& value : predicate->Values)
+        {
+            column.ByValue[value].insert(aKey);
+        }
+        if (predicate->Values.empty())
+        {
+            column.Ranges.insert(aKey);
+        }
+        column.ByType[predicate->Type].insert(aKey);
+        mPredicates.emplace(aKey, std::move(*predicate));
+    }
+
+    void Remove(const TKey& aKey)
+    {
+        if (mAlwaysAffected.erase(aKey))
+        {
+            return;
+        }
+
+        const auto it = mPredicates.find(aKey);
+        if (it == mPredicates.cend())
+        {
+            return;
+        }
+
+        const auto& predicate = it->second;
+        const auto columnIt = mColumns.find(predicate.Column);
+        assert(columnIt != mColumns.cend());
+        auto& column = columnIt->second;
+        for (const auto& value : predicate.Values)
+        {
+            const auto valueIt = column.ByValue.find(value);
+            assert(valueIt != column.ByValue.cend());
+            valueIt->second.erase(aKey);
+            if (valueIt->second.empty())
+            {
+                column.ByValue.erase(valueIt);
+            }
+        }
+        column.Ranges.erase(aKey);
+        column.ByType[predicate.Type].erase(aKey);
+        if (std::all_of(column.ByType.cbegin(), column.ByType.cend(), [](const auto& aKeys) { return aKeys.empty(); }))
+        {
+            mColumns.erase(columnIt);
+        }
+        mPredicates.erase(it);
+    }
+
+    void Clear()
+    {
+        mPredicates.clear();
+        mColumns.clear();
+        mAlwaysAffected.clear();
+        mVersions.clear();
+    }
+
+    void AddVersionDelta(TDataVersion aVersion, TDeltaPtr aDelta)
+    {
+        if (aDelta)
+        {
+            mVersions[aVersion] = VersionRoute { std::move(aDelta), std::nullopt };
+        }
+    }
+
+    /**
+     * \brief Удалить изменения версий до aVersion.
+     */
+    void ErasePrevious(TDataVersion aVersion)
+    {
+        mVersions.erase(mVersions.begin(), mVersions.lower_bound(aVersion));
+    }
+
+    /**
+     * \brief Может ли версия aVersion изменить результат подписки aKey.
+     */
+    bool IsAffected(const TKey& aKey, TDataVersion aVersion)
+    {
+        const auto it = mVersions.find(aVersion);
+        if (it == mVersions.end())
+        {
+            return true;
+        }
+        auto& route = it->second;
+        if (!route.Affected)
+        {
+            route.Affected = GetAffected(*route.Delta);
+        }
+        return route.Affected->count(aKey) != 0;
+    }
+
+    size_t Size() const
+    {
+        return mPredicates.size() + mAlwaysAffected.size();
+    }
+
+    /**
+     * \brief Подписки, результат которых могут изменить строки aDelta.
+     * Проверяются и новые, и перезаписанные строки: строка могла как войти в результат, так и выйти из него.
+     */
+    TKeys GetAffected(const TDelta& aDelta) const
+    {
+        TKeys result = mAlwaysAffected;
+
+        Basis::Vector<TCellVariant> values;
+        for (const auto& [columnType, column] : mColumns)
+        {
+            values.clear();
+            CollectValues(aDelta.Added, columnType, values);
+            CollectValues(aDelta.Deleted, columnType, values);
+            if (values.empty())
+            {
+                continue;
+            }
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+
+            std::array<bool, TypesCount> hasType {};
+            for (const auto& value : values)
+            {
+                hasType[value.which()] = true;
+                const auto valueIt = column.ByValue.find(value);
+                if (valueIt != column.ByValue.cend())
+                {
+                    result.insert(valueIt->second.cbegin(), valueIt->second.cend());
+                }
+            }
+
+            for (size_t type = 0; type < TypesCount; ++type)
+            {
+                if (HasOtherType(hasType, type))
+                {
+                    result.insert(column.ByType[type].cbegin(), column.ByType[type].cend());
+                }
+            }
+
+            for (const auto& key : column.Ranges)
+            {
+                if (!result.count(key) && HasValueInRange(values, mPredicates.at(key)))
+                {
+                    result.insert(key);
+                }
+            }
+        }
+        return result;
+    }
+
+private:
+    void ResetAffected()
+    {
+        for (auto& [version, route] : mVersions)
+        {
+            route.Affected.reset();
+        }
+    }
+
+    /**
+     * \brief Выбрать ключевой фильтр подписки.
+     * Оператор In предпочтительнее отрезка: по нему подписка находится поиском по значению.
+     */
+    static std::optional<Predicate> MakePredicate(const TUiFilters& aFilters)
+    {
+        if (aFilters.Relation != TradingSerialization::Table::FilterRelation::And)
+        {
+            return std::nullopt;
+        }
+
+        /// Подписка с некорректной колонкой завершится ошибкой при любом изменении.
+        const auto& filters = aFilters.Filters;
+        if (!std::all_of(filters.cbegin(), filters.cend(), [](const auto& aFilter)
+            {
+                return TableUtils<TTableSetup>::ColumnTypeIsValid(aFilter.Column);
+            }))
+        {
+            return std::nullopt;
+        }
+
+        std::optional<Predicate> range;
+        for (const auto& filter : filters)
+        {
+            Basis::Vector<TCellVariant> values;
+            if (!GetIndexedValues(filter, values))
+            {
+                continue;
+            }
+
+            const auto type = static_cast<size_t>(values.front().which());
+            if (filter.Operator == TFilterOperator::In)
+            {
+                return Predicate { filter.Column, type, std::move(values), std::nullopt, std::nullopt };
+            }
+
+            if (!range)
+            {
+                range = Predicate { filter.Column, type, {}, std::nullopt, std::nullopt };
+            }
+            else if (range->Column != filter.Column || range->Type != type)
+            {
+                continue;
+            }
+            AddBound(filter.Operator, std::move(values.front()), *range);
+        }
+        return range;
+    }
+
+    /**
+     * \brief Значения строкового или целого фильтра одного типа.
+     */
+    static bool GetIndexedValues(const TUiFilter& aFilter, Basis::Vector<TCellVariant>& outValues)
+    {
+        const auto& values = aFilter.Values;
+        if (!values.FloatValues.empty()
+            || values.StringValues.empty() == values.IntValues.empty())
+        {
+            return false;
+        }
+        if (aFilter.Operator != TFilterOperator::In && values.Size() != 1)
+        {
+            return false;
+        }
+
+        outValues.insert(outValues.end(), values.StringValues.cbegin(), values.StringValues.cend());
+        outValues.insert(outValues.end(), values.IntValues.cbegin(), values.IntValues.cend());
+        return true;
+    }
+
+    /// Строгие границы расширяются до нестрогих, что допустимо для поиска затронутых подписок.
+    static void AddBound(TFilterOperator aOperator, TCellVariant&& aValue, Predicate& outPredicate)
+    {
+        switch (aOperator)
+        {
+        case TFilterOperator::Greater:
+        case TFilterOperator::GreaterEq:
+            if (!outPredicate.Lower || *outPredicate.Lower < aValue)
+            {
+                outPredicate.Lower = std::move(aValue);
+            }
+            break;
+        case TFilterOperator::Less:
+        case TFilterOperator::LessEq:
+            if (!outPredicate.Upper || aValue < *outPredicate.Upper)
+            {
+                outPredicate.Upper = std::move(aValue);
+            }
+            break;
+        case TFilterOperator::In:
+            assert(false);
+            break;
+        }
+    }
+
+    template <typename TRows>
+    static void CollectValues(const TRows& aRows, TUiColumnType aColumn, Basis::Vector<TCellVariant>& outValues)
+    {
+        for (const auto& row : aRows)
+        {
+            outValues.push_back(row->GetValue(static_cast<typename TData::TColumnType>(aColumn)));
+        }
+    }
+
+    static bool HasOtherType(const std::array<bool, TypesCount>& aHasType, size_t aType)
+    {
+        for (size_t type = 0; type < TypesCount; ++type)
+        {
+            if (type != aType && aHasType[type])
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * \brief Есть ли среди отсортированных значений значение из отрезка предиката.
+     * Незаполненное значение меньше любого заполненного, как в CompiledFilterGroup.
+     */
+    static bool HasValueInRange(const Basis::Vector<TCellVariant>& aSortedValues, const Predicate& aPredicate)
+    {
+        const auto it = aPredicate.Lower
+            ? std::lower_bound(aSortedValues.cbegin(), aSortedValues.cend(), *aPredicate.Lower)
+            : std::find_if(aSortedValues.cbegin(), aSortedValues.cend(), [&](const auto& aValue)
+                {
+                    return static_cast<size_t>(aValue.which()) == aPredicate.Type;
+                });
+        return it != aSortedValues.cend()
+            && static_cast<size_t>(it->which()) == aPredicate.Type
+            && (!aPredicate.Upper || !(*aPredicate.Upper < *it));
+    }
+};
+
+/**
+ * \brief Заглушка для контейнеров подписок без обратного индекса фильтров.
+ */
+struct NoSubscriptionPredicateIndex
+{
+    template <typename TKey, typename TFilters>
+    void Add(const TKey&, const TFilters&)
+    {
+    }
+
+    template <typename TKey>
+    void Remove(const TKey&)
+    {
+    }
+
+    void Clear()
+    {
+    }
+
+    template <typename TDeltaPtr>
+    void AddVersionDelta(TDataVersion, const TDeltaPtr&)
+    {
+    }
+
+    void ErasePrevious(TDataVersion)
+    {
+    }
+
+    template <typename TKey>
+    bool IsAffected(const TKey&, TDataVersion)
+    {
+        return true;
+    }
+};
+
+template <typename TSetup, bool = HasSubscriptionPredicateIndex<TSetup>::value>
+struct SubscriptionPredicateIndexOf
+{
+    using Type = NoSubscriptionPredicateIndex;
+};
+
+template <typename TSetup>
+struct SubscriptionPredicateIndexOf<TSetup, true>
+{
+    using Type = typename TSetup::TSubscriptionPredicateIndex;
+};
+
+}
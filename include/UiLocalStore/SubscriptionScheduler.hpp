@@ -0,0 +1,135 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Класс обработки подписки.
+ * \ingroup NewUiServer
+ */
+enum class SchedulingClass
+{
+    /// Применение обновлений к готовому результату.
+    Increment,
+    /// Построение первого результата подписки.
+    Snapshot,
+    /// Число классов, не является классом обработки.
+    Count
+};
+
+inline constexpr size_t SchedulingClassesCount = static_cast<size_t>(SchedulingClass::Count);
+
+/**
+ * \brief Планировщик обработки подписок: deficit round robin по классам обработки.
+ * \ingroup NewUiServer
+ * Стоимость обработки считается в строках. За каждый обход класс с подписками в обработке получает
+ * свою квоту строк и обрабатывается, пока квота не исчерпана, стоимость обработки вычитается из квоты.
+ * Перерасход переносится на следующий обход, поэтому большие снапшоты не вытесняют обновления,
+ * а обновления, квота которых больше, не останавливают построение снапшотов.
+ * Внутри класса подписки обрабатываются по очереди, это обеспечивает контейнер подписок.
+ */
+template <int64_t SnapshotQuantum = 1024, int64_t IncrementQuantum = 4 * SnapshotQuantum>
+class SubscriptionScheduler
+{
+    static_assert(SnapshotQuantum > 0 && IncrementQuantum > 0);
+
+    std::array<int64_t, SchedulingClassesCount> mDeficits {};
+    /// Обход начинается с обновлений.
+    SchedulingClass mCurrent = SchedulingClass::Snapshot;
+    /// При последнем выборе подписки в обработке были в обоих классах.
+    bool mIsContended = false;
+
+public:
+    /**
+     * \brief Выбрать класс для очередной обработки.
+     * Хотя бы в одном классе должны быть подписки в обработке.
+     */
+    SchedulingClass Select(bool aHasIncrements, bool aHasSnapshots)
+    {
+        assert(aHasIncrements || aHasSnapshots);
+        mIsContended = aHasIncrements && aHasSnapshots;
+        if (!mIsContended)
+        {
+            /// Единственный активный класс обрабатывается без квоты и не накапливает долг.
+            mCurrent = aHasIncrements ? SchedulingClass::Increment : SchedulingClass::Snapshot;
+            mDeficits.fill(0);
+            return mCurrent;
+        }
+        while (Deficit(mCurrent) <= 0)
+        {
+            mCurrent = Next(mCurrent);
+            Deficit(mCurrent) += GetQuantum(mCurrent);
+        }
+        return mCurrent;
+    }
+
+    /**
+     * \brief Учесть стоимость обработки подписки класса aClass, выбранного последним.
+     */
+    void Charge(SchedulingClass aClass, int64_t aRows)
+    {
+        if (mIsContended)
+        {
+            Deficit(aClass) -= aRows;
+        }
+    }
+
+    int64_t GetDeficit(SchedulingClass aClass) const
+    {
+        return mDeficits[static_cast<size_t>(aClass)];
+    }
+
+    void Clear()
+    {
+        mDeficits.fill(0);
+        mCurrent = SchedulingClass::Snapshot;
+        mIsContended = false;
+    }
+
+    static constexpr int64_t GetQuantum(SchedulingClass aClass)
+    {
+        return aClass == SchedulingClass::Increment ? IncrementQuantum : SnapshotQuantum;
+    }
+
+private:
+    int64_t& Deficit(SchedulingClass aClass)
+    {
+        return mDeficits[static_cast<size_t>(aClass)];
+    }
+
+    static SchedulingClass Next(SchedulingClass aClass)
+    {
+        return static_cast<SchedulingClass>((static_cast<size_t>(aClass) + 1) % SchedulingClassesCount);
+    }
+};
+
+/**
+ * \brief Заглушка для контейнеров подписок, обрабатывающих подписки строго по очереди.
+ */
+struct NoSubscriptionScheduler
+{
+    void Clear()
+    {
+    }
+};
+
+template <typename TSetup, bool = HasSubscriptionScheduler<TSetup>::value>
+struct SubscriptionSchedulerOf
+{
+    using Type = NoSubscriptionScheduler;
+};
+
+template <typename TSetup>
+struct SubscriptionSchedulerOf<TSetup, true>
+{
+    using Type = typename TSetup::TSubscriptionScheduler;
+};
+
+}
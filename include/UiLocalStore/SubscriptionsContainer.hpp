@@ -5,6 +5,10 @@
 #include "UiLocalStore/ISubscriptionActor.hpp"
 #include "UiLocalStore/ISubscriptionStateMachine.hpp"
 #include "UiLocalStore/ISubscriptionsContainer.hpp"
+#include "UiLocalStore/SubscriptionContainment.hpp"
+#include "UiLocalStore/SubscriptionKey.hpp"
+#include "UiLocalStore/SubscriptionPredicateIndex.hpp"
+#include "UiLocalStore/SubscriptionScheduler.hpp"
 #include "UiLocalStore/VersionedDataContainer.hpp"
 
 #include <boost/multi_index_container.hpp>
@@ -12,6 +16,12 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 
+#include <array>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <limits>
+
 namespace NTPro::Ecn::NewUiServer
 {
 
@@ -19,6 +29,40 @@ namespace NTPro::Ecn::NewUiServer
  * \brief Контейнер подписок.
  * \ingroup NewUiServer
  * Обеспечивает поочередную обработку всех активных подписок.
+ *
+ * Одинаковые табличные подписки могут обрабатываться одним обработчиком.
+ * Обработчик, добавленный через EmplaceSharedSubscription, регистрируется по ключу подписки.
+ * Подписка с тем же ключом присоединяется к нему через ShareSubscription и получает тот же результат.
+ * Если подписка, создавшая обработчик, отписалась, обработчик работает, пока есть присоединенные подписки.
+ *
+ * Окно строк, запрошенное подпиской (SetRowWindow), передается обработчику, в том числе общему:
+ * обработчик, упорядочивающий только окно, досортировывает результат и отправляет его всем своим подпискам.
+ * Обработчик, выдающий строки окна по номерам (IsRowWindowRequested), отправляет только их,
+ * если у него нет присоединенных подписок; иначе все подписки получают полный результат.
+ *
+ * Если в сетапе задан обратный индекс фильтров (TSubscriptionPredicateIndex), при обновлении табличные подписки,
+ * фильтры которых не затрагивают изменения очередной версии (AddVersionDelta), не пересчитываются,
+ * а только переходят на эту версию (SkipVersion).
+ *
+ * Если в сетапе включен CoalesceVersions, табличная подписка, отставшая на несколько версий,
+ * переходит сразу на текущую версию (JumpToVersion) вместо обработки каждой версии по очереди.
+ * Пока ее инкремент не применен, GetOldestVersion не выше первой пропущенной версии (GetOldestReadVersion),
+ * чтобы очистка хранилища не удалила строки, которые читает инкремент.
+ *
+ * Если в сетапе задан планировщик (TSubscriptionScheduler), табличные подписки обрабатываются не строго по очереди:
+ * обновления готовых подписок и построение первых результатов делят реактор по квотам строк
+ * (SubscriptionScheduler), внутри каждого класса подписки обрабатываются по очереди.
+ * Стоимость обработки - число строк, просмотренных этапами подписки за вызов (GetProcessedRows),
+ * без него или при нуле - одна строка за вызов.
+ *
+ * Если сетап включает ProcessSubscriptionsInParallel и задан пул потоков (SetWorkerPool, UiCacheLogic передает
+ * пул из TSetup::GetWorkerPool), табличные подписки обрабатываются пачками: за вызов ProcessNextSubscription
+ * очередные подписки в обработке (не больше числа потоков пула плюс одна) выполняют по одному шагу параллельно,
+ * реактор выполняет шаги вместе с пулом и дожидается завершения всей пачки. Пока идут шаги, реактор не меняет
+ * хранилище и контейнер, поэтому версии, которые читают подписки, не могут быть удалены.
+ * Готовые результаты пачки отдаются по одному в следующих вызовах. Планировщик в этом режиме не используется.
+ * Обработчик подписки должен объявлять TData и допускать вызов Process не из потока реактора,
+ * трейсер - вызовы из нескольких потоков. Строки хранилища должны иметь атомарный счетчик ссылок.
  */
 template <typename TSetup>
 class SubscriptionsContainer
@@ -32,6 +76,22 @@ public:
     using TSubscriptionId = ISubscriptionsContainer::TSubscriptionId;
 
 private:
+    using TPredicateIndex = typename SubscriptionPredicateIndexOf<TSetup>::Type;
+    static constexpr bool RouteByPredicates =
+        HasSubscriptionPredicateIndex<TSetup>::value && TSetup::StoreType == SubscriptionType::Table;
+    static constexpr bool CoalesceVersions =
+        CoalesceVersionsOf<TSetup>::value && TSetup::StoreType == SubscriptionType::Table;
+    using TScheduler = typename SubscriptionSchedulerOf<TSetup>::Type;
+    static constexpr bool UseScheduler =
+        HasSubscriptionScheduler<TSetup>::value && TSetup::StoreType == SubscriptionType::Table;
+    static constexpr bool CountProcessedRows = HasProcessedRows<TSubscriptionActorImpl>::value;
+    using TActorData = typename ActorDataOf<TSubscriptionActorImpl>::Type;
+    static constexpr bool ProcessInParallel = ProcessSubscriptionsInParallelOf<TSetup>::value
+        && !std::is_void_v<TActorData> && TSetup::StoreType == SubscriptionType::Table;
+    /// Шаги разных подписок одновременно копируют указатели на одни и те же строки хранилища.
+    static_assert(!ProcessInParallel || std::is_base_of_v<std::shared_ptr<TActorData>, Basis::SPtr<TActorData>>,
+        "Parallel subscription steps require row pointers with an atomic reference count");
+
     Basis::Tracer& mTracer;
 
     struct SubscriptionInfo
@@ -39,14 +99,24 @@ private:
         SubscriptionInfo() = default;
         SubscriptionInfo(
             const TSubscriptionPtr& aSubscription,
-            size_t aSubscriptionNumber)
+            size_t aSubscriptionNumber,
+            std::optional<SubscriptionKey> aKey = std::nullopt)
             : Subscription(aSubscription)
             , SubscriptionNumber(aSubscriptionNumber)
+            , Key(std::move(aKey))
         {}
 
         TSubscriptionPtr Subscription;
         size_t SubscriptionNumber = 0;
         mutable bool WaitNextPacket = true;
+        /// Ключ, по которому к обработчику могут присоединяться одинаковые подписки.
+        std::optional<SubscriptionKey> Key;
+        /// Присоединенные подписки.
+        mutable Basis::Vector<TSubscriptionId> AttachedRequestIds;
+        /// Подписка, создавшая обработчик, активна.
+        mutable bool IsOwnerSubscribed = true;
+        /// Первый результат подписки построен, дальше она обрабатывает обновления.
+        bool HasResult = false;
     };
 
     struct SubscriptionsContainerType
@@ -78,41 +148,73 @@ private:
             }
         };
 
+        /// Самая старая версия, которую читает подписка: версии раньше нее можно удалять из хранилища.
         struct ByVersion
         {
             typedef TDataVersion result_type;
             result_type operator()(const SubscriptionInfo aData) const
             {
-                return aData.Subscription->Get().GetVersion();
+                if constexpr (HasOldestReadVersion<TSubscriptionActorImpl>::value)
+                {
+                    return aData.Subscription->Get().GetOldestReadVersion();
+                }
+                else
+                {
+                    return aData.Subscription->Get().GetVersion();
+                }
+            }
+        };
+
+        struct BySchedulingClass
+        {
+            typedef SchedulingClass result_type;
+            result_type operator()(const SubscriptionInfo& aData) const
+            {
+                return aData.HasResult ? SchedulingClass::Increment : SchedulingClass::Snapshot;
             }
         };
 
         struct ByIsProcessingAndSubscription {};
+        struct ByIsProcessingAndClass {};
+
+        using TRequestIdIndex = boost::multi_index::hashed_unique<
+            boost::multi_index::tag<ByRequestId>,
+            ByRequestId,
+            Basis::UniqueIdHasher<TSubscriptionId>
+        >;
+
+        using TProcessingIndex = boost::multi_index::ordered_unique<
+            boost::multi_index::tag<ByIsProcessingAndSubscription>,
+            boost::multi_index::composite_key<
+                SubscriptionInfo,
+                ByIsProcessing,
+                BySubscriptionNumber
+            >
+        >;
+
+        using TVersionIndex = boost::multi_index::ordered_non_unique<
+            boost::multi_index::tag<ByVersion>,
+            ByVersion
+        >;
+
+        /// Очередь обработки внутри класса планировщика.
+        using TSchedulingIndex = boost::multi_index::ordered_unique<
+            boost::multi_index::tag<ByIsProcessingAndClass>,
+            boost::multi_index::composite_key<
+                SubscriptionInfo,
+                ByIsProcessing,
+                BySchedulingClass,
+                BySubscriptionNumber
+            >
+        >;
 
         using Type = Basis::MultiIndex
             <
                 SubscriptionInfo,
-                boost::multi_index::indexed_by
-                <
-                    boost::multi_index::hashed_unique<
-                        boost::multi_index::tag<ByRequestId>,
-                        ByRequestId,
-                        Basis::UniqueIdHasher<TSubscriptionId>
-                    >,
-
-                    boost::multi_index::ordered_unique<
-                        boost::multi_index::tag<ByIsProcessingAndSubscription>,
-                        boost::multi_index::composite_key<
-                            SubscriptionInfo,
-                            ByIsProcessing,
-                            BySubscriptionNumber
-                        >
-                    >,
-
-                    boost::multi_index::ordered_non_unique<
-                        boost::multi_index::tag<ByVersion>,
-                        ByVersion
-                    >
+                std::conditional_t<
+                    UseScheduler,
+                    boost::multi_index::indexed_by<TRequestIdIndex, TProcessingIndex, TVersionIndex, TSchedulingIndex>,
+                    boost::multi_index::indexed_by<TRequestIdIndex, TProcessingIndex, TVersionIndex>
                 >
             >;
     };
@@ -123,6 +225,16 @@ private:
 
     Basis::Vector<TSubscriptionId> mRejectedSubscriptions;
 
+    /// Общие обработчики по ключу подписки.
+    Basis::UnorderedMap<SubscriptionKey, TSubscriptionId, SubscriptionKey::Hasher> mSharedSubscriptions;
+    /// Присоединенные подписки и id их обработчиков.
+    Basis::UnorderedMap<TSubscriptionId, TSubscriptionId, Basis::UniqueIdHasher<TSubscriptionId>> mAttachedSubscriptions;
+    /// Присоединенные подписки, которым нужно отправить уже готовый результат обработчика.
+    Basis::Vector<TSubscriptionId> mPendingAttached;
+
+    /// Фильтры обработчиков по id подписки, создавшей обработчик.
+    TPredicateIndex mPredicateIndex;
+
     /// Счетчик новых подписок. Каждой новой подписке присваивается порядковый номер.
     size_t mSubscriptionsCounter = 0;
     /// Номер последней обработанной подписки.
@@ -130,12 +242,65 @@ private:
     /// Здесь сохраняется индекс последней обработанной подписки.
     size_t mLastProcessedSubscriptionNumber = 0;
 
+    /// Квоты классов обработки.
+    TScheduler mScheduler;
+    /// Номер последней обработанной подписки в каждом классе планировщика.
+    std::array<size_t, SchedulingClassesCount> mLastProcessedInClass {};
+
+    /// Пул потоков для параллельной обработки подписок.
+    std::shared_ptr<WorkerPool> mWorkerPool;
+    /// Готовые результаты последней пачки, еще не отданные реактору.
+    std::conditional_t<
+        ProcessInParallel,
+        Basis::Deque<ISubscriptionsContainer::ProcessingResult<TActorData>>,
+        std::nullptr_t> mParallelResults {};
+
+    /**
+     * \brief Пачка подписок, шаги которых выполняются параллельно.
+     * Потоки берут подписки по очереди, пока они не закончатся.
+     */
+    struct ParallelBatch
+    {
+        Basis::Vector<TSubscriptionPtr> Subscriptions;
+        Basis::Vector<std::exception_ptr> Errors;
+        std::atomic<size_t> Next { 0 };
+        std::atomic<size_t> Remaining { 0 };
+        std::promise<void> Done;
+
+        void Run()
+        {
+            for (auto i = Next.fetch_add(1); i < Subscriptions.size(); i = Next.fetch_add(1))
+            {
+                try
+                {
+                    Subscriptions[i]->Process();
+                }
+                catch (...)
+                {
+                    Errors[i] = std::current_exception();
+                }
+                if (Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    Done.set_value();
+                }
+            }
+        }
+    };
+
 public:
     SubscriptionsContainer(Basis::Tracer& aTracer)
         : mTracer(aTracer)
     {
     }
 
+    /**
+     * \brief Задать пул потоков для параллельной обработки табличных подписок.
+     */
+    void SetWorkerPool(std::shared_ptr<WorkerPool> aWorkerPool)
+    {
+        mWorkerPool = std::move(aWorkerPool);
+    }
+
     bool EmplaceSubscription(const TSubscriptionPtr& aSubscription)
     {
         if (!mSubscriptions.emplace(aSubscription, ++mSubscriptionsCounter).second)
@@ -143,32 +308,330 @@ public:
             mTracer.Error("Request id duplicated, reject");
             return false;
         }
+        AddPredicate(*aSubscription);
 
         mTracer.InfoSlow("EmplaceSubscription: size:", mSubscriptions.size());
         return true;
     }
 
+    /**
+     * \brief Добавить обработчик, к которому могут присоединяться подписки с ключом aKey.
+     */
+    bool EmplaceSharedSubscription(const TSubscriptionPtr& aSubscription, const SubscriptionKey& aKey)
+    {
+        const auto& requestId = aSubscription->Get().GetRequestId();
+        if (mAttachedSubscriptions.count(requestId)
+            || !mSubscriptions.emplace(aSubscription, ++mSubscriptionsCounter, aKey).second)
+        {
+            mTracer.Error("Request id duplicated, reject");
+            return false;
+        }
+        /// Прежний обработчик с тем же ключом мог завершиться с ошибкой, новые подписки присоединяются к этому.
+        mSharedSubscriptions[aKey] = requestId;
+        AddPredicate(*aSubscription);
+
+        mTracer.InfoSlow("EmplaceSharedSubscription: size:", mSubscriptions.size());
+        return true;
+    }
+
+    /**
+     * \brief Присоединить подписку к обработчику одинаковой подписки.
+     * Возвращает false, если такого обработчика нет. В этом случае нужно создать новый обработчик.
+     */
+    bool ShareSubscription(const TSubscriptionId& aRequestId, const SubscriptionKey& aKey)
+    {
+        if constexpr (TSetup::StoreType != SubscriptionType::Table)
+        {
+            return false;
+        }
+
+        const auto sharedIt = mSharedSubscriptions.find(aKey);
+        if (sharedIt == mSharedSubscriptions.cend()
+            || mAttachedSubscriptions.count(aRequestId)
+            || mSubscriptions.count(aRequestId))
+        {
+            return false;
+        }
+
+        const auto ownerId = sharedIt->second;
+        auto it = mSubscriptions.find(ownerId);
+        assert(it != mSubscriptions.cend());
+        if (it->Subscription->Get().IsError())
+        {
+            return false;
+        }
+
+        it->AttachedRequestIds.push_back(aRequestId);
+        mAttachedSubscriptions.emplace(aRequestId, ownerId);
+        if (it->Subscription->Get().IsOk())
+        {
+            /// Результат уже готов, отправим его при следующей обработке.
+            mPendingAttached.push_back(aRequestId);
+        }
+
+        mTracer.InfoSlow("ShareSubscription:", aRequestId, ", owner: ", ownerId,
+            ", attached: ", it->AttachedRequestIds.size());
+        return true;
+    }
+
+    /**
+     * \brief Заполнить новую подписку результатом подписки, которую она уточняет.
+     * Подходят только готовые подписки версии aVersion с тем же порядком сортировки.
+     * Из подходящих выбирается подписка с наименьшим результатом.
+     * Возвращает false, если такой подписки нет или обработчик не поддерживает заполнение.
+     */
+    bool SeedSubscription(const TSubscriptionPtr& aSubscription, TDataVersion aVersion)
+    {
+        if constexpr (TSetup::StoreType != SubscriptionType::Table)
+        {
+            return false;
+        }
+        else
+        {
+            auto& subscription = aSubscription->Get();
+            std::optional<decltype(subscription.GetResult())> seed;
+            for (const auto& info : mSubscriptions)
+            {
+                const auto& candidate = info.Subscription->Get();
+                if (!candidate.IsOk()
+                    || candidate.GetVersion() != aVersion
+                    || !SubscriptionContainment::IsRefinement(candidate.GetSubscription(), subscription.GetSubscription()))
+                {
+                    continue;
+                }
+                auto result = candidate.GetResult();
+                if (!seed || result->size() < (*seed)->size())
+                {
+                    seed = std::move(result);
+                }
+            }
+            if (!seed || !subscription.Seed(*seed))
+            {
+                return false;
+            }
+
+            mTracer.InfoSlow("SeedSubscription:", subscription.GetRequestId(), ", seed size: ", (*seed)->size());
+            return true;
+        }
+    }
+
+    /**
+     * \brief Изменить фильтры и порядок сортировки подписки без пересоздания обработчика.
+     * Обработчик, к которому присоединены другие подписки, не изменяется.
+     * Ключ общего обработчика строится заново: к нему присоединяются подписки с новым ключом,
+     * если у этого ключа еще нет обработчика.
+     * Возвращает false, если подписка не найдена или обработчик не может измениться на месте.
+     */
+    bool ModifySubscription(
+        const TSubscriptionId& aRequestId,
+        const TradingSerialization::Table::SubscribeBase& aSubscription)
+    {
+        if constexpr (TSetup::StoreType != SubscriptionType::Table)
+        {
+            return false;
+        }
+        else
+        {
+            auto& index = mSubscriptions.template get<typename SubscriptionsContainerType::ByRequestId>();
+            auto it = index.find(aRequestId);
+            if (it == index.cend() || !it->AttachedRequestIds.empty())
+            {
+                return false;
+            }
+
+            bool modified = false;
+            index.modify(it, [&](SubscriptionInfo& outInfo)
+            {
+                modified = outInfo.Subscription->Get().Modify(aSubscription);
+                if (modified)
+                {
+                    /// Новый результат отправляется сразу, не дожидаясь запроса следующего пакета.
+                    outInfo.WaitNextPacket = true;
+                    /// Результат строится заново и планируется как первый.
+                    outInfo.HasResult = false;
+                    if (outInfo.Key)
+                    {
+                        EraseSharedKey(outInfo);
+                        outInfo.Key = SubscriptionKey::Make(aSubscription);
+                        mSharedSubscriptions.emplace(*outInfo.Key, aRequestId);
+                    }
+                }
+            });
+            if (modified)
+            {
+                AddPredicate(*it->Subscription);
+            }
+
+            mTracer.InfoSlow("ModifySubscription:", aRequestId, ", modified:", modified);
+            return modified;
+        }
+    }
+
+    /**
+     * \brief Передать обработчику окно строк, запрошенное подпиской.
+     * Возвращает true, если обработчик начал пересчет результата.
+     */
+    bool SetRowWindow(const TSubscriptionId& aRequestId, const TradingSerialization::Table::RowRange& aRows)
+    {
+        if constexpr (!HasRowWindow<TSubscriptionActorImpl, TradingSerialization::Table::RowRange>::value)
+        {
+            return false;
+        }
+        else
+        {
+            const auto attachedIt = mAttachedSubscriptions.find(aRequestId);
+            const auto& ownerId = attachedIt != mAttachedSubscriptions.cend() ? attachedIt->second : aRequestId;
+
+            auto& index = mSubscriptions.template get<typename SubscriptionsContainerType::ByRequestId>();
+            auto it = index.find(ownerId);
+            if (it == index.cend())
+            {
+                mTracer.InfoSlow("SetRowWindow: subscription not found", aRequestId);
+                return false;
+            }
+
+            bool processing = false;
+            index.modify(it, [&](SubscriptionInfo& outInfo)
+            {
+                processing = outInfo.Subscription->Get().SetRowWindow(aRows);
+                if (processing)
+                {
+                    /// Досортированный результат отправляется сразу, не дожидаясь запроса следующего пакета.
+                    outInfo.WaitNextPacket = true;
+                }
+            });
+
+            mTracer.DebugSlow("SetRowWindow:", aRequestId, ", ", aRows, ", processing: ", processing);
+            return processing;
+        }
+    }
+
     void EraseSubscription(const TSubscriptionId& aRequestId)
     {
-        mSubscriptions.erase(aRequestId);
+        DropParallelResults(aRequestId);
+        const auto attachedIt = mAttachedSubscriptions.find(aRequestId);
+        if (attachedIt != mAttachedSubscriptions.cend())
+        {
+            const auto ownerId = attachedIt->second;
+            mAttachedSubscriptions.erase(attachedIt);
+            auto it = mSubscriptions.find(ownerId);
+            assert(it != mSubscriptions.cend());
+            auto& attached = it->AttachedRequestIds;
+            attached.erase(std::remove(attached.begin(), attached.end(), aRequestId), attached.end());
+            ErasePendingAttached(aRequestId);
+            if (attached.empty() && !it->IsOwnerSubscribed)
+            {
+                EraseInfo(it);
+            }
+        }
+        else
+        {
+            auto it = mSubscriptions.find(aRequestId);
+            if (it != mSubscriptions.cend())
+            {
+                if (it->AttachedRequestIds.empty())
+                {
+                    EraseInfo(it);
+                }
+                else
+                {
+                    /// Обработчик продолжает работать для присоединенных подписок.
+                    it->IsOwnerSubscribed = false;
+                }
+            }
+        }
         mTracer.InfoSlow("EraseSubscription: size:", mSubscriptions.size());
     }
 
+    /**
+     * \brief Передать обработчик подписки первой присоединенной к нему подписке.
+     * Остальные присоединенные подписки остаются у обработчика, идентификатор aRequestId освобождается.
+     * Возвращает false, если подписка не владеет обработчиком с присоединенными подписками.
+     */
+    bool TransferOwnership(const TSubscriptionId& aRequestId)
+    {
+        if constexpr (TSetup::StoreType != SubscriptionType::Table)
+        {
+            return false;
+        }
+        else
+        {
+            auto& index = mSubscriptions.template get<typename SubscriptionsContainerType::ByRequestId>();
+            auto it = index.find(aRequestId);
+            if (it == index.cend() || it->AttachedRequestIds.empty())
+            {
+                return false;
+            }
+
+            DropParallelResults(aRequestId);
+            mPredicateIndex.Remove(aRequestId);
+            const auto ownerId = it->AttachedRequestIds.front();
+            index.modify(it, [&](SubscriptionInfo& outInfo)
+            {
+                outInfo.Subscription->Get().SetRequestId(ownerId);
+                outInfo.AttachedRequestIds.erase(outInfo.AttachedRequestIds.begin());
+                outInfo.IsOwnerSubscribed = true;
+            });
+            mAttachedSubscriptions.erase(ownerId);
+            for (const auto& requestId : it->AttachedRequestIds)
+            {
+                mAttachedSubscriptions[requestId] = ownerId;
+            }
+            if (it->Key)
+            {
+                const auto sharedIt = mSharedSubscriptions.find(*it->Key);
+                if (sharedIt != mSharedSubscriptions.cend() && sharedIt->second == aRequestId)
+                {
+                    sharedIt->second = ownerId;
+                }
+            }
+            AddPredicate(*it->Subscription);
+
+            mTracer.InfoSlow("TransferOwnership:", aRequestId, ", owner: ", ownerId,
+                ", attached: ", it->AttachedRequestIds.size());
+            return true;
+        }
+    }
+
     Basis::Vector<TSubscriptionId> Clear()
     {
         Basis::Vector<TSubscriptionId> result;
-        result.reserve(mSubscriptions.size());
-        std::transform(
-            mSubscriptions.cbegin(),
-            mSubscriptions.cend(),
-            std::back_inserter(result),
-            [](const SubscriptionInfo& aInfo) { return aInfo.Subscription->Get().GetRequestId(); });
+        result.reserve(mSubscriptions.size() + mAttachedSubscriptions.size());
+        for (const auto& info : mSubscriptions)
+        {
+            AppendRecipients(info, result);
+        }
 
         mSubscriptions.clear();
+        mSharedSubscriptions.clear();
+        mAttachedSubscriptions.clear();
+        mPendingAttached.clear();
+        mPredicateIndex.Clear();
+        mScheduler.Clear();
+        mLastProcessedInClass.fill(0);
+        if constexpr (ProcessInParallel)
+        {
+            mParallelResults.clear();
+        }
 
         return result;
     }
 
+    /**
+     * \brief Сохранить изменения версии aVersion для выбора подписок, которые нужно обновить.
+     * Изменения версий, уже полученных всеми подписками, удаляются.
+     */
+    template <typename TDeltaPtr>
+    void AddVersionDelta(TDataVersion aVersion, const TDeltaPtr& aDelta)
+    {
+        if constexpr (RouteByPredicates)
+        {
+            mPredicateIndex.AddVersionDelta(aVersion, aDelta);
+            const auto oldestVersion = GetOldestVersion();
+            mPredicateIndex.ErasePrevious(oldestVersion ? *oldestVersion + 1 : aVersion + 1);
+        }
+    }
+
     Basis::Vector<TSubscriptionId> GetRejectedSubscriptions()
     {
         Basis::Vector<TSubscriptionId> result;
@@ -188,7 +651,11 @@ public:
             && it->Subscription->Get().IsOk()
             && iterators.size() < MaxUpdatedSubscriptions)
         {
-            iterators.push_back(it);
+            /// Подписки, пропустившие версии до текущей, остаются в Ok.
+            if (it->Subscription->Get().GetVersion() < aCurrentVersion)
+            {
+                iterators.push_back(it);
+            }
             ++it;
         }
         for (auto mutableIt : iterators)
@@ -200,8 +667,8 @@ public:
             {
                 assert(false);
                 mTracer.ErrorSlow("Updating error:", mutableIt->Subscription->Get().GetRequestId());
-                mRejectedSubscriptions.push_back(mutableIt->Subscription->Get().GetRequestId());
-                index.erase(mutableIt);
+                AppendRecipients(*mutableIt, mRejectedSubscriptions);
+                EraseInfo(mSubscriptions.template project<0>(mutableIt));
             }
         }
 
@@ -214,23 +681,43 @@ public:
     {
         ISubscriptionsContainer::ProcessingResult<TData> result;
 
+        if (TryFillPendingAttachedResult(result))
+        {
+            return result;
+        }
+        if constexpr (ProcessInParallel)
+        {
+            if (mWorkerPool)
+            {
+                return ProcessNextInParallel<TData>(aCurrentVersion);
+            }
+        }
+
         auto& index = mSubscriptions.template get<
             typename SubscriptionsContainerType::ByIsProcessingAndSubscription>();
-        /// Получаем следующую подписку, которая обрабатывается.
-        auto it = index.lower_bound(std::make_tuple(
-            ISubscriptionStateMachine::ProcessingState::Processing,
-            ++mLastProcessedSubscriptionNumber));
-        if (it == index.end())
+        auto it = index.end();
+        if constexpr (UseScheduler)
+        {
+            it = SelectScheduledSubscription();
+        }
+        else
         {
-            mLastProcessedSubscriptionNumber = 0;
+            /// Получаем следующую подписку, которая обрабатывается.
             it = index.lower_bound(std::make_tuple(
                 ISubscriptionStateMachine::ProcessingState::Processing,
-                mLastProcessedSubscriptionNumber));
+                ++mLastProcessedSubscriptionNumber));
             if (it == index.end())
             {
-                return result;
+                mLastProcessedSubscriptionNumber = 0;
+                it = index.lower_bound(std::make_tuple(
+                    ISubscriptionStateMachine::ProcessingState::Processing,
+                    mLastProcessedSubscriptionNumber));
             }
         }
+        if (it == index.end())
+        {
+            return result;
+        }
 
         assert(it->Subscription->Get().GetProcessingState() == ISubscriptionStateMachine::ProcessingState::Processing);
         mLastProcessedSubscriptionNumber = it->SubscriptionNumber;
@@ -239,28 +726,18 @@ public:
         index.modify(it, [&](SubscriptionInfo& outInfo)
         {
             TSubscriptionActor& subscription = *outInfo.Subscription;
+            const auto processedRows = GetProcessedRows(subscription);
             subscription.Process();
-            if (subscription.Get().IsOk())
+            if constexpr (UseScheduler)
             {
-                mTracer.InfoSlow(
-                    "Subscription completed:", subscription.Get().GetRequestId());
-                TryFillResult(outInfo, true, result, aCurrentVersion);
-                UpdateSubscriptionData(outInfo, aCurrentVersion);
+                /// Вызов без обработанных строк тоже расходует квоту.
+                mScheduler.Charge(
+                    typename SubscriptionsContainerType::BySchedulingClass()(outInfo),
+                    std::max<int64_t>(GetProcessedRows(subscription) - processedRows, 1));
             }
-            else if (subscription.Get().IsPending())
-            {
-                mTracer.TraceSlow(
-                    "Subscription pending:", subscription.Get().GetRequestId());
-                TryFillResult(outInfo, false, result, aCurrentVersion);
-            }
-
+            CompleteProcessing(outInfo, result, aCurrentVersion);
         });
-        if (it->Subscription->Get().IsError())
-        {
-            mTracer.ErrorSlow("Processing error:", it->Subscription->Get().GetRequestId());
-            mRejectedSubscriptions.push_back(it->Subscription->Get().GetRequestId());
-            index.erase(it);
-        }
+        EraseIfProcessingError(it);
 
         return result;
     }
@@ -312,11 +789,374 @@ public:
         else
         {
             auto& index = mSubscriptions.template get<typename SubscriptionsContainerType::ByVersion>();
-            return index.begin()->Subscription->Get().GetVersion();
+            return typename SubscriptionsContainerType::ByVersion()(*index.begin());
         }
     }
 
 private:
+    using TByRequestIdIt = typename TSubscriptionsContainer::const_iterator;
+    using TProcessingIt = typename TSubscriptionsContainer::template index<
+        typename SubscriptionsContainerType::ByIsProcessingAndSubscription>::type::iterator;
+
+    /**
+     * \brief Учесть результат шага обработки подписки.
+     */
+    template <typename TData>
+    void CompleteProcessing(
+        SubscriptionInfo& outInfo,
+        ISubscriptionsContainer::ProcessingResult<TData>& outResult,
+        TDataVersion aCurrentVersion)
+    {
+        TSubscriptionActor& subscription = *outInfo.Subscription;
+        if (subscription.Get().IsOk())
+        {
+            outInfo.HasResult = true;
+            mTracer.InfoSlow(
+                "Subscription completed:", subscription.Get().GetRequestId());
+            TryFillResult(outInfo, true, outResult, aCurrentVersion);
+            UpdateSubscriptionData(outInfo, aCurrentVersion);
+        }
+        else if (subscription.Get().IsPending())
+        {
+            mTracer.TraceSlow(
+                "Subscription pending:", subscription.Get().GetRequestId());
+            TryFillResult(outInfo, false, outResult, aCurrentVersion);
+        }
+    }
+
+    void EraseIfProcessingError(TProcessingIt aIt)
+    {
+        if (aIt->Subscription->Get().IsError())
+        {
+            mTracer.ErrorSlow("Processing error:", aIt->Subscription->Get().GetRequestId());
+            AppendRecipients(*aIt, mRejectedSubscriptions);
+            EraseInfo(mSubscriptions.template project<0>(aIt));
+        }
+    }
+
+    template <typename TData>
+    ISubscriptionsContainer::ProcessingResult<TData> ProcessNextInParallel(TDataVersion aCurrentVersion)
+    {
+        static_assert(std::is_same_v<TData, TActorData>);
+
+        ISubscriptionsContainer::ProcessingResult<TData> result;
+        if (mParallelResults.empty())
+        {
+            result.Processed = ProcessParallelBatch<TData>(aCurrentVersion);
+        }
+        if (!mParallelResults.empty())
+        {
+            result = std::move(mParallelResults.front());
+            mParallelResults.pop_front();
+        }
+        return result;
+    }
+
+    /**
+     * \brief Выполнить по одному шагу очередных подписок в обработке на пуле потоков.
+     * На время шагов подписки извлекаются из контейнера: их состояние, по которому они индексируются,
+     * меняется в других потоках. Возвращает false, если подписок в обработке нет.
+     */
+    template <typename TData>
+    bool ProcessParallelBatch(TDataVersion aCurrentVersion)
+    {
+        auto& index = mSubscriptions.template get<
+            typename SubscriptionsContainerType::ByIsProcessingAndSubscription>();
+        const auto processing = ISubscriptionStateMachine::ProcessingState::Processing;
+        const auto batchSize = mWorkerPool->GetThreadsCount() + 1;
+
+        /// Подписки берутся по очереди номеров, начиная со следующей за последней обработанной.
+        Basis::Vector<SubscriptionInfo> infos;
+        const auto collect = [&](TProcessingIt aIt, size_t aEndNumber)
+        {
+            for (; aIt != index.end()
+                && infos.size() < batchSize
+                && aIt->Subscription->Get().GetProcessingState() == processing
+                && aIt->SubscriptionNumber < aEndNumber; ++aIt)
+            {
+                infos.push_back(*aIt);
+            }
+        };
+        collect(
+            index.lower_bound(std::make_tuple(processing, mLastProcessedSubscriptionNumber + 1)),
+            std::numeric_limits<size_t>::max());
+        collect(index.lower_bound(std::make_tuple(processing)), mLastProcessedSubscriptionNumber + 1);
+        if (infos.empty())
+        {
+            return false;
+        }
+        mLastProcessedSubscriptionNumber = infos.back().SubscriptionNumber;
+
+        auto batch = std::make_shared<ParallelBatch>();
+        batch->Subscriptions.reserve(infos.size());
+        for (const auto& info : infos)
+        {
+            batch->Subscriptions.push_back(info.Subscription);
+            mSubscriptions.erase(info.Subscription->Get().GetRequestId());
+        }
+        batch->Errors.resize(infos.size());
+        batch->Remaining = infos.size();
+
+        auto done = batch->Done.get_future();
+        const auto helpersCount = std::min(mWorkerPool->GetThreadsCount(), infos.size() - 1);
+        for (size_t i = 0; i < helpersCount; ++i)
+        {
+            mWorkerPool->Post([batch]() { batch->Run(); });
+        }
+        batch->Run();
+        done.wait();
+
+        for (auto& info : infos)
+        {
+            const auto inserted = mSubscriptions.insert(std::move(info));
+            assert(inserted.second);
+            const auto it = mSubscriptions.template project<
+                typename SubscriptionsContainerType::ByIsProcessingAndSubscription>(inserted.first);
+
+            ISubscriptionsContainer::ProcessingResult<TData> result;
+            index.modify(it, [&](SubscriptionInfo& outInfo)
+            {
+                CompleteProcessing(outInfo, result, aCurrentVersion);
+            });
+            EraseIfProcessingError(it);
+            if (result.IsOk())
+            {
+                /// Результат отдается в одном из следующих вызовов, которые тоже считаются обработкой.
+                result.Processed = true;
+                mParallelResults.push_back(std::move(result));
+            }
+        }
+        mTracer.TraceSlow("ProcessParallelBatch: size:", infos.size(), ", results: ", mParallelResults.size());
+
+        for (const auto& error : batch->Errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * \brief Не отдавать отписавшейся подписке результат, посчитанный пачкой.
+     */
+    void DropParallelResults(const TSubscriptionId& aRequestId)
+    {
+        if constexpr (ProcessInParallel)
+        {
+            for (auto it = mParallelResults.begin(); it != mParallelResults.end();)
+            {
+                auto& shared = it->SharedSubscriptionIds;
+                shared.erase(std::remove(shared.begin(), shared.end(), aRequestId), shared.end());
+                if (it->SubscriptionId == aRequestId)
+                {
+                    if (shared.empty())
+                    {
+                        it = mParallelResults.erase(it);
+                        continue;
+                    }
+                    it->SubscriptionId = shared.front();
+                    shared.erase(shared.begin());
+                }
+                ++it;
+            }
+        }
+    }
+
+    /**
+     * \brief Убрать ключ обработчика из общих, если к ключу присоединяются подписки этого обработчика.
+     */
+    void EraseSharedKey(const SubscriptionInfo& aInfo)
+    {
+        if (aInfo.Key)
+        {
+            const auto sharedIt = mSharedSubscriptions.find(*aInfo.Key);
+            if (sharedIt != mSharedSubscriptions.cend()
+                && sharedIt->second == aInfo.Subscription->Get().GetRequestId())
+            {
+                mSharedSubscriptions.erase(sharedIt);
+            }
+        }
+    }
+
+    void ErasePendingAttached(const TSubscriptionId& aRequestId)
+    {
+        mPendingAttached.erase(
+            std::remove(mPendingAttached.begin(), mPendingAttached.end(), aRequestId),
+            mPendingAttached.end());
+    }
+
+    void EraseInfo(TByRequestIdIt aIt)
+    {
+        EraseSharedKey(*aIt);
+        for (const auto& requestId : aIt->AttachedRequestIds)
+        {
+            mAttachedSubscriptions.erase(requestId);
+            ErasePendingAttached(requestId);
+        }
+        mPredicateIndex.Remove(aIt->Subscription->Get().GetRequestId());
+        mSubscriptions.erase(aIt);
+    }
+
+    /**
+     * \brief Выбрать подписку для обработки по квотам классов планировщика.
+     * Внутри класса подписки выбираются по очереди номеров.
+     */
+    auto SelectScheduledSubscription()
+    {
+        auto& processingIndex = mSubscriptions.template get<
+            typename SubscriptionsContainerType::ByIsProcessingAndSubscription>();
+        if constexpr (UseScheduler)
+        {
+            auto& index = mSubscriptions.template get<typename SubscriptionsContainerType::ByIsProcessingAndClass>();
+            const auto processing = ISubscriptionStateMachine::ProcessingState::Processing;
+            const auto isInClass = [&](auto aIt, SchedulingClass aClass)
+            {
+                return aIt != index.end()
+                    && aIt->Subscription->Get().GetProcessingState() == processing
+                    && typename SubscriptionsContainerType::BySchedulingClass()(*aIt) == aClass;
+            };
+
+            const auto hasIncrements = isInClass(
+                index.lower_bound(std::make_tuple(processing, SchedulingClass::Increment)), SchedulingClass::Increment);
+            const auto hasSnapshots = isInClass(
+                index.lower_bound(std::make_tuple(processing, SchedulingClass::Snapshot)), SchedulingClass::Snapshot);
+            if (!hasIncrements && !hasSnapshots)
+            {
+                return processingIndex.end();
+            }
+
+            const auto schedulingClass = mScheduler.Select(hasIncrements, hasSnapshots);
+            auto& lastProcessed = mLastProcessedInClass[static_cast<size_t>(schedulingClass)];
+            auto it = index.lower_bound(std::make_tuple(processing, schedulingClass, lastProcessed + 1));
+            if (!isInClass(it, schedulingClass))
+            {
+                it = index.lower_bound(std::make_tuple(processing, schedulingClass));
+            }
+            lastProcessed = it->SubscriptionNumber;
+            return mSubscriptions.template project<
+                typename SubscriptionsContainerType::ByIsProcessingAndSubscription>(it);
+        }
+        else
+        {
+            return processingIndex.end();
+        }
+    }
+
+    static int64_t GetProcessedRows(TSubscriptionActor& aSubscription)
+    {
+        if constexpr (CountProcessedRows)
+        {
+            return static_cast<int64_t>(aSubscription.Get().GetProcessedRows());
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    void AddPredicate(TSubscriptionActor& aSubscription)
+    {
+        if constexpr (RouteByPredicates)
+        {
+            const auto& subscription = aSubscription.Get();
+            mPredicateIndex.Add(subscription.GetRequestId(), subscription.GetSubscription().FilterExpression);
+        }
+    }
+
+    /**
+     * \brief Перевести подписку через версии, изменения которых не затрагивают ее фильтры.
+     * Возвращает true, если подписка дошла до текущей версии и обновлять ее не нужно.
+     */
+    bool SkipUnaffectedVersions(TSubscriptionActor& aSubscription, TDataVersion aCurrentVersion)
+    {
+        if constexpr (RouteByPredicates)
+        {
+            const auto requestId = aSubscription.Get().GetRequestId();
+            while (aSubscription.Get().GetVersion() < aCurrentVersion
+                && !mPredicateIndex.IsAffected(requestId, aSubscription.Get().GetVersion() + 1))
+            {
+                aSubscription.SkipVersion();
+            }
+            return aSubscription.Get().GetVersion() == aCurrentVersion;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    /**
+     * \brief Подписки, получающие результат обработчика.
+     */
+    static void AppendRecipients(const SubscriptionInfo& aInfo, Basis::Vector<TSubscriptionId>& outRequestIds)
+    {
+        if (aInfo.IsOwnerSubscribed)
+        {
+            outRequestIds.push_back(aInfo.Subscription->Get().GetRequestId());
+        }
+        outRequestIds.insert(outRequestIds.end(), aInfo.AttachedRequestIds.cbegin(), aInfo.AttachedRequestIds.cend());
+    }
+
+    /**
+     * \brief Отправить готовый результат обработчика очередной присоединенной подписке.
+     */
+    template <typename TData>
+    bool TryFillPendingAttachedResult(ISubscriptionsContainer::ProcessingResult<TData>& outResult)
+    {
+        while (!mPendingAttached.empty())
+        {
+            const auto requestId = mPendingAttached.back();
+            mPendingAttached.pop_back();
+
+            /// Подписка могла стать владельцем обработчика после TransferOwnership.
+            const auto attachedIt = mAttachedSubscriptions.find(requestId);
+            const auto it = mSubscriptions.find(
+                attachedIt != mAttachedSubscriptions.cend() ? attachedIt->second : requestId);
+            if (it == mSubscriptions.cend())
+            {
+                continue;
+            }
+            const auto& subscription = it->Subscription->Get();
+            if (!subscription.IsOk())
+            {
+                /// Подписка получит результат вместе с обработчиком.
+                continue;
+            }
+
+            outResult.Processed = true;
+            outResult.ResultState = subscription.GetResultState();
+            outResult.SubscriptionId = requestId;
+            outResult.Result = subscription.GetResult();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * \brief Заполнить результат строками подписки.
+     * Подписке, запросившей окно строк, отправляются только его строки, если у обработчика нет
+     * присоединенных подписок: их окна могут отличаться.
+     */
+    template <typename TData>
+    static void FillResultRows(
+        const TSubscriptionActorImpl& aSubscription,
+        ISubscriptionsContainer::ProcessingResult<TData>& outResult)
+    {
+        if constexpr (HasRowWindowResult<TSubscriptionActorImpl>::value)
+        {
+            if (outResult.SharedSubscriptionIds.empty() && aSubscription.IsRowWindowRequested())
+            {
+                outResult.Result = aSubscription.GetRowWindowResult();
+                outResult.Rows = aSubscription.GetRowWindow();
+                outResult.RowCount = static_cast<int64_t>(aSubscription.GetResultSize());
+                return;
+            }
+        }
+        outResult.Result = aSubscription.GetResult();
+    }
+
     void UpdateSubscriptionData(SubscriptionInfo& outSubscription, TDataVersion aCurrentVersion)
     {
         TSubscriptionActor& subscription = *outSubscription.Subscription;
@@ -326,10 +1166,23 @@ private:
         const auto nextVersion = version + 1;
         if (nextVersion <= aCurrentVersion)
         {
+            if (SkipUnaffectedVersions(subscription, aCurrentVersion))
+            {
+                mTracer.TraceSlow("Subscription skipped versions:", subscription.Get().GetRequestId());
+                return;
+            }
             if constexpr (TSetup::StoreType == SubscriptionType::Table)
             {
                 outSubscription.WaitNextPacket = true;
             }
+            if constexpr (CoalesceVersions)
+            {
+                if (subscription.Get().GetVersion() + 1 < aCurrentVersion)
+                {
+                    subscription.JumpToVersion(aCurrentVersion);
+                    return;
+                }
+            }
             subscription.IncreaseVersion();
         }
     }
@@ -360,8 +1213,12 @@ private:
         if (outInfo.WaitNextPacket
             && outResult.ResultState != ISubscriptionActor::ResultState::NoResult)
         {
-            outResult.SubscriptionId = subscription.Get().GetRequestId();
-            outResult.Result = subscription.Get().GetResult();
+            Basis::Vector<TSubscriptionId> recipients;
+            AppendRecipients(outInfo, recipients);
+            assert(!recipients.empty());
+            outResult.SubscriptionId = recipients.front();
+            outResult.SharedSubscriptionIds.assign(recipients.cbegin() + 1, recipients.cend());
+            FillResultRows(subscription.Get(), outResult);
             outResult.DeletedIds = subscription.Get().GetDeletedIds();
             outInfo.WaitNextPacket = false;
 
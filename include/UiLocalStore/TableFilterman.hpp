@@ -4,6 +4,8 @@
 #include <NewUiServer/UiLocalStore/IDataRanges.hpp>
 #include <NewUiServer/UiLocalStore/TableUtils.hpp>
 #include <NewUiServer/UiLocalStore/LocalStoreUtils.hpp>
+#include <NewUiServer/UiLocalStore/CompiledFilterGroup.hpp>
+#include <NewUiServer/UiLocalStore/ColumnarSnapshot.hpp>
 
 #include "TradingSerialization/Table/Columns.hpp"
 
@@ -17,6 +19,9 @@ namespace NTPro::Ecn::NewUiServer
 /**
  * \brief Фильтрация данных таблицы.
  * \ingroup NewUiServer
+ * Фильтры применяются в скомпилированном виде. Скомпилированную группу можно передать в TInit,
+ * чтобы не компилировать фильтры подписки при каждой инициализации.
+ * GetSliceRows - число строк, просмотренных последним вызовом Process.
  */
 template <typename TSetup, typename TDataRanges>
 class TableFilterman
@@ -29,20 +34,27 @@ public:
 
     using TUiFilters = TradingSerialization::Table::FilterGroup;
     using TDataPack = Basis::Pack<TData>;
+    using TCompiledFilters = CompiledFilterGroup<TTableSetup>;
 
     struct TInit
     {
+        using TCompiledFilters = CompiledFilterGroup<TTableSetup>;
+
         const TUiFilters& Filters;
         TDataPack& Result;
         TDataRanges& IndexRanges;
+        /// Заранее скомпилированные Filters, может отсутствовать.
+        const TCompiledFilters* CompiledFilters;
 
         TInit(
             const TUiFilters& aFilters,
             TDataPack& outResult,
-            TDataRanges& aIndexRanges)
+            TDataRanges& aIndexRanges,
+            const TCompiledFilters* aCompiledFilters = nullptr)
             : Filters(aFilters)
             , Result(outResult)
             , IndexRanges(aIndexRanges)
+            , CompiledFilters(aCompiledFilters)
         {}
     };
 
@@ -52,9 +64,12 @@ public:
 
 private:
     const TUiFilters* mFilters = nullptr;
+    TCompiledFilters mOwnFilters;
+    const TCompiledFilters* mCompiledFilters = nullptr;
     TDataPack* mResult = nullptr;
     Basis::Tracer& mTracer;
     TableFiltermanState mState = TableFiltermanState::Initializing;
+    size_t mSliceRows = 0;
 
 public:
     TableFilterman(Basis::Tracer& aTracer)
@@ -74,6 +89,17 @@ public:
         mFilters = &aInit.Filters;
         mResult = &aInit.Result;
 
+        if (aInit.CompiledFilters)
+        {
+            assert(aInit.CompiledFilters->IsCompiled());
+            mCompiledFilters = aInit.CompiledFilters;
+        }
+        else
+        {
+            mOwnFilters.Compile(aInit.Filters);
+            mCompiledFilters = &mOwnFilters;
+        }
+
         mState = TableFiltermanState::Processing;
     }
 
@@ -81,13 +107,16 @@ public:
     {
         Ranges.Bind(nullptr);
         mFilters = nullptr;
+        mCompiledFilters = nullptr;
         mResult = nullptr;
 
         mState = TableFiltermanState::Initializing;
+        mSliceRows = 0;
     }
 
     TableFiltermanState Process()
     {
+        mSliceRows = 0;
         if (mState != TableFiltermanState::Processing)
         {
             assert(false);
@@ -105,9 +134,10 @@ public:
                 mState = TableFiltermanState::Completed;
                 return mState;
             }
+            ++mSliceRows;
 
             bool ok = true;
-            if (LocalStoreUtils::CheckDataByFilter<TTableSetup>(*dataPtr, *mFilters, ok))
+            if (CheckData(*dataPtr, ok))
             {
                 mResult->push_back(dataPtr);
             }
@@ -126,6 +156,25 @@ public:
     {
         return mState;
     }
+
+    size_t GetSliceRows() const
+    {
+        return mSliceRows;
+    }
+
+private:
+    bool CheckData(const TData& aData, bool& outOk)
+    {
+        if constexpr (IsColumnarRanges<TDataRanges>::value)
+        {
+            const auto& ranges = Ranges.Get();
+            return mCompiledFilters->CheckRow(ranges.GetColumns(), ranges.GetCurrentRow(), outOk);
+        }
+        else
+        {
+            return mCompiledFilters->Check(aData, outOk);
+        }
+    }
 };
 
 }
@@ -3,6 +3,7 @@
 #include <NewUiServer/UiLocalStore/ITableIncrementApplicator.hpp>
 #include <NewUiServer/UiLocalStore/TableUtils.hpp>
 #include <NewUiServer/UiLocalStore/LocalStoreUtils.hpp>
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
 #include <NewUiServer/UiLocalStore/SortOrderComparator.hpp>
 
 #include "TradingSerialization/Table/Columns.hpp"
@@ -11,12 +12,19 @@
 
 #include <Common/Pack.hpp>
 
+#include <algorithm>
+
 namespace NTPro::Ecn::NewUiServer
 {
 
 /**
  * \brief Применение инкремента.
  * \ingroup NewUiServer
+ * Серии старых элементов между изменениями переносятся в новый снапшот целиком:
+ * конец серии ищется экспоненциальным поиском по компаратору, без сравнения каждого элемента.
+ * Если старым снапшотом больше никто не владеет, элементы из него перемещаются, а не копируются.
+ * Ограничение MaxCount за вызов Process считается в элементах, как и при поэлементном слиянии.
+ * GetSliceRows - число элементов старого снапшота и инкремента, пройденных последним вызовом Process.
  */
 template <typename TSetup>
 class TableIncrementApplicator
@@ -31,6 +39,7 @@ public:
     using TDataPack = Basis::Pack<TData>;
     using TDataSPtrPack = Basis::SPtr<TDataPack>;
     using TIt = typename TDataPack::const_iterator;
+    using TOldIt = typename TDataPack::iterator;
 
     using TSortOrder = TradingSerialization::Table::TSortOrder;
 
@@ -39,6 +48,7 @@ public:
     struct TInit
     {
         const TSortOrder& SortOrder;
+        /// Если снапшот принадлежит только вызывающей стороне, его элементы будут перемещены.
         const TDataSPtrPack& OldSnapshot;
         const TDataPack& DeletedIncrement;
         const TDataPack& AddedIncrement;
@@ -62,7 +72,7 @@ private:
 
     struct MergePosition
     {
-        TIt OldIt;
+        TOldIt OldIt;
         TIt DeletedIt;
         TIt AddedIt;
     };
@@ -80,6 +90,9 @@ private:
     bool mOk = true;
     std::optional<TComparator> mComparator;
     MergePosition mPosition;
+    /// Старый снапшот принадлежит только вызывающей стороне, элементы можно перемещать.
+    bool mMoveOld = false;
+    size_t mSliceRows = 0;
 
 public:
     TableIncrementApplicator(
@@ -97,7 +110,7 @@ public:
         mAddedIncrement = &aInit.AddedIncrement;
         mNewSnapshot = &aInit.NewSnapshot;
 
-        mPosition.OldIt = (*mOldSnapshot)->cbegin();
+        mPosition.OldIt = (*mOldSnapshot)->begin();
         mPosition.DeletedIt = mDeletedIncrement->cbegin();
         mPosition.AddedIt = mAddedIncrement->cbegin();
 
@@ -112,6 +125,12 @@ public:
             return;
         }
 
+        if constexpr (HasUseCount<TDataSPtrPack>::value)
+        {
+            mMoveOld = mOldSnapshot->use_count() == 1;
+        }
+        mNewSnapshot->reserve((*mOldSnapshot)->size() + mAddedIncrement->size());
+
         mState = TableIncrementApplicatorState::Processing;
     }
 
@@ -123,6 +142,8 @@ public:
         mAddedIncrement = nullptr;
         mNewSnapshot = nullptr;
         mComparator = std::nullopt;
+        mMoveOld = false;
+        mSliceRows = 0;
 
         mState = TableIncrementApplicatorState::Initializing;
     }
@@ -139,11 +160,16 @@ public:
 
     TableIncrementApplicatorState Process()
     {
+        mSliceRows = 0;
         switch(mState)
         {
         case TableIncrementApplicatorState::Processing:
+        {
+            const auto consumedRows = GetConsumedRows();
             ProcessInternal();
+            mSliceRows = GetConsumedRows() - consumedRows;
             break;
+        }
         default:
             mTracer.ErrorSlow("IncrementApplicator.Process: state is invalid:", mState);
             mState = TableIncrementApplicatorState::Error;
@@ -153,7 +179,23 @@ public:
         return mState;
     }
 
+    size_t GetSliceRows() const
+    {
+        return mSliceRows;
+    }
+
 private:
+    /**
+     * \brief Число элементов старого снапшота и инкремента, пройденных с начала применения.
+     */
+    size_t GetConsumedRows() const
+    {
+        return static_cast<size_t>(
+            (mPosition.OldIt - (*mOldSnapshot)->begin())
+            + (mPosition.DeletedIt - mDeletedIncrement->cbegin())
+            + (mPosition.AddedIt - mAddedIncrement->cbegin()));
+    }
+
     bool TrySetCompleted()
     {
         if (!IsOldIt() && !IsAddedIt() && !IsDeletedIt())
@@ -255,10 +297,72 @@ private:
                     continue;
                 }
             }
-            /// Нет нового и старый не удален
-            mNewSnapshot->push_back(*mPosition.OldIt);
-            ++mPosition.OldIt;
+            /// Нет нового и старый не удален: переносим серию старых элементов до ближайшего изменения.
+            counter += AppendOldRun(MaxCount - counter + 1) - 1;
+            if (TrySetError())
+            {
+                return;
+            }
+        }
+    }
+
+    /**
+     * \brief Ближайший элемент инкремента.
+     * Старые элементы, меньшие его, не меняются.
+     */
+    const Basis::SPtr<TData>* GetRunBoundary() const
+    {
+        if (IsAddedIt() && IsDeletedIt())
+        {
+            return (*mComparator)(*mPosition.AddedIt, *mPosition.DeletedIt)
+                ? &*mPosition.AddedIt
+                : &*mPosition.DeletedIt;
+        }
+        if (IsAddedIt())
+        {
+            return &*mPosition.AddedIt;
+        }
+        if (IsDeletedIt())
+        {
+            return &*mPosition.DeletedIt;
+        }
+        return nullptr;
+    }
+
+    /**
+     * \brief Перенести серию старых элементов, не затронутых инкрементом.
+     * Первый элемент серии уже проверен. Переносится не больше aLimit элементов.
+     * Возвращает количество перенесенных элементов.
+     */
+    int AppendOldRun(int aLimit)
+    {
+        const auto begin = mPosition.OldIt;
+        const auto limit = std::min<ptrdiff_t>(aLimit, (*mOldSnapshot)->end() - begin);
+
+        auto runEnd = begin + limit;
+        if (const auto* boundary = GetRunBoundary())
+        {
+            /// Элементы [0, low) меньше границы.
+            ptrdiff_t low = 1;
+            ptrdiff_t high = 1;
+            while (high < limit && (*mComparator)(begin[high], *boundary))
+            {
+                low = high + 1;
+                high *= 2;
+            }
+            runEnd = std::lower_bound(begin + low, begin + std::min(high, limit), *boundary, *mComparator);
+        }
+
+        if (mMoveOld)
+        {
+            std::move(begin, runEnd, std::back_inserter(*mNewSnapshot));
+        }
+        else
+        {
+            mNewSnapshot->insert(mNewSnapshot->end(), begin, runEnd);
         }
+        mPosition.OldIt = runEnd;
+        return static_cast<int>(runEnd - begin);
     }
 };
 
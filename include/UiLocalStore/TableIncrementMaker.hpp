@@ -20,6 +20,15 @@ namespace NTPro::Ecn::NewUiServer
 /**
  * \brief Расчет инкремента.
  * \ingroup NewUiServer
+ * Строки версии берутся из диапазонов хранилища. Если хранилище ведет кэш изменений (VersionDeltaCache),
+ * диапазоны читают строки, собранные один раз при фиксации версии, а не обходят индексы версий заново.
+ *
+ * Инкремент можно построить сразу по интервалу версий [FromVersion, Version], если диапазоны хранилища
+ * принимают первую версию интервала (SupportsVersionInterval). Тогда из нескольких изменений строки
+ * в инкремент попадает только последнее, а удаленными считаются только строки, существовавшие до интервала.
+ *
+ * GetSliceRows - число строк, которые последний вызов Process отфильтровал или отсортировал,
+ * по данным фильтрации и сортировки.
  */
 template <typename TSetup>
 class TableIncrementMaker
@@ -36,6 +45,7 @@ public:
     using TFiltermanImpl = typename TSetup::TTableIndexFilterman;
     using TFiltermanInit = typename TSetup::TTableIndexFiltermanInit;
     using IFilterman = ITableFilterman::Performer<TFiltermanImpl>;
+    using TCompiledFilters = typename TFiltermanInit::TCompiledFilters;
 
     using TUiFilters = TradingSerialization::Table::FilterGroup;
     using TSortOrder = TradingSerialization::Table::TSortOrder;
@@ -45,6 +55,14 @@ public:
 
     using TMap = typename TSetup::TMap;
 
+    static constexpr bool SupportsVersionInterval = std::is_constructible_v<
+        IRangesInit,
+        const TMap&,
+        const TUiFilters&,
+        std::optional<Model::ActionType>,
+        TDataVersion,
+        TDataVersion>;
+
     struct TInit
     {
         const TUiFilters& Filters;
@@ -54,6 +72,10 @@ public:
         const TMap& Map;
         TDataPack& TmpBuffer;
         TDataVersion Version;
+        /// Заранее скомпилированные Filters, может отсутствовать.
+        const TCompiledFilters* CompiledFilters;
+        /// Первая версия инкремента, по умолчанию Version.
+        TDataVersion FromVersion;
 
         TInit(
             const TUiFilters& aFilters,
@@ -62,7 +84,9 @@ public:
             TDataPack& outAdded,
             const TMap& aMap,
             TDataPack& aTmpBuffer,
-            TDataVersion aVersion)
+            TDataVersion aVersion,
+            const TCompiledFilters* aCompiledFilters = nullptr,
+            std::optional<TDataVersion> aFromVersion = std::nullopt)
             : Filters(aFilters)
             , SortOrder(aSortOrder)
             , Deleted(outDeleted)
@@ -70,11 +94,14 @@ public:
             , Map(aMap)
             , TmpBuffer(aTmpBuffer)
             , Version(aVersion)
+            , CompiledFilters(aCompiledFilters)
+            , FromVersion(aFromVersion.value_or(aVersion))
         {}
     };
 
 private:
     const TUiFilters* mFilters = nullptr;
+    const TCompiledFilters* mCompiledFilters = nullptr;
     const TSortOrder* mSortOrder = nullptr;
 
     TDataPack* mDeleted = nullptr;
@@ -83,6 +110,7 @@ private:
     TDataPack* mTmpBuffer = nullptr;
 
     TableIncrementMakerState mState = TableIncrementMakerState::Initializing;
+    size_t mSliceRows = 0;
 
     Basis::Tracer& mTracer;
 
@@ -108,19 +136,20 @@ public:
         assert(!IsInitialized());
 
         mFilters = &aInit.Filters;
+        mCompiledFilters = aInit.CompiledFilters;
         mSortOrder = &aInit.SortOrder;
         mDeleted = &aInit.Deleted;
         mAdded = &aInit.Added;
         mMap = &aInit.Map;
         mTmpBuffer = &aInit.TmpBuffer;
 
-        if (!DeletedRange.Init(IRangesInit { *mMap, *mFilters, Model::ActionType::Delete, aInit.Version }))
+        if (!DeletedRange.Init(MakeRangesInit(Model::ActionType::Delete, aInit)))
         {
             mTracer.Error("TableIncrementMaker: error during initialization deleted increment");
             assert(false);
         }
 
-        if (!AddedRange.Init(IRangesInit { *mMap, *mFilters, Model::ActionType::New, aInit.Version }))
+        if (!AddedRange.Init(MakeRangesInit(Model::ActionType::New, aInit)))
         {
             mTracer.Error("TableIncrementMaker: error during initialization deleted increment");
             assert(false);
@@ -132,6 +161,7 @@ public:
     void Reset()
     {
         mFilters = nullptr;
+        mCompiledFilters = nullptr;
         mSortOrder = nullptr;
         mDeleted = nullptr;
         mAdded = nullptr;
@@ -142,6 +172,7 @@ public:
         AddedRange.Reset();
 
         mState = TableIncrementMakerState::Initializing;
+        mSliceRows = 0;
     }
 
     bool IsInitialized() const
@@ -156,6 +187,7 @@ public:
 
     TableIncrementMakerState Process()
     {
+        mSliceRows = 0;
         switch(mState)
         {
         case TableIncrementMakerState::DeletedFiltration:
@@ -179,7 +211,25 @@ public:
         return mState;
     }
 
+    size_t GetSliceRows() const
+    {
+        return mSliceRows;
+    }
+
 private:
+    IRangesInit MakeRangesInit(Model::ActionType aAction, const TInit& aInit) const
+    {
+        if constexpr (SupportsVersionInterval)
+        {
+            return IRangesInit { *mMap, *mFilters, aAction, aInit.Version, aInit.FromVersion };
+        }
+        else
+        {
+            assert(aInit.FromVersion == aInit.Version);
+            return IRangesInit { *mMap, *mFilters, aAction, aInit.Version };
+        }
+    }
+
     void ProcessFiltrationInternal(
         TDataPack* outResult,
         IRanges& aRange,
@@ -187,10 +237,12 @@ private:
     {
         if (!Filterman.IsInitialized())
         {
-            Filterman.Init(TFiltermanInit { *mFilters, *outResult, aRange.Get() });
+            Filterman.Init(TFiltermanInit { *mFilters, *outResult, aRange.Get(), mCompiledFilters });
         }
 
-        switch (Filterman.Process())
+        const auto state = Filterman.Process();
+        mSliceRows = NewUiServer::GetSliceRows<TFiltermanImpl>(Filterman);
+        switch (state)
         {
         case TableFiltermanState::Completed:
             mState = aNextState;
@@ -222,7 +274,9 @@ private:
             return;
         }
 
-        switch (Sorter.Process())
+        const auto state = Sorter.Process();
+        mSliceRows = NewUiServer::GetSliceRows<TSorterImpl>(Sorter);
+        switch (state)
         {
         case TableSorterState::Completed:
             Sorter.Reset();
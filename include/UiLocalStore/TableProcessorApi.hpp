@@ -33,6 +33,9 @@ struct TableProcessorEvents
     static constexpr TEventType ChunkSnapshotEvent = TEventType(6 + IdShift, TableProcessorApiType, "ChunkSnapshotEvent");
     static constexpr TEventType GetNextInternalEvent = TEventType(7 + IdShift, TableProcessorApiType, "GetNextInternalEvent");
     static constexpr TEventType RecallInternalEvent = TEventType(8 + IdShift, TableProcessorApiType, "RecallInternalEvent");
+    static constexpr TEventType TableModifySubscription = TEventType(9 + IdShift, TableProcessorApiType, "TableModifySubscription");
+    static constexpr TEventType TableRowWindow = TEventType(10 + IdShift, TableProcessorApiType, "TableRowWindow");
+    static constexpr TEventType TableRowWindowSnapshot = TEventType(11 + IdShift, TableProcessorApiType, "TableRowWindowSnapshot");
 };
 
 template <typename TDataPack_>
@@ -73,6 +76,47 @@ struct TableProcessorApi
         }
     };
 
+    /// Строки окна Rows результата подписки из RowCount строк.
+    struct RowWindowSnapshot : public Basis::Traceable
+    {
+        TQueryId RequestId;
+        TradingSerialization::Table::RowRange Rows;
+        int64_t RowCount{0};
+        TSptrPack Data;
+
+        RowWindowSnapshot() = default;
+        RowWindowSnapshot(
+            const TQueryId& aRequestId,
+            const TradingSerialization::Table::RowRange& aRows,
+            int64_t aRowCount,
+            const TSptrPack& aData)
+            : RequestId(aRequestId)
+            , Rows(aRows)
+            , RowCount(aRowCount)
+            , Data(aData)
+        {}
+
+        template <class Archive>
+        void serialize(Archive& archive)
+        {
+            archive(
+                RequestId,
+                Rows,
+                RowCount,
+                Data);
+        }
+
+        void ToString(std::ostream& stream) const override
+        {
+            stream << "RowWindowSnapshot:{";
+            FIELD_TO_STREAM(stream, RequestId);
+            FIELD_TO_STREAM(stream, Rows);
+            FIELD_TO_STREAM(stream, RowCount);
+            FIELD_TO_STREAM(stream, Data);
+            stream << "}";
+        }
+    };
+
     struct ChunkSnapshot : public Basis::Traceable
     {
         TQueryId RequestId;
@@ -188,6 +232,68 @@ struct TableProcessorApi
         }
     };
 
+    /// Новые фильтры и порядок сортировки активной подписки.
+    struct Modification : public Basis::Traceable
+    {
+        TQueryId RequestId;
+        TradingSerialization::Table::SubscribeBase UiSubscription;
+
+        Modification() = default;
+        Modification(
+            const TQueryId& aRequestId,
+            const TradingSerialization::Table::SubscribeBase& aUiSubscription)
+            : RequestId(aRequestId)
+            , UiSubscription(aUiSubscription)
+        {}
+
+        template <class Archive>
+        void serialize(Archive& archive)
+        {
+            archive(
+                RequestId,
+                UiSubscription);
+        }
+
+        void ToString(std::ostream& stream) const override
+        {
+            stream << "Modification:{";
+            FIELD_TO_STREAM(stream, RequestId);
+            FIELD_TO_STREAM(stream, UiSubscription);
+            stream << "}";
+        }
+    };
+
+    /// Окно строк, которое показывает клиент подписки.
+    struct RowWindow : public Basis::Traceable
+    {
+        TQueryId RequestId;
+        TradingSerialization::Table::RowRange Rows;
+
+        RowWindow() = default;
+        RowWindow(
+            const TQueryId& aRequestId,
+            const TradingSerialization::Table::RowRange& aRows)
+            : RequestId(aRequestId)
+            , Rows(aRows)
+        {}
+
+        template <class Archive>
+        void serialize(Archive& archive)
+        {
+            archive(
+                RequestId,
+                Rows);
+        }
+
+        void ToString(std::ostream& stream) const override
+        {
+            stream << "RowWindow:{";
+            FIELD_TO_STREAM(stream, RequestId);
+            FIELD_TO_STREAM(stream, Rows);
+            stream << "}";
+        }
+    };
+
     struct Feedback : public Basis::Traceable
     {
         TQueryId RequestId;
@@ -252,11 +358,14 @@ struct TableProcessorApi
             , mTracer(Basis::Tracing::GetTracer(aComponentId, "StoreApi"))
         {
             this->template RegisterOutEvent<Snapshot>(TEvents::TableSnapshot);
+            this->template RegisterOutEvent<RowWindowSnapshot>(TEvents::TableRowWindowSnapshot);
             this->template RegisterOutEvent<ChunkSnapshot>(TEvents::ChunkSnapshotEvent);
             this->template RegisterOutEvent<Reject>(TEvents::TableReject);
 
             this->template RegisterHandler(TEvents::TableSubscribe, &Store<TSetup>::ProcessSubscription);
             this->template RegisterHandler(TEvents::TableUnsubscribe, &Store<TSetup>::ProcessUnsubscription);
+            this->template RegisterHandler(TEvents::TableModifySubscription, &Store<TSetup>::ProcessModifySubscription);
+            this->template RegisterHandler(TEvents::TableRowWindow, &Store<TSetup>::ProcessRowWindow);
 
             this->template RegisterHandler(TEvents::FeedbackEvent, &Store<TSetup>::ProcessFeedback);
             this->template RegisterHandler(TEvents::GetNextInternalEvent, &Store<TSetup>::ProcessGetNextInternal);
@@ -288,6 +397,27 @@ struct TableProcessorApi
                 Basis::MakeSPtr<Snapshot>(aRequestId, aData));
         }
 
+        void SendRowWindowSnapshot(
+            const TQueryId& aRequestId,
+            const TradingSerialization::Table::RowRange& aRows,
+            int64_t aRowCount,
+            const TSptrPack& aData)
+        {
+            assert(aData.HasValue());
+
+            auto client = mQueries.find(aRequestId);
+            if(client == mQueries.end())
+            {
+                assert(false);
+                return;
+            }
+
+            this->SendToTarget(
+                client->second.Identity,
+                TEvents::TableRowWindowSnapshot.Id,
+                Basis::MakeSPtr<RowWindowSnapshot>(aRequestId, aRows, aRowCount, aData));
+        }
+
         void SendChunkSnapshot(
             const TQueryId& aRequestId,
             const TSptrPack& aData,
@@ -389,6 +519,30 @@ struct TableProcessorApi
             }
         }
 
+        void ProcessModifySubscription(
+            const Basis::SenderInfo& /*aSenderIdentity*/,
+            const Modification& aModification)
+        {
+            mTracer.InfoSlow("ProcessModifySubscription:", aModification.RequestId);
+
+            if (mQueries.find(aModification.RequestId) != mQueries.end())
+            {
+                Handler.ProcessModifySubscription(aModification.RequestId, aModification.UiSubscription);
+            }
+        }
+
+        void ProcessRowWindow(
+            const Basis::SenderInfo& /*aSenderIdentity*/,
+            const RowWindow& aRowWindow)
+        {
+            mTracer.DebugSlow("ProcessRowWindow:", aRowWindow.RequestId, ", ", aRowWindow.Rows);
+
+            if (mQueries.find(aRowWindow.RequestId) != mQueries.end())
+            {
+                Handler.ProcessRowWindow(aRowWindow.RequestId, aRowWindow.Rows);
+            }
+        }
+
         void ProcessFeedback(const Basis::SenderInfo& /*aSenderIdentity*/, const Feedback& aFeedback)
         {
             auto it = mQueries.find(aFeedback.RequestId);
@@ -513,9 +667,12 @@ struct TableProcessorApi
         {
             this->template RegisterOutEvent<Subscription>(TEvents::TableSubscribe);
             this->template RegisterOutEvent<TQueryId>(TEvents::TableUnsubscribe);
+            this->template RegisterOutEvent<Modification>(TEvents::TableModifySubscription);
+            this->template RegisterOutEvent<RowWindow>(TEvents::TableRowWindow);
             this->template RegisterOutEvent<Feedback>(TEvents::FeedbackEvent);
 
             this->template RegisterHandler(TEvents::TableSnapshot, &Processor<TSetup>::ProcessDataSnapshot);
+            this->template RegisterHandler(TEvents::TableRowWindowSnapshot, &Processor<TSetup>::ProcessRowWindowSnapshot);
             this->template RegisterHandler(TEvents::ChunkSnapshotEvent, &Processor<TSetup>::ProcessChunkSnapshot);
             this->template RegisterHandler(TEvents::TableReject, &Processor<TSetup>::ProcessReject);
             this->template RegisterHandler(TEvents::RecallInternalEvent, &Processor<TSetup>::ProcessRecallSubscriptionInternal);
@@ -596,6 +753,70 @@ struct TableProcessorApi
             return true;
         }
 
+        /**
+         * \brief Изменить фильтры или порядок сортировки активной подписки.
+         * Хранилище присылает новый результат так же, как после подписки.
+         */
+        bool ModifySubscription(
+            const TQueryId& aRequestId,
+            const TradingSerialization::Table::SubscribeBase& aUiSubscription)
+        {
+            auto it = mActiveQueries.find(aRequestId);
+            if (it == mActiveQueries.cend())
+            {
+                return false;
+            }
+
+            const auto routeIndex = it->second.StoreIndex;
+            if (!IsSessionConnected(routeIndex))
+            {
+                mTracer.Info("ModifySubscription: is disconnected");
+                return false;
+            }
+
+            mTracer.InfoSlow("ModifySubscription:", aRequestId, ". Send to ", mServerIdentities[routeIndex]);
+
+            this->SendToTarget(
+                mServerIdentities[routeIndex],
+                TEvents::TableModifySubscription.Id,
+                Basis::MakeSPtr<Modification>(aRequestId, aUiSubscription));
+
+            return true;
+        }
+
+        /**
+         * \brief Сообщить хранилищу окно строк, которое показывает клиент подписки (RowWindowRequest).
+         * Если хранилище упорядочивает только окно, оно присылает досортированный результат так же, как после подписки.
+         * Если хранилище держит результат в упорядоченном дереве, дальше оно присылает только строки окна
+         * (ProcessRowWindowSnapshot).
+         */
+        bool RequestRowWindow(
+            const TQueryId& aRequestId,
+            const TradingSerialization::Table::RowRange& aRows)
+        {
+            auto it = mActiveQueries.find(aRequestId);
+            if (it == mActiveQueries.cend())
+            {
+                return false;
+            }
+
+            const auto routeIndex = it->second.StoreIndex;
+            if (!IsSessionConnected(routeIndex))
+            {
+                mTracer.Info("RequestRowWindow: is disconnected");
+                return false;
+            }
+
+            mTracer.DebugSlow("RequestRowWindow:", aRequestId, ", ", aRows, ". Send to ", mServerIdentities[routeIndex]);
+
+            this->SendToTarget(
+                mServerIdentities[routeIndex],
+                TEvents::TableRowWindow.Id,
+                Basis::MakeSPtr<RowWindow>(aRequestId, aRows));
+
+            return true;
+        }
+
         void StartSession()
         {
             for (const auto& identity : mServerIdentities)
@@ -699,6 +920,27 @@ struct TableProcessorApi
             Handler.ProcessDataSnapshot(aSnapshot.RequestId, aSnapshot.Data);
         }
 
+        void ProcessRowWindowSnapshot(
+            const Basis::SenderInfo& aIdentity,
+            const RowWindowSnapshot& aSnapshot)
+        {
+            auto it = mActiveQueries.find(aSnapshot.RequestId);
+            if (it == mActiveQueries.cend())
+            {
+                return;
+            }
+
+            const auto& info = it->second;
+            if (aIdentity.BusinessId != mServerIdentities[info.StoreIndex])
+            {
+                /// Пока нет динамического роутинга, Identities должны совпадать.
+                assert(false);
+                return;
+            }
+
+            Handler.ProcessRowWindowSnapshot(aSnapshot.RequestId, aSnapshot.Rows, aSnapshot.RowCount, aSnapshot.Data);
+        }
+
         void ProcessChunkSnapshot(
             [[maybe_unused]] const Basis::SenderInfo& aIdentity,
             const Basis::SPtr<ChunkSnapshot>& aSnapshot)
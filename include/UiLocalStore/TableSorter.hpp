@@ -1,6 +1,7 @@
 #pragma once
 
 #include <NewUiServer/UiLocalStore/ITableSorter.hpp>
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
 #include <NewUiServer/UiLocalStore/SortOrderComparator.hpp>
 #include <NewUiServer/UiLocalStore/TableUtils.hpp>
 
@@ -10,12 +11,19 @@
 
 #include <Common/Pack.hpp>
 
+#include <algorithm>
+#include <array>
+
 namespace NTPro::Ecn::NewUiServer
 {
 
 /**
  * \brief Табличный сортировальщик.
  * \ingroup NewUiServer
+ * Если в сетапе объявлен UseRadixSort и все колонки порядка сортировки целочисленные,
+ * вместо сортировки сравнением выполняется поразрядная (LSD) сортировка номеров строк.
+ * Вещественные колонки сравниваются Basis::Real с точностью, поэтому для них используется сравнение.
+ * GetSliceRows - число строк, отсортированных, слитых или перемещенных последним вызовом Process.
  */
 template <typename TSetup>
 class TableSorter
@@ -28,6 +36,7 @@ public:
 
     using TDataPack = Basis::Pack<TData>;
     using TIt = typename TDataPack::iterator;
+    using TItem = typename TDataPack::value_type;
     using State = TableSorterState;
 
     using TTableColumnType = typename TTableSetup::TTableColumnType;
@@ -35,6 +44,8 @@ public:
     using TSortOrder = TradingSerialization::Table::TSortOrder;
     using TComparator = SortOrderComparator<TData, TTableColumnType>;
 
+    static constexpr bool UseRadixSort = UseRadixSortOf<TSetup>::value;
+
     struct TInit
     {
         const TSortOrder& SortOrder;
@@ -60,6 +71,10 @@ private:
      * \brief Флаг ошибки.
      */
     bool mOk = true;
+    /**
+     * \brief Число строк, обработанных последним вызовом Process.
+     */
+    size_t mSliceRows = 0;
 
     /// Входные параметы
     /**
@@ -74,6 +89,7 @@ private:
     /**
      * \brief Временный буфер.
      * Используется для сортировки слиянием.
+     * Заполняется по мере первого прохода слияния или перестановки, затем его элементы перезаписываются.
      */
     TDataPack* mTmpBuffer;
 
@@ -112,9 +128,9 @@ private:
                  */
                 TIt IRight;
                 /**
-                 * \brief Итератор целевого элемента слияния.
+                 * \brief Позиция целевого элемента слияния во временном буфере.
                  */
-                TIt ITarget;
+                size_t ITarget;
             };
 
             /**
@@ -122,9 +138,9 @@ private:
              */
             TIt SortIt1;
             /**
-             * \brief Итератор на целевой буфер слияния.
+             * \brief Позиция в целевом буфере слияния.
              */
-            TIt Target;
+            size_t Target;
 
             /**
              * \brief Итератор начала второй (правой) части.
@@ -166,6 +182,51 @@ private:
      * \see MergeSortInfo.
      */
     MergeSortInfo mMergeInfo;
+    /**
+     * \brief Состояние поразрядной сортировки.
+     * Используется только на этапах KeyExtraction, RadixSort и Permutation.
+     */
+    struct RadixSortInfo
+    {
+        using TRow = uint32_t;
+        using THistogram = std::array<std::array<uint32_t, 256>, sizeof(uint64_t)>;
+
+        /**
+         * \brief Проход по одному байту ключа колонки.
+         * Проход по флагу заполненности значения имеет Shift < 0.
+         */
+        struct Pass
+        {
+            size_t Column = 0;
+            int Shift = 0;
+            /// Позиции записи для каждого значения байта.
+            Basis::Vector<TRow> Offsets;
+        };
+
+        /**
+         * \brief Ключи колонок порядка сортировки.
+         * Значение отображается в беззнаковое с сохранением порядка.
+         */
+        Basis::Vector<Basis::Vector<uint64_t>> Keys;
+        /// Флаги заполненности значений колонок.
+        Basis::Vector<Basis::Vector<uint8_t>> HasValue;
+        /// Гистограммы байтов ключей по колонкам.
+        Basis::Vector<THistogram> Histograms;
+        Basis::Vector<size_t> ValuesCounts;
+
+        Basis::Vector<TRow> Rows;
+        Basis::Vector<TRow> TmpRows;
+        Basis::Vector<Pass> Passes;
+        size_t PassIndex = 0;
+        /// Позиция обработки на текущем этапе.
+        size_t Position = 0;
+    };
+
+    /**
+     * \brief Cостояние поразрядной сортировки.
+     * \see RadixSortInfo.
+     */
+    std::optional<RadixSortInfo> mRadixInfo;
     /**
      * \brief Функтор сравнения.
      * \see SortOrderComparator.
@@ -208,9 +269,16 @@ public:
             return;
         }
 
-        /// Временный буфер должен иметь размер исходного буфера.
-        /// TODO: аллокация может занимать много времени.
-        mTmpBuffer->resize(mResult->size());
+        /// Временный буфер заполняется при слиянии. Буфер из SortBufferPool уже имеет нужную емкость.
+        mTmpBuffer->clear();
+        mTmpBuffer->reserve(mResult->size());
+
+        if (IsRadixSortApplicable())
+        {
+            InitRadixSort();
+            mState = State::KeyExtraction;
+            return;
+        }
         /// Если объект создан переходим в следующее состояние.
         mState = State::PartSort;
     }
@@ -225,17 +293,21 @@ public:
 
         mState = State::Initializing;
         mOk = true;
+        mSliceRows = 0;
 
         mMergeInfo = MergeSortInfo {};
+        mRadixInfo = std::nullopt;
     }
 
     /**
      * \brief Выполнение операции.
      * Два этапа сортировки: сортировка по частям и сортировка слиянием.
+     * Для поразрядной сортировки: извлечение ключей, проходы по байтам ключей и перестановка.
      * Каждый вызов Process выполняется за константное время.
      */
     State Process()
     {
+        mSliceRows = 0;
         switch (mState)
         {
         case State::PartSort:
@@ -244,6 +316,15 @@ public:
         case State::MergeSort:
             ProcessMergeSort();
             break;
+        case State::KeyExtraction:
+            ProcessKeyExtraction();
+            break;
+        case State::RadixSort:
+            ProcessRadixSort();
+            break;
+        case State::Permutation:
+            ProcessPermutation();
+            break;
         default:
             /// Process можно вызывать только в состояниях обработки операции.
             mTracer.ErrorSlow("Sorter.Process: state is invalid:", mState);
@@ -258,7 +339,204 @@ public:
         return mState;
     }
 
+    size_t GetSliceRows() const
+    {
+        return mSliceRows;
+    }
+
 private:
+    /**
+     * \brief Проверка применимости поразрядной сортировки.
+     * Все колонки порядка сортировки должны быть целочисленными.
+     * Небольшие массивы сортируются сравнением за один вызов.
+     */
+    bool IsRadixSortApplicable() const
+    {
+        if constexpr (!UseRadixSort)
+        {
+            return false;
+        }
+        else
+        {
+            if (mResult->size() <= static_cast<size_t>(MaxCount))
+            {
+                return false;
+            }
+            return std::all_of(mSortOrder->cbegin(), mSortOrder->cend(), [](const auto aColumn)
+            {
+                const auto* info = TableUtils<TTableSetup>::GetColumnsInfo(aColumn);
+                return info && info->Type == TradingSerialization::Table::FilterValueType::Int;
+            });
+        }
+    }
+
+    void InitRadixSort()
+    {
+        const auto size = mResult->size();
+        const auto columnsCount = mSortOrder->size();
+
+        auto& info = mRadixInfo.emplace();
+        info.Keys.resize(columnsCount);
+        info.HasValue.resize(columnsCount);
+        info.Histograms.resize(columnsCount);
+        info.ValuesCounts.resize(columnsCount);
+        for (size_t i = 0; i < columnsCount; ++i)
+        {
+            info.Keys[i].reserve(size);
+            info.HasValue[i].reserve(size);
+            for (auto& histogram : info.Histograms[i])
+            {
+                histogram.fill(0);
+            }
+        }
+        info.Rows.resize(size);
+        info.TmpRows.resize(size);
+    }
+
+    /**
+     * \brief Извлечение ключей.
+     * Значения колонок отображаются в беззнаковые ключи, по ним строятся гистограммы байтов.
+     */
+    void ProcessKeyExtraction()
+    {
+        auto& info = *mRadixInfo;
+        const auto size = mResult->size();
+        const auto end = std::min(size, info.Position + MaxCount);
+        mSliceRows = end - info.Position;
+        for (; info.Position < end; ++info.Position)
+        {
+            const auto& item = (*mResult)[info.Position];
+            for (size_t i = 0; i < mSortOrder->size(); ++i)
+            {
+                const auto value = item->GetValue(static_cast<TTableColumnType>((*mSortOrder)[i]));
+                const auto* intValue = boost::get<TradingSerialization::Table::TInt>(&value);
+                if (!intValue)
+                {
+                    mState = State::Error;
+                    mTracer.ErrorSlow("Sorter: column is not integer:", (*mSortOrder)[i]);
+                    return;
+                }
+
+                uint64_t key = 0;
+                if (*intValue)
+                {
+                    key = static_cast<uint64_t>(**intValue) ^ (uint64_t { 1 } << 63);
+                    ++info.ValuesCounts[i];
+                }
+                info.Keys[i].push_back(key);
+                info.HasValue[i].push_back(intValue->has_value());
+                for (size_t byte = 0; byte < sizeof(uint64_t); ++byte)
+                {
+                    ++info.Histograms[i][byte][(key >> (8 * byte)) & 0xFF];
+                }
+            }
+            info.Rows[info.Position] = static_cast<typename RadixSortInfo::TRow>(info.Position);
+        }
+
+        if (info.Position == size)
+        {
+            PrepareRadixPasses();
+            info.Position = 0;
+            mState = info.Passes.empty() ? State::Permutation : State::RadixSort;
+        }
+    }
+
+    /**
+     * \brief Подготовка проходов.
+     * Проходы идут от младшей колонки порядка сортировки к старшей, внутри колонки - от младшего байта
+     * к старшему, последним - проход по флагу заполненности: незаполненные значения меньше заполненных.
+     * Байты, одинаковые у всех строк, пропускаются.
+     */
+    void PrepareRadixPasses()
+    {
+        using TRow = typename RadixSortInfo::TRow;
+
+        auto& info = *mRadixInfo;
+        const auto size = mResult->size();
+        for (size_t column = mSortOrder->size(); column-- > 0;)
+        {
+            for (size_t byte = 0; byte < sizeof(uint64_t); ++byte)
+            {
+                const auto& histogram = info.Histograms[column][byte];
+                if (std::find(histogram.cbegin(), histogram.cend(), size) != histogram.cend())
+                {
+                    continue;
+                }
+
+                typename RadixSortInfo::Pass pass { column, static_cast<int>(8 * byte), {} };
+                pass.Offsets.resize(histogram.size());
+                TRow offset = 0;
+                for (size_t digit = 0; digit < histogram.size(); ++digit)
+                {
+                    pass.Offsets[digit] = offset;
+                    offset += histogram[digit];
+                }
+                info.Passes.push_back(std::move(pass));
+            }
+
+            const auto valuesCount = info.ValuesCounts[column];
+            if (valuesCount != 0 && valuesCount != size)
+            {
+                info.Passes.push_back({ column, -1, { 0, static_cast<TRow>(size - valuesCount) } });
+            }
+        }
+        info.Histograms.clear();
+    }
+
+    /**
+     * \brief Очередная итерация прохода поразрядной сортировки.
+     * Устойчиво раскладывает не больше MaxCount строк по значению байта ключа.
+     */
+    void ProcessRadixSort()
+    {
+        auto& info = *mRadixInfo;
+        auto& pass = info.Passes[info.PassIndex];
+        const auto& keys = info.Keys[pass.Column];
+        const auto& hasValue = info.HasValue[pass.Column];
+
+        const auto end = std::min(info.Rows.size(), info.Position + MaxCount);
+        mSliceRows = end - info.Position;
+        for (; info.Position < end; ++info.Position)
+        {
+            const auto row = info.Rows[info.Position];
+            const auto digit = pass.Shift < 0
+                ? hasValue[row]
+                : (keys[row] >> pass.Shift) & 0xFF;
+            info.TmpRows[pass.Offsets[digit]++] = row;
+        }
+
+        if (info.Position == info.Rows.size())
+        {
+            std::swap(info.Rows, info.TmpRows);
+            info.Position = 0;
+            if (++info.PassIndex == info.Passes.size())
+            {
+                mState = State::Permutation;
+            }
+        }
+    }
+
+    /**
+     * \brief Перестановка элементов в порядке отсортированных номеров строк.
+     */
+    void ProcessPermutation()
+    {
+        auto& info = *mRadixInfo;
+        const auto end = std::min(info.Rows.size(), info.Position + MaxCount);
+        mSliceRows = end - info.Position;
+        for (; info.Position < end; ++info.Position)
+        {
+            PutTmp(info.Position, std::move((*mResult)[info.Rows[info.Position]]));
+        }
+
+        if (info.Position == info.Rows.size())
+        {
+            std::swap(*mTmpBuffer, *mResult);
+            mRadixInfo = std::nullopt;
+            mState = State::Completed;
+        }
+    }
+
     /**
      * \brief Простая сортировка.
      * Сортировка текущей части с помощью стандартной функции сортировки из std.
@@ -266,6 +544,7 @@ private:
      */
     bool PlainSort(TIt aSecondIt)
     {
+        mSliceRows += aSecondIt - mCurrentPartIt;
         std::sort(mCurrentPartIt, aSecondIt, *mComparator);
         /// Компаратор может выставить флаг ошибки в False
         if (!mOk)
@@ -343,7 +622,7 @@ private:
         {
             /// Начало среднего цикла
             mergeParts = TPartIterators {};
-            mergeParts->Target = mTmpBuffer->begin();
+            mergeParts->Target = 0;
             mergeParts->SortIt1 = mResult->begin();
             FindSecondPart();
         }
@@ -367,7 +646,7 @@ private:
             {
                 /// Завершение итерации среднего цикла. Перемещаемся к следующим двум частям
                 const auto partsDistance = mergeParts->SortIt3 - mergeParts->SortIt1;
-                mergeParts->Target = mergeParts->Target += partsDistance;
+                mergeParts->Target += static_cast<size_t>(partsDistance);
                 mergeParts->SortIt1 = mergeParts->SortIt3;
                 FindSecondPart();
             }
@@ -507,9 +786,10 @@ private:
         auto& mergeParts = mMergeInfo.PartIt;
         assert(mergeParts);
 
-        std::swap(*mergeParts->Target, *mergeParts->SortIt1);
+        PutTmp(mergeParts->Target, std::move(*mergeParts->SortIt1));
         ++mergeParts->SortIt1;
         ++mergeParts->Target;
+        ++mSliceRows;
     }
 
     /**
@@ -540,9 +820,10 @@ private:
         auto& itemIt = mergeParts.ItemIt;
         assert(itemIt);
 
-        std::swap(*itemIt->ITarget, *itemIt->IRight);
+        PutTmp(itemIt->ITarget, std::move(*itemIt->IRight));
         ++itemIt->ITarget;
         ++itemIt->IRight;
+        ++mSliceRows;
     }
 
     /**
@@ -556,9 +837,25 @@ private:
         auto& itemIt = mergeParts.ItemIt;
         assert(itemIt);
 
-        std::swap(*itemIt->ITarget, *itemIt->ILeft);
+        PutTmp(itemIt->ITarget, std::move(*itemIt->ILeft));
         ++itemIt->ITarget;
         ++itemIt->ILeft;
+        ++mSliceRows;
+    }
+
+    /**
+     * \brief Записать элемент во временный буфер.
+     * Позиции проходятся по порядку, поэтому на первом проходе элемент дописывается в конец буфера.
+     */
+    void PutTmp(size_t aPosition, TItem&& aItem)
+    {
+        if (aPosition < mTmpBuffer->size())
+        {
+            (*mTmpBuffer)[aPosition] = std::move(aItem);
+            return;
+        }
+        assert(aPosition == mTmpBuffer->size());
+        mTmpBuffer->push_back(std::move(aItem));
     }
 
     /**
@@ -11,7 +11,14 @@
 #include "UiLocalStore/ITableIncrementMaker.hpp"
 #include "UiLocalStore/ITableSorter.hpp"
 #include "UiLocalStore/LocalStoreUtils.hpp"
+#include "UiLocalStore/RankedSnapshot.hpp"
+#include "UiLocalStore/SeededFiltration.hpp"
+#include "UiLocalStore/SortBufferPool.hpp"
+#include "UiLocalStore/SubscriptionContainment.hpp"
 #include "UiLocalStore/VersionedDataContainer.hpp"
+#include "UiLocalStore/WindowedTableSorter.hpp"
+
+#include "TradingSerialization/Table/RowRange.hpp"
 
 #include <Common/Tracer.hpp>
 
@@ -22,6 +29,26 @@ namespace NTPro::Ecn::NewUiServer
  * \brief Обработчик подписки на табличные данные.
  * \ingroup NewUiServer
  * Подготавливает данные для подписки и содержит ее состояние.
+ * Если в сетапе объявлен TRankedSnapshot, после первой сортировки результат хранится в упорядоченном дереве:
+ * инкременты применяются к нему за O(k log N) без пересборки массива. Пока клиент не запросил окно строк,
+ * массив собирается при запросе результата. После запроса окна (SetRowWindow) отправляются только его строки
+ * (GetRowWindowResult), выбранные по номерам без обхода результата, а сдвиг окна не требует обработки.
+ * Если в сетапе объявлен TSeededFiltration, подписку можно заполнить результатом более широкой подписки
+ * с тем же порядком сортировки (Seed): он фильтруется вместо обхода хранилища, сортировка пропускается.
+ * Так же готовая подписка меняет фильтры или порядок сортировки (Modify): если новые фильтры уже старых,
+ * фильтруется и при необходимости пересортировывается ее текущий результат.
+ * Если в сетапе объявлен TWindowedTableSorter, подписка упорядочивает только строки [0, Bottom] окна,
+ * запрошенного клиентом (SetRowWindow), остальные строки результата остаются в произвольном порядке.
+ * Окно только расширяется: при прокрутке готовая подписка досортировывает копию результата до конца окна.
+ * Инкремент применяется без слияния (WindowedIncrementApplicator), затем окно упорядочивается заново.
+ * Если расчет инкремента поддерживает интервалы версий, отставшая подписка переходит сразу на нужную версию
+ * (JumpToVersion) и строит один инкремент за все пропущенные версии.
+ * Если TIndexedDataRanges - ColumnarRanges, первый результат строится обходом колоночного снимка хранилища,
+ * и фильтрация проверяет строки по колонкам (CompiledFilterGroup::CheckRow), не читая значения из элементов.
+ * Инкременты при этом по-прежнему строятся по индексам хранилища.
+ * Подписка считает обработанные строки (GetProcessedRows): строки, которые просмотрели за каждый вызов Process
+ * фильтрация, сортировка, расчет и применение инкремента (GetSliceRows этих операций).
+ * По ним контейнер подписок распределяет реактор.
  */
 template <typename TSetup>
 class TableSubscriptionActor
@@ -47,6 +74,7 @@ public:
     using TFiltermanImpl = typename TSetup::TTableIndexFilterman;
     using TFiltermanInit = typename TSetup::TTableIndexFiltermanInit;
     using IFilterman = ITableFilterman::Performer<TFiltermanImpl>;
+    using TCompiledFilters = typename TFiltermanInit::TCompiledFilters;
     using TSorterImpl = typename TSetup::TTableSorter;
     using TSorterInit = typename TSetup::TTableSorterInit;
     using ISorter = ITableSorter::Performer<TSorterImpl>;
@@ -60,6 +88,20 @@ public:
     using IRanges = typename IDataRanges<TData>::template Ranges<typename TSetup::TIndexedDataRanges>;
     using IRangesInit = typename TSetup::TIndexedDataRangesInit;
     using IState = ISubscriptionStateMachine::Machine<TState, TEvent, typename TSetup::TSubscriptionStateMachine>;
+    using TSortBufferPoolPtr = std::shared_ptr<SortBufferPool<TData>>;
+    using TSeededFiltration = typename SeededFiltrationOf<TSetup>::Type;
+    using TWindowedSorter = typename WindowedTableSorterOf<TSetup>::Type;
+    using TWindowedIncrementApplicator = typename TWindowedSorter::TIncrementApplicator;
+    using TRowRange = TradingSerialization::Table::RowRange;
+    using TRankedSnapshot = typename RankedSnapshotOf<TSetup>::Type;
+
+    static constexpr bool UseRankedSnapshot = HasRankedSnapshot<TSetup>::value;
+    static constexpr bool UseSeededFiltration = HasSeededFiltration<TSetup>::value;
+    static constexpr bool UseWindowedSorting = HasWindowedTableSorter<TSetup>::value;
+    static constexpr bool UseVersionIntervals = SupportsVersionIntervalOf<TTableIncrementMakerImpl>::value;
+
+    static_assert(!UseRankedSnapshot || !UseWindowedSorting,
+        "TRankedSnapshot requires a fully sorted result and cannot be used with TWindowedTableSorter");
 
 private:
 
@@ -67,20 +109,51 @@ private:
 
     TUiSubscription::TId mRequestId;
     TUiSubscription mSubscription;
+    /// Фильтры подписки компилируются один раз и используются при каждой фильтрации.
+    TCompiledFilters mCompiledFilters;
 
     const TMap& mRawData;
 
     mutable TProcessingResult mProcessedResult;
     /// For sorting
     TDataPack mTmpBuffer;
+    /// Пул, из которого берется mTmpBuffer на время сортировки. Если не задан, буфер принадлежит подписке.
+    TSortBufferPoolPtr mSortBuffers;
+    bool mTmpBufferBorrowed = false;
 
     mutable TCompletedResult mCompletedResult;
 
     TDataVersion mVersion = 0;
+    /// Первая версия, изменения которой еще не учтены в результате.
+    /// После перехода через несколько версий остается меньше mVersion, пока инкремент не применен.
+    TDataVersion mIncrementFromVersion = 0;
 
     TDataPack mDeletedIncrement;
     TDataPack mAddedIncrement;
 
+    TRankedSnapshot mRankedSnapshot;
+    /// Массив результата не соответствует дереву и будет собран при запросе.
+    mutable bool mRankedResultStale = false;
+
+    /// Фильтрация результата более широкой подписки вместо обхода хранилища.
+    TSeededFiltration mSeededFiltration;
+    /// Результат, которым заполнена подписка, уже отсортирован в ее порядке.
+    bool mSeedKeepsOrder = false;
+
+    /// Строки, обработанные подпиской за все время.
+    size_t mProcessedRows = 0;
+
+    /// Окно строк, запрошенное клиентом. При сортировке окна упорядочиваются строки [0, Bottom].
+    TRowRange mRowWindow;
+    /// Клиент запросил окно строк, результат из дерева отправляется по окну.
+    bool mRowWindowRequested = false;
+    /// Окно сдвинулось у готовой подписки: нужно только отправить его строки.
+    bool mRowWindowMoved = false;
+    /// Количество первых строк mProcessedResult, которые уже упорядочены.
+    size_t mSortedCount = 0;
+    TWindowedSorter mWindowedSorter;
+    TWindowedIncrementApplicator mWindowedIncrementApplicator;
+
 public:
     IState State;
 
@@ -96,12 +169,20 @@ public:
         const TUiSubscription::TId& aRequestId,
         const TUiSubscription& aSubscription,
         const TMap& aRawData,
-        TDataVersion aVersion)
+        TDataVersion aVersion,
+        TSortBufferPoolPtr aSortBuffers = nullptr)
         : mTracer(aTracer)
         , mRequestId(aRequestId)
         , mSubscription(aSubscription)
+        , mCompiledFilters(mSubscription.FilterExpression)
         , mRawData(aRawData)
+        , mSortBuffers(std::move(aSortBuffers))
         , mVersion(aVersion)
+        , mIncrementFromVersion(aVersion)
+        , mRankedSnapshot(mTracer)
+        , mSeededFiltration(mTracer)
+        , mWindowedSorter(mTracer)
+        , mWindowedIncrementApplicator(mTracer)
         , State(mTracer)
         , Ranges(mTracer)
         , Filterman(mTracer)
@@ -110,19 +191,156 @@ public:
         , IncrementApplicator(mTracer)
 
     {
+        mRowWindow.Top = 0;
+        mRowWindow.Bottom = TRowRange::MaxRowWindow - 1;
         mTracer.Info("New subscription: snapshot size");
     }
 
+    ~TableSubscriptionActor()
+    {
+        ReleaseTmpBuffer();
+    }
+
     const TUiSubscription::TId& GetRequestId() const
     {
         return mRequestId;
     }
 
+    /**
+     * \brief Передать обработчик другой подписке, которая получает его результат.
+     */
+    void SetRequestId(const TUiSubscription::TId& aRequestId)
+    {
+        mRequestId = aRequestId;
+    }
+
     TDataVersion GetVersion() const
     {
         return mVersion;
     }
 
+    /**
+     * \brief Самая старая версия, строки которой еще нужны подписке.
+     * После JumpToVersion инкремент читает строки, перезаписанные всеми пропущенными версиями,
+     * поэтому до его применения хранилище не должно удалять версии раньше mIncrementFromVersion.
+     */
+    TDataVersion GetOldestReadVersion() const
+    {
+        return mIncrementFromVersion;
+    }
+
+    const TUiSubscription& GetSubscription() const
+    {
+        return mSubscription;
+    }
+
+    /**
+     * \brief Заполнить подписку результатом более широкой подписки.
+     * aParentResult - отсортированный результат подписки той же версии данных,
+     * которую уточняет эта подписка (SubscriptionContainment::IsRefinement).
+     * Возможно только до начала обработки.
+     */
+    bool Seed(const TCompletedResult& aParentResult)
+    {
+        if constexpr (UseSeededFiltration)
+        {
+            if (State.GetState() != TState::Initializing || mSeededFiltration.IsSeeded())
+            {
+                return false;
+            }
+            mSeededFiltration.Seed(aParentResult);
+            mSeedKeepsOrder = true;
+            mTracer.InfoSlow("Seed: size:", aParentResult->size());
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    /**
+     * \brief Изменить фильтры и порядок сортировки готовой подписки.
+     * Новые фильтры должны быть не шире текущих (SubscriptionContainment::IsFilterRefinement):
+     * текущий результат фильтруется, а при смене порядка пересортировывается, хранилище не обходится.
+     * Возвращает false, если изменение невозможно, тогда подписка остается прежней.
+     */
+    bool Modify(const TUiSubscription& aSubscription)
+    {
+        if constexpr (UseSeededFiltration)
+        {
+            if (!IsOk()
+                || !SubscriptionContainment::IsFilterRefinement(
+                    mSubscription.FilterExpression, aSubscription.FilterExpression))
+            {
+                return false;
+            }
+            auto result = GetResult();
+            mSeedKeepsOrder = (mSubscription.SortOrder == aSubscription.SortOrder);
+            mSubscription = aSubscription;
+            mCompiledFilters = TCompiledFilters(mSubscription.FilterExpression);
+            mSeededFiltration.Seed(result);
+            State.ChangeState(TEvent::SubscriptionModified);
+            mTracer.InfoSlow("Modify: size:", result->size(), ", keeps order:", mSeedKeepsOrder);
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    /**
+     * \brief Запросить окно строк результата.
+     * При сортировке окна оно только расширяется, чтобы его строки оставались упорядоченными
+     * для всех подписок обработчика. Если готовая подписка упорядочила меньше строк, чем требует окно,
+     * она досортировывает результат.
+     * С упорядоченным деревом окно может сдвигаться в обе стороны, готовая подписка отправляет его строки.
+     * Возвращает true, если подписка начала обработку.
+     */
+    bool SetRowWindow(const TRowRange& aRows)
+    {
+        if (aRows.Top < 0 || aRows.Bottom < aRows.Top)
+        {
+            mTracer.WarningSlow("SetRowWindow: invalid window:", aRows);
+            return false;
+        }
+        if constexpr (UseRankedSnapshot)
+        {
+            mRowWindow.Top = aRows.Top;
+            mRowWindow.Bottom = aRows.Bottom;
+            mRowWindowRequested = true;
+            if (IsOk())
+            {
+                mRowWindowMoved = true;
+                State.ChangeState(TEvent::RowWindowChanged);
+                mTracer.InfoSlow("SetRowWindow: window: ", mRowWindow);
+                return true;
+            }
+            return false;
+        }
+        mRowWindow.Top = aRows.Top;
+        mRowWindow.Bottom = std::max(mRowWindow.Bottom, aRows.Bottom);
+
+        if constexpr (UseWindowedSorting)
+        {
+            if (IsOk() && !IsRowWindowSorted())
+            {
+                /// Отправленный результат не меняется, окно упорядочивается в его копии.
+                mProcessedResult = Basis::MakeShared<TDataPack>(*mCompletedResult);
+                State.ChangeState(TEvent::RowWindowChanged);
+                mTracer.InfoSlow("SetRowWindow: sorted:", mSortedCount, ", window: ", mRowWindow);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const TRowRange& GetRowWindow() const
+    {
+        return mRowWindow;
+    }
+
     TState GetState() const
     {
         return State.GetState();
@@ -151,9 +369,40 @@ public:
     void IncreaseVersion()
     {
         ++mVersion;
+        mIncrementFromVersion = mVersion;
         State.ChangeState(TEvent::UpdatesReceived);
     }
 
+    /**
+     * \brief Перейти сразу на версию aVersion одним инкрементом.
+     * Если расчет инкремента не поддерживает интервалы версий, подписка переходит на следующую версию.
+     */
+    void JumpToVersion(TDataVersion aVersion)
+    {
+        if constexpr (UseVersionIntervals)
+        {
+            assert(aVersion > mVersion);
+            mIncrementFromVersion = mVersion + 1;
+            mVersion = aVersion;
+            State.ChangeState(TEvent::UpdatesReceived);
+        }
+        else
+        {
+            IncreaseVersion();
+        }
+    }
+
+    /**
+     * \brief Перейти на следующую версию без пересчета.
+     * Вызывается, если изменения версии не затрагивают фильтры подписки.
+     */
+    void SkipVersion()
+    {
+        assert(IsOk());
+        ++mVersion;
+        mIncrementFromVersion = mVersion;
+    }
+
     bool ProcessGetNext()
     {
         assert(false);
@@ -187,13 +436,84 @@ public:
         }
     }
 
+    /**
+     * \brief Число строк, обработанных подпиской за все время.
+     */
+    size_t GetProcessedRows() const
+    {
+        return mProcessedRows;
+    }
+
+    /**
+     * \brief Результат подписки.
+     * При сортировке окна упорядочены только строки до конца окна, остальные следуют за ними в произвольном порядке.
+     */
     TCompletedResult GetResult() const
     {
         [[maybe_unused]] auto state = State.GetState();
         assert(state == TState::Ok);
+        if constexpr (UseRankedSnapshot)
+        {
+            if (mRankedResultStale)
+            {
+                mProcessedResult = Basis::MakeShared<TDataPack>();
+                mRankedSnapshot.CopyAll(*mProcessedResult);
+                mCompletedResult = mProcessedResult;
+                mRankedResultStale = false;
+            }
+        }
         return mCompletedResult;
     }
 
+    /**
+     * \brief Отправлять клиенту только строки окна (GetRowWindowResult) вместо всего результата.
+     */
+    bool IsRowWindowRequested() const
+    {
+        return UseRankedSnapshot && mRowWindowRequested;
+    }
+
+    /**
+     * \brief Строки окна [Top, Bottom] текущего результата.
+     * С упорядоченным деревом окно выдается по номерам строк, без сборки всего результата.
+     */
+    TCompletedResult GetRowWindowResult() const
+    {
+        [[maybe_unused]] auto state = State.GetState();
+        assert(state == TState::Ok);
+        auto rows = Basis::MakeShared<TDataPack>();
+        if constexpr (UseRankedSnapshot)
+        {
+            mRankedSnapshot.CopyRows(mRowWindow, *rows);
+        }
+        else
+        {
+            const auto size = static_cast<int64_t>(mCompletedResult->size());
+            if (mRowWindow.Top < size)
+            {
+                rows->assign(
+                    mCompletedResult->cbegin() + mRowWindow.Top,
+                    mCompletedResult->cbegin() + std::min(mRowWindow.Bottom + 1, size));
+            }
+        }
+        return rows;
+    }
+
+    /**
+     * \brief Количество строк текущего результата.
+     */
+    size_t GetResultSize() const
+    {
+        if constexpr (UseRankedSnapshot)
+        {
+            return mRankedSnapshot.Size();
+        }
+        else
+        {
+            return mCompletedResult->size();
+        }
+    }
+
     ISubscriptionActor::TDeletedIds GetDeletedIds() const
     {
         return ISubscriptionActor::TDeletedIds {};
@@ -205,10 +525,116 @@ public:
     }
 
 private:
+    bool IsSeeded() const
+    {
+        if constexpr (UseSeededFiltration)
+        {
+            return mSeededFiltration.IsSeeded();
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    /**
+     * \brief Взять буфер сортировки из пула.
+     * Без пула используется собственный буфер подписки.
+     */
+    void BorrowTmpBuffer(size_t aSize)
+    {
+        if (!mSortBuffers || mTmpBufferBorrowed)
+        {
+            return;
+        }
+        mTmpBuffer = mSortBuffers->Acquire(aSize);
+        mTmpBufferBorrowed = true;
+    }
+
+    void ReleaseTmpBuffer()
+    {
+        if (!mTmpBufferBorrowed)
+        {
+            return;
+        }
+        mSortBuffers->Release(std::move(mTmpBuffer));
+        mTmpBuffer = TDataPack {};
+        mTmpBufferBorrowed = false;
+    }
+
+    bool IsRowWindowSorted() const
+    {
+        const auto windowEnd = static_cast<size_t>(mRowWindow.Bottom) + 1;
+        return mSortedCount >= std::min(windowEnd, mProcessedResult->size());
+    }
+
+    /**
+     * \brief Упорядочить окно строк mProcessedResult, первые mSortedCount строк которого уже упорядочены.
+     * Completed возвращается, когда упорядочено все окно, в том числе расширенное во время сортировки.
+     */
+    TableSorterState SortRowWindow()
+    {
+        if constexpr (!UseWindowedSorting)
+        {
+            return TableSorterState::Error;
+        }
+        else
+        {
+            auto state = mWindowedSorter.GetState();
+            if (!mWindowedSorter.IsInitialized())
+            {
+                BorrowTmpBuffer(mProcessedResult->size());
+                mWindowedSorter.Init(typename TWindowedSorter::TInit
+                {
+                    mSubscription.SortOrder,
+                    *mProcessedResult,
+                    mTmpBuffer,
+                    mRowWindow.Bottom,
+                    mSortedCount
+                });
+                state = mWindowedSorter.GetState();
+            }
+            else
+            {
+                state = mWindowedSorter.Process();
+                mProcessedRows += mWindowedSorter.GetSliceRows();
+            }
+
+            switch (state)
+            {
+            case TableSorterState::Completed:
+                mSortedCount = mWindowedSorter.GetSortedCount();
+                if (!IsRowWindowSorted())
+                {
+                    /// Окно расширилось во время сортировки, отбор продолжается по хвосту.
+                    return mWindowedSorter.ExtendWindow(mRowWindow.Bottom);
+                }
+                mWindowedSorter.Reset();
+                ReleaseTmpBuffer();
+                break;
+            case TableSorterState::Error:
+                mWindowedSorter.Reset();
+                ReleaseTmpBuffer();
+                break;
+            default:
+                break;
+            }
+            return state;
+        }
+    }
 
     bool ProcessInitializingState()
     {
         mProcessedResult = Basis::MakeShared<TDataPack>();
+        mSortedCount = 0;
+        mRowWindowMoved = false;
+        if (IsSeeded())
+        {
+            /// Строки берутся из результата другой подписки, хранилище не обходится.
+            State.ChangeState(TEvent::Initialized);
+            mTracer.Info("ProcessInitializingState: initialized from seed");
+            return true;
+        }
         /// TODO: нельзя отдавать управление в реактор после инициализации, т.к. в первый момент времени
         /// итераторы могут указывать на данные предыдущих версий, которые могут быть удалены.
         /// При фильтрации мы отдаем управление, остановившись на данных своей версии, которые не будут удаляться.
@@ -225,17 +651,49 @@ private:
 
     bool ProcessFiltrationState()
     {
+        if constexpr (UseSeededFiltration)
+        {
+            if (mSeededFiltration.IsSeeded())
+            {
+                /// Фильтруется результат более широкой подписки.
+                if (!mSeededFiltration.IsInitialized())
+                {
+                    mSeededFiltration.Init(mSubscription.FilterExpression, *mProcessedResult, &mCompiledFilters);
+                }
+
+                const auto state = mSeededFiltration.Process();
+                mProcessedRows += mSeededFiltration.GetSliceRows();
+                switch (state)
+                {
+                case TableFiltermanState::Completed:
+                    State.ChangeState(TEvent::FiltrationCompleted);
+                    mTracer.InfoSlow("ProcessFiltrationState: seeded filtration completed:", mProcessedResult->size());
+                    break;
+                case TableFiltermanState::Error:
+                    mSeededFiltration.Reset();
+                    State.ReportError("Seeded filtration failed");
+                    return false;
+                default:
+                    break;
+                }
+                return true;
+            }
+        }
+
         if (!Filterman.IsInitialized())
         {
             Filterman.Init(TFiltermanInit
             {
                 mSubscription.FilterExpression,
                 *mProcessedResult,
-                Ranges.Get()
+                Ranges.Get(),
+                &mCompiledFilters
             });
         }
 
-        switch (Filterman.Process())
+        const auto state = Filterman.Process();
+        mProcessedRows += GetSliceRows<TFiltermanImpl>(Filterman);
+        switch (state)
         {
         case TableFiltermanState::Completed:
             State.ChangeState(TEvent::FiltrationCompleted);
@@ -254,8 +712,57 @@ private:
 
     bool ProcessSortingState()
     {
+        if constexpr (UseRankedSnapshot)
+        {
+            if (mRowWindowMoved)
+            {
+                /// Результат не изменился, отправляются строки нового окна.
+                mRowWindowMoved = false;
+                State.ChangeState(TEvent::SortingCompleted);
+                return true;
+            }
+        }
+
+        if (IsSeeded())
+        {
+            if constexpr (UseSeededFiltration)
+            {
+                mSeededFiltration.Reset();
+            }
+            /// Результат с упорядоченным только окном после фильтрации упорядочивается заново.
+            if (mSeedKeepsOrder && !UseWindowedSorting)
+            {
+                /// Фильтрация отсортированного результата сохраняет порядок.
+                mSeedKeepsOrder = false;
+                State.ChangeState(TEvent::SortingCompleted);
+                CompleteSorting();
+                return true;
+            }
+            /// Порядок изменился: пересортировывается только отфильтрованный результат.
+            mSeedKeepsOrder = false;
+        }
+
+        if constexpr (UseWindowedSorting)
+        {
+            switch (SortRowWindow())
+            {
+            case TableSorterState::Completed:
+                State.ChangeState(TEvent::SortingCompleted);
+                Ranges.Reset();
+                CompleteSorting();
+                break;
+            case TableSorterState::Error:
+                State.ReportError("ProcessSortingState: cannot process window sorting");
+                return false;
+            default:
+                break;
+            }
+            return true;
+        }
+
         if (!Sorter.IsInitialized())
         {
+            BorrowTmpBuffer(mProcessedResult->size());
             Sorter.Init(TSorterInit
             {
                 mSubscription.SortOrder,
@@ -265,17 +772,19 @@ private:
             return true;
         }
 
-        switch (Sorter.Process())
+        const auto state = Sorter.Process();
+        mProcessedRows += GetSliceRows<TSorterImpl>(Sorter);
+        switch (state)
         {
         case TableSorterState::Completed:
             Sorter.Reset();
-            /// TODO: clear sort buffer
+            ReleaseTmpBuffer();
             State.ChangeState(TEvent::SortingCompleted);
-            mCompletedResult = mProcessedResult;
             Ranges.Reset();
-            mTracer.InfoSlow("ProcessSortingState: completed. mCompletedResult.size:", mCompletedResult->size());
+            CompleteSorting();
             break;
         case TableSorterState::Error:
+            ReleaseTmpBuffer();
             State.ReportError("ProcessSortingState: cannot process sorting");
             return false;
         default:
@@ -285,6 +794,17 @@ private:
         return true;
     }
 
+    void CompleteSorting()
+    {
+        mCompletedResult = mProcessedResult;
+        if constexpr (UseRankedSnapshot)
+        {
+            mRankedSnapshot.Build(*mCompletedResult);
+            mRankedResultStale = false;
+        }
+        mTracer.InfoSlow("ProcessSortingState: completed. mCompletedResult.size:", mCompletedResult->size());
+    }
+
     bool ProcessUpdatingState()
     {
         mProcessedResult = Basis::MakeShared<TDataPack>();
@@ -299,6 +819,7 @@ private:
             /// TODO: сделать плавную очистку
             mDeletedIncrement.clear();
             mAddedIncrement.clear();
+            BorrowTmpBuffer(0);
 
             IncrementMaker.Init(TTableIncrementMakerInit
             {
@@ -308,17 +829,23 @@ private:
                 mAddedIncrement,
                 mRawData,
                 mTmpBuffer,
-                mVersion
+                mVersion,
+                &mCompiledFilters,
+                mIncrementFromVersion
             });
         }
 
-        switch (IncrementMaker.Process())
+        const auto state = IncrementMaker.Process();
+        mProcessedRows += GetSliceRows<TTableIncrementMakerImpl>(IncrementMaker);
+        switch (state)
         {
         case TableIncrementMakerState::Completed:
             IncrementMaker.Reset();
+            ReleaseTmpBuffer();
             State.ChangeState(TEvent::IncrementMade);
             break;
         case TableIncrementMakerState::Error:
+            ReleaseTmpBuffer();
             State.ReportError("Increment making failed");
             return false;
         default:
@@ -330,6 +857,32 @@ private:
 
     bool ProcessIncrementApplyingState()
     {
+        if constexpr (UseWindowedSorting)
+        {
+            return ProcessWindowIncrementApplyingState();
+        }
+
+        if constexpr (UseRankedSnapshot)
+        {
+            /// Инкремент применяется к дереву, массив результата собирается при запросе.
+            const auto state = mRankedSnapshot.ApplyIncrement(mSubscription.SortOrder, mDeletedIncrement, mAddedIncrement);
+            mProcessedRows += mRankedSnapshot.GetSliceRows();
+            switch (state)
+            {
+            case TableIncrementApplicatorState::Completed:
+                mRankedResultStale = true;
+                mIncrementFromVersion = mVersion;
+                State.ChangeState(TEvent::IncrementApplied);
+                break;
+            case TableIncrementApplicatorState::Error:
+                State.ReportError("Increment applying failed");
+                return false;
+            default:
+                break;
+            }
+            return true;
+        }
+
         if (!IncrementApplicator.IsInitialized())
         {
             IncrementApplicator.Init(TTableIncrementApplicatorInit
@@ -342,10 +895,15 @@ private:
             });
         }
 
-        switch (IncrementApplicator.Process())
+        const auto state = IncrementApplicator.Process();
+        mProcessedRows += GetSliceRows<TTableIncrementApplicatorImpl>(IncrementApplicator);
+        switch (state)
         {
         case TableIncrementApplicatorState::Completed:
             IncrementApplicator.Reset();
+            /// Элементы старого снапшота могли быть перемещены в новый.
+            mCompletedResult = mProcessedResult;
+            mIncrementFromVersion = mVersion;
             State.ChangeState(TEvent::IncrementApplied);
             break;
         case TableIncrementApplicatorState::Error:
@@ -356,6 +914,67 @@ private:
         }
         return true;
     }
+
+    /**
+     * \brief Применить инкремент к результату, упорядоченному только в окне строк.
+     * Инкремент переносится в новый снапшот без слияния, затем окно в нем упорядочивается заново.
+     */
+    bool ProcessWindowIncrementApplyingState()
+    {
+        if constexpr (!UseWindowedSorting)
+        {
+            return false;
+        }
+        else
+        {
+            if (!mWindowedSorter.IsInitialized())
+            {
+                if (!mWindowedIncrementApplicator.IsInitialized())
+                {
+                    mWindowedIncrementApplicator.Init(typename TWindowedIncrementApplicator::TInit
+                    {
+                        mSubscription.SortOrder,
+                        mCompletedResult,
+                        mDeletedIncrement,
+                        mAddedIncrement,
+                        *mProcessedResult
+                    });
+                }
+
+                const auto state = mWindowedIncrementApplicator.Process();
+                mProcessedRows += mWindowedIncrementApplicator.GetSliceRows();
+                switch (state)
+                {
+                case TableIncrementApplicatorState::Completed:
+                    mWindowedIncrementApplicator.Reset();
+                    mSortedCount = 0;
+                    break;
+                case TableIncrementApplicatorState::Error:
+                    mWindowedIncrementApplicator.Reset();
+                    State.ReportError("Increment applying failed");
+                    return false;
+                default:
+                    return true;
+                }
+            }
+
+            switch (SortRowWindow())
+            {
+            case TableSorterState::Completed:
+                /// Элементы старого снапшота могли быть перемещены в новый.
+                mCompletedResult = mProcessedResult;
+                mIncrementFromVersion = mVersion;
+                State.ChangeState(TEvent::IncrementApplied);
+                break;
+            case TableSorterState::Error:
+                State.ReportError("Increment applying failed: cannot sort the row window");
+                return false;
+            default:
+                break;
+            }
+            return true;
+        }
+    }
 };
 
 }
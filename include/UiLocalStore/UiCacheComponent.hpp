@@ -194,6 +194,53 @@ public:
         }
     }
 
+    /**
+     * \brief Изменить фильтры или порядок сортировки подписки кэша.
+     * Подписки, которые обслуживаются или должны обслуживаться из БД, не изменяются и отклоняются.
+     */
+    void ProcessModifySubscription(
+        const TUiSubscription::TId& aRequestId,
+        const typename TLocalStoreLogicInterface::TUiSubscription& aSubscriptionInfo)
+    {
+        mTracer.InfoSlow("ProcessModifySubscription:", aRequestId);
+
+        auto it = mDbQueries.find(aRequestId);
+        if (it != mDbQueries.cend() || SubscriptionRouter.IsDbQuery(aSubscriptionInfo))
+        {
+            mTracer.WarningSlow("Db query cannot be modified:", aRequestId);
+            ProcessUnsubscription(aRequestId);
+            TableProcessor.RejectSubscription(aRequestId, TableProcessorRejectType::WrongSubscription);
+            return;
+        }
+
+        auto error = Logic.ModifySubscription(aRequestId, aSubscriptionInfo);
+        if (error.has_value())
+        {
+            mTracer.Info("Wrong subscription: modification failed");
+            TableProcessor.RejectSubscription(aRequestId, *error);
+            return;
+        }
+        ManageRecalls();
+    }
+
+    /**
+     * \brief Окно строк, которое показывает клиент подписки.
+     * Подписки, которые обслуживаются из БД, отдают строки пакетами и окно не учитывают.
+     */
+    void ProcessRowWindow(
+        const TUiSubscription::TId& aRequestId,
+        const TradingSerialization::Table::RowRange& aRows)
+    {
+        mTracer.TraceSlow("ProcessRowWindow:", aRequestId, ", ", aRows);
+
+        if (mDbQueries.find(aRequestId) != mDbQueries.cend())
+        {
+            return;
+        }
+        Logic.ProcessRowWindow(aRequestId, aRows);
+        ManageRecalls();
+    }
+
     void ProcessGetNext(const TUiSubscription::TId& aRequestId)
     {
         mTracer.TraceSlow("ProcessGetNext", aRequestId);
@@ -350,12 +397,33 @@ private:
             if constexpr (StoreType == SubscriptionType::Table)
             {
                 assert(aUpdate.Result.HasValue());
+                if (aUpdate.Rows)
+                {
+                    /// Окно строк отправляется только подписке без присоединенных.
+                    assert(aUpdate.SharedSubscriptionIds.empty());
+                    mTracer.InfoSlow(
+                        "Send row window snapshot: RequestId:", *aUpdate.SubscriptionId,
+                        ", rows: ", *aUpdate.Rows,
+                        ", row count: ", aUpdate.RowCount);
+                    TableProcessor.SendRowWindowSnapshot(
+                        *aUpdate.SubscriptionId,
+                        *aUpdate.Rows,
+                        aUpdate.RowCount,
+                        aUpdate.Result);
+                    return;
+                }
                 mTracer.InfoSlow(
                     "Send data snapshot: RequestId:", *aUpdate.SubscriptionId,
-                    ", size: ", aUpdate.Result->size());
+                    ", size: ", aUpdate.Result->size(),
+                    ", shared: ", aUpdate.SharedSubscriptionIds.size());
                 TableProcessor.SendDataSnapshot(
                     *aUpdate.SubscriptionId,
                     aUpdate.Result);
+                /// Одинаковые подписки получают один и тот же снапшот.
+                for (const auto& requestId : aUpdate.SharedSubscriptionIds)
+                {
+                    TableProcessor.SendDataSnapshot(requestId, aUpdate.Result);
+                }
             }
             else
             {
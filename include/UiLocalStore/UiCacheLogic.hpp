@@ -10,6 +10,9 @@
 #include "UiLocalStore/VersionedDataContainer.hpp"
 #include "UiLocalStore/ISubscriptionActor.hpp"
 #include "UiLocalStore/ISubscriptionsContainer.hpp"
+#include "UiLocalStore/SetupTraits.hpp"
+#include "UiLocalStore/SortBufferPool.hpp"
+#include "UiLocalStore/SubscriptionKey.hpp"
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/composite_key.hpp>
@@ -64,6 +67,25 @@ namespace NTPro::Ecn::NewUiServer
  * - Idle -> Updating. При получении пакета обновлений он записывается в хранилище с новой версией.
  * - Idle -> Processing. При получении подписки переходим в состояние Processing.
  * - Idle, Processing, Updating -> NotReady. При дисконнекте. Очищаем хранилище. Реджектим подписки.
+ *
+ * Если в сетапе включен ShareIdenticalSubscriptions, подписки с одинаковым каноническим ключом
+ * (SubscriptionKey) обрабатываются одним обработчиком, а результат рассылается всем таким подпискам.
+ * Если включен SeedNarrowerSubscriptions, новая подписка, уточняющая готовую подписку с тем же порядком
+ * сортировки, заполняется фильтрацией ее результата (SubscriptionContainment), без обхода хранилища.
+ * Изменение фильтров или сортировки подписки (ModifySubscription) по возможности выполняется на месте,
+ * иначе подписка пересоздается.
+ * Окно строк клиента (ProcessRowWindow) передается обработчику подписки: обработчик, упорядочивающий
+ * только окно (TWindowedTableSorter), при прокрутке досортировывает результат и отправляет его снова,
+ * а обработчик с упорядоченным деревом (TRankedSnapshot) отправляет только строки окна.
+ * Если включен RouteUpdatesByPredicates, изменения каждой версии хранилища передаются контейнеру подписок,
+ * и обновляются только подписки, фильтры которых эти изменения затрагивают (SubscriptionPredicateIndex).
+ * Если контейнеру подписок задан планировщик (TSubscriptionScheduler), в состоянии Processing подписки
+ * обрабатываются не строго по порядковым номерам: обновления готовых подписок и построение первых результатов
+ * получают квоты строк за обход (SubscriptionScheduler). Внутри класса порядок номеров сохраняется,
+ * и ни один класс не остается без обработки, поэтому справедливость распределения сохраняется.
+ * Пул потоков (TSetup::GetWorkerPool или SetWorkerPool) передается хранилищу для создания элементов
+ * больших пакетов и контейнеру подписок, который выполняет на нем шаги подписок, если это разрешено
+ * его сетапом (ProcessSubscriptionsInParallel). Без пула все выполняется в потоке реактора.
  */
 template <typename TSetup>
 class UiCacheLogic
@@ -80,12 +102,21 @@ public:
     using TState = ILocalStoreStateMachine::State;
     using TEvent = ILocalStoreStateMachine::Event;
 
+    using TSubscriptionActorImpl = typename TSetup::TSubscriptionActor;
+    using TSortBufferPoolPtr = std::shared_ptr<SortBufferPool<TData>>;
+
+    static constexpr bool ShareIdenticalSubscriptions = ShareIdenticalSubscriptionsOf<TSetup>::value;
+    static constexpr bool SeedNarrowerSubscriptions = SeedNarrowerSubscriptionsOf<TSetup>::value;
+    static constexpr bool RouteUpdatesByPredicates = RouteUpdatesByPredicatesOf<TSetup>::value;
+
     ILocalStoreStateMachine::Machine<typename TSetup::TLocalStoreStateMachine> StateMachine;
     ISubscriptionsContainer::Logic<typename TSetup::TSubscriptionsContainer> Subscriptions;
     VersionedDataContainer<TSetup> Data;
 
 private:
     Basis::Tracer& mTracer;
+    /// Временные буферы сортировки, общие для всех подписок.
+    TSortBufferPoolPtr mSortBuffers;
 
 public:
     UiCacheLogic(Basis::Tracer& aTracer)
@@ -93,7 +124,30 @@ public:
         , Subscriptions(aTracer)
         , Data(aTracer)
         , mTracer(aTracer)
+        , mSortBuffers(std::make_shared<SortBufferPool<TData>>())
+    {
+        if constexpr (HasWorkerPool<TSetup>::value)
+        {
+            SetWorkerPool(TSetup::GetWorkerPool());
+        }
+    }
+
+    /**
+     * \brief Задать пул потоков для создания элементов больших пакетов и обработки подписок.
+     * Без пула все выполняется в потоке реактора.
+     */
+    void SetWorkerPool(const std::shared_ptr<WorkerPool>& aWorkerPool)
+    {
+        Data.SetWorkerPool(aWorkerPool);
+        if constexpr (HasSetWorkerPool<typename TSetup::TSubscriptionsContainer>::value)
+        {
+            Subscriptions.Get().SetWorkerPool(aWorkerPool);
+        }
+    }
+
+    const SortBufferPool<TData>& GetSortBufferPool() const
     {
+        return *mSortBuffers;
     }
 
     bool IsReady() const
@@ -111,13 +165,17 @@ public:
             return TableProcessorRejectType::Disconnected;
         }
 
-        if (!Subscriptions.EmplaceSubscription(
-            Basis::MakeShared<ISubscriptionActor::Logic<typename TSetup::TSubscriptionActor>>(
-                mTracer,
-                aRequestId,
-                aSubscription,
-                Data.GetData(),
-                Data.GetCurrentVersion())))
+        if constexpr (ShareIdenticalSubscriptions)
+        {
+            const auto key = SubscriptionKey::Make(aSubscription);
+            if (!Subscriptions.ShareSubscription(aRequestId, key)
+                && !Subscriptions.EmplaceSharedSubscription(CreateSubscriptionActor(aRequestId, aSubscription), key))
+            {
+                mTracer.Error("Request id duplicated, reject");
+                return TableProcessorRejectType::WrongSubscription;
+            }
+        }
+        else if (!Subscriptions.EmplaceSubscription(CreateSubscriptionActor(aRequestId, aSubscription)))
         {
             mTracer.Error("Request id duplicated, reject");
             return TableProcessorRejectType::WrongSubscription;
@@ -126,11 +184,58 @@ public:
         return std::nullopt;
     }
 
+    /**
+     * \brief Изменить фильтры или порядок сортировки подписки.
+     * Если обработчик не может измениться на месте, подписка пересоздается с новыми параметрами.
+     * Общий обработчик при этом передается присоединенной подписке, чтобы освободить идентификатор.
+     */
+    std::optional<TableProcessorRejectType> ModifySubscription(
+        const TSubscriptionId& aRequestId,
+        const TUiSubscription& aSubscription)
+    {
+        if (!IsReady())
+        {
+            mTracer.Info("Logic not ready");
+            return TableProcessorRejectType::Disconnected;
+        }
+
+        if (Subscriptions.ModifySubscription(aRequestId, aSubscription))
+        {
+            StateMachine.ChangeState(TEvent::NewRequestReceived);
+            return std::nullopt;
+        }
+
+        /// Присоединенные подписки продолжают получать результат прежнего обработчика.
+        if (!Subscriptions.TransferOwnership(aRequestId))
+        {
+            Subscriptions.EraseSubscription(aRequestId);
+        }
+        return ProcessSubscription(aRequestId, aSubscription);
+    }
+
     void ProcessUnsubscription(const TSubscriptionId& aRequestId)
     {
         Subscriptions.EraseSubscription(aRequestId);
     }
 
+    /**
+     * \brief Окно строк, которое показывает клиент подписки.
+     * Если обработчик должен досортировать результат до конца окна, подписка снова обрабатывается.
+     */
+    void ProcessRowWindow(const TSubscriptionId& aRequestId, const TradingSerialization::Table::RowRange& aRows)
+    {
+        if (!IsReady())
+        {
+            mTracer.Info("Logic not ready");
+            return;
+        }
+
+        if (Subscriptions.SetRowWindow(aRequestId, aRows))
+        {
+            StateMachine.ChangeState(TEvent::NewRequestReceived);
+        }
+    }
+
     Basis::Vector<TSubscriptionId> Clear()
     {
         StateMachine.ChangeState(TEvent::ApiDisconnected);
@@ -182,6 +287,8 @@ public:
         case TState::Processing:
         {
             auto result = Subscriptions.template ProcessNextSubscription<TData>(version);
+            /// Обработка подписок на пуле завершена, номера строк колоночного снимка можно менять.
+            Data.CompactColumns();
             if (result.Processed)
             {
                 if (result.IsOk())
@@ -223,6 +330,59 @@ public:
     }
 
 private:
+    /**
+     * \brief Создать обработчик подписки.
+     * Если подписка уточняет готовую подписку, обработчик заполняется ее результатом.
+     */
+    auto CreateSubscriptionActor(
+        const TSubscriptionId& aRequestId,
+        const TUiSubscription& aSubscription)
+    {
+        auto actor = MakeSubscriptionActor(aRequestId, aSubscription);
+        if constexpr (SeedNarrowerSubscriptions)
+        {
+            Subscriptions.SeedSubscription(actor, Data.GetCurrentVersion());
+        }
+        return actor;
+    }
+
+    /**
+     * \brief Пул буферов сортировки передается только обработчикам, которые его принимают.
+     */
+    auto MakeSubscriptionActor(
+        const TSubscriptionId& aRequestId,
+        const TUiSubscription& aSubscription)
+    {
+        using TActor = ISubscriptionActor::Logic<TSubscriptionActorImpl>;
+
+        if constexpr (std::is_constructible_v<
+            TSubscriptionActorImpl,
+            Basis::Tracer&,
+            const TSubscriptionId&,
+            const TUiSubscription&,
+            decltype(Data.GetData()),
+            TDataVersion,
+            TSortBufferPoolPtr>)
+        {
+            return Basis::MakeShared<TActor>(
+                mTracer,
+                aRequestId,
+                aSubscription,
+                Data.GetData(),
+                Data.GetCurrentVersion(),
+                mSortBuffers);
+        }
+        else
+        {
+            return Basis::MakeShared<TActor>(
+                mTracer,
+                aRequestId,
+                aSubscription,
+                Data.GetData(),
+                Data.GetCurrentVersion());
+        }
+    }
+
     void ClearOldVersions()
     {
         if (auto version = Subscriptions.GetOldestVersion())
@@ -239,6 +399,11 @@ private:
     {
         if (Data.ProcessIncomingQueue())
         {
+            if constexpr (RouteUpdatesByPredicates)
+            {
+                const auto version = Data.GetCurrentVersion();
+                Subscriptions.AddVersionDelta(version, Data.GetData().GetVersionDeltas().Find(version));
+            }
             StateMachine.ChangeState(TEvent::UpdatesReceived);
             return true;
         }
@@ -149,6 +149,26 @@ public:
         mSubscriptions.erase(aRequestId);
     }
 
+    void ProcessModifySubscription(
+        const TUiSubscription::TId& aRequestId,
+        const TUiSubscription& /* aSubscription */)
+    {
+        /// Запрос к БД не изменяется на месте: клиент переподписывается.
+        mTracer.WarningSlow("ProcessModifySubscription: not supported:", aRequestId);
+        if (mSubscriptions.erase(aRequestId) != 0)
+        {
+            ClientApi.RejectSubscription(aRequestId, TableProcessorRejectType::WrongSubscription);
+        }
+    }
+
+    void ProcessRowWindow(
+        const TUiSubscription::TId& aRequestId,
+        const TradingSerialization::Table::RowRange& /* aRows */)
+    {
+        /// Запрос к БД отдает строки пакетами по порядку, окно строк на него не влияет.
+        mTracer.TraceSlow("ProcessRowWindow: ignored:", aRequestId);
+    }
+
     void ProcessGetNext(const TUiSubscription::TId& aRequestId)
     {
         mTracer.TraceSlow("ProcessGetNext:", aRequestId);
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/VersionedDataContainer.hpp>
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
+
+#include <Common/Tracer.hpp>
+
+#include <Common/Pack.hpp>
+
+#include <memory>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Строки, добавленные и перезаписанные одной версией хранилища.
+ * \ingroup NewUiServer
+ * Строки упорядочены по id, как в индексах версий хранилища.
+ */
+template <typename TData>
+struct VersionDelta
+{
+    using TDataPack = Basis::Pack<TData>;
+
+    TDataVersion Version { 0 };
+    TDataPack Added;
+    TDataPack Deleted;
+};
+
+/**
+ * \brief Кэш изменений по версиям хранилища.
+ * \ingroup NewUiServer
+ * Изменения версии собираются один раз при ее фиксации и затем читаются всеми подписками,
+ * которые строят инкремент к этой версии, вместо прохода по индексам версий каждой подпиской.
+ * Изменение отдается по shared_ptr, поэтому подписка может дочитать его после удаления из кэша.
+ */
+template <typename TData>
+class VersionDeltaCache
+{
+public:
+    using TDelta = VersionDelta<TData>;
+    using TDeltaPtr = std::shared_ptr<const TDelta>;
+    using TDataPack = typename TDelta::TDataPack;
+
+private:
+    /// Изменения идущих подряд версий, начиная с mFirstVersion.
+    Basis::Deque<TDeltaPtr> mDeltas;
+    TDataVersion mFirstVersion { 0 };
+
+    Basis::Tracer& mTracer;
+
+public:
+    VersionDeltaCache(Basis::Tracer& aTracer)
+        : mTracer(aTracer)
+    {
+    }
+
+    /**
+     * \brief Сохранить изменения версии aVersion.
+     * Версии фиксируются по возрастанию, пропуск версии очищает кэш.
+     */
+    void Commit(TDataVersion aVersion, TDataPack&& aAdded, TDataPack&& aDeleted)
+    {
+        if (!mDeltas.empty() && aVersion != mFirstVersion + static_cast<TDataVersion>(mDeltas.size()))
+        {
+            mTracer.WarningSlow("VersionDeltaCache: version gap:", aVersion);
+            mDeltas.clear();
+        }
+        if (mDeltas.empty())
+        {
+            mFirstVersion = aVersion;
+        }
+
+        auto delta = std::make_shared<TDelta>();
+        delta->Version = aVersion;
+        delta->Added = std::move(aAdded);
+        delta->Deleted = std::move(aDeleted);
+        mTracer.InfoSlow(
+            "VersionDeltaCache.Commit: version:", aVersion,
+            ", added: ", delta->Added.size(),
+            ", deleted: ", delta->Deleted.size());
+        mDeltas.push_back(std::move(delta));
+    }
+
+    TDeltaPtr Find(TDataVersion aVersion) const
+    {
+        if (mDeltas.empty()
+            || aVersion < mFirstVersion
+            || aVersion >= mFirstVersion + static_cast<TDataVersion>(mDeltas.size()))
+        {
+            return nullptr;
+        }
+        return mDeltas[static_cast<size_t>(aVersion - mFirstVersion)];
+    }
+
+    /**
+     * \brief Удалить изменения версий до aVersion.
+     */
+    void ErasePrevious(TDataVersion aVersion)
+    {
+        while (!mDeltas.empty() && mFirstVersion < aVersion)
+        {
+            mDeltas.pop_front();
+            ++mFirstVersion;
+        }
+    }
+
+    size_t Size() const
+    {
+        return mDeltas.size();
+    }
+
+    void Clear()
+    {
+        mDeltas.clear();
+        mFirstVersion = 0;
+    }
+};
+
+/**
+ * \brief Заглушка для хранилищ без кэша изменений.
+ */
+template <typename TData>
+struct NoVersionDeltaCache
+{
+    using TDelta = VersionDelta<TData>;
+    using TDeltaPtr = std::shared_ptr<const TDelta>;
+    using TDataPack = typename TDelta::TDataPack;
+
+    NoVersionDeltaCache(Basis::Tracer&)
+    {
+    }
+
+    void Commit(TDataVersion, TDataPack&&, TDataPack&&)
+    {
+    }
+
+    TDeltaPtr Find(TDataVersion) const
+    {
+        return nullptr;
+    }
+
+    void ErasePrevious(TDataVersion)
+    {
+    }
+
+    size_t Size() const
+    {
+        return 0;
+    }
+
+    void Clear()
+    {
+    }
+};
+
+template <typename TContainerSetup, bool = HasVersionDeltaCache<TContainerSetup>::value>
+struct VersionDeltaCacheOf
+{
+    using Type = NoVersionDeltaCache<typename TContainerSetup::TData>;
+};
+
+template <typename TContainerSetup>
+struct VersionDeltaCacheOf<TContainerSetup, true>
+{
+    using Type = typename TContainerSetup::TVersionDeltaCache;
+};
+
+}
@@ -0,0 +1,366 @@
+#pragma once
+
+#include "UiLocalStore/VersionedDataContainer.hpp"
+
+#include <Common/Collections.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <new>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Арена узлов хранилища, сгруппированных по версиям.
+ * \ingroup NewUiServer
+ * Память выделяется из блоков фиксированного размера, выровненных по своему размеру,
+ * поэтому блок освобождаемого узла находится по адресу без дополнительных заголовков.
+ * Узлы идущих подряд версий попадают в одни и те же блоки: при смене версии текущий блок закрывается,
+ * только если он заполнен хотя бы наполовину. Поэтому небольшие версии делят блок, и долгоживущие узлы
+ * малых версий не держат по блоку на версию, а узлы крупных версий лежат в своих блоках.
+ * Блок целиком возвращается в запас, когда освобожден последний его узел, то есть
+ * когда ErasePrevious прошел все версии, которыми блок заполнялся.
+ * Пока в блоке остаются живые узлы, освобожденные узлы одного размера собираются в список свободных
+ * узлов блока и выделяются повторно раньше новых. Иначе при перезаписи случайных строк каждый блок
+ * удерживался бы несколькими долгоживущими узлами, и число блоков росло бы без ограничения.
+ * Крупные выделения идут мимо арены.
+ * Арена не потокобезопасна, как и хранилище, которое ее использует.
+ */
+class VersionEpochArena
+{
+public:
+    static constexpr size_t ChunkSize = 64 * 1024;
+    /// Выделения больше этого размера идут напрямую в operator new.
+    static constexpr size_t MaxBlockSize = ChunkSize / 16;
+    /// Сколько свободных блоков держать для переиспользования.
+    static constexpr size_t MaxSpareChunks = 16;
+    /// Блок, заполненный меньше, продолжает заполняться следующей версией.
+    static constexpr size_t MinEpochChunkFill = ChunkSize / 2;
+
+private:
+    struct FreeNode
+    {
+        FreeNode* Next;
+    };
+
+    struct Chunk
+    {
+        size_t Used;
+        size_t Live;
+        /// Освобожденные узлы размера FreeSize.
+        FreeNode* Free;
+        size_t FreeSize;
+        /// Соседи в списке блоков со свободными узлами размера FreeSize.
+        Chunk* PrevPartial;
+        Chunk* NextPartial;
+    };
+
+    static constexpr size_t DataOffset = (sizeof(Chunk) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    Chunk* mCurrent = nullptr;
+    std::optional<TDataVersion> mEpoch;
+    Basis::Vector<Chunk*> mSpare;
+    /// Блоки со свободными узлами по размеру узла.
+    Basis::UnorderedMap<size_t, Chunk*> mPartial;
+    size_t mChunksCount = 0;
+
+public:
+    VersionEpochArena() = default;
+    VersionEpochArena(const VersionEpochArena&) = delete;
+    VersionEpochArena& operator=(const VersionEpochArena&) = delete;
+
+    ~VersionEpochArena()
+    {
+        if (mCurrent && mCurrent->Live == 0)
+        {
+            FreeChunk(mCurrent);
+        }
+        for (auto* chunk : mSpare)
+        {
+            FreeChunk(chunk);
+        }
+        assert(mChunksCount == 0);
+    }
+
+    /**
+     * \brief Начать выделение узлов версии aVersion.
+     */
+    void BeginEpoch(TDataVersion aVersion)
+    {
+        if (mEpoch == aVersion)
+        {
+            return;
+        }
+        mEpoch = aVersion;
+        if (mCurrent && mCurrent->Live != 0 && mCurrent->Used >= MinEpochChunkFill)
+        {
+            /// Блок освободится, когда будут удалены все его узлы.
+            mCurrent = nullptr;
+        }
+    }
+
+    void* Allocate(size_t aSize, size_t aAlign)
+    {
+        if (aSize > MaxBlockSize || aAlign > alignof(std::max_align_t))
+        {
+            return ::operator new(aSize, std::align_val_t { aAlign });
+        }
+
+        if (auto* node = TakeFreeNode(aSize, aAlign))
+        {
+            return node;
+        }
+
+        auto offset = mCurrent ? AlignUp(mCurrent->Used, aAlign) : ChunkSize;
+        if (offset + aSize > ChunkSize)
+        {
+            if (mCurrent && mCurrent->Live == 0)
+            {
+                mCurrent->Used = DataOffset;
+            }
+            else
+            {
+                mCurrent = TakeChunk();
+            }
+            offset = AlignUp(mCurrent->Used, aAlign);
+        }
+        mCurrent->Used = offset + aSize;
+        ++mCurrent->Live;
+        return reinterpret_cast<char*>(mCurrent) + offset;
+    }
+
+    void Deallocate(void* aPtr, size_t aSize, size_t aAlign) noexcept
+    {
+        if (aSize > MaxBlockSize || aAlign > alignof(std::max_align_t))
+        {
+            ::operator delete(aPtr, std::align_val_t { aAlign });
+            return;
+        }
+
+        auto* chunk = reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(aPtr) & ~(uintptr_t { ChunkSize } - 1));
+        assert(chunk->Live > 0);
+        if (--chunk->Live != 0)
+        {
+            PutFreeNode(chunk, aPtr, aSize);
+            return;
+        }
+        UnlinkPartial(chunk);
+        if (chunk == mCurrent)
+        {
+            chunk->Used = DataOffset;
+            return;
+        }
+        ReleaseChunk(chunk);
+    }
+
+    /// Количество блоков, полученных у системы, включая запасные.
+    size_t GetChunksCount() const
+    {
+        return mChunksCount;
+    }
+
+    size_t GetSpareChunksCount() const
+    {
+        return mSpare.size();
+    }
+
+    /// Количество блоков, в которых есть свободные узлы.
+    size_t GetPartialChunksCount() const
+    {
+        size_t result = 0;
+        for (const auto& [size, chunk] : mPartial)
+        {
+            for (auto* it = chunk; it; it = it->NextPartial)
+            {
+                ++result;
+            }
+        }
+        return result;
+    }
+
+private:
+    static size_t AlignUp(size_t aValue, size_t aAlign)
+    {
+        return (aValue + aAlign - 1) & ~(aAlign - 1);
+    }
+
+    Chunk* TakeChunk()
+    {
+        Chunk* chunk = nullptr;
+        if (!mSpare.empty())
+        {
+            chunk = mSpare.back();
+            mSpare.pop_back();
+        }
+        else
+        {
+            chunk = static_cast<Chunk*>(::operator new(ChunkSize, std::align_val_t { ChunkSize }));
+            ++mChunksCount;
+        }
+        chunk->Used = DataOffset;
+        chunk->Live = 0;
+        chunk->Free = nullptr;
+        chunk->FreeSize = 0;
+        chunk->PrevPartial = nullptr;
+        chunk->NextPartial = nullptr;
+        return chunk;
+    }
+
+    void* TakeFreeNode(size_t aSize, size_t aAlign)
+    {
+        const auto it = mPartial.find(aSize);
+        if (it == mPartial.end())
+        {
+            return nullptr;
+        }
+        auto* chunk = it->second;
+        auto* node = chunk->Free;
+        /// Узел того же размера мог быть выровнен слабее.
+        if ((reinterpret_cast<uintptr_t>(node) & (aAlign - 1)) != 0)
+        {
+            return nullptr;
+        }
+        if (node->Next)
+        {
+            chunk->Free = node->Next;
+        }
+        else
+        {
+            UnlinkPartial(chunk);
+        }
+        ++chunk->Live;
+        return node;
+    }
+
+    /**
+     * \brief Запомнить освобожденный узел живого блока.
+     * В блоке собираются узлы одного размера, узлы других размеров ждут освобождения блока.
+     */
+    void PutFreeNode(Chunk* aChunk, void* aPtr, size_t aSize)
+    {
+        if (aSize < sizeof(FreeNode) || (aChunk->Free && aChunk->FreeSize != aSize))
+        {
+            return;
+        }
+        if (!aChunk->Free)
+        {
+            aChunk->FreeSize = aSize;
+            LinkPartial(aChunk);
+        }
+        auto* node = static_cast<FreeNode*>(aPtr);
+        node->Next = aChunk->Free;
+        aChunk->Free = node;
+    }
+
+    void LinkPartial(Chunk* aChunk)
+    {
+        auto& head = mPartial[aChunk->FreeSize];
+        aChunk->PrevPartial = nullptr;
+        aChunk->NextPartial = head;
+        if (head)
+        {
+            head->PrevPartial = aChunk;
+        }
+        head = aChunk;
+    }
+
+    void UnlinkPartial(Chunk* aChunk)
+    {
+        if (!aChunk->Free)
+        {
+            return;
+        }
+        if (aChunk->NextPartial)
+        {
+            aChunk->NextPartial->PrevPartial = aChunk->PrevPartial;
+        }
+        if (aChunk->PrevPartial)
+        {
+            aChunk->PrevPartial->NextPartial = aChunk->NextPartial;
+        }
+        else if (aChunk->NextPartial)
+        {
+            mPartial[aChunk->FreeSize] = aChunk->NextPartial;
+        }
+        else
+        {
+            mPartial.erase(aChunk->FreeSize);
+        }
+        aChunk->Free = nullptr;
+        aChunk->PrevPartial = nullptr;
+        aChunk->NextPartial = nullptr;
+    }
+
+    void ReleaseChunk(Chunk* aChunk)
+    {
+        if (mSpare.size() < MaxSpareChunks)
+        {
+            mSpare.push_back(aChunk);
+            return;
+        }
+        FreeChunk(aChunk);
+    }
+
+    void FreeChunk(Chunk* aChunk)
+    {
+        ::operator delete(aChunk, std::align_val_t { ChunkSize });
+        --mChunksCount;
+    }
+};
+
+/**
+ * \brief Аллокатор узлов хранилища поверх VersionEpochArena.
+ * \ingroup NewUiServer
+ * Подключается в сетапе хранилища:
+ * template <typename T> using TNodeAllocator = EpochAllocator<T>;
+ */
+template <typename T>
+class EpochAllocator
+{
+    template <typename U>
+    friend class EpochAllocator;
+
+    VersionEpochArena* mArena;
+
+public:
+    using value_type = T;
+
+    explicit EpochAllocator(VersionEpochArena* aArena) noexcept
+        : mArena(aArena)
+    {}
+
+    template <typename U>
+    EpochAllocator(const EpochAllocator<U>& aOther) noexcept
+        : mArena(aOther.mArena)
+    {}
+
+    T* allocate(size_t aCount)
+    {
+        return static_cast<T*>(mArena->Allocate(aCount * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* aPtr, size_t aCount) noexcept
+    {
+        mArena->Deallocate(aPtr, aCount * sizeof(T), alignof(T));
+    }
+
+    VersionEpochArena* GetArena() const
+    {
+        return mArena;
+    }
+
+    template <typename U>
+    bool operator==(const EpochAllocator<U>& aOther) const
+    {
+        return mArena == aOther.mArena;
+    }
+
+    template <typename U>
+    bool operator!=(const EpochAllocator<U>& aOther) const
+    {
+        return mArena != aOther.mArena;
+    }
+};
+
+}
@@ -2,6 +2,12 @@
 
 #include "UiLocalStore/IDataItemBuilder.hpp"
 #include "UiLocalStore/LocalStoreUtils.hpp"
+#include "UiLocalStore/SetupTraits.hpp"
+#include "UiLocalStore/WorkerPool.hpp"
+
+#include <chrono>
+#include <future>
+#include <memory>
 
 namespace NTPro::Ecn::NewUiServer
 {
@@ -45,6 +51,19 @@ struct VersionedItem
  * Хранилище версионируется.
  * Старые версии должны удаляться, если они никому больше не нужны.
  * Новые данные применяются небольшими порциями.
+ * Размер порции ограничивается количеством строк либо, если задан бюджет, временем.
+ * Время проверяется раз в ClockCheckInterval строк, чтобы не опрашивать часы на каждой строке.
+ * Первая версия, пока подписок еще нет, собирается целиком и загружается в хранилище
+ * одним вызовом BulkLoad, если хранилище его поддерживает.
+ *
+ * Если задан пул потоков, элементы больших пакетов создаются на нем пачками по ParallelBatchSize строк.
+ * Реактор применяет готовые пачки строго в порядке строк пакета, поэтому версионирование не меняется.
+ * Пока очередная пачка не готова, ProcessIncomingQueue ждет ее не дольше бюджета времени,
+ * а без бюджета сразу возвращает управление.
+ * Фабрика элементов в этом режиме должна допускать вызовы из нескольких потоков.
+ *
+ * После применения версии хранилище уведомляется о ее фиксации (CommitVersion, если оно его поддерживает),
+ * например, чтобы один раз собрать изменения версии для всех подписок.
  */
 template <typename TSetup>
 class VersionedDataContainer
@@ -54,18 +73,51 @@ class VersionedDataContainer
     using TIncomingPack = typename TSetup::TQueryApiPack;
     using TIncomingPackIt = typename TIncomingPack::const_iterator;
 
+    using TClock = std::chrono::steady_clock;
+
     static constexpr size_t MaxIncomingChunkSize = 100;
+    static constexpr size_t ClockCheckInterval = 64;
+    static constexpr bool UseBulkLoad = HasBulkLoad<TMap, TData>::value;
+    static constexpr bool UseCommitVersion = HasCommitVersion<TMap>::value;
+
+    /// Размер пачки строк, создаваемой одной задачей пула.
+    static constexpr size_t ParallelBatchSize = 1024;
+    /// Меньшие пакеты обрабатываются на реакторе.
+    static constexpr size_t ParallelPackMinSize = 4 * ParallelBatchSize;
     
 private:
+    struct ItemsBatch
+    {
+        TIncomingPackIt Begin;
+        size_t Size = 0;
+        Basis::Vector<Basis::SPtr<TData>> Items;
+        std::promise<void> Ready;
+    };
+
+    struct PendingBatch
+    {
+        std::shared_ptr<ItemsBatch> Batch;
+        std::future<void> Ready;
+        /// Пул не смог создать элементы пачки, ее строки создаются на реакторе.
+        bool Serial = false;
+    };
+
     struct IncomingPackCtx
     {
         Basis::SPtr<TIncomingPack> Pack;
         TIncomingPackIt It;
+        /// Первая строка, еще не отданная в пул.
+        TIncomingPackIt ScheduledIt;
+        Basis::Deque<PendingBatch> Batches;
     };
     
     TDataVersion mCurrentVersion;
     TMap mData;
     Basis::Deque<IncomingPackCtx> mIncomingQueue;
+    /// Элементы первой версии, ожидающие загрузки в хранилище.
+    Basis::Vector<Basis::SPtr<TData>> mInitialItems;
+    std::optional<std::chrono::microseconds> mTimeBudget = IncomingTimeBudgetOf<TSetup>::Value;
+    std::shared_ptr<WorkerPool> mWorkerPool;
 
     Basis::Tracer& mTracer;
     
@@ -81,9 +133,24 @@ public:
     {
     }
 
+    ~VersionedDataContainer()
+    {
+        /// Задачи пула ссылаются на фабрику элементов.
+        for (auto& ctx : mIncomingQueue)
+        {
+            for (auto& pending : ctx.Batches)
+            {
+                if (pending.Ready.valid())
+                {
+                    pending.Ready.wait();
+                }
+            }
+        }
+    }
+
     void UpdateAllData(const Basis::SPtr<TIncomingPack>& aPack)
     {
-        mIncomingQueue.push_back(IncomingPackCtx { aPack, aPack->cbegin() });
+        mIncomingQueue.push_back(IncomingPackCtx { aPack, aPack->cbegin(), aPack->cbegin(), {} });
         mTracer.InfoSlow("UpdateAllData: internal queue size:", mIncomingQueue.size());
     }
 
@@ -92,6 +159,23 @@ public:
         return !mIncomingQueue.empty();
     }
 
+    /**
+     * \brief Задать бюджет времени на один вызов ProcessIncomingQueue.
+     * Без бюджета за вызов применяется не более MaxIncomingChunkSize строк.
+     */
+    void SetIncomingTimeBudget(std::optional<std::chrono::microseconds> aBudget)
+    {
+        mTimeBudget = aBudget;
+    }
+
+    /**
+     * \brief Задать пул потоков для создания элементов больших пакетов.
+     */
+    void SetWorkerPool(std::shared_ptr<WorkerPool> aWorkerPool)
+    {
+        mWorkerPool = std::move(aWorkerPool);
+    }
+
     bool ProcessIncomingQueue()
     {
         if (mIncomingQueue.empty())
@@ -101,33 +185,23 @@ public:
         auto nextVersion = mCurrentVersion + 1;
 
         auto& ctx = mIncomingQueue.front();
-        for (
-            size_t counter = 0;
-            ctx.It != ctx.Pack->cend() && counter < MaxIncomingChunkSize;
-            ++counter, ++ctx.It)
+        const auto deadline = mTimeBudget ? std::optional(TClock::now() + *mTimeBudget) : std::nullopt;
+        if (mWorkerPool && ctx.Pack->size() >= ParallelPackMinSize)
         {
-            const auto& modelData = *ctx.It;
-            auto item = ItemBuilder.CreateItem(modelData);
-            if (!item.HasValue())
-            {
-                continue;
-            }
-            switch (modelData->Action)
-            {
-            case Model::ActionType::New:
-            case Model::ActionType::Change:
-            {
-                mData.Emplace(item, nextVersion);
-                break;
-            }
-            case Model::ActionType::Delete:
-                mData.Erase(item->GetId(), nextVersion);
-                break;
-            }
+            ApplyBatches(ctx, nextVersion, deadline);
+        }
+        else
+        {
+            ApplyRows(ctx, nextVersion, deadline);
         }
 
         if (ctx.It == ctx.Pack->cend())
         {
+            LoadInitialItems(nextVersion);
+            if constexpr (UseCommitVersion)
+            {
+                mData.CommitVersion(nextVersion);
+            }
             mCurrentVersion = nextVersion;
             mTracer.InfoSlow(
                 "ProcessIncomingQueue: version:", mCurrentVersion,
@@ -166,10 +240,188 @@ public:
             ", size: ", mData.Size());
     }
 
+    /**
+     * \brief Выполнить уплотнение колоночного снимка, отложенное из-за сканирований подписок.
+     */
+    void CompactColumns()
+    {
+        mData.CompactColumns();
+    }
+
     void Clear()
     {
         mCurrentVersion = 0;
+        mInitialItems.clear();
         mData.Clear();
     }
+
+private:
+    void ApplyRows(IncomingPackCtx& aCtx, TDataVersion aVersion, const std::optional<TClock::time_point>& aDeadline)
+    {
+        for (
+            size_t counter = 0;
+            aCtx.It != aCtx.Pack->cend() && !IsChunkFinished(counter, aDeadline);
+            ++counter, ++aCtx.It)
+        {
+            const auto& modelData = *aCtx.It;
+            ApplyItem(modelData, ItemBuilder.CreateItem(modelData), aVersion);
+        }
+        aCtx.ScheduledIt = aCtx.It;
+    }
+
+    /**
+     * \brief Применить готовые пачки по порядку.
+     * Без бюджета времени за вызов применяется одна пачка.
+     * Если фабрика элементов бросила исключение в пуле, строки пачки создаются заново на реакторе,
+     * как в ApplyRows: исключение при повторном создании передается вызывающему,
+     * а следующий вызов продолжает с той же строки. Строки пачки не пропускаются.
+     */
+    void ApplyBatches(IncomingPackCtx& aCtx, TDataVersion aVersion, const std::optional<TClock::time_point>& aDeadline)
+    {
+        ScheduleBatches(aCtx);
+        while (!aCtx.Batches.empty())
+        {
+            auto& pending = aCtx.Batches.front();
+            if (!pending.Serial)
+            {
+                /// В пределах бюджета реактор ждет пачку, иначе только проверяет ее готовность.
+                const auto status = aDeadline
+                    ? pending.Ready.wait_until(*aDeadline)
+                    : pending.Ready.wait_for(std::chrono::seconds(0));
+                if (status != std::future_status::ready)
+                {
+                    return;
+                }
+                try
+                {
+                    pending.Ready.get();
+                }
+                catch (...)
+                {
+                    mTracer.WarningSlow("ApplyBatches: failed to create items on worker pool, rows:",
+                        pending.Batch->Size, ", creating them serially");
+                    pending.Serial = true;
+                }
+            }
+
+            const auto& batch = *pending.Batch;
+            const auto end = std::next(batch.Begin, batch.Size);
+            if (pending.Serial)
+            {
+                for (
+                    size_t counter = 0;
+                    aCtx.It != end && !IsChunkFinished(counter, aDeadline);
+                    ++counter, ++aCtx.It)
+                {
+                    const auto& modelData = *aCtx.It;
+                    ApplyItem(modelData, ItemBuilder.CreateItem(modelData), aVersion);
+                }
+                if (aCtx.It != end)
+                {
+                    return;
+                }
+            }
+            else
+            {
+                auto it = batch.Begin;
+                for (const auto& item : batch.Items)
+                {
+                    ApplyItem(*it, item, aVersion);
+                    ++it;
+                }
+                aCtx.It = end;
+            }
+            aCtx.Batches.pop_front();
+            ScheduleBatches(aCtx);
+
+            if (!aDeadline || TClock::now() >= *aDeadline)
+            {
+                return;
+            }
+        }
+    }
+
+    void ScheduleBatches(IncomingPackCtx& aCtx)
+    {
+        const auto maxBatches = 2 * mWorkerPool->GetThreadsCount();
+        while (aCtx.ScheduledIt != aCtx.Pack->cend() && aCtx.Batches.size() < maxBatches)
+        {
+            auto batch = std::make_shared<ItemsBatch>();
+            batch->Begin = aCtx.ScheduledIt;
+            batch->Size = std::min<size_t>(ParallelBatchSize, std::distance(aCtx.ScheduledIt, aCtx.Pack->cend()));
+            std::advance(aCtx.ScheduledIt, batch->Size);
+
+            aCtx.Batches.push_back(PendingBatch { batch, batch->Ready.get_future() });
+            mWorkerPool->Post([batch, &builder = ItemBuilder]()
+            {
+                try
+                {
+                    batch->Items.reserve(batch->Size);
+                    auto it = batch->Begin;
+                    for (size_t i = 0; i < batch->Size; ++i, ++it)
+                    {
+                        batch->Items.push_back(builder.CreateItem(*it));
+                    }
+                    batch->Ready.set_value();
+                }
+                catch (...)
+                {
+                    batch->Ready.set_exception(std::current_exception());
+                }
+            });
+        }
+    }
+
+    template <typename TModelData>
+    void ApplyItem(const TModelData& aModelData, const Basis::SPtr<TData>& aItem, TDataVersion aVersion)
+    {
+        if (!aItem.HasValue())
+        {
+            return;
+        }
+        switch (aModelData->Action)
+        {
+        case Model::ActionType::New:
+        case Model::ActionType::Change:
+        {
+            if (UseBulkLoad && aVersion == 1)
+            {
+                mInitialItems.push_back(aItem);
+            }
+            else
+            {
+                mData.Emplace(aItem, aVersion);
+            }
+            break;
+        }
+        case Model::ActionType::Delete:
+            LoadInitialItems(aVersion);
+            mData.Erase(aItem->GetId(), aVersion);
+            break;
+        }
+    }
+
+    bool IsChunkFinished(size_t aCounter, const std::optional<TClock::time_point>& aDeadline) const
+    {
+        if (!aDeadline)
+        {
+            return aCounter >= MaxIncomingChunkSize;
+        }
+        return aCounter != 0
+            && aCounter % ClockCheckInterval == 0
+            && TClock::now() >= *aDeadline;
+    }
+
+    void LoadInitialItems(TDataVersion aVersion)
+    {
+        if constexpr (UseBulkLoad)
+        {
+            if (!mInitialItems.empty())
+            {
+                mData.BulkLoad(std::move(mInitialItems), aVersion);
+                mInitialItems.clear();
+            }
+        }
+    }
 };
 }
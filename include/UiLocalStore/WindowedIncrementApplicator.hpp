@@ -0,0 +1,218 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/ITableIncrementApplicator.hpp>
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
+#include <NewUiServer/UiLocalStore/SortOrderComparator.hpp>
+#include <NewUiServer/UiLocalStore/TableUtils.hpp>
+
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Common/Tracer.hpp>
+
+#include <Common/Pack.hpp>
+
+#include <algorithm>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Применение инкремента к результату, упорядоченному только в окне строк.
+ * \ingroup NewUiServer
+ * Используется вместе с WindowedTableSorter: хвост старого снапшота не упорядочен,
+ * поэтому слияние по порядку сортировки невозможно.
+ * Старые элементы, равные удаленному или добавленному по порядку сортировки, пропускаются,
+ * остальные переносятся в новый снапшот в прежнем порядке, добавленные элементы дописываются в конец.
+ * Новый снапшот не упорядочен, окно строк в нем заново упорядочивает WindowedTableSorter.
+ * За вызов Process обрабатывается не больше MaxCount элементов, их число возвращает GetSliceRows.
+ */
+template <typename TSetup>
+class WindowedIncrementApplicator
+{
+public:
+    static constexpr int MaxCount = TSetup::MaxCount;
+
+    using TData = typename TSetup::TData;
+    using TTableSetup = typename TSetup::TTableSetup;
+
+    using TTableColumnType = typename TTableSetup::TTableColumnType;
+    using TDataPack = Basis::Pack<TData>;
+    using TDataSPtrPack = Basis::SPtr<TDataPack>;
+
+    using TSortOrder = TradingSerialization::Table::TSortOrder;
+
+    using TComparator = SortOrderComparator<TData, TTableColumnType>;
+
+    struct TInit
+    {
+        const TSortOrder& SortOrder;
+        /// Если снапшот принадлежит только вызывающей стороне, его элементы будут перемещены.
+        const TDataSPtrPack& OldSnapshot;
+        const TDataPack& DeletedIncrement;
+        const TDataPack& AddedIncrement;
+        TDataPack& NewSnapshot;
+
+        TInit(
+            const TSortOrder& aSortOrder,
+            const TDataSPtrPack& aOldSnapshot,
+            const TDataPack& aDeletedIncrement,
+            const TDataPack& aAddedIncrement,
+            TDataPack& outNewSnapshot)
+            : SortOrder(aSortOrder)
+            , OldSnapshot(aOldSnapshot)
+            , DeletedIncrement(aDeletedIncrement)
+            , AddedIncrement(aAddedIncrement)
+            , NewSnapshot(outNewSnapshot)
+        {}
+    };
+
+private:
+    const TSortOrder* mSortOrder = nullptr;
+    const TDataSPtrPack* mOldSnapshot = nullptr;
+    const TDataPack* mDeletedIncrement = nullptr;
+    const TDataPack* mAddedIncrement = nullptr;
+
+    TDataPack* mNewSnapshot = nullptr;
+
+    Basis::Tracer& mTracer;
+
+    TableIncrementApplicatorState mState = TableIncrementApplicatorState::Initializing;
+    bool mOk = true;
+    /// Позиция в старом снапшоте, затем в добавленных элементах.
+    size_t mOldPosition = 0;
+    size_t mAddedPosition = 0;
+    /// Старый снапшот принадлежит только вызывающей стороне, элементы можно перемещать.
+    bool mMoveOld = false;
+    size_t mSliceRows = 0;
+
+public:
+    WindowedIncrementApplicator(Basis::Tracer& aTracer)
+        : mTracer(aTracer)
+    {}
+
+    void Init(const TInit& aInit)
+    {
+        assert(!IsInitialized());
+
+        mSortOrder = &aInit.SortOrder;
+        mOldSnapshot = &aInit.OldSnapshot;
+        mDeletedIncrement = &aInit.DeletedIncrement;
+        mAddedIncrement = &aInit.AddedIncrement;
+        mNewSnapshot = &aInit.NewSnapshot;
+
+        auto sortOrderError = TableUtils<TTableSetup>::CheckSortOrder(*mSortOrder);
+        if (!sortOrderError.empty())
+        {
+            mState = TableIncrementApplicatorState::Error;
+            mTracer.ErrorSlow("WindowedIncrementApplicator:", sortOrderError, ", ", *mSortOrder);
+            return;
+        }
+
+        if constexpr (HasUseCount<TDataSPtrPack>::value)
+        {
+            mMoveOld = mOldSnapshot->use_count() == 1;
+        }
+        mNewSnapshot->reserve((*mOldSnapshot)->size() + mAddedIncrement->size());
+
+        mState = TableIncrementApplicatorState::Processing;
+    }
+
+    void Reset()
+    {
+        mSortOrder = nullptr;
+        mOldSnapshot = nullptr;
+        mDeletedIncrement = nullptr;
+        mAddedIncrement = nullptr;
+        mNewSnapshot = nullptr;
+        mOk = true;
+        mOldPosition = 0;
+        mAddedPosition = 0;
+        mMoveOld = false;
+        mSliceRows = 0;
+
+        mState = TableIncrementApplicatorState::Initializing;
+    }
+
+    bool IsInitialized() const
+    {
+        return mState != TableIncrementApplicatorState::Initializing;
+    }
+
+    TableIncrementApplicatorState GetState() const
+    {
+        return mState;
+    }
+
+    TableIncrementApplicatorState Process()
+    {
+        mSliceRows = 0;
+        switch (mState)
+        {
+        case TableIncrementApplicatorState::Processing:
+            ProcessInternal();
+            break;
+        default:
+            mTracer.ErrorSlow("WindowedIncrementApplicator.Process: state is invalid:", mState);
+            mState = TableIncrementApplicatorState::Error;
+            break;
+        }
+        return mState;
+    }
+
+    size_t GetSliceRows() const
+    {
+        return mSliceRows;
+    }
+
+private:
+    void ProcessInternal()
+    {
+        const TComparator comparator(*mSortOrder, mOk);
+        auto& oldSnapshot = **mOldSnapshot;
+
+        const auto oldEnd = std::min(oldSnapshot.size(), mOldPosition + MaxCount);
+        mSliceRows = oldEnd - mOldPosition;
+        for (; mOldPosition < oldEnd; ++mOldPosition)
+        {
+            auto& item = oldSnapshot[mOldPosition];
+            /// Равный добавленному элемент заменяется им в конце снапшота.
+            if (std::binary_search(mDeletedIncrement->cbegin(), mDeletedIncrement->cend(), item, comparator)
+                || std::binary_search(mAddedIncrement->cbegin(), mAddedIncrement->cend(), item, comparator))
+            {
+                continue;
+            }
+            if (mMoveOld)
+            {
+                mNewSnapshot->push_back(std::move(item));
+            }
+            else
+            {
+                mNewSnapshot->push_back(item);
+            }
+        }
+
+        if (!mOk)
+        {
+            mState = TableIncrementApplicatorState::Error;
+            mTracer.Error("WindowedIncrementApplicator. Error occured");
+            return;
+        }
+
+        if (mOldPosition == oldSnapshot.size())
+        {
+            const auto addedEnd = std::min(mAddedIncrement->size(), mAddedPosition + MaxCount - mSliceRows);
+            mNewSnapshot->insert(
+                mNewSnapshot->end(),
+                mAddedIncrement->cbegin() + mAddedPosition,
+                mAddedIncrement->cbegin() + addedEnd);
+            mSliceRows += addedEnd - mAddedPosition;
+            mAddedPosition = addedEnd;
+            if (mAddedPosition == mAddedIncrement->size())
+            {
+                mState = TableIncrementApplicatorState::Completed;
+            }
+        }
+    }
+};
+
+}
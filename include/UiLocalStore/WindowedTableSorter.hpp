@@ -0,0 +1,320 @@
+#pragma once
+
+#include <NewUiServer/UiLocalStore/ITableSorter.hpp>
+#include <NewUiServer/UiLocalStore/SetupTraits.hpp>
+#include <NewUiServer/UiLocalStore/SortOrderComparator.hpp>
+#include <NewUiServer/UiLocalStore/TableUtils.hpp>
+#include <NewUiServer/UiLocalStore/WindowedIncrementApplicator.hpp>
+
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Common/Tracer.hpp>
+
+#include <Common/Pack.hpp>
+
+#include <algorithm>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Табличный сортировальщик окна строк.
+ * \ingroup NewUiServer
+ * Упорядочивает только строки [0, Bottom] запрошенного окна (RowRange::Bottom).
+ * Строки окна отбираются ограниченной кучей, по MaxCount строк за вызов Process,
+ * затем массив переставляется: отсортированное окно, за ним остальные строки в произвольном порядке.
+ * При прокрутке окно расширяется через ExtendWindow, и отбор продолжается только по хвосту.
+ * Если первые строки массива уже упорядочены (TInit::SortedCount), отбор начинается с хвоста.
+ * Окно рассчитано на размер порядка RowRange::MaxRowWindow: куча окна сортируется за один вызов.
+ * GetSliceRows - число строк, пройденных последним вызовом Process.
+ */
+template <typename TSetup>
+class WindowedTableSorter
+{
+public:
+    static constexpr int MaxCount = TSetup::MaxCount;
+
+    using TData = typename TSetup::TData;
+    using TTableSetup = typename TSetup::TTableSetup;
+
+    using TDataPack = Basis::Pack<TData>;
+    using State = TableSorterState;
+
+    using TTableColumnType = typename TTableSetup::TTableColumnType;
+
+    using TSortOrder = TradingSerialization::Table::TSortOrder;
+    using TComparator = SortOrderComparator<TData, TTableColumnType>;
+    /// Применение инкремента к результату, упорядоченному этим сортировальщиком.
+    using TIncrementApplicator = WindowedIncrementApplicator<TSetup>;
+
+    struct TInit
+    {
+        const TSortOrder& SortOrder;
+        TDataPack& Result;
+        TDataPack& TmpBuffer;
+        /// Последняя строка окна.
+        int64_t Bottom;
+        /// Количество первых строк, которые уже упорядочены и меньше остальных.
+        size_t SortedCount;
+
+        TInit(
+            const TSortOrder& aSortOrder,
+            TDataPack& outResult,
+            TDataPack& outTmpBuffer,
+            int64_t aBottom,
+            size_t aSortedCount = 0)
+            : SortOrder(aSortOrder)
+            , Result(outResult)
+            , TmpBuffer(outTmpBuffer)
+            , Bottom(aBottom)
+            , SortedCount(aSortedCount)
+        {}
+    };
+
+private:
+    State mState = State::Initializing;
+    bool mOk = true;
+
+    const TSortOrder* mSortOrder = nullptr;
+    TDataPack* mResult = nullptr;
+    /**
+     * \brief Временный буфер.
+     * Хранит строки хвоста, не попавшие в окно, на время отбора.
+     */
+    TDataPack* mTmpBuffer = nullptr;
+
+    /**
+     * \brief Куча строк окна.
+     * Вершина - наибольшая из отобранных строк.
+     */
+    TDataPack mHeap;
+
+    /// Количество упорядоченных строк в начале массива.
+    size_t mSortedCount = 0;
+    /// Количество строк, которые должны быть упорядочены по завершении этапа.
+    size_t mWindowEnd = 0;
+    /// Позиция обработки на этапах PartSort и Permutation.
+    size_t mPosition = 0;
+    size_t mSliceRows = 0;
+
+    Basis::Tracer& mTracer;
+
+public:
+    WindowedTableSorter(Basis::Tracer& aTracer)
+        : mTracer(aTracer)
+    {
+    }
+
+    bool IsInitialized() const
+    {
+        return mState != State::Initializing;
+    }
+
+    void Init(const TInit& aInit)
+    {
+        assert(!IsInitialized());
+
+        mSortOrder = &aInit.SortOrder;
+        mResult = &aInit.Result;
+        mTmpBuffer = &aInit.TmpBuffer;
+
+        auto sortOrderError = TableUtils<TTableSetup>::CheckSortOrder(*mSortOrder);
+        if (!sortOrderError.empty())
+        {
+            mState = State::Error;
+            mTracer.ErrorSlow("WindowedTableSorter:", sortOrderError, ", ", *mSortOrder);
+            return;
+        }
+
+        mSortedCount = std::min(aInit.SortedCount, mResult->size());
+        StartSelection(aInit.Bottom);
+    }
+
+    void Reset()
+    {
+        mSortOrder = nullptr;
+        mResult = nullptr;
+        mTmpBuffer = nullptr;
+
+        mHeap.clear();
+        mOk = true;
+        mSortedCount = 0;
+        mWindowEnd = 0;
+        mPosition = 0;
+        mSliceRows = 0;
+
+        mState = State::Initializing;
+    }
+
+    State Process()
+    {
+        mSliceRows = 0;
+        switch (mState)
+        {
+        case State::PartSort:
+            ProcessSelection();
+            break;
+        case State::Permutation:
+            ProcessPermutation();
+            break;
+        default:
+            mTracer.ErrorSlow("WindowedSorter.Process: state is invalid:", mState);
+            mState = State::Error;
+            break;
+        }
+        return mState;
+    }
+
+    State GetState() const
+    {
+        return mState;
+    }
+
+    /**
+     * \brief Расширить окно до строки aBottom.
+     * Допустимо только после завершения сортировки текущего окна.
+     * Уже упорядоченные строки повторно не обрабатываются.
+     */
+    State ExtendWindow(int64_t aBottom)
+    {
+        if (mState != State::Completed)
+        {
+            mTracer.ErrorSlow("WindowedSorter.ExtendWindow: state is invalid:", mState);
+            mState = State::Error;
+            return mState;
+        }
+        StartSelection(aBottom);
+        return mState;
+    }
+
+    /**
+     * \brief Количество упорядоченных строк в начале массива.
+     */
+    size_t GetSortedCount() const
+    {
+        return mSortedCount;
+    }
+
+    bool IsFullySorted() const
+    {
+        return mState == State::Completed && mSortedCount == mResult->size();
+    }
+
+    size_t GetSliceRows() const
+    {
+        return mSliceRows;
+    }
+
+private:
+    void StartSelection(int64_t aBottom)
+    {
+        const auto windowEnd = static_cast<size_t>(std::max<int64_t>(aBottom + 1, 0));
+        mWindowEnd = std::max(mSortedCount, std::min(windowEnd, mResult->size()));
+        if (mWindowEnd == mSortedCount)
+        {
+            mState = State::Completed;
+            return;
+        }
+
+        mHeap.clear();
+        mHeap.reserve(mWindowEnd - mSortedCount);
+        mTmpBuffer->clear();
+        mTmpBuffer->reserve(mResult->size() - mSortedCount);
+        mPosition = mSortedCount;
+        mState = State::PartSort;
+    }
+
+    /**
+     * \brief Отбор строк окна из хвоста массива.
+     * Строки переносятся либо в кучу окна, либо во временный буфер.
+     */
+    void ProcessSelection()
+    {
+        const TComparator comparator(*mSortOrder, mOk);
+        const auto windowSize = mWindowEnd - mSortedCount;
+        const auto end = std::min(mResult->size(), mPosition + MaxCount);
+        mSliceRows = end - mPosition;
+        for (; mPosition < end; ++mPosition)
+        {
+            auto& item = (*mResult)[mPosition];
+            if (mHeap.size() < windowSize)
+            {
+                mHeap.push_back(std::move(item));
+                std::push_heap(mHeap.begin(), mHeap.end(), comparator);
+            }
+            else if (comparator(item, mHeap.front()))
+            {
+                std::pop_heap(mHeap.begin(), mHeap.end(), comparator);
+                mTmpBuffer->push_back(std::move(mHeap.back()));
+                mHeap.back() = std::move(item);
+                std::push_heap(mHeap.begin(), mHeap.end(), comparator);
+            }
+            else
+            {
+                mTmpBuffer->push_back(std::move(item));
+            }
+        }
+
+        if (!mOk)
+        {
+            mTracer.Error("WindowedSorter: selection failed");
+            mState = State::Error;
+            return;
+        }
+
+        if (mPosition == mResult->size())
+        {
+            std::sort_heap(mHeap.begin(), mHeap.end(), comparator);
+            mPosition = mSortedCount;
+            mState = State::Permutation;
+        }
+    }
+
+    /**
+     * \brief Возврат строк в массив: сначала окно, затем хвост.
+     */
+    void ProcessPermutation()
+    {
+        const auto end = std::min(mResult->size(), mPosition + MaxCount);
+        mSliceRows = end - mPosition;
+        for (; mPosition < end; ++mPosition)
+        {
+            const auto index = mPosition - mSortedCount;
+            (*mResult)[mPosition] = index < mHeap.size()
+                ? std::move(mHeap[index])
+                : std::move((*mTmpBuffer)[index - mHeap.size()]);
+        }
+
+        if (mPosition == mResult->size())
+        {
+            mHeap.clear();
+            mTmpBuffer->clear();
+            mSortedCount = mWindowEnd;
+            mState = State::Completed;
+        }
+    }
+};
+
+template <typename TData>
+struct NoWindowedTableSorter
+{
+    NoWindowedTableSorter(Basis::Tracer&)
+    {
+    }
+
+    using TIncrementApplicator = NoWindowedTableSorter<TData>;
+};
+
+template <typename TSetup, bool = HasWindowedTableSorter<TSetup>::value>
+struct WindowedTableSorterOf
+{
+    using Type = NoWindowedTableSorter<typename TSetup::TData>;
+};
+
+template <typename TSetup>
+struct WindowedTableSorterOf<TSetup, true>
+{
+    using Type = typename TSetup::TWindowedTableSorter;
+};
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Common/Collections.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+/**
+ * \brief Пул рабочих потоков для тяжелых операций хранилища.
+ * \ingroup NewUiServer
+ * Количество потоков фиксируется при создании.
+ * Задачи выполняются в порядке постановки, результаты задачи передают сами.
+ * Ограничение количества задач в очереди лежит на вызывающей стороне.
+ * При удалении пула дожидается выполнения всех поставленных задач.
+ */
+class WorkerPool
+{
+public:
+    using TTask = std::function<void()>;
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    Basis::Deque<TTask> mTasks;
+    Basis::Vector<std::thread> mThreads;
+    bool mStopped = false;
+
+public:
+    explicit WorkerPool(size_t aThreadsCount);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void Post(TTask aTask);
+
+    size_t GetThreadsCount() const;
+
+private:
+    void Run();
+};
+
+}
@@ -0,0 +1,164 @@
+#include "UiLocalStore/SubscriptionContainment.hpp"
+
+#include <algorithm>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+using namespace TradingSerialization::Table;
+
+namespace
+{
+
+bool IsLowerBound(FilterOperator aOperator)
+{
+    return aOperator == FilterOperator::GreaterEq || aOperator == FilterOperator::Greater;
+}
+
+bool IsStrict(FilterOperator aOperator)
+{
+    return aOperator == FilterOperator::Greater || aOperator == FilterOperator::Less;
+}
+
+/// Незаполненное значение меньше любого заполненного, как при применении фильтров.
+template <typename TValue>
+bool Satisfies(FilterOperator aOperator, const TValue& aBound, const TValue& aValue)
+{
+    switch (aOperator)
+    {
+    case FilterOperator::In:
+        return aValue == aBound;
+    case FilterOperator::GreaterEq:
+        return !(aValue < aBound);
+    case FilterOperator::LessEq:
+        return !(aBound < aValue);
+    case FilterOperator::Greater:
+        return aBound < aValue;
+    case FilterOperator::Less:
+        return aValue < aBound;
+    }
+    return false;
+}
+
+template <typename TValues>
+bool IsSubset(const TValues& aValues, const TValues& aOtherValues)
+{
+    return std::all_of(aValues.cbegin(), aValues.cend(), [&](const auto& aValue)
+    {
+        return std::find(aOtherValues.cbegin(), aOtherValues.cend(), aValue) != aOtherValues.cend();
+    });
+}
+
+/**
+ * \brief Следует ли граница aOther из фильтра aFilter с одним типом значений.
+ */
+template <typename TValues>
+bool ImpliesBound(
+    FilterOperator aOperator,
+    const TValues& aValues,
+    FilterOperator aOtherOperator,
+    const TValues& aOtherValues)
+{
+    if (aOtherValues.size() != 1)
+    {
+        return false;
+    }
+    const auto& bound = aOtherValues.front();
+
+    if (aOperator == FilterOperator::In)
+    {
+        return std::all_of(aValues.cbegin(), aValues.cend(), [&](const auto& aValue)
+        {
+            return Satisfies(aOtherOperator, bound, aValue);
+        });
+    }
+
+    if (aValues.size() != 1 || IsLowerBound(aOperator) != IsLowerBound(aOtherOperator))
+    {
+        return false;
+    }
+    const auto& value = aValues.front();
+    if (value == bound)
+    {
+        /// Строгая граница уже нестрогой с тем же значением.
+        return IsStrict(aOperator) || !IsStrict(aOtherOperator);
+    }
+    return Satisfies(aOtherOperator, bound, value);
+}
+
+size_t GetValueGroups(const ValueSet& aValues)
+{
+    return !aValues.StringValues.empty() + !aValues.IntValues.empty() + !aValues.FloatValues.empty();
+}
+
+}
+
+bool SubscriptionContainment::IsRefinement(const SubscribeBase& aParent, const SubscribeBase& aChild)
+{
+    return aParent.SortOrder == aChild.SortOrder
+        && IsFilterRefinement(aParent.FilterExpression, aChild.FilterExpression);
+}
+
+bool SubscriptionContainment::IsFilterRefinement(const FilterGroup& aParent, const FilterGroup& aChild)
+{
+    /// Фильтры применяются только в группах с отношением And.
+    if (aParent.Relation != FilterRelation::And || aChild.Relation != FilterRelation::And)
+    {
+        return false;
+    }
+
+    for (const auto& parentFilter : aParent.Filters)
+    {
+        const auto implied = std::any_of(aChild.Filters.cbegin(), aChild.Filters.cend(), [&](const auto& aChildFilter)
+        {
+            return Implies(aChildFilter, parentFilter);
+        });
+        if (!implied)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SubscriptionContainment::Implies(const Filter& aFilter, const Filter& aOther)
+{
+    if (aFilter.Column != aOther.Column || aFilter.IsInverse != aOther.IsInverse)
+    {
+        return false;
+    }
+    if (aFilter == aOther)
+    {
+        return true;
+    }
+
+    const auto& values = aFilter.Values;
+    const auto& otherValues = aOther.Values;
+    if (aOther.Operator == FilterOperator::In)
+    {
+        return aFilter.Operator == FilterOperator::In
+            && IsSubset(values.StringValues, otherValues.StringValues)
+            && IsSubset(values.IntValues, otherValues.IntValues)
+            && IsSubset(values.FloatValues, otherValues.FloatValues);
+    }
+
+    /// Границы сравниваются только для значений одного типа.
+    if (GetValueGroups(values) != 1 || GetValueGroups(otherValues) != 1)
+    {
+        return false;
+    }
+    if (!otherValues.StringValues.empty())
+    {
+        return !values.StringValues.empty()
+            && ImpliesBound(aFilter.Operator, values.StringValues, aOther.Operator, otherValues.StringValues);
+    }
+    if (!otherValues.IntValues.empty())
+    {
+        return !values.IntValues.empty()
+            && ImpliesBound(aFilter.Operator, values.IntValues, aOther.Operator, otherValues.IntValues);
+    }
+    return !values.FloatValues.empty()
+        && ImpliesBound(aFilter.Operator, values.FloatValues, aOther.Operator, otherValues.FloatValues);
+}
+
+}
@@ -0,0 +1,101 @@
+#include "UiLocalStore/SubscriptionKey.hpp"
+
+#include <Common/Collections.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+using namespace TradingSerialization::Table;
+
+namespace
+{
+
+template <typename TValue>
+void AppendValue(std::ostream& out, const TValue& aValue)
+{
+    out << aValue;
+}
+
+/// Строка записывается с длиной, поэтому разделитель внутри нее не сдвигает границы значений.
+void AppendValue(std::ostream& out, const std::string& aValue)
+{
+    out << aValue.size() << ':' << aValue;
+}
+
+template <typename TValue>
+void AppendValues(std::ostream& out, char aTag, std::vector<TValue> aValues, bool aIsSet)
+{
+    if (aIsSet)
+    {
+        std::sort(aValues.begin(), aValues.end());
+        aValues.erase(std::unique(aValues.begin(), aValues.end()), aValues.end());
+    }
+    out << aTag << aValues.size() << '[';
+    for (const auto& value : aValues)
+    {
+        if (value)
+        {
+            out << '=';
+            AppendValue(out, *value);
+        }
+        else
+        {
+            out << '-';
+        }
+        out << '\x1f';
+    }
+    out << ']';
+}
+
+std::string MakeFilterKey(const Filter& aFilter)
+{
+    const bool isSet = aFilter.Operator == FilterOperator::In;
+
+    std::ostringstream out;
+    /// Basis::Real хранит double: такой точности хватает, чтобы разные значения давали разную запись.
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << aFilter.Column << ':' << static_cast<int64_t>(aFilter.Operator) << ':' << aFilter.IsInverse << ':';
+    AppendValues(out, 's', aFilter.Values.StringValues, isSet);
+    AppendValues(out, 'i', aFilter.Values.IntValues, isSet);
+    AppendValues(out, 'f', aFilter.Values.FloatValues, isSet);
+    return out.str();
+}
+
+}
+
+SubscriptionKey SubscriptionKey::Make(const SubscribeBase& aSubscription)
+{
+    /// Фильтры группы уже упорядочены по колонке, но порядок фильтров одной колонки произволен.
+    Basis::Vector<std::pair<TColumnType, std::string>> filters;
+    filters.reserve(aSubscription.FilterExpression.Filters.size());
+    for (const auto& filter : aSubscription.FilterExpression.Filters)
+    {
+        filters.emplace_back(filter.Column, MakeFilterKey(filter));
+    }
+    std::sort(filters.begin(), filters.end());
+
+    std::ostringstream out;
+    out << "sort:";
+    for (const auto column : aSubscription.SortOrder)
+    {
+        out << column << ',';
+    }
+    out << ";relation:" << static_cast<int64_t>(aSubscription.FilterExpression.Relation) << ";filters:";
+    for (const auto& filter : filters)
+    {
+        out << '{' << filter.second << '}';
+    }
+
+    SubscriptionKey result;
+    result.mValue = out.str();
+    result.mHash = std::hash<std::string> {}(result.mValue);
+    return result;
+}
+
+}
@@ -162,6 +162,12 @@ bool TableSubscriptionStateMachineLogic::ProcessOkState(TableSubscriptionStateMa
     case TEvent::UpdatesReceived:
         mState = TState::Updating;
         return true;
+    case TEvent::SubscriptionModified:
+        mState = TState::Initializing;
+        return true;
+    case TEvent::RowWindowChanged:
+        mState = TState::Sorting;
+        return true;
     default:
         break;
     }
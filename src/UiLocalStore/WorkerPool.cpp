@@ -0,0 +1,64 @@
+#include "UiLocalStore/WorkerPool.hpp"
+
+#include <algorithm>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+WorkerPool::WorkerPool(size_t aThreadsCount)
+{
+    const auto threadsCount = std::max<size_t>(aThreadsCount, 1);
+    mThreads.reserve(threadsCount);
+    for (size_t i = 0; i < threadsCount; ++i)
+    {
+        mThreads.emplace_back([this]() { Run(); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopped = true;
+    }
+    mCondition.notify_all();
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::Post(TTask aTask)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(aTask));
+    }
+    mCondition.notify_one();
+}
+
+size_t WorkerPool::GetThreadsCount() const
+{
+    return mThreads.size();
+}
+
+void WorkerPool::Run()
+{
+    while (true)
+    {
+        TTask task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopped || !mTasks.empty(); });
+            if (mTasks.empty())
+            {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
+
+}
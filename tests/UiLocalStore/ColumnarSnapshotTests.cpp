@@ -0,0 +1,243 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/ColumnarSnapshot.hpp"
+#include "UiLocalStore/MultiIndexContainer.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_ColumnarSnapshotTests)
+
+using namespace TradingSerialization::Table;
+
+using TDummyColumnarSnapshot = ColumnarSnapshot<DummyTableSetup, DummyTableItem>;
+
+struct DummyColumnarContainerSetup : public DummyMultiIndexContainerSetup
+{
+    using TColumnarSnapshot = TDummyColumnarSnapshot;
+};
+
+class DummyColumnarMultiIndex : public BaseMultiIndexContainer<
+    DummyColumnarMultiIndex,
+    DummyColumnarContainerSetup,
+    DummyColumnarContainerSetup::ByValue>
+{
+public:
+    DummyColumnarMultiIndex(Basis::Tracer& aTracer)
+        : BaseMultiIndexContainer(aTracer)
+    {}
+};
+
+struct TColumnarRangesSetup
+{
+    using TData = DummyTableItem;
+    using TColumnarSnapshot = TDummyColumnarSnapshot;
+};
+
+struct ColumnarSnapshotTests : public BaseTestFixture
+{
+    Basis::Tracer& Tracer;
+    TDummyColumnarSnapshot Columns;
+
+    ColumnarSnapshotTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+        , Columns(Tracer)
+    {
+    }
+
+    const TDummyColumnarSnapshot::Column& GetColumn(DummyColumnType aColumn) const
+    {
+        const auto* column = Columns.FindColumn(static_cast<TColumnType>(aColumn));
+        BOOST_REQUIRE(column);
+        return *column;
+    }
+
+    Basis::Vector<size_t> GetVisibleRows(TDataVersion aVersion) const
+    {
+        RowBitmap bitmap;
+        Columns.BuildValidityBitmap(aVersion, bitmap);
+
+        Basis::Vector<size_t> result;
+        for (auto row = bitmap.FindNext(0); row < bitmap.Size(); row = bitmap.FindNext(row + 1))
+        {
+            result.push_back(row);
+        }
+        BOOST_CHECK_EQUAL(bitmap.Count(), result.size());
+        return result;
+    }
+
+    void CheckRows(TDataVersion aVersion, const Basis::Vector<size_t>& aExpected) const
+    {
+        auto rows = GetVisibleRows(aVersion);
+        BOOST_CHECK_EQUAL_COLLECTIONS(rows.cbegin(), rows.cend(), aExpected.cbegin(), aExpected.cend());
+    }
+
+    Basis::Vector<int64_t> ScanIds(TDataVersion aVersion)
+    {
+        ColumnarRanges<TColumnarRangesSetup> ranges(Tracer);
+        BOOST_CHECK(ranges.Init(ColumnarRanges<TColumnarRangesSetup>::TInit { Columns, aVersion }));
+
+        Basis::Vector<int64_t> result;
+        while (auto item = ranges.GetNext())
+        {
+            BOOST_CHECK_EQUAL(Columns.GetItem(ranges.GetCurrentRow()), item);
+            result.push_back(item->GetId());
+        }
+        return result;
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestTypedValues, ColumnarSnapshotTests)
+{
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(1, "First"), 1);
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(2, "Second"), 1);
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(3, "First"), 1);
+
+    const auto& ids = GetColumn(DummyColumnType::Id);
+    const auto& values = GetColumn(DummyColumnType::Value);
+
+    BOOST_CHECK_EQUAL(Columns.RowsCount(), 3);
+    BOOST_CHECK(Columns.GetInt(ids, 1) == TInt { 2 });
+    BOOST_REQUIRE(Columns.GetString(values, 1));
+    BOOST_CHECK_EQUAL(*Columns.GetString(values, 1), "Second");
+
+    /// Одинаковые строки хранятся один раз.
+    BOOST_CHECK_EQUAL(values.Strings[0], values.Strings[2]);
+    BOOST_CHECK_EQUAL(Columns.GetStrings().Size(), 2);
+
+    BOOST_CHECK(Columns.GetValue(values, 0) == TCellVariant { TString { "First" } });
+    BOOST_CHECK(!Columns.FindColumn(static_cast<TColumnType>(Filters::FullTextSearch)));
+}
+
+BOOST_FIXTURE_TEST_CASE(TestVisibilityByVersion, ColumnarSnapshotTests)
+{
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(1), 1);
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(2), 1);
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(1, "Changed"), 2);
+    Columns.MarkRewrited(2, 3);
+
+    CheckRows(1, { 0, 1 });
+    CheckRows(2, { 1, 2 });
+    CheckRows(3, { 2 });
+
+    const Basis::Vector<int64_t> expected { 2, 1 };
+    auto ids = ScanIds(2);
+    BOOST_CHECK_EQUAL_COLLECTIONS(ids.cbegin(), ids.cend(), expected.cbegin(), expected.cend());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestErasePreviousCompacts, ColumnarSnapshotTests)
+{
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(1), 1);
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(2), 1);
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(1, "Changed"), 2);
+    Columns.MarkRewrited(2, 3);
+
+    Columns.ErasePrevious(4);
+    BOOST_CHECK_EQUAL(Columns.RowsCount(), 3);
+    BOOST_CHECK(Columns.TryCompact());
+    BOOST_CHECK_EQUAL(Columns.RowsCount(), 1);
+    CheckRows(4, { 0 });
+    BOOST_REQUIRE(Columns.GetString(GetColumn(DummyColumnType::Value), 0));
+    BOOST_CHECK_EQUAL(*Columns.GetString(GetColumn(DummyColumnType::Value), 0), "Changed");
+
+    /// После уплотнения перезапись находит правильную строку.
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(1, "Again"), 5);
+    CheckRows(4, { 0 });
+    CheckRows(5, { 1 });
+}
+
+BOOST_FIXTURE_TEST_CASE(TestCompactionDeferredWhileScanning, ColumnarSnapshotTests)
+{
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(1), 1);
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(2), 1);
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(1, "Changed"), 2);
+    Columns.Append(Basis::MakeSPtr<DummyTableItem>(2, "Changed"), 2);
+
+    ColumnarRanges<TColumnarRangesSetup> ranges(Tracer);
+    ranges.Init(ColumnarRanges<TColumnarRangesSetup>::TInit { Columns, 2 });
+    BOOST_CHECK_EQUAL(ranges.GetNext()->GetId(), 1);
+
+    Columns.ErasePrevious(3);
+    BOOST_CHECK(!Columns.TryCompact());
+    BOOST_CHECK_EQUAL(Columns.RowsCount(), 4);
+
+    BOOST_CHECK_EQUAL(ranges.GetNext()->GetId(), 2);
+    BOOST_CHECK(!ranges.GetNext().HasValue());
+    ranges.Reset();
+
+    /// Отложенное уплотнение выполняется следующим вызовом, без новой очистки.
+    BOOST_CHECK(Columns.TryCompact());
+    BOOST_CHECK_EQUAL(Columns.RowsCount(), 2);
+    BOOST_CHECK(!Columns.TryCompact());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestContainerCompactsDeferredColumns, ColumnarSnapshotTests)
+{
+    DummyColumnarMultiIndex map(Tracer);
+    map.Emplace(Basis::MakeSPtr<DummyTableItem>(1), 1);
+    map.Emplace(Basis::MakeSPtr<DummyTableItem>(1, "Changed"), 2);
+
+    ColumnarRanges<TColumnarRangesSetup> ranges(Tracer);
+    ranges.Init(ColumnarRanges<TColumnarRangesSetup>::TInit { map.GetColumns(), 2 });
+
+    map.ErasePrevious(3);
+    BOOST_CHECK_EQUAL(map.GetColumns().RowsCount(), 2);
+
+    ranges.Reset();
+    map.CompactColumns();
+    BOOST_CHECK_EQUAL(map.GetColumns().RowsCount(), 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestInitLikeIndexRanges, ColumnarSnapshotTests)
+{
+    using TRanges = ColumnarRanges<TColumnarRangesSetup>;
+
+    DummyColumnarMultiIndex map(Tracer);
+    map.Emplace(Basis::MakeSPtr<DummyTableItem>(1), 1);
+    map.Emplace(Basis::MakeSPtr<DummyTableItem>(2), 1);
+    map.Emplace(Basis::MakeSPtr<DummyTableItem>(1, "Changed"), 2);
+
+    FilterGroup filters;
+    filters.Relation = FilterRelation::And;
+
+    /// Обработчик подписки инициализирует диапазоны так же, как диапазоны хранилища.
+    TRanges ranges(Tracer);
+    BOOST_REQUIRE(ranges.Init(TRanges::TInit { map, filters, std::nullopt, 2 }));
+    BOOST_CHECK_EQUAL(&ranges.GetColumns(), &map.GetColumns());
+    BOOST_CHECK_EQUAL(ranges.GetNext()->GetId(), 2);
+    BOOST_CHECK_EQUAL(ranges.GetNext()->GetId(), 1);
+    BOOST_CHECK(!ranges.GetNext().HasValue());
+    ranges.Reset();
+
+    /// Инкременты строятся по индексам хранилища.
+    BOOST_CHECK(!ranges.Init(TRanges::TInit { map, filters, Model::ActionType::New, 2 }));
+    BOOST_CHECK(!ranges.IsInitialized());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestContainerKeepsColumnsInSync, ColumnarSnapshotTests)
+{
+    DummyColumnarMultiIndex map(Tracer);
+    map.Emplace(Basis::MakeSPtr<DummyTableItem>(1), 1);
+    map.Emplace(Basis::MakeSPtr<DummyTableItem>(2), 1);
+    map.Emplace(Basis::MakeSPtr<DummyTableItem>(2, "Changed"), 2);
+    map.Erase(1, 2);
+
+    const auto& columns = map.GetColumns();
+    BOOST_CHECK_EQUAL(columns.RowsCount(), 3);
+    BOOST_CHECK(columns.IsVisible(0, 1) && columns.IsVisible(1, 1));
+    BOOST_CHECK(!columns.IsVisible(0, 2) && !columns.IsVisible(1, 2) && columns.IsVisible(2, 2));
+
+    map.ErasePrevious(3);
+    BOOST_CHECK_EQUAL(map.Size(), 1);
+    BOOST_CHECK_EQUAL(map.GetColumns().RowsCount(), 1);
+
+    map.Clear();
+    BOOST_CHECK_EQUAL(map.GetColumns().RowsCount(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
@@ -0,0 +1,246 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/CompiledFilterGroup.hpp"
+#include "UiLocalStore/ColumnarSnapshot.hpp"
+#include "UiLocalStore/LocalStoreUtils.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+#include <chrono>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_CompiledFilterGroupTests)
+
+using namespace TradingSerialization::Table;
+
+struct CompiledFilterGroupTests : public BaseTestFixture
+{
+    using TCompiledFilters = CompiledFilterGroup<DummyTableSetup>;
+    using TColumns = ColumnarSnapshot<DummyTableSetup, DummyTableItem>;
+
+    Basis::Tracer& Tracer;
+    Basis::Vector<Basis::SPtr<DummyTableItem>> Items;
+
+    CompiledFilterGroupTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+    {
+        for (int64_t i = 0; i < 10; ++i)
+        {
+            Items.push_back(Basis::MakeSPtr<DummyTableItem>(i, i % 2 ? "Odd" : "Even"));
+        }
+    }
+
+    template <typename... TValues>
+    static Filter MakeFilter(DummyColumnType aColumn, FilterOperator aOperator, TValues&&... aValues)
+    {
+        Filter filter;
+        filter.Column = static_cast<TColumnType>(aColumn);
+        filter.Operator = aOperator;
+        (filter.Values.Add(std::forward<TValues>(aValues)), ...);
+        return filter;
+    }
+
+    static FilterGroup MakeGroup(std::initializer_list<Filter> aFilters)
+    {
+        FilterGroup group;
+        group.Relation = FilterRelation::And;
+        for (const auto& filter : aFilters)
+        {
+            group.Filters.insert(filter);
+        }
+        return group;
+    }
+
+    /// Скомпилированные фильтры дают тот же результат, что и LocalStoreUtils::CheckDataByFilter.
+    void CheckSameAsInterpreter(const FilterGroup& aGroup) const
+    {
+        TCompiledFilters compiled(aGroup);
+        for (const auto& item : Items)
+        {
+            bool expectedOk = true;
+            const auto expected = LocalStoreUtils::CheckDataByFilter<DummyTableSetup>(*item, aGroup, expectedOk);
+
+            bool ok = true;
+            BOOST_CHECK_EQUAL(compiled.Check(*item, ok), expected);
+            BOOST_CHECK_EQUAL(ok, expectedOk);
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestMatchesInterpreter, CompiledFilterGroupTests)
+{
+    using Op = FilterOperator;
+    const auto id = DummyColumnType::Id;
+    const auto value = DummyColumnType::Value;
+
+    const Basis::Vector<FilterGroup> groups
+    {
+        MakeGroup({}),
+        MakeGroup({ MakeFilter(id, Op::In, 1, 3, 8) }),
+        MakeGroup({ MakeFilter(id, Op::In) }),
+        MakeGroup({ MakeFilter(id, Op::In, TInt {}) }),
+        MakeGroup({ MakeFilter(id, Op::GreaterEq, 5) }),
+        MakeGroup({ MakeFilter(id, Op::LessEq, 5) }),
+        MakeGroup({ MakeFilter(id, Op::Greater, 5) }),
+        MakeGroup({ MakeFilter(id, Op::Less, 5) }),
+        MakeGroup({ MakeFilter(id, Op::Greater, TInt {}) }),
+        MakeGroup({ MakeFilter(id, Op::LessEq, TInt {}) }),
+        MakeGroup({ MakeFilter(value, Op::In, TString { "Odd" }) }),
+        MakeGroup({ MakeFilter(value, Op::Less, TString { "F" }) }),
+        MakeGroup({ MakeFilter(id, Op::GreaterEq, 2), MakeFilter(value, Op::In, TString { "Even" }) }),
+        MakeGroup({ MakeFilter(id, Op::GreaterEq, 2), MakeFilter(id, Op::Less, 7) }),
+        /// Несовпадение типов.
+        MakeGroup({ MakeFilter(id, Op::In, TString { "1" }) }),
+        MakeGroup({ MakeFilter(value, Op::Less, TFloat { Basis::Real { 1.0 } }) }),
+        /// Значения разных типов.
+        MakeGroup({ MakeFilter(id, Op::In, 1, TString { "1" }) }),
+        MakeGroup({ MakeFilter(id, Op::In, TString { "1" }, 1) }),
+    };
+
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        BOOST_TEST_CONTEXT("Group " << i)
+        {
+            CheckSameAsInterpreter(groups[i]);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestLongInLists, CompiledFilterGroupTests)
+{
+    auto ids = MakeFilter(DummyColumnType::Id, FilterOperator::In, TInt {});
+    auto values = MakeFilter(DummyColumnType::Value, FilterOperator::In);
+    for (int64_t i = 0; i < 1000; i += 3)
+    {
+        ids.Values.Add(1000 - i);
+        values.Values.Add(TString { "Value" + std::to_string(i) });
+    }
+    values.Values.Add(TString { "Odd" });
+
+    CheckSameAsInterpreter(MakeGroup({ ids }));
+    CheckSameAsInterpreter(MakeGroup({ values }));
+    CheckSameAsInterpreter(MakeGroup({ ids, values }));
+}
+
+BOOST_FIXTURE_TEST_CASE(TestInvalidFilters, CompiledFilterGroupTests)
+{
+    BOOST_TEST_CONTEXT("Invalid column")
+    {
+        auto filter = MakeFilter(DummyColumnType::Id, FilterOperator::In, 1);
+        filter.Column = -1;
+        auto group = MakeGroup({ filter });
+        CheckSameAsInterpreter(group);
+
+        bool ok = true;
+        BOOST_CHECK(!TCompiledFilters(group).Check(*Items.front(), ok));
+        BOOST_CHECK(!ok);
+    }
+
+    BOOST_TEST_CONTEXT("Invalid relation")
+    {
+        auto group = MakeGroup({});
+        group.Relation = static_cast<FilterRelation>(-1);
+        CheckSameAsInterpreter(group);
+
+        bool ok = true;
+        BOOST_CHECK(!TCompiledFilters(group).Check(*Items.front(), ok));
+        BOOST_CHECK(!ok);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestColumnarRows, CompiledFilterGroupTests)
+{
+    TColumns columns(Tracer);
+    for (const auto& item : Items)
+    {
+        columns.Append(item, 1);
+    }
+
+    const auto group = MakeGroup({
+        MakeFilter(DummyColumnType::Id, FilterOperator::In, 1, 2, 3, 4, 5),
+        MakeFilter(DummyColumnType::Value, FilterOperator::GreaterEq, TString { "F" }) });
+    TCompiledFilters compiled(group);
+
+    Basis::Vector<int64_t> ids;
+    for (size_t row = 0; row < columns.RowsCount(); ++row)
+    {
+        bool ok = true;
+        bool expectedOk = true;
+        const auto result = compiled.CheckRow(columns, row, ok);
+        BOOST_CHECK_EQUAL(result, compiled.Check(*columns.GetItem(row), expectedOk));
+        BOOST_CHECK_EQUAL(ok, expectedOk);
+        if (result)
+        {
+            ids.push_back(columns.GetItem(row)->GetId());
+        }
+    }
+
+    const Basis::Vector<int64_t> expected { 1, 3, 5 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(ids.cbegin(), ids.cend(), expected.cbegin(), expected.cend());
+
+    bool ok = true;
+    const auto mismatch = MakeGroup({ MakeFilter(DummyColumnType::Value, FilterOperator::In, 1) });
+    BOOST_CHECK(!TCompiledFilters(mismatch).CheckRow(columns, 0, ok));
+    BOOST_CHECK(!ok);
+}
+
+/**
+ * \brief Сравнение пропускной способности интерпретатора и скомпилированных фильтров.
+ * Результат выводится в лог теста и не проверяется, чтобы тест не зависел от нагрузки машины.
+ */
+BOOST_FIXTURE_TEST_CASE(TestThroughput, CompiledFilterGroupTests)
+{
+    constexpr int64_t RowsCount = 100000;
+
+    TColumns columns(Tracer);
+    Items.clear();
+    for (int64_t i = 0; i < RowsCount; ++i)
+    {
+        Items.push_back(Basis::MakeSPtr<DummyTableItem>(i, "Value" + std::to_string(i % 100)));
+        columns.Append(Items.back(), 1);
+    }
+
+    const auto group = MakeGroup({
+        MakeFilter(DummyColumnType::Id, FilterOperator::GreaterEq, 1000),
+        MakeFilter(DummyColumnType::Value, FilterOperator::In, TString { "Value1" }, TString { "Value7" }, TString { "Value42" }) });
+    const TCompiledFilters compiled(group);
+
+    const auto measure = [](const char* aName, auto&& aCheck)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        size_t matched = 0;
+        bool ok = true;
+        for (int64_t row = 0; row < RowsCount; ++row)
+        {
+            matched += aCheck(row, ok);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        BOOST_CHECK(ok);
+        BOOST_TEST_MESSAGE(aName << ": " << static_cast<int64_t>(RowsCount / std::max(elapsed.count(), 1e-9)) << " rows/sec");
+        return matched;
+    };
+
+    const auto interpreted = measure("Interpreted", [&](int64_t aRow, bool& outOk)
+    {
+        return LocalStoreUtils::CheckDataByFilter<DummyTableSetup>(*Items[aRow], group, outOk);
+    });
+    const auto compiledRows = measure("Compiled", [&](int64_t aRow, bool& outOk)
+    {
+        return compiled.Check(*Items[aRow], outOk);
+    });
+    const auto columnarRows = measure("Compiled columnar", [&](int64_t aRow, bool& outOk)
+    {
+        return compiled.CheckRow(columns, static_cast<size_t>(aRow), outOk);
+    });
+
+    BOOST_CHECK_EQUAL(interpreted, 2970);
+    BOOST_CHECK_EQUAL(compiledRows, interpreted);
+    BOOST_CHECK_EQUAL(columnarRows, interpreted);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
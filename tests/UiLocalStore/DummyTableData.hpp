@@ -170,16 +170,27 @@ struct DummyTableItemIndexRangesInit
     const TradingSerialization::Table::FilterGroup& FilterExpression;
     std::optional<Model::ActionType> IncrementAction;
     TDataVersion Version;
+    TDataVersion FromVersion;
 
     DummyTableItemIndexRangesInit(
         const DummyTableItemMultiIndex& aMap,
         const TradingSerialization::Table::FilterGroup& aFilterExpression,
         std::optional<Model::ActionType> aIncrementAction,
         TDataVersion aVersion)
+        : DummyTableItemIndexRangesInit(aMap, aFilterExpression, aIncrementAction, aVersion, aVersion)
+    {}
+
+    DummyTableItemIndexRangesInit(
+        const DummyTableItemMultiIndex& aMap,
+        const TradingSerialization::Table::FilterGroup& aFilterExpression,
+        std::optional<Model::ActionType> aIncrementAction,
+        TDataVersion aVersion,
+        TDataVersion aFromVersion)
         : Map(aMap)
         , FilterExpression(aFilterExpression)
         , IncrementAction(aIncrementAction)
         , Version(aVersion)
+        , FromVersion(aFromVersion)
     {}
 };
 
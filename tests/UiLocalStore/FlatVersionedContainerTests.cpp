@@ -0,0 +1,308 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/FlatVersionedContainer.hpp"
+#include "UiLocalStore/IteratorRanges.hpp"
+#include "UiLocalStore/MultiIndexContainer.hpp"
+#include "UiLocalStore/VersionDeltaCache.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+#include <random>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_FlatVersionedContainerTests)
+
+using namespace TradingSerialization::Table;
+
+class ReferenceMultiIndex : public BaseMultiIndexContainer<
+    ReferenceMultiIndex,
+    DummyMultiIndexContainerSetup>
+{
+public:
+    ReferenceMultiIndex(Basis::Tracer& aTracer)
+        : BaseMultiIndexContainer(aTracer)
+    {}
+
+    template <typename TSetup>
+    class IndexRanges : public BaseIndexRanges<TSetup, IndexRanges<TSetup>>
+    {
+        using TBase = BaseIndexRanges<TSetup, IndexRanges<TSetup>>;
+
+    public:
+        IndexRanges(Basis::Tracer& aTracer)
+            : TBase(aTracer, this)
+        {}
+
+        std::optional<bool> InitCustom()
+        {
+            return std::nullopt;
+        }
+
+        Basis::SPtr<DummyTableItem> CustomGetNext()
+        {
+            return nullptr;
+        }
+
+        void ResetCustom()
+        {
+        }
+    };
+};
+
+struct ReferenceRangesSetup
+{
+    using TData = DummyTableItem;
+    using TIdRanges = IteratorRanges<ReferenceMultiIndex::TIdConstIterator>;
+    using TAddedRanges = IteratorRanges<ReferenceMultiIndex::TVersionConstIterator>;
+    using TDeletedRanges = IteratorRanges<ReferenceMultiIndex::TRewritedConstIterator>;
+};
+
+struct DeltaContainerSetup : DummyMultiIndexContainerSetup
+{
+    using TVersionDeltaCache = VersionDeltaCache<DummyTableItem>;
+};
+
+using TFlatContainer = FlatVersionedContainer<DummyMultiIndexContainerSetup>;
+using TFlatRanges = TFlatContainer::IndexRanges<DummyMultiIndexContainerSetup>;
+using TFlatDeltaContainer = FlatVersionedContainer<DeltaContainerSetup>;
+using TFlatDeltaRanges = TFlatDeltaContainer::IndexRanges<DeltaContainerSetup>;
+using TReferenceRanges = ReferenceMultiIndex::IndexRanges<ReferenceRangesSetup>;
+
+struct FlatVersionedContainerTests : public BaseTestFixture
+{
+    using TItems = Basis::Vector<DummyTableItem>;
+
+    Basis::Tracer& Tracer;
+    TFlatContainer Flat;
+    TFlatDeltaContainer FlatWithDeltas;
+    ReferenceMultiIndex Reference;
+    FilterGroup Filters;
+
+    FlatVersionedContainerTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+        , Flat(Tracer)
+        , FlatWithDeltas(Tracer)
+        , Reference(Tracer)
+    {
+        Filters.Relation = FilterRelation::And;
+    }
+
+    /**
+     * \brief Элементы диапазона в порядке выдачи.
+     */
+    template <typename TRanges, typename TMap>
+    TItems GetRangeItems(
+        const TMap& aMap,
+        std::optional<Model::ActionType> aAction,
+        TDataVersion aVersion,
+        TDataVersion aFromVersion)
+    {
+        TRanges ranges(Tracer);
+        BOOST_CHECK(ranges.Init(typename TRanges::TInit { aMap, Filters, aAction, aVersion, aFromVersion }));
+
+        TItems result;
+        while (auto item = ranges.GetNext())
+        {
+            result.push_back(*item);
+        }
+        return result;
+    }
+
+    template <typename TRanges, typename TMap>
+    TItems GetItems(const TMap& aMap, std::optional<Model::ActionType> aAction, TDataVersion aVersion)
+    {
+        auto result = GetRangeItems<TRanges>(aMap, aAction, aVersion, aVersion);
+        std::sort(result.begin(), result.end(), [](const auto& aLhs, const auto& aRhs)
+        {
+            return aLhs.Data < aRhs.Data;
+        });
+        return result;
+    }
+
+    /**
+     * \brief Диапазоны обоих хранилищ отдают одни и те же элементы в одном порядке.
+     */
+    void CheckSameItems(
+        std::optional<Model::ActionType> aAction,
+        TDataVersion aVersion,
+        std::optional<TDataVersion> aFromVersion = std::nullopt)
+    {
+        const auto fromVersion = aFromVersion.value_or(aVersion);
+        const auto reference = GetRangeItems<TReferenceRanges>(Reference, aAction, aVersion, fromVersion);
+        const auto flat = GetRangeItems<TFlatRanges>(Flat, aAction, aVersion, fromVersion);
+        BOOST_CHECK_EQUAL(flat.size(), reference.size());
+        BOOST_CHECK(flat == reference);
+        const auto flatWithDeltas = GetRangeItems<TFlatDeltaRanges>(FlatWithDeltas, aAction, aVersion, fromVersion);
+        BOOST_CHECK_EQUAL(flatWithDeltas.size(), reference.size());
+        BOOST_CHECK(flatWithDeltas == reference);
+    }
+
+    void Emplace(int64_t aId, const std::string& aValue, TDataVersion aVersion)
+    {
+        auto item = Basis::MakeSPtr<DummyTableItem>(aId, aValue);
+        Flat.Emplace(item, aVersion);
+        FlatWithDeltas.Emplace(item, aVersion);
+        Reference.Emplace(item, aVersion);
+    }
+
+    void Erase(int64_t aId, TDataVersion aVersion)
+    {
+        Flat.Erase(aId, aVersion);
+        FlatWithDeltas.Erase(aId, aVersion);
+        Reference.Erase(aId, aVersion);
+    }
+
+    void ErasePrevious(TDataVersion aVersion)
+    {
+        Flat.ErasePrevious(aVersion);
+        FlatWithDeltas.ErasePrevious(aVersion);
+        Reference.ErasePrevious(aVersion);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestFlatIdIndex, FlatVersionedContainerTests)
+{
+    using TIndex = FlatIdIndex<int64_t, std::hash<int64_t>>;
+
+    TIndex index;
+    for (uint32_t i = 0; i < 10000; ++i)
+    {
+        index.Insert(static_cast<int64_t>(i) * 1024, i);
+    }
+    BOOST_CHECK_EQUAL(index.Size(), 10000);
+
+    for (uint32_t i = 0; i < 10000; i += 2)
+    {
+        index.Erase(static_cast<int64_t>(i) * 1024);
+    }
+    index.Erase(1);
+    BOOST_CHECK_EQUAL(index.Size(), 5000);
+
+    for (uint32_t i = 0; i < 10000; ++i)
+    {
+        const auto expected = i % 2 ? i : TIndex::NoSlot;
+        BOOST_REQUIRE_EQUAL(index.Find(static_cast<int64_t>(i) * 1024), expected);
+    }
+
+    index.Clear();
+    BOOST_CHECK_EQUAL(index.Size(), 0);
+    BOOST_CHECK_EQUAL(index.Find(1024), TIndex::NoSlot);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestRanges, FlatVersionedContainerTests)
+{
+    Emplace(1, "First", 1);
+    Emplace(2, "Second", 1);
+
+    const TItems itemsV1 { { 1, "First" }, { 2, "Second" } };
+    BOOST_CHECK(GetItems<TFlatRanges>(Flat, std::nullopt, 1) == itemsV1);
+
+    Emplace(1, "Changed", 2);
+    Erase(2, 2);
+    Emplace(3, "Third", 2);
+
+    BOOST_CHECK_EQUAL(Flat.Size(), 4);
+
+    const TItems itemsV2 { { 1, "Changed" }, { 3, "Third" } };
+    BOOST_CHECK(GetItems<TFlatRanges>(Flat, std::nullopt, 2) == itemsV2);
+    BOOST_CHECK(GetItems<TFlatRanges>(Flat, Model::ActionType::New, 2) == itemsV2);
+
+    const TItems deletedV2 { { 1, "First" }, { 2, "Second" } };
+    BOOST_CHECK(GetItems<TFlatRanges>(Flat, Model::ActionType::Delete, 2) == deletedV2);
+    BOOST_CHECK(GetItems<TFlatRanges>(Flat, Model::ActionType::Delete, 3).empty());
+
+    Flat.ErasePrevious(3);
+    BOOST_CHECK_EQUAL(Flat.Size(), 2);
+    BOOST_CHECK(GetItems<TFlatRanges>(Flat, std::nullopt, 2) == itemsV2);
+
+    /// Ячейка удаленного элемента переиспользуется.
+    Emplace(4, "Fourth", 3);
+    const TItems itemsV3 { { 1, "Changed" }, { 3, "Third" }, { 4, "Fourth" } };
+    BOOST_CHECK(GetItems<TFlatRanges>(Flat, std::nullopt, 3) == itemsV3);
+
+    Flat.Clear();
+    BOOST_CHECK_EQUAL(Flat.Size(), 0);
+    BOOST_CHECK(GetItems<TFlatRanges>(Flat, std::nullopt, 3).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestSameAsMultiIndexContainer, FlatVersionedContainerTests)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int64_t> ids(0, 49);
+    std::uniform_int_distribution<int> actions(0, 3);
+
+    for (TDataVersion version = 1; version <= 40; ++version)
+    {
+        Basis::Set<int64_t> touched;
+        for (int i = 0; i < 20; ++i)
+        {
+            const auto id = ids(random);
+            if (!touched.insert(id).second)
+            {
+                continue;
+            }
+            if (actions(random) == 0)
+            {
+                Erase(id, version);
+            }
+            else
+            {
+                Emplace(id, std::to_string(version), version);
+            }
+        }
+        FlatWithDeltas.CommitVersion(version);
+
+        BOOST_TEST_CONTEXT("Version " << version)
+        {
+            CheckSameItems(std::nullopt, version);
+            CheckSameItems(std::nullopt, version - 1);
+            CheckSameItems(Model::ActionType::New, version);
+            CheckSameItems(Model::ActionType::Delete, version);
+            if (version > 3)
+            {
+                CheckSameItems(Model::ActionType::New, version, version - 3);
+                CheckSameItems(Model::ActionType::Delete, version, version - 3);
+            }
+
+            if (version % 5 == 0)
+            {
+                ErasePrevious(version - 2);
+                CheckSameItems(std::nullopt, version);
+            }
+            BOOST_CHECK_EQUAL(Flat.Size(), Reference.Size());
+            BOOST_CHECK_EQUAL(FlatWithDeltas.Size(), Reference.Size());
+        }
+    }
+}
+
+/**
+ * \brief Строка, добавленная и удаленная одной версией, попадает в удаленные вместе с перезаписанной.
+ */
+BOOST_FIXTURE_TEST_CASE(TestRewriteAndEraseInOneVersion, FlatVersionedContainerTests)
+{
+    Emplace(2, "First", 1);
+    Emplace(1, "First", 1);
+    Emplace(1, "Changed", 2);
+    Erase(1, 2);
+    FlatWithDeltas.CommitVersion(2);
+
+    const TItems deletedV2 { { 1, "First" }, { 1, "Changed" } };
+    BOOST_CHECK(GetRangeItems<TFlatRanges>(Flat, Model::ActionType::Delete, 2, 2) == deletedV2);
+    BOOST_CHECK(GetRangeItems<TFlatDeltaRanges>(FlatWithDeltas, Model::ActionType::Delete, 2, 2) == deletedV2);
+    BOOST_CHECK(GetItems<TReferenceRanges>(Reference, Model::ActionType::Delete, 2) == GetItems<TFlatRanges>(Flat, Model::ActionType::Delete, 2));
+
+    const auto delta = FlatWithDeltas.GetVersionDeltas().Find(2);
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK_EQUAL(delta->Added.size(), 1);
+    BOOST_CHECK_EQUAL(delta->Deleted.size(), 2);
+
+    const TItems itemsV2 { { 2, "First" } };
+    BOOST_CHECK(GetRangeItems<TFlatRanges>(Flat, std::nullopt, 2, 2) == itemsV2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
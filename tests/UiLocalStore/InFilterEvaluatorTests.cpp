@@ -0,0 +1,85 @@
+#include "UiLocalStore/InFilterEvaluator.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_InFilterEvaluatorTests)
+
+struct InFilterEvaluatorTests : public BaseTestFixture
+{
+    template <typename T>
+    static void CheckContains(const InFilterEvaluator<T>& aEvaluator, const T& aValue, bool aExpected)
+    {
+        BOOST_CHECK_EQUAL(aEvaluator.Contains(&aValue), aExpected);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestIntValues, InFilterEvaluatorTests)
+{
+    BOOST_TEST_CONTEXT("Short list")
+    {
+        InFilterEvaluator<int64_t> evaluator;
+        evaluator.Init({ 5, 1, 3 }, false);
+        CheckContains<int64_t>(evaluator, 3, true);
+        CheckContains<int64_t>(evaluator, 4, false);
+        BOOST_CHECK(!evaluator.Contains(nullptr));
+    }
+
+    BOOST_TEST_CONTEXT("Long list with duplicates")
+    {
+        Basis::Vector<int64_t> values;
+        for (int64_t i = 1000; i > 0; --i)
+        {
+            values.push_back(i * 2);
+            values.push_back(i * 2);
+        }
+
+        InFilterEvaluator<int64_t> evaluator;
+        evaluator.Init(values, true);
+        BOOST_CHECK_EQUAL(evaluator.Size(), 1000);
+        CheckContains<int64_t>(evaluator, 2, true);
+        CheckContains<int64_t>(evaluator, 2000, true);
+        CheckContains<int64_t>(evaluator, 1001, false);
+        CheckContains<int64_t>(evaluator, 0, false);
+        CheckContains<int64_t>(evaluator, 2002, false);
+        BOOST_CHECK(evaluator.Contains(nullptr));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestStringValues, InFilterEvaluatorTests)
+{
+    Basis::Vector<std::string> values;
+    for (int i = 0; i < 100; ++i)
+    {
+        values.push_back("Instrument" + std::to_string(i));
+    }
+
+    InFilterEvaluator<std::string> evaluator;
+    evaluator.Init(values, false);
+    CheckContains<std::string>(evaluator, "Instrument0", true);
+    CheckContains<std::string>(evaluator, "Instrument99", true);
+    CheckContains<std::string>(evaluator, "Instrument100", false);
+    CheckContains<std::string>(evaluator, "", false);
+    BOOST_CHECK(!evaluator.Contains(nullptr));
+}
+
+BOOST_FIXTURE_TEST_CASE(TestFloatValuesUseRealEquality, InFilterEvaluatorTests)
+{
+    Basis::Vector<Basis::Real> values;
+    for (int i = 0; i < 20; ++i)
+    {
+        values.push_back(Basis::Real { i + 0.1 });
+    }
+
+    InFilterEvaluator<Basis::Real> evaluator;
+    evaluator.Init(values, false);
+    CheckContains(evaluator, Basis::Real { 0.1 + 0.2 - 0.2 }, true);
+    CheckContains(evaluator, Basis::Real { 19.1 }, true);
+    CheckContains(evaluator, Basis::Real { 0.2 }, false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
@@ -111,5 +111,26 @@ BOOST_FIXTURE_TEST_CASE(TestResetRanges, IteratorRangesTests)
     TestForEach(ranges, Buffer.size());
 }
 
+BOOST_FIXTURE_TEST_CASE(TestMergedRanges, IteratorRangesTests)
+{
+    MergedIteratorRanges<TIterator, std::less<int>> ranges;
+    Buffer = { 1, 4, 7, 2, 2, 8, 3 };
+    ranges.Add(std::make_pair<TIterator, TIterator>(Buffer.cbegin(), Buffer.cbegin() + 3));
+    ranges.Add(std::make_pair<TIterator, TIterator>(Buffer.cbegin() + 3, Buffer.cbegin() + 6));
+    ranges.Add(std::make_pair<TIterator, TIterator>(Buffer.cbegin() + 6, Buffer.cbegin() + 6));
+    ranges.Add(std::make_pair<TIterator, TIterator>(Buffer.cbegin() + 6, Buffer.cend()));
+
+    Basis::Vector<int> result;
+    while (auto it = ranges.Next())
+    {
+        result.push_back(**it);
+    }
+    const Basis::Vector<int> expected { 1, 2, 2, 3, 4, 7, 8 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.cbegin(), result.cend(), expected.cbegin(), expected.cend());
+
+    /// После окончания диапазоны сброшены.
+    BOOST_CHECK(!ranges.Next());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
@@ -0,0 +1,150 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/KeyedTableSorter.hpp"
+#include "UiLocalStore/SortOrderComparator.hpp"
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+#include <random>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_KeyedTableSorterTests)
+
+using namespace TradingSerialization::Table;
+
+template <int _MaxCount>
+struct TKeyedSorterSetup
+{
+    static constexpr int MaxCount = _MaxCount;
+    using TData = DummyTableItem;
+    using TTableSetup = DummyTableSetup;
+};
+
+struct KeyedTableSorterTests : public BaseTestFixture
+{
+    using TSortOrder = TradingSerialization::Table::TSortOrder;
+    using TDataPack = Basis::Pack<DummyTableItem>;
+
+    TSortOrder SortOrder;
+    TDataPack Data;
+    TDataPack ExpectedData;
+    TDataPack TmpBuf;
+
+    std::mt19937 Random { 7 };
+    Basis::Tracer& Tracer;
+
+    KeyedTableSorterTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+    {
+        SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Value));
+        SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+    }
+
+    void FillRandomData(int aCount)
+    {
+        Data.clear();
+        for (int i = 0; i < aCount; ++i)
+        {
+            const auto value = static_cast<int>(Random() % 50);
+            Data.push_back(Basis::MakeSPtr<DummyTableItem>(i, "Value" + std::to_string(value)));
+        }
+        std::shuffle(Data.begin(), Data.end(), Random);
+
+        ExpectedData = Data;
+        bool ok = true;
+        std::sort(ExpectedData.begin(), ExpectedData.end(), SortOrderComparator<DummyTableItem, DummyColumnType>(SortOrder, ok));
+        BOOST_REQUIRE(ok);
+    }
+
+    template <int MaxCount>
+    TableSorterState Sort(KeyedTableSorter<TKeyedSorterSetup<MaxCount>>& aSorter, int& outCalls)
+    {
+        using TSorter = KeyedTableSorter<TKeyedSorterSetup<MaxCount>>;
+        aSorter.Init(typename TSorter::TInit { SortOrder, Data, TmpBuf });
+        BOOST_CHECK(aSorter.IsInitialized());
+
+        outCalls = 0;
+        auto state = aSorter.GetState();
+        while (state != TableSorterState::Completed && state != TableSorterState::Error)
+        {
+            state = aSorter.Process();
+            ++outCalls;
+        }
+        return state;
+    }
+
+    void CheckResult()
+    {
+        BOOST_REQUIRE_EQUAL(Data.size(), ExpectedData.size());
+        for (size_t i = 0; i < Data.size(); ++i)
+        {
+            BOOST_REQUIRE_EQUAL(Data[i]->GetId(), ExpectedData[i]->GetId());
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestSameOrderAsComparator, KeyedTableSorterTests)
+{
+    for (int count : { 0, 1, 99, 100, 101, 777, 3200 })
+    {
+        BOOST_TEST_CONTEXT("Items count: " << count)
+        {
+            FillRandomData(count);
+            KeyedTableSorter<TKeyedSorterSetup<100>> sorter(Tracer);
+            int calls = 0;
+            BOOST_CHECK_EQUAL(TableSorterState::Completed, Sort(sorter, calls));
+            CheckResult();
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestProcessIsBounded, KeyedTableSorterTests)
+{
+    constexpr int MaxCount = 100;
+    constexpr int PartsCount = 16;
+    FillRandomData(MaxCount * PartsCount);
+
+    KeyedTableSorter<TKeyedSorterSetup<MaxCount>> sorter(Tracer);
+    int calls = 0;
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Sort(sorter, calls));
+    CheckResult();
+
+    /// Извлечение, сортировка частей, перестановка и log2(PartsCount) проходов слияния,
+    /// каждый этап не больше PartsCount вызовов.
+    BOOST_CHECK_LE(calls, PartsCount * (3 + 4));
+}
+
+BOOST_FIXTURE_TEST_CASE(TestReset, KeyedTableSorterTests)
+{
+    KeyedTableSorter<TKeyedSorterSetup<100>> sorter(Tracer);
+    int calls = 0;
+
+    FillRandomData(450);
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Sort(sorter, calls));
+    CheckResult();
+    BOOST_CHECK_EQUAL(TableSorterState::Error, sorter.Process());
+
+    sorter.Reset();
+    BOOST_CHECK(!sorter.IsInitialized());
+
+    SortOrder = { static_cast<TColumnType>(DummyColumnType::Id) };
+    FillRandomData(250);
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Sort(sorter, calls));
+    CheckResult();
+}
+
+BOOST_FIXTURE_TEST_CASE(TestInvalidSortOrder, KeyedTableSorterTests)
+{
+    KeyedTableSorter<TKeyedSorterSetup<100>> sorter(Tracer);
+    SortOrder.clear();
+    sorter.Init(KeyedTableSorter<TKeyedSorterSetup<100>>::TInit { SortOrder, Data, TmpBuf });
+    BOOST_CHECK_EQUAL(TableSorterState::Error, sorter.GetState());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
@@ -0,0 +1,373 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/IteratorRanges.hpp"
+#include "UiLocalStore/MultiIndexContainer.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_MultiIndexContainerTests)
+
+using namespace TradingSerialization::Table;
+
+struct IntersectionContainerSetup : public DummyMultiIndexContainerSetup
+{
+    struct ByGroup
+    {
+        typedef int64_t result_type;
+        result_type operator()(const VersionedItem<TData>& aData) const
+        {
+            return aData.Item->Data % 10;
+        }
+    };
+
+    /// Последняя цифра значения, меняется вместе со значением строки.
+    struct ByTag
+    {
+        typedef int64_t result_type;
+        result_type operator()(const VersionedItem<TData>& aData) const
+        {
+            return aData.Item->Value.back() - '0';
+        }
+    };
+};
+
+class IntersectionMultiIndex : public BaseMultiIndexContainer<
+    IntersectionMultiIndex,
+    IntersectionContainerSetup,
+    IntersectionContainerSetup::ByValue,
+    IntersectionContainerSetup::ByGroup,
+    IntersectionContainerSetup::ByTag>
+{
+public:
+    IntersectionMultiIndex(Basis::Tracer& aTracer)
+        : BaseMultiIndexContainer(aTracer)
+    {}
+
+    using ByGroupAndIdAndVersion = BySomethingAndId<IntersectionContainerSetup::ByGroup>;
+    using TGroupConstIterator = Type::index<ByGroupAndIdAndVersion>::type::const_iterator;
+    using ByTagAndIdAndVersion = BySomethingAndId<IntersectionContainerSetup::ByTag>;
+    using TTagConstIterator = Type::index<ByTagAndIdAndVersion>::type::const_iterator;
+
+    template <typename TSetup>
+    class IndexRanges : public BaseIndexRanges<TSetup, IndexRanges<TSetup>>
+    {
+        using TBase = BaseIndexRanges<TSetup, IndexRanges<TSetup>>;
+
+        MergedIteratorRanges<TGroupConstIterator, IdAndVersionLess> mGroupRanges;
+        MergedIteratorRanges<TTagConstIterator, IdAndVersionLess> mTagRanges;
+
+    public:
+        typename TBase::template IndexProbe<IntersectionContainerSetup::ByValue> Values;
+        typename TBase::template IndexProbe<IntersectionContainerSetup::ByGroup> Groups;
+        /// Если задано, используются только диапазоны по группам.
+        std::optional<TIntValues> GroupKeys;
+        /// Если задано, используются только диапазоны по тегам.
+        std::optional<TIntValues> TagKeys;
+
+        IndexRanges(Basis::Tracer& aTracer)
+            : TBase(aTracer, this)
+        {}
+
+        std::optional<bool> InitCustom()
+        {
+            if (GroupKeys)
+            {
+                return this->template InitFilterIteratorRangeByKeys<ByGroupAndIdAndVersion>(*GroupKeys, mGroupRanges);
+            }
+            if (TagKeys)
+            {
+                return this->template InitFilterIteratorRangeByKeys<ByTagAndIdAndVersion>(*TagKeys, mTagRanges);
+            }
+            return this->InitIntersection(Values, Groups);
+        }
+
+        Basis::SPtr<DummyTableItem> CustomGetNext()
+        {
+            return GroupKeys ? this->GetNext(mGroupRanges) : this->GetNext(mTagRanges);
+        }
+
+        void ResetCustom()
+        {
+            mGroupRanges.Reset();
+            mTagRanges.Reset();
+        }
+    };
+};
+
+struct IntersectionRangesSetup
+{
+    using TData = DummyTableItem;
+    using TIdRanges = IteratorRanges<IntersectionMultiIndex::TIdConstIterator>;
+    using TAddedRanges = IteratorRanges<IntersectionMultiIndex::TVersionConstIterator>;
+    using TDeletedRanges = IteratorRanges<IntersectionMultiIndex::TRewritedConstIterator>;
+};
+
+using TIntersectionRanges = IntersectionMultiIndex::IndexRanges<IntersectionRangesSetup>;
+
+struct MultiIndexContainerTests : public BaseTestFixture
+{
+    Basis::Tracer& Tracer;
+    IntersectionMultiIndex Map;
+    FilterGroup Filters;
+
+    MultiIndexContainerTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+        , Map(Tracer)
+    {
+        Filters.Relation = FilterRelation::And;
+        for (int64_t i = 0; i < 100; ++i)
+        {
+            Map.Emplace(Basis::MakeSPtr<DummyTableItem>(i, "V" + std::to_string(i % 4)), 1);
+        }
+    }
+
+    Basis::Vector<int64_t> GetIds(
+        const Basis::Vector<std::string>& aValues,
+        const Basis::Vector<int64_t>& aGroups,
+        TDataVersion aVersion)
+    {
+        TIntersectionRanges ranges(Tracer);
+        ranges.Values.Keys = aValues;
+        ranges.Groups.Keys = aGroups;
+        BOOST_CHECK(ranges.Init(TIntersectionRanges::TInit { Map, Filters, std::nullopt, aVersion }));
+
+        Basis::Vector<int64_t> result;
+        while (auto item = ranges.GetNext())
+        {
+            result.push_back(item->GetId());
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    Basis::Vector<std::string> GetIncrement(Model::ActionType aAction, TDataVersion aFromVersion, TDataVersion aVersion)
+    {
+        TIntersectionRanges ranges(Tracer);
+        BOOST_CHECK(ranges.Init(TIntersectionRanges::TInit { Map, Filters, aAction, aVersion, aFromVersion }));
+
+        Basis::Vector<std::string> result;
+        while (auto item = ranges.GetNext())
+        {
+            result.push_back(std::to_string(item->GetId()) + ":" + item->Value);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    void CheckIncrement(
+        Model::ActionType aAction,
+        TDataVersion aFromVersion,
+        TDataVersion aVersion,
+        const Basis::Vector<std::string>& aExpected)
+    {
+        const auto rows = GetIncrement(aAction, aFromVersion, aVersion);
+        BOOST_CHECK_EQUAL_COLLECTIONS(rows.cbegin(), rows.cend(), aExpected.cbegin(), aExpected.cend());
+    }
+
+    void CheckIds(
+        const Basis::Vector<std::string>& aValues,
+        const Basis::Vector<int64_t>& aGroups,
+        TDataVersion aVersion,
+        const Basis::Vector<int64_t>& aExpected)
+    {
+        const auto ids = GetIds(aValues, aGroups, aVersion);
+        BOOST_CHECK_EQUAL_COLLECTIONS(ids.cbegin(), ids.cend(), aExpected.cbegin(), aExpected.cend());
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestIntersection, MultiIndexContainerTests)
+{
+    CheckIds({ "V1" }, { 3, 5 }, 1, { 5, 13, 25, 33, 45, 53, 65, 73, 85, 93 });
+    CheckIds({ "V1", "V3" }, { 7 }, 1, { 7, 17, 27, 37, 47, 57, 67, 77, 87, 97 });
+    CheckIds({ "V0" }, { 7 }, 1, {});
+    CheckIds({}, { 7 }, 1, {});
+}
+
+BOOST_FIXTURE_TEST_CASE(TestIntersectionByVersion, MultiIndexContainerTests)
+{
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(5, "V2"), 2);
+    Map.Erase(13, 2);
+
+    CheckIds({ "V1" }, { 3, 5 }, 1, { 5, 13, 25, 33, 45, 53, 65, 73, 85, 93 });
+    CheckIds({ "V1" }, { 3, 5 }, 2, { 25, 33, 45, 53, 65, 73, 85, 93 });
+    CheckIds({ "V2" }, { 5 }, 2, { 5 });
+}
+
+BOOST_FIXTURE_TEST_CASE(TestLargeIndexIsNotIntersected, MultiIndexContainerTests)
+{
+    /// Диапазоны по значениям в 10 раз больше ведущих и не пересекаются,
+    /// их фильтр проверяется построчно при фильтрации.
+    CheckIds({ "V0", "V1", "V2", "V3" }, { 3 }, 1, { 3, 13, 23, 33, 43, 53, 63, 73, 83, 93 });
+}
+
+BOOST_FIXTURE_TEST_CASE(TestRangesByKeys, MultiIndexContainerTests)
+{
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(5, "Changed"), 2);
+    Map.Erase(13, 2);
+
+    const auto getIds = [this](const TIntValues& aKeys, TDataVersion aVersion)
+    {
+        TIntersectionRanges ranges(Tracer);
+        ranges.GroupKeys = aKeys;
+        BOOST_CHECK(ranges.Init(TIntersectionRanges::TInit { Map, Filters, std::nullopt, aVersion }));
+
+        Basis::Vector<int64_t> result;
+        while (auto item = ranges.GetNext())
+        {
+            result.push_back(item->GetId());
+        }
+        return result;
+    };
+
+    BOOST_TEST_CONTEXT("Keys are deduplicated, rows are merged by id")
+    {
+        const auto ids = getIds({ 5, 3, 5, 3 }, 2);
+        const Basis::Vector<int64_t> expected { 3, 5, 15, 23, 25, 33, 35, 43, 45, 53, 55, 63, 65, 73, 75, 83, 85, 93, 95 };
+        BOOST_CHECK_EQUAL_COLLECTIONS(ids.cbegin(), ids.cend(), expected.cbegin(), expected.cend());
+    }
+
+    BOOST_TEST_CONTEXT("Previous version")
+    {
+        const auto ids = getIds({ 3 }, 1);
+        const Basis::Vector<int64_t> expected { 3, 13, 23, 33, 43, 53, 63, 73, 83, 93 };
+        BOOST_CHECK_EQUAL_COLLECTIONS(ids.cbegin(), ids.cend(), expected.cbegin(), expected.cend());
+    }
+
+    BOOST_TEST_CONTEXT("Missing keys")
+    {
+        BOOST_CHECK(getIds({ 10, 11 }, 2).empty());
+    }
+
+    BOOST_TEST_CONTEXT("Null key")
+    {
+        TIntersectionRanges ranges(Tracer);
+        ranges.GroupKeys = TIntValues { 1, std::nullopt };
+        BOOST_CHECK(!ranges.Init(TIntersectionRanges::TInit { Map, Filters, std::nullopt, 2 }));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestRangesByKeysMergesVersions, MultiIndexContainerTests)
+{
+    /// Строка 5 переходит из тега 1 в тег 3: ее версии лежат в диапазонах разных ключей.
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(5, "V3"), 2);
+
+    const auto getRows = [this](const TIntValues& aKeys, TDataVersion aVersion)
+    {
+        TIntersectionRanges ranges(Tracer);
+        ranges.TagKeys = aKeys;
+        BOOST_CHECK(ranges.Init(TIntersectionRanges::TInit { Map, Filters, std::nullopt, aVersion }));
+
+        Basis::Vector<std::string> result;
+        while (auto item = ranges.GetNext())
+        {
+            if (item->GetId() < 12)
+            {
+                result.push_back(std::to_string(item->GetId()) + ":" + item->Value);
+            }
+        }
+        return result;
+    };
+
+    BOOST_TEST_CONTEXT("Previous version is returned once")
+    {
+        const auto rows = getRows({ 3, 1 }, 1);
+        const Basis::Vector<std::string> expected { "1:V1", "3:V3", "5:V1", "7:V3", "9:V1", "11:V3" };
+        BOOST_CHECK_EQUAL_COLLECTIONS(rows.cbegin(), rows.cend(), expected.cbegin(), expected.cend());
+    }
+
+    BOOST_TEST_CONTEXT("Current version")
+    {
+        const auto rows = getRows({ 3, 1 }, 2);
+        const Basis::Vector<std::string> expected { "1:V1", "3:V3", "5:V3", "7:V3", "9:V1", "11:V3" };
+        BOOST_CHECK_EQUAL_COLLECTIONS(rows.cbegin(), rows.cend(), expected.cbegin(), expected.cend());
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestBulkLoad, MultiIndexContainerTests)
+{
+    const auto size = Map.Size();
+    Map.Clear();
+
+    Basis::Vector<Basis::SPtr<DummyTableItem>> items;
+    for (int64_t i = 99; i >= 0; --i)
+    {
+        items.push_back(Basis::MakeSPtr<DummyTableItem>(i, "V" + std::to_string(i % 4)));
+    }
+    /// Повтор id: как и при вставке по одному, остается первый элемент.
+    items.push_back(Basis::MakeSPtr<DummyTableItem>(7, "V0"));
+    items.push_back(Basis::MakeSPtr<DummyTableItem>(7, "V1"));
+    items.push_back(Basis::MakeSPtr<DummyTableItem>(200, "V1"));
+    items.push_back(Basis::MakeSPtr<DummyTableItem>(200, "V2"));
+    Map.BulkLoad(std::move(items), 1);
+
+    BOOST_CHECK_EQUAL(Map.Size(), size + 1);
+    CheckIds({ "V1" }, { 3, 5 }, 1, { 5, 13, 25, 33, 45, 53, 65, 73, 85, 93 });
+    CheckIds({ "V1" }, { 7 }, 1, { 17, 37, 57, 77, 97 });
+    CheckIds({ "V3" }, { 7 }, 1, { 7, 27, 47, 67, 87 });
+    CheckIds({ "V1" }, { 0 }, 1, { 200 });
+    CheckIds({ "V2" }, { 0 }, 1, { 10, 30, 50, 70, 90 });
+
+    /// Следующие версии применяются поверх загруженной как обычно.
+    Map.BulkLoad({ Basis::MakeSPtr<DummyTableItem>(5, "V2") }, 2);
+    Map.Erase(13, 2);
+    CheckIds({ "V1" }, { 3, 5 }, 2, { 25, 33, 45, 53, 65, 73, 85, 93 });
+}
+
+BOOST_FIXTURE_TEST_CASE(TestVersionInterval, MultiIndexContainerTests)
+{
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(5, "A2"), 2);
+    Map.Erase(6, 2);
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(200, "N2"), 2);
+
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(5, "A3"), 3);
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(7, "A3"), 3);
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(200, "N3"), 3);
+
+    Map.Erase(200, 4);
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(201, "N4"), 4);
+
+    /// Одна версия.
+    CheckIncrement(Model::ActionType::New, 4, 4, { "201:N4" });
+    CheckIncrement(Model::ActionType::Delete, 4, 4, { "200:N3" });
+
+    /// Из нескольких изменений строки берется последнее, строки, удаленные внутри интервала, пропускаются.
+    CheckIncrement(Model::ActionType::New, 2, 4, { "201:N4", "5:A3", "7:A3" });
+    CheckIncrement(Model::ActionType::Delete, 2, 4, { "5:V1", "6:V2", "7:V3" });
+
+    /// Удаляются только строки, которые подписка видела до интервала.
+    CheckIncrement(Model::ActionType::New, 3, 4, { "201:N4", "5:A3", "7:A3" });
+    CheckIncrement(Model::ActionType::Delete, 3, 4, { "200:N2", "5:A2", "7:V3" });
+}
+
+BOOST_FIXTURE_TEST_CASE(TestVersionIntervalAfterClear, MultiIndexContainerTests)
+{
+    /// Подписка на версии 1 переходит сразу на версию 4.
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(5, "A2"), 2);
+    Map.Erase(6, 2);
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(200, "N2"), 2);
+
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(5, "A3"), 3);
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(7, "A3"), 3);
+
+    Map.Erase(200, 4);
+    Map.Emplace(Basis::MakeSPtr<DummyTableItem>(201, "N4"), 4);
+
+    /// До построения инкремента хранилище очищается до первой пропущенной версии.
+    Map.ErasePrevious(2);
+
+    /// Удаления и смена значений ключа за весь интервал видны полностью.
+    CheckIncrement(Model::ActionType::New, 2, 4, { "201:N4", "5:A3", "7:A3" });
+    CheckIncrement(Model::ActionType::Delete, 2, 4, { "5:V1", "6:V2", "7:V3" });
+
+    /// Очистка до текущей версии теряет строки, которые заменены внутри интервала.
+    Map.ErasePrevious(4);
+    CheckIncrement(Model::ActionType::Delete, 2, 4, {});
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
@@ -0,0 +1,103 @@
+#include "UiLocalStore/OrderStatisticTree.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Collections.hpp>
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_OrderStatisticTreeTests)
+
+using TTree = OrderStatisticTree<int>;
+
+void CheckSame(const TTree& aTree, const std::set<int>& aExpected)
+{
+    BOOST_REQUIRE_EQUAL(aTree.Size(), aExpected.size());
+    Basis::Vector<int> values;
+    aTree.ForEach([&](int aValue)
+    {
+        values.push_back(aValue);
+    });
+    BOOST_CHECK_EQUAL_COLLECTIONS(values.cbegin(), values.cend(), aExpected.cbegin(), aExpected.cend());
+}
+
+BOOST_AUTO_TEST_CASE(TestBuildAndRank)
+{
+    Basis::Vector<int> sorted;
+    for (int i = 0; i < 1000; ++i)
+    {
+        sorted.push_back(3 * i);
+    }
+
+    TTree tree;
+    tree.Build(sorted.cbegin(), sorted.cend());
+    BOOST_REQUIRE_EQUAL(tree.Size(), sorted.size());
+
+    const auto less = std::less<int> {};
+    for (size_t i = 0; i < sorted.size(); i += 37)
+    {
+        BOOST_CHECK_EQUAL(tree.At(i), sorted[i]);
+        BOOST_CHECK_EQUAL(tree.LowerBound(sorted[i], less), i);
+        BOOST_CHECK_EQUAL(tree.LowerBound(sorted[i] + 1, less), i + 1);
+    }
+
+    Basis::Vector<int> window;
+    tree.ForEach(995, 1005, [&](int aValue)
+    {
+        window.push_back(aValue);
+    });
+    const Basis::Vector<int> expected { 2985, 2988, 2991, 2994, 2997 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(window.cbegin(), window.cend(), expected.cbegin(), expected.cend());
+
+    /// Повторная вставка равного элемента не меняет размер.
+    BOOST_CHECK(!tree.InsertOrAssign(3, less));
+    BOOST_CHECK(!tree.Erase(4, less));
+    BOOST_CHECK_EQUAL(tree.Size(), sorted.size());
+}
+
+BOOST_AUTO_TEST_CASE(TestRandomOperations)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> values(0, 5000);
+    const auto less = std::less<int> {};
+
+    std::set<int> expected;
+    for (int i = 0; i < 2000; ++i)
+    {
+        expected.insert(values(random));
+    }
+
+    TTree tree;
+    tree.Build(expected.cbegin(), expected.cend());
+    CheckSame(tree, expected);
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        const auto value = values(random);
+        if (random() % 2)
+        {
+            BOOST_REQUIRE_EQUAL(tree.InsertOrAssign(value, less), expected.insert(value).second);
+        }
+        else
+        {
+            BOOST_REQUIRE_EQUAL(tree.Erase(value, less), expected.erase(value) > 0);
+        }
+    }
+    CheckSame(tree, expected);
+
+    const auto rank = expected.size() / 2;
+    BOOST_CHECK_EQUAL(tree.At(rank), *std::next(expected.cbegin(), rank));
+
+    tree.Clear();
+    BOOST_CHECK(tree.Empty());
+    BOOST_CHECK(tree.InsertOrAssign(1, less));
+    BOOST_CHECK_EQUAL(tree.At(0), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
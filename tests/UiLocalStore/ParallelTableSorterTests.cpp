@@ -0,0 +1,252 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/ParallelTableSorter.hpp"
+#include "UiLocalStore/SortOrderComparator.hpp"
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+#include <random>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_ParallelTableSorterTests)
+
+using namespace TradingSerialization::Table;
+
+struct TParallelSorterSetup
+{
+    static constexpr int MaxCount = 100;
+    using TData = DummyTableItem;
+    using TTableSetup = DummyTableSetup;
+
+    static std::shared_ptr<WorkerPool> GetWorkerPool()
+    {
+        static auto pool = std::make_shared<WorkerPool>(4);
+        return pool;
+    }
+};
+
+struct TNoPoolSorterSetup : public TParallelSorterSetup
+{
+    static std::shared_ptr<WorkerPool> GetWorkerPool()
+    {
+        return nullptr;
+    }
+};
+
+using TSorter = ParallelTableSorter<TParallelSorterSetup>;
+
+/**
+ * \brief Строка, значение колонки Value которой нельзя сравнить с другими строками.
+ */
+struct FailingTableItem : public DummyTableItem
+{
+    using DummyTableItem::DummyTableItem;
+
+    TCellVariant GetValue(TColumnType aColumn) const
+    {
+        if (Data == 0 && aColumn == DummyColumnType::Value)
+        {
+            return TradingSerialization::Table::TInt { Data };
+        }
+        return DummyTableItem::GetValue(aColumn);
+    }
+};
+
+struct TFailingSorterSetup : public TParallelSorterSetup
+{
+    using TData = FailingTableItem;
+};
+
+struct ParallelTableSorterTests : public BaseTestFixture
+{
+    using TSortOrder = TradingSerialization::Table::TSortOrder;
+    using TDataPack = Basis::Pack<DummyTableItem>;
+
+    TSortOrder SortOrder;
+    TDataPack Data;
+    TDataPack ExpectedData;
+    TDataPack TmpBuf;
+
+    std::mt19937 Random { 11 };
+    Basis::Tracer& Tracer;
+
+    ParallelTableSorterTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+    {
+        SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Value));
+        SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+    }
+
+    void FillRandomData(int aCount)
+    {
+        Data.clear();
+        for (int i = 0; i < aCount; ++i)
+        {
+            Data.push_back(Basis::MakeSPtr<DummyTableItem>(i, "Value" + std::to_string(Random() % 50)));
+        }
+        std::shuffle(Data.begin(), Data.end(), Random);
+
+        ExpectedData = Data;
+        bool ok = true;
+        std::sort(ExpectedData.begin(), ExpectedData.end(), SortOrderComparator<DummyTableItem, DummyColumnType>(SortOrder, ok));
+        BOOST_REQUIRE(ok);
+    }
+
+    template <typename TSorterType>
+    TableSorterState Sort(TSorterType& aSorter, size_t* outProcessCount = nullptr)
+    {
+        aSorter.Init(typename TSorterType::TInit { SortOrder, Data, TmpBuf });
+        auto state = aSorter.GetState();
+        size_t processCount = 0;
+        while (state != TableSorterState::Completed && state != TableSorterState::Error)
+        {
+            state = aSorter.Process();
+            ++processCount;
+        }
+        if (outProcessCount)
+        {
+            *outProcessCount = processCount;
+        }
+        return state;
+    }
+
+    void CheckResult()
+    {
+        BOOST_REQUIRE_EQUAL(Data.size(), ExpectedData.size());
+        for (size_t i = 0; i < Data.size(); ++i)
+        {
+            BOOST_REQUIRE_EQUAL(Data[i]->GetId(), ExpectedData[i]->GetId());
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestSameOrderAsComparator, ParallelTableSorterTests)
+{
+    for (int count : { 0, 1, 100, 101, 250, 999, 10000 })
+    {
+        BOOST_TEST_CONTEXT("Items count: " << count)
+        {
+            FillRandomData(count);
+            TSorter sorter(Tracer);
+            BOOST_CHECK_EQUAL(TableSorterState::Completed, Sort(sorter));
+            CheckResult();
+            BOOST_CHECK_EQUAL(TableSorterState::Error, sorter.Process());
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestResetWhileSorting, ParallelTableSorterTests)
+{
+    TSorter sorter(Tracer);
+    FillRandomData(20000);
+    sorter.Init(TSorter::TInit { SortOrder, Data, TmpBuf });
+    BOOST_CHECK_EQUAL(TableSorterState::PartSort, sorter.GetState());
+
+    /// Задачи пула продолжают работу со своей копией состояния.
+    sorter.Reset();
+    BOOST_CHECK(!sorter.IsInitialized());
+
+    FillRandomData(3000);
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Sort(sorter));
+    CheckResult();
+}
+
+BOOST_FIXTURE_TEST_CASE(TestSlicedWithoutPool, ParallelTableSorterTests)
+{
+    ParallelTableSorter<TNoPoolSorterSetup> sorter(Tracer);
+    FillRandomData(1000);
+
+    /// Без пула за вызов Process сортируется не больше MaxCount элементов.
+    size_t processCount = 0;
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Sort(sorter, &processCount));
+    BOOST_CHECK_GE(processCount, 1000 / TNoPoolSorterSetup::MaxCount);
+    CheckResult();
+
+    sorter.Reset();
+    BOOST_CHECK(!sorter.IsInitialized());
+    FillRandomData(250);
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Sort(sorter));
+    CheckResult();
+}
+
+BOOST_FIXTURE_TEST_CASE(TestSliceRowsWithoutPool, ParallelTableSorterTests)
+{
+    ParallelTableSorter<TNoPoolSorterSetup> sorter(Tracer);
+    FillRandomData(1000);
+    sorter.Init(ParallelTableSorter<TNoPoolSorterSetup>::TInit { SortOrder, Data, TmpBuf });
+
+    /// Каждый вызов Process сообщает строки, просмотренные за этот вызов, а не размер результата.
+    size_t sliceRows = 0;
+    auto state = sorter.GetState();
+    while (state != TableSorterState::Completed && state != TableSorterState::Error)
+    {
+        state = sorter.Process();
+        BOOST_CHECK_LE(sorter.GetSliceRows(), Data.size());
+        sliceRows += sorter.GetSliceRows();
+    }
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, state);
+    BOOST_CHECK_GE(sliceRows, Data.size());
+    CheckResult();
+
+    sorter.Reset();
+    BOOST_CHECK_EQUAL(0u, sorter.GetSliceRows());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestInvalidSortOrder, ParallelTableSorterTests)
+{
+    TSorter sorter(Tracer);
+    SortOrder.clear();
+    sorter.Init(TSorter::TInit { SortOrder, Data, TmpBuf });
+    BOOST_CHECK_EQUAL(TableSorterState::Error, sorter.GetState());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestErrorKeepsRows, ParallelTableSorterTests)
+{
+    using TFailingSorter = ParallelTableSorter<TFailingSorterSetup>;
+    using TFailingPack = Basis::Pack<FailingTableItem>;
+
+    for (const auto count : { 50, 1000 })
+    {
+        BOOST_TEST_CONTEXT("Items count: " << count)
+        {
+            TFailingPack data;
+            for (int i = 0; i < count; ++i)
+            {
+                data.push_back(Basis::MakeSPtr<FailingTableItem>(i, "Value" + std::to_string(Random() % 50)));
+            }
+            std::shuffle(data.begin(), data.end(), Random);
+
+            TFailingPack tmpBuffer;
+            TFailingSorter sorter(Tracer);
+            sorter.Init(TFailingSorter::TInit { SortOrder, data, tmpBuffer });
+            auto state = sorter.GetState();
+            while (state != TableSorterState::Completed && state != TableSorterState::Error)
+            {
+                state = sorter.Process();
+            }
+            BOOST_CHECK_EQUAL(TableSorterState::Error, state);
+
+            /// После ошибки все строки возвращены в результат.
+            BOOST_REQUIRE_EQUAL(data.size(), static_cast<size_t>(count));
+            Basis::Vector<int64_t> ids;
+            for (const auto& item : data)
+            {
+                BOOST_REQUIRE(item);
+                ids.push_back(item->GetId());
+            }
+            std::sort(ids.begin(), ids.end());
+            for (int i = 0; i < count; ++i)
+            {
+                BOOST_REQUIRE_EQUAL(ids[i], i);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
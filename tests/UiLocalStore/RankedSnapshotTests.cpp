@@ -0,0 +1,115 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/RankedSnapshot.hpp"
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Pack.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_RankedSnapshotTests)
+
+using namespace TradingSerialization::Table;
+
+template <int _MaxCount>
+struct TRankedSetup
+{
+    static constexpr int MaxCount = _MaxCount;
+    using TData = DummyTableItem;
+    using TTableSetup = DummyTableSetup;
+};
+
+struct RankedSnapshotTests : public BaseTestFixture
+{
+    using TDataPack = Basis::Pack<DummyTableItem>;
+
+    TSortOrder SortOrder;
+    Basis::Tracer& Tracer;
+
+    RankedSnapshotTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+    {
+        SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+    }
+
+    static TDataPack MakePack(const Basis::Vector<int>& aIds, const std::string& aValue = "Value1")
+    {
+        TDataPack result;
+        for (const auto id : aIds)
+        {
+            result.push_back(Basis::MakeSPtr<DummyTableItem>(id, aValue));
+        }
+        return result;
+    }
+
+    static void CheckRows(const TDataPack& aRows, const Basis::Vector<int>& aExpectedIds)
+    {
+        BOOST_REQUIRE_EQUAL(aRows.size(), aExpectedIds.size());
+        for (size_t i = 0; i < aRows.size(); ++i)
+        {
+            BOOST_CHECK_EQUAL(aRows[i]->Data, aExpectedIds[i]);
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestApplyIncrement, RankedSnapshotTests)
+{
+    RankedSnapshot<TRankedSetup<2>> snapshot(Tracer);
+    snapshot.Build(MakePack({ 10, 20, 30, 40, 50 }));
+
+    const auto deleted = MakePack({ 20, 50, 60 });
+    const auto added = MakePack({ 5, 30, 45 }, "Value2");
+
+    /// 6 изменений по 2 за вызов.
+    BOOST_CHECK_EQUAL(snapshot.ApplyIncrement(SortOrder, deleted, added), TableIncrementApplicatorState::Processing);
+    BOOST_CHECK_EQUAL(snapshot.ApplyIncrement(SortOrder, deleted, added), TableIncrementApplicatorState::Processing);
+    BOOST_CHECK_EQUAL(snapshot.ApplyIncrement(SortOrder, deleted, added), TableIncrementApplicatorState::Completed);
+    BOOST_CHECK_EQUAL(snapshot.GetSliceRows(), 2);
+
+    TDataPack rows;
+    snapshot.CopyAll(rows);
+    CheckRows(rows, { 5, 10, 30, 40, 45 });
+    /// Равный элемент заменен добавленным.
+    BOOST_CHECK_EQUAL(rows[2]->Value, "Value2");
+    BOOST_CHECK_EQUAL(rows[3]->Value, "Value1");
+
+    /// Следующий инкремент применяется с начала.
+    BOOST_CHECK_EQUAL(
+        snapshot.ApplyIncrement(SortOrder, MakePack({ 10 }), TDataPack {}),
+        TableIncrementApplicatorState::Completed);
+    BOOST_CHECK_EQUAL(snapshot.Size(), 4);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestCopyRows, RankedSnapshotTests)
+{
+    RankedSnapshot<TRankedSetup<100>> snapshot(Tracer);
+    Basis::Vector<int> ids;
+    for (int i = 0; i < 1000; ++i)
+    {
+        ids.push_back(i);
+    }
+    snapshot.Build(MakePack(ids));
+
+    TDataPack rows;
+    RowRange range;
+    range.Top = 100;
+    range.Bottom = 104;
+    snapshot.CopyRows(range, rows);
+    CheckRows(rows, { 100, 101, 102, 103, 104 });
+
+    range.Top = 998;
+    range.Bottom = 1100;
+    snapshot.CopyRows(range, rows);
+    CheckRows(rows, { 998, 999 });
+
+    range.Top = -1;
+    range.Bottom = -1;
+    snapshot.CopyRows(range, rows);
+    BOOST_CHECK(rows.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,78 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/SeededFiltration.hpp"
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Pack.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_SeededFiltrationTests)
+
+using namespace TradingSerialization::Table;
+
+struct TSeededSetup
+{
+    static constexpr int MaxCount = 2;
+    using TData = DummyTableItem;
+    using TTableSetup = DummyTableSetup;
+};
+
+struct SeededFiltrationTests : public BaseTestFixture
+{
+    using TDataPack = Basis::Pack<DummyTableItem>;
+
+    FilterGroup Filters;
+    Basis::Tracer& Tracer;
+
+    SeededFiltrationTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+    {
+        ValueSet values;
+        values.StringValues = { std::string { "A" } };
+        Filters.Filters.insert(Filter { static_cast<TColumnType>(DummyColumnType::Value), values, FilterOperator::In, false });
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestFiltrationKeepsOrder, SeededFiltrationTests)
+{
+    /// Результат исходной подписки отсортирован по убыванию id.
+    auto seed = Basis::MakeSPtrPack<DummyTableItem>();
+    for (const auto& [id, value] : Basis::Vector<std::pair<int, std::string>> {
+        { 50, "A" }, { 40, "B" }, { 30, "A" }, { 20, "A" }, { 10, "B" } })
+    {
+        seed->push_back(Basis::MakeSPtr<DummyTableItem>(id, value));
+    }
+
+    SeededFiltration<TSeededSetup> filtration(Tracer);
+    BOOST_CHECK(!filtration.IsSeeded());
+    filtration.Seed(seed);
+    BOOST_CHECK(filtration.IsSeeded());
+
+    TDataPack result;
+    const CompiledFilterGroup<DummyTableSetup> compiled(Filters);
+    filtration.Init(Filters, result, &compiled);
+
+    /// Не больше MaxCount строк за вызов.
+    BOOST_CHECK_EQUAL(filtration.Process(), TableFiltermanState::Processing);
+    BOOST_CHECK_EQUAL(result.size(), 1u);
+    BOOST_CHECK_EQUAL(filtration.Process(), TableFiltermanState::Processing);
+    BOOST_CHECK_EQUAL(filtration.Process(), TableFiltermanState::Completed);
+
+    BOOST_REQUIRE_EQUAL(result.size(), 3u);
+    BOOST_CHECK_EQUAL(result[0]->Data, 50);
+    BOOST_CHECK_EQUAL(result[1]->Data, 30);
+    BOOST_CHECK_EQUAL(result[2]->Data, 20);
+    /// Строки не копируются.
+    BOOST_CHECK_EQUAL(result[0], (*seed)[0]);
+
+    filtration.Reset();
+    BOOST_CHECK(!filtration.IsSeeded());
+    BOOST_CHECK(!filtration.IsInitialized());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,92 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/SortBufferPool.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Pack.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_SortBufferPoolTests)
+
+using TPool = SortBufferPool<DummyTableItem>;
+
+BOOST_AUTO_TEST_CASE(TestBufferIsReused)
+{
+    TPool pool;
+
+    auto buffer = pool.Acquire(3000);
+    BOOST_CHECK_GE(buffer.capacity(), 4096);
+    const auto* data = buffer.data();
+
+    buffer.resize(3000);
+    buffer[0] = Basis::MakeSPtr<DummyTableItem>(1);
+    pool.Release(std::move(buffer));
+    BOOST_CHECK_EQUAL(pool.GetStats().PooledElements, 4096);
+
+    /// Буфер того же класса размера выдается повторно, пустым.
+    auto reused = pool.Acquire(4000);
+    BOOST_CHECK_EQUAL(reused.data(), data);
+    BOOST_CHECK(reused.empty());
+
+    /// Другой класс размера.
+    auto other = pool.Acquire(100);
+    BOOST_CHECK_NE(other.data(), data);
+    BOOST_CHECK_GE(other.capacity(), TPool::MinClassSize);
+
+    const auto& stats = pool.GetStats();
+    BOOST_CHECK_EQUAL(stats.AcquireCount, 3);
+    BOOST_CHECK_EQUAL(stats.ReuseCount, 1);
+    BOOST_CHECK_EQUAL(stats.BorrowedCount, 2);
+    BOOST_CHECK_EQUAL(stats.PeakBorrowedCount, 2);
+    BOOST_CHECK_EQUAL(stats.PooledElements, 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestReleaseByCapacity)
+{
+    TPool pool;
+
+    /// Буфер, полученный не из пула, попадает в класс, который он гарантированно вмещает.
+    Basis::Pack<DummyTableItem> buffer;
+    buffer.reserve(3000);
+    pool.Release(std::move(buffer));
+
+    auto small = pool.Acquire(2048);
+    BOOST_CHECK_GE(small.capacity(), 3000);
+    BOOST_CHECK_EQUAL(pool.GetStats().ReuseCount, 1);
+
+    /// Маленькие буферы не хранятся.
+    Basis::Pack<DummyTableItem> tiny;
+    tiny.reserve(10);
+    pool.Release(std::move(tiny));
+    BOOST_CHECK_EQUAL(pool.GetStats().PooledElements, 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestPoolIsBounded)
+{
+    TPool pool;
+
+    Basis::Vector<TPool::TDataPack> buffers;
+    for (size_t i = 0; i < TPool::MaxBuffersPerClass + 2; ++i)
+    {
+        buffers.push_back(pool.Acquire(TPool::MinClassSize));
+    }
+    for (auto& buffer : buffers)
+    {
+        pool.Release(std::move(buffer));
+    }
+
+    const auto& stats = pool.GetStats();
+    BOOST_CHECK_EQUAL(stats.DropCount, 2);
+    BOOST_CHECK_EQUAL(stats.BorrowedCount, 0);
+    BOOST_CHECK_EQUAL(stats.PeakBorrowedCount, TPool::MaxBuffersPerClass + 2);
+    BOOST_CHECK_EQUAL(stats.PooledElements, TPool::MaxBuffersPerClass * TPool::MinClassSize);
+    BOOST_CHECK_EQUAL(stats.PeakPooledElements, stats.PooledElements);
+
+    pool.Shrink();
+    BOOST_CHECK_EQUAL(pool.GetStats().PooledElements, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
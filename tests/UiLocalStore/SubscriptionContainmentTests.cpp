@@ -0,0 +1,107 @@
+#include "UiLocalStore/SubscriptionContainment.hpp"
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_SubscriptionContainmentTests)
+
+using namespace TradingSerialization::Table;
+
+SubscribeBase MakeSubscription(const TSortOrder& aSortOrder, const Basis::Vector<Filter>& aFilters)
+{
+    SubscribeBase result;
+    result.SortOrder = aSortOrder;
+    for (const auto& filter : aFilters)
+    {
+        result.FilterExpression.Filters.insert(filter);
+    }
+    return result;
+}
+
+Filter MakeIntFilter(TColumnType aColumn, FilterOperator aOperator, const TIntValues& aValues)
+{
+    ValueSet values;
+    values.IntValues = aValues;
+    return Filter { aColumn, values, aOperator, false };
+}
+
+Filter MakeStringFilter(TColumnType aColumn, const TStringValues& aValues)
+{
+    ValueSet values;
+    values.StringValues = aValues;
+    return Filter { aColumn, values, FilterOperator::In, false };
+}
+
+BOOST_AUTO_TEST_CASE(TestRefinement)
+{
+    const auto parent = MakeSubscription({ 0, 1 }, { MakeIntFilter(1, FilterOperator::GreaterEq, { 10 }) });
+
+    BOOST_CHECK(SubscriptionContainment::IsRefinement(parent, parent));
+    /// Дополнительный фильтр по другой колонке.
+    BOOST_CHECK(SubscriptionContainment::IsRefinement(parent, MakeSubscription({ 0, 1 }, {
+        MakeIntFilter(1, FilterOperator::GreaterEq, { 10 }),
+        MakeStringFilter(0, { std::string { "A" } }) })));
+    /// Более узкий диапазон.
+    BOOST_CHECK(SubscriptionContainment::IsRefinement(parent, MakeSubscription({ 0, 1 }, {
+        MakeIntFilter(1, FilterOperator::Greater, { 10 }),
+        MakeIntFilter(1, FilterOperator::Less, { 20 }) })));
+    BOOST_CHECK(SubscriptionContainment::IsRefinement(parent, MakeSubscription({ 0, 1 }, {
+        MakeIntFilter(1, FilterOperator::In, { 10, 15 }) })));
+    /// Подписка без фильтров уточняется любой подпиской с тем же порядком.
+    BOOST_CHECK(SubscriptionContainment::IsRefinement(MakeSubscription({ 0, 1 }, {}), parent));
+    /// Порядок сортировки не влияет на вложенность фильтров.
+    BOOST_CHECK(SubscriptionContainment::IsFilterRefinement(
+        parent.FilterExpression,
+        MakeSubscription({ 1 }, { MakeIntFilter(1, FilterOperator::Greater, { 20 }) }).FilterExpression));
+}
+
+BOOST_AUTO_TEST_CASE(TestNotRefinement)
+{
+    const auto parent = MakeSubscription({ 0, 1 }, { MakeIntFilter(1, FilterOperator::Greater, { 10 }) });
+
+    /// Другой порядок сортировки.
+    BOOST_CHECK(!SubscriptionContainment::IsRefinement(parent, MakeSubscription({ 1 }, {
+        MakeIntFilter(1, FilterOperator::Greater, { 20 }) })));
+    /// Нестрогая граница шире строгой.
+    BOOST_CHECK(!SubscriptionContainment::IsRefinement(parent, MakeSubscription({ 0, 1 }, {
+        MakeIntFilter(1, FilterOperator::GreaterEq, { 10 }) })));
+    BOOST_CHECK(!SubscriptionContainment::IsRefinement(parent, MakeSubscription({ 0, 1 }, {
+        MakeIntFilter(1, FilterOperator::Less, { 20 }) })));
+    BOOST_CHECK(!SubscriptionContainment::IsRefinement(parent, MakeSubscription({ 0, 1 }, {
+        MakeIntFilter(1, FilterOperator::In, { 10, 15 }) })));
+    /// Фильтр по другой колонке не ограничивает колонку исходной подписки.
+    BOOST_CHECK(!SubscriptionContainment::IsRefinement(parent, MakeSubscription({ 0, 1 }, {
+        MakeStringFilter(0, { std::string { "A" } }) })));
+    BOOST_CHECK(!SubscriptionContainment::IsRefinement(parent, MakeSubscription({ 0, 1 }, {})));
+}
+
+BOOST_AUTO_TEST_CASE(TestImplies)
+{
+    const auto in = MakeStringFilter(0, { std::string { "A" }, std::string { "B" }, std::nullopt });
+
+    BOOST_CHECK(SubscriptionContainment::Implies(MakeStringFilter(0, { std::string { "B" } }), in));
+    BOOST_CHECK(SubscriptionContainment::Implies(MakeStringFilter(0, { std::nullopt, std::string { "A" } }), in));
+    BOOST_CHECK(!SubscriptionContainment::Implies(MakeStringFilter(0, { std::string { "C" } }), in));
+    BOOST_CHECK(!SubscriptionContainment::Implies(in, MakeStringFilter(0, { std::string { "A" } })));
+
+    /// Незаполненное значение не проходит нижнюю границу.
+    BOOST_CHECK(!SubscriptionContainment::Implies(
+        MakeIntFilter(1, FilterOperator::In, { std::nullopt, 15 }),
+        MakeIntFilter(1, FilterOperator::GreaterEq, { 10 })));
+    BOOST_CHECK(SubscriptionContainment::Implies(
+        MakeIntFilter(1, FilterOperator::In, { std::nullopt, 5 }),
+        MakeIntFilter(1, FilterOperator::LessEq, { 10 })));
+    BOOST_CHECK(SubscriptionContainment::Implies(
+        MakeIntFilter(1, FilterOperator::LessEq, { 9 }),
+        MakeIntFilter(1, FilterOperator::Less, { 10 })));
+    BOOST_CHECK(!SubscriptionContainment::Implies(
+        MakeIntFilter(1, FilterOperator::LessEq, { 10 }),
+        MakeIntFilter(1, FilterOperator::Less, { 10 })));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
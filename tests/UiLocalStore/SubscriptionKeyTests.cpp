@@ -0,0 +1,118 @@
+#include "UiLocalStore/SubscriptionKey.hpp"
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_SubscriptionKeyTests)
+
+using namespace TradingSerialization::Table;
+
+SubscribeBase MakeSubscription(const TSortOrder& aSortOrder, const Basis::Vector<Filter>& aFilters)
+{
+    SubscribeBase result;
+    result.SortOrder = aSortOrder;
+    for (const auto& filter : aFilters)
+    {
+        result.FilterExpression.Filters.insert(filter);
+    }
+    return result;
+}
+
+Filter MakeInFilter(TColumnType aColumn, const TIntValues& aValues)
+{
+    ValueSet values;
+    values.IntValues = aValues;
+    return Filter { aColumn, values, FilterOperator::In, false };
+}
+
+Filter MakeInStringFilter(TColumnType aColumn, const TStringValues& aValues)
+{
+    ValueSet values;
+    values.StringValues = aValues;
+    return Filter { aColumn, values, FilterOperator::In, false };
+}
+
+Filter MakeInFloatFilter(TColumnType aColumn, const TFloatValues& aValues)
+{
+    ValueSet values;
+    values.FloatValues = aValues;
+    return Filter { aColumn, values, FilterOperator::In, false };
+}
+
+Filter MakeLessFilter(TColumnType aColumn, int64_t aValue)
+{
+    ValueSet values;
+    values.IntValues = { aValue };
+    return Filter { aColumn, values, FilterOperator::Less, false };
+}
+
+BOOST_AUTO_TEST_CASE(TestEquivalentSubscriptions)
+{
+    const auto lhs = MakeSubscription(
+        { 2, 1 },
+        { MakeInFilter(1, { 3, 1, 2 }), MakeLessFilter(2, 10), MakeInFilter(2, { 5 }) });
+    /// Значения In в другом порядке и с повтором, фильтры одной колонки в другом порядке.
+    const auto rhs = MakeSubscription(
+        { 2, 1 },
+        { MakeInFilter(2, { 5 }), MakeLessFilter(2, 10), MakeInFilter(1, { 2, 3, 1, 3 }) });
+
+    const auto key = SubscriptionKey::Make(lhs);
+    BOOST_CHECK_EQUAL(key, SubscriptionKey::Make(rhs));
+    BOOST_CHECK_EQUAL(SubscriptionKey::Hasher {}(key), SubscriptionKey::Hasher {}(SubscriptionKey::Make(rhs)));
+}
+
+BOOST_AUTO_TEST_CASE(TestDifferentSubscriptions)
+{
+    const auto base = SubscriptionKey::Make(MakeSubscription({ 2, 1 }, { MakeInFilter(1, { 1, 2 }) }));
+
+    /// Порядок сортировки значим.
+    BOOST_CHECK_NE(base, SubscriptionKey::Make(MakeSubscription({ 1, 2 }, { MakeInFilter(1, { 1, 2 }) })));
+    BOOST_CHECK_NE(base, SubscriptionKey::Make(MakeSubscription({ 2, 1 }, { MakeInFilter(1, { 1, 3 }) })));
+    BOOST_CHECK_NE(base, SubscriptionKey::Make(MakeSubscription({ 2, 1 }, { MakeInFilter(2, { 1, 2 }) })));
+    BOOST_CHECK_NE(base, SubscriptionKey::Make(MakeSubscription({ 2, 1 }, {})));
+    /// Пустое значение отличается от отсутствующего.
+    BOOST_CHECK_NE(
+        SubscriptionKey::Make(MakeSubscription({ 1 }, { MakeInFilter(1, { std::nullopt }) })),
+        SubscriptionKey::Make(MakeSubscription({ 1 }, { MakeInFilter(1, {}) })));
+    /// Для операторов сравнения значения не упорядочиваются.
+    BOOST_CHECK_NE(
+        SubscriptionKey::Make(MakeSubscription({ 1 }, { MakeLessFilter(1, 1) })),
+        SubscriptionKey::Make(MakeSubscription({ 1 }, { MakeInFilter(1, { 1 }) })));
+}
+
+BOOST_AUTO_TEST_CASE(TestStringValuesDoNotCollide)
+{
+    const auto makeKey = [](const TStringValues& aValues)
+    {
+        return SubscriptionKey::Make(MakeSubscription({ 1 }, { MakeInStringFilter(1, aValues) }));
+    };
+
+    /// Разделитель значений внутри строки не сдвигает границы значений.
+    BOOST_CHECK_NE(
+        makeKey({ std::string("a\x1f"), std::string("b") }),
+        makeKey({ std::string("a"), std::string("\x1f" "b") }));
+    BOOST_CHECK_NE(makeKey({ std::string("a\x1f" "b") }), makeKey({ std::string("a"), std::string("b") }));
+    /// Строка "-" отличается от пустого значения.
+    BOOST_CHECK_NE(makeKey({ std::string("-") }), makeKey({ std::nullopt }));
+    BOOST_CHECK_EQUAL(makeKey({ std::string("b"), std::string("a") }), makeKey({ std::string("a"), std::string("b") }));
+}
+
+BOOST_AUTO_TEST_CASE(TestFloatValuesDoNotCollide)
+{
+    const auto makeKey = [](const TFloatValues& aValues)
+    {
+        return SubscriptionKey::Make(MakeSubscription({ 1 }, { MakeInFloatFilter(1, aValues) }));
+    };
+
+    /// Значения совпадают в первых шести знаках.
+    BOOST_CHECK_NE(makeKey({ Basis::Real { 100.000001 } }), makeKey({ Basis::Real { 100.000002 } }));
+    BOOST_CHECK_NE(makeKey({ Basis::Real { 1234567.1 } }), makeKey({ Basis::Real { 1234567.2 } }));
+    BOOST_CHECK_EQUAL(makeKey({ Basis::Real { 0.1 } }), makeKey({ Basis::Real { 0.1 } }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
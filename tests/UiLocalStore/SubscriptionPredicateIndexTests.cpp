@@ -0,0 +1,153 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/SubscriptionPredicateIndex.hpp"
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_SubscriptionPredicateIndexTests)
+
+using namespace TradingSerialization::Table;
+
+using TIndex = SubscriptionPredicateIndex<DummyTableSetup, DummyTableItem, int64_t>;
+
+struct SubscriptionPredicateIndexTests : public BaseTestFixture
+{
+    static constexpr auto ValueColumn = static_cast<TColumnType>(DummyColumnType::Value);
+    static constexpr auto IdColumn = static_cast<TColumnType>(DummyColumnType::Id);
+
+    TIndex Index;
+
+    static FilterGroup MakeFilters(const Basis::Vector<Filter>& aFilters)
+    {
+        FilterGroup result;
+        result.Relation = FilterRelation::And;
+        for (const auto& filter : aFilters)
+        {
+            result.Filters.insert(filter);
+        }
+        return result;
+    }
+
+    static Filter MakeIntFilter(TColumnType aColumn, FilterOperator aOperator, const TIntValues& aValues)
+    {
+        ValueSet values;
+        values.IntValues = aValues;
+        return Filter { aColumn, values, aOperator, false };
+    }
+
+    static Filter MakeStringFilter(TColumnType aColumn, FilterOperator aOperator, const TStringValues& aValues)
+    {
+        ValueSet values;
+        values.StringValues = aValues;
+        return Filter { aColumn, values, aOperator, false };
+    }
+
+    static TIndex::TDelta MakeDelta(
+        const Basis::Vector<DummyTableItem>& aAdded,
+        const Basis::Vector<DummyTableItem>& aDeleted = {})
+    {
+        TIndex::TDelta result;
+        for (const auto& item : aAdded)
+        {
+            result.Added.push_back(Basis::MakeSPtr<DummyTableItem>(item));
+        }
+        for (const auto& item : aDeleted)
+        {
+            result.Deleted.push_back(Basis::MakeSPtr<DummyTableItem>(item));
+        }
+        return result;
+    }
+
+    void CheckAffected(const TIndex::TDelta& aDelta, Basis::Vector<int64_t> aExpected)
+    {
+        const auto affected = Index.GetAffected(aDelta);
+        Basis::Vector<int64_t> actual(affected.cbegin(), affected.cend());
+        std::sort(actual.begin(), actual.end());
+        std::sort(aExpected.begin(), aExpected.end());
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.cbegin(), actual.cend(), aExpected.cbegin(), aExpected.cend());
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestInFilter, SubscriptionPredicateIndexTests)
+{
+    Index.Add(1, MakeFilters({ MakeStringFilter(ValueColumn, FilterOperator::In, { std::string { "A" } }) }));
+    Index.Add(2, MakeFilters({ MakeStringFilter(ValueColumn, FilterOperator::In, {
+        std::string { "A" }, std::string { "B" } }) }));
+    /// In предпочтительнее отрезка.
+    Index.Add(3, MakeFilters({
+        MakeIntFilter(IdColumn, FilterOperator::Greater, { 100 }),
+        MakeStringFilter(ValueColumn, FilterOperator::In, { std::string { "C" } }) }));
+
+    CheckAffected(MakeDelta({ { 1, "A" } }), { 1, 2 });
+    CheckAffected(MakeDelta({ { 1, "B" } }), { 2 });
+    CheckAffected(MakeDelta({ { 1, "D" } }), {});
+    /// Строка вышла из результата подписки.
+    CheckAffected(MakeDelta({ { 5, "D" } }, { { 5, "C" } }), { 3 });
+
+    Index.Remove(2);
+    CheckAffected(MakeDelta({ { 1, "A" }, { 2, "B" } }), { 1 });
+}
+
+BOOST_FIXTURE_TEST_CASE(TestRangeFilter, SubscriptionPredicateIndexTests)
+{
+    Index.Add(1, MakeFilters({
+        MakeIntFilter(IdColumn, FilterOperator::GreaterEq, { 10 }),
+        MakeIntFilter(IdColumn, FilterOperator::Less, { 20 }) }));
+    Index.Add(2, MakeFilters({ MakeIntFilter(IdColumn, FilterOperator::Greater, { 30 }) }));
+    Index.Add(3, MakeFilters({ MakeIntFilter(IdColumn, FilterOperator::LessEq, { 5 }) }));
+
+    CheckAffected(MakeDelta({ { 15 } }), { 1 });
+    CheckAffected(MakeDelta({ { 25 } }), {});
+    CheckAffected(MakeDelta({ { 1 }, { 40 } }), { 2, 3 });
+    /// Строгие границы не исключают граничное значение.
+    CheckAffected(MakeDelta({ { 20 } }), { 1 });
+}
+
+BOOST_FIXTURE_TEST_CASE(TestAlwaysAffected, SubscriptionPredicateIndexTests)
+{
+    /// Без фильтров.
+    Index.Add(1, MakeFilters({}));
+    /// Фильтр по некорректной колонке.
+    Index.Add(2, MakeFilters({
+        MakeStringFilter(ValueColumn, FilterOperator::In, { std::string { "A" } }),
+        MakeIntFilter(100, FilterOperator::In, { 1 }) }));
+    /// Только дробные значения.
+    ValueSet floats;
+    floats.FloatValues = { Basis::Real { 1 } };
+    Index.Add(3, MakeFilters({ Filter { IdColumn, floats, FilterOperator::Greater, false } }));
+    /// Значение другого типа, чем у колонки.
+    Index.Add(4, MakeFilters({ MakeIntFilter(ValueColumn, FilterOperator::In, { 1 }) }));
+    Index.Add(5, MakeFilters({ MakeStringFilter(ValueColumn, FilterOperator::In, { std::string { "A" } }) }));
+
+    CheckAffected(MakeDelta({ { 1, "B" } }), { 1, 2, 3, 4 });
+    CheckAffected(MakeDelta({}), { 1, 2, 3 });
+}
+
+BOOST_FIXTURE_TEST_CASE(TestVersions, SubscriptionPredicateIndexTests)
+{
+    Index.Add(1, MakeFilters({ MakeStringFilter(ValueColumn, FilterOperator::In, { std::string { "A" } }) }));
+    Index.AddVersionDelta(2, std::make_shared<TIndex::TDelta>(MakeDelta({ { 1, "B" } })));
+    Index.AddVersionDelta(3, std::make_shared<TIndex::TDelta>(MakeDelta({ { 2, "A" } })));
+
+    BOOST_CHECK(!Index.IsAffected(1, 2));
+    BOOST_CHECK(Index.IsAffected(1, 3));
+    /// Изменения версии неизвестны.
+    BOOST_CHECK(Index.IsAffected(1, 4));
+
+    /// Новые фильтры учитываются в уже вычисленных версиях.
+    Index.Add(1, MakeFilters({ MakeStringFilter(ValueColumn, FilterOperator::In, { std::string { "B" } }) }));
+    BOOST_CHECK(Index.IsAffected(1, 2));
+    BOOST_CHECK(!Index.IsAffected(1, 3));
+
+    Index.ErasePrevious(3);
+    BOOST_CHECK(Index.IsAffected(1, 2));
+    BOOST_CHECK(!Index.IsAffected(1, 3));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,64 @@
+#include "UiLocalStore/SubscriptionScheduler.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_SubscriptionSchedulerTests)
+
+using TScheduler = SubscriptionScheduler<100, 400>;
+
+struct SubscriptionSchedulerTests : public BaseTestFixture
+{
+    TScheduler Scheduler;
+
+    /// Выбрать класс при активных обоих классах и списать aRows строк.
+    SchedulingClass Run(int64_t aRows)
+    {
+        const auto result = Scheduler.Select(true, true);
+        Scheduler.Charge(result, aRows);
+        return result;
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestQuantums, SubscriptionSchedulerTests)
+{
+    /// Обход начинается с обновлений.
+    for (size_t i = 0; i < 4; ++i)
+    {
+        BOOST_CHECK(Run(100) == SchedulingClass::Increment);
+    }
+    BOOST_CHECK(Run(100) == SchedulingClass::Snapshot);
+    BOOST_CHECK(Run(1) == SchedulingClass::Increment);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestOverdraftCarriesOver, SubscriptionSchedulerTests)
+{
+    BOOST_CHECK(Run(1) == SchedulingClass::Increment);
+    BOOST_CHECK(Run(399) == SchedulingClass::Increment);
+
+    /// Снапшот перерасходовал квоту на два обхода.
+    BOOST_CHECK(Run(250) == SchedulingClass::Snapshot);
+    BOOST_CHECK_EQUAL(Scheduler.GetDeficit(SchedulingClass::Snapshot), -150);
+    BOOST_CHECK(Run(400) == SchedulingClass::Increment);
+    BOOST_CHECK(Run(400) == SchedulingClass::Increment);
+    BOOST_CHECK(Run(400) == SchedulingClass::Snapshot);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestSingleClass, SubscriptionSchedulerTests)
+{
+    BOOST_CHECK(Scheduler.Select(false, true) == SchedulingClass::Snapshot);
+    Scheduler.Charge(SchedulingClass::Snapshot, 10000);
+    BOOST_CHECK(Scheduler.Select(false, true) == SchedulingClass::Snapshot);
+    /// Без конкуренции долг не накапливается.
+    BOOST_CHECK_EQUAL(Scheduler.GetDeficit(SchedulingClass::Snapshot), 0);
+
+    BOOST_CHECK(Scheduler.Select(true, false) == SchedulingClass::Increment);
+    Scheduler.Charge(SchedulingClass::Increment, 10);
+    BOOST_CHECK(Run(10) == SchedulingClass::Snapshot);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
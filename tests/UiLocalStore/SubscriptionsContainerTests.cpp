@@ -14,6 +14,30 @@ struct TSubscriptionsContainerSetup
     static constexpr SubscriptionType StoreType = SubscriptionType::Table;
 };
 
+struct TRoutedSubscriptionsContainerSetup : public TSubscriptionsContainerSetup
+{
+    using TSubscriptionPredicateIndex = SubscriptionPredicateIndex<
+        DummyTableSetup,
+        DummyTableItem,
+        Actor::TUiRequestId,
+        Basis::UniqueIdHasher<Actor::TUiRequestId>>;
+};
+
+struct TScheduledSubscriptionsContainerSetup : public TSubscriptionsContainerSetup
+{
+    using TSubscriptionScheduler = SubscriptionScheduler<10, 40>;
+};
+
+struct TParallelSubscriptionsContainerSetup : public TSubscriptionsContainerSetup
+{
+    static constexpr bool ProcessSubscriptionsInParallel = true;
+};
+
+struct TCoalescingSubscriptionsContainerSetup : public TSubscriptionsContainerSetup
+{
+    static constexpr bool CoalesceVersions = true;
+};
+
 struct SubscriptionsContainerTests : public BaseTestFixture
 {
     using TSortOrder = TradingSerialization::Table::TSortOrder;
@@ -426,5 +450,384 @@ BOOST_FIXTURE_TEST_CASE(UpdateManySubscriptionsTest, SubscriptionsContainerTests
     UpdateSubscription(3, TActorPack { subscriptions[3] }, true);
 }
 
+BOOST_FIXTURE_TEST_CASE(SharedSubscriptionTest, SubscriptionsContainerTests)
+{
+    TUiSubscription subscription;
+    subscription.SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+    const auto key = SubscriptionKey::Make(subscription);
+
+    BOOST_CHECK(!Container.ShareSubscription(Request2, key));
+    auto actor = MakeActor(Request1, 1);
+    BOOST_CHECK(Container.EmplaceSharedSubscription(actor, key));
+    BOOST_CHECK(!Container.ShareSubscription(Request1, key));
+
+    auto expectedResult = GenerateResult();
+    BOOST_TEST_CONTEXT("Attached before result")
+    {
+        BOOST_CHECK(Container.ShareSubscription(Request2, key));
+
+        EXPECT_CALL(*actor, Process()).WillOnce(Invoke([&]()
+        {
+            actor->Get().State = Actor::TState::Ok;
+            actor->Get().Result = expectedResult;
+            return true;
+        }));
+        auto result = Container.ProcessNextSubscription<DummyTableItem>(1);
+        BOOST_CHECK(result.Processed);
+        BOOST_REQUIRE(result.SubscriptionId);
+        BOOST_CHECK_EQUAL(*result.SubscriptionId, Request1);
+        CompareUiRequests(result.SharedSubscriptionIds, Basis::Vector<TUiRequestId> {{ Request2 }});
+        BOOST_CHECK_EQUAL(expectedResult, result.Result);
+    }
+
+    BOOST_TEST_CONTEXT("Attached after result")
+    {
+        /// Готовый результат отправляется без повторной обработки.
+        BOOST_CHECK(Container.ShareSubscription(Request3, key));
+        auto result = Container.ProcessNextSubscription<DummyTableItem>(1);
+        BOOST_CHECK(result.Processed);
+        BOOST_REQUIRE(result.SubscriptionId);
+        BOOST_CHECK_EQUAL(*result.SubscriptionId, Request3);
+        BOOST_CHECK(result.SharedSubscriptionIds.empty());
+        BOOST_CHECK_EQUAL(expectedResult, result.Result);
+        ProcessEmpty(1);
+    }
+
+    BOOST_TEST_CONTEXT("Owner unsubscribed")
+    {
+        Container.EraseSubscription(Request1);
+        CheckVersion(1);
+        Container.EraseSubscription(Request2);
+        CheckVersion(1);
+        Container.EraseSubscription(Request3);
+        BOOST_CHECK(!Container.GetOldestVersion());
+        BOOST_CHECK(!Container.ShareSubscription(Request4, key));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(ModifySharedSubscriptionTest, SubscriptionsContainerTests)
+{
+    TUiSubscription subscription;
+    subscription.SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+    const auto key = SubscriptionKey::Make(subscription);
+    TUiSubscription modified;
+    modified.SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Value));
+    const auto modifiedKey = SubscriptionKey::Make(modified);
+
+    auto actor = MakeActor(Request1, 1);
+    BOOST_CHECK(Container.EmplaceSharedSubscription(actor, key));
+
+    /// Обработчик без присоединенных подписок меняется на месте и присоединяет подписки по новому ключу.
+    BOOST_CHECK(Container.ModifySubscription(Request1, modified));
+    BOOST_CHECK(!Container.ShareSubscription(Request2, key));
+    BOOST_CHECK(Container.ShareSubscription(Request2, modifiedKey));
+
+    /// Обработчик с присоединенной подпиской не меняется.
+    BOOST_CHECK(!Container.ModifySubscription(Request1, subscription));
+    BOOST_CHECK(Container.ShareSubscription(Request3, modifiedKey));
+
+    Container.EraseSubscription(Request2);
+    Container.EraseSubscription(Request3);
+    Container.EraseSubscription(Request1);
+    BOOST_CHECK(!Container.ShareSubscription(Request4, modifiedKey));
+}
+
+BOOST_FIXTURE_TEST_CASE(TransferOwnershipTest, SubscriptionsContainerTests)
+{
+    TUiSubscription subscription;
+    subscription.SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+    const auto key = SubscriptionKey::Make(subscription);
+
+    auto actor = MakeActor(Request1, 1);
+    BOOST_CHECK(Container.EmplaceSharedSubscription(actor, key));
+    BOOST_CHECK(!Container.TransferOwnership(Request1));
+    BOOST_CHECK(Container.ShareSubscription(Request2, key));
+    BOOST_CHECK(Container.ShareSubscription(Request3, key));
+
+    EXPECT_CALL(*actor, Process()).WillOnce(Invoke([&]()
+    {
+        actor->Get().State = Actor::TState::Ok;
+        actor->Get().Result = GenerateResult();
+        return true;
+    }));
+    BOOST_CHECK(Container.ProcessNextSubscription<DummyTableItem>(1).Processed);
+
+    /// Обработчик с присоединенными подписками не меняется на месте, а передается первой из них.
+    BOOST_CHECK(!Container.ModifySubscription(Request1, TUiSubscription {}));
+    BOOST_CHECK(Container.TransferOwnership(Request1));
+    BOOST_CHECK_EQUAL(actor->Get().RequestId, Request2);
+    BOOST_CHECK(!Container.TransferOwnership(Request1));
+
+    BOOST_TEST_CONTEXT("Request id reused")
+    {
+        auto modified = MakeActor(Request1, 1);
+        BOOST_CHECK(Container.EmplaceSubscription(modified));
+        EXPECT_CALL(*modified, Process()).WillOnce(Invoke([&]()
+        {
+            modified->Get().State = Actor::TState::Ok;
+            modified->Get().Result = GenerateResult();
+            return true;
+        }));
+        auto result = Container.ProcessNextSubscription<DummyTableItem>(1);
+        BOOST_CHECK(result.Processed);
+        BOOST_REQUIRE(result.SubscriptionId);
+        BOOST_CHECK_EQUAL(*result.SubscriptionId, Request1);
+        BOOST_CHECK(result.SharedSubscriptionIds.empty());
+        ProcessEmpty(1);
+    }
+
+    BOOST_TEST_CONTEXT("New owner unsubscribed")
+    {
+        /// Ключ по-прежнему присоединяет подписки к переданному обработчику.
+        BOOST_CHECK(Container.ShareSubscription(Request4, key));
+        Container.EraseSubscription(Request2);
+        Container.EraseSubscription(Request3);
+        Container.EraseSubscription(Request4);
+        BOOST_CHECK(!Container.ShareSubscription(Request5, key));
+        Container.EraseSubscription(Request1);
+        BOOST_CHECK(!Container.GetOldestVersion());
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(SkipUnaffectedSubscriptionsTest, SubscriptionsContainerTests)
+{
+    SubscriptionsContainer<TRoutedSubscriptionsContainerSetup> container(Tracer);
+
+    const auto makeSubscription = [](const std::string& aValue)
+    {
+        ValueSet values;
+        values.StringValues = { aValue };
+        TUiSubscription result;
+        result.FilterExpression.Relation = FilterRelation::And;
+        result.FilterExpression.Filters.insert(TUiFilter {
+            static_cast<TColumnType>(DummyColumnType::Value), values, FilterOperator::In, false });
+        return result;
+    };
+
+    auto affected = MakeActor(Request1, 1);
+    affected->Get().Subscription = makeSubscription("A");
+    affected->Get().State = Actor::TState::Ok;
+    auto unaffected = MakeActor(Request2, 1);
+    unaffected->Get().Subscription = makeSubscription("B");
+    unaffected->Get().State = Actor::TState::Ok;
+    BOOST_CHECK(container.EmplaceSubscription(affected));
+    BOOST_CHECK(container.EmplaceSubscription(unaffected));
+
+    using TDelta = VersionDelta<DummyTableItem>;
+    auto delta = std::make_shared<TDelta>();
+    delta->Added.push_back(Basis::MakeSPtr<DummyTableItem>(1, "A"));
+    container.AddVersionDelta(2, std::shared_ptr<const TDelta>(delta));
+
+    auto affectedPtr = affected.get();
+    EXPECT_CALL(*affectedPtr, IncreaseVersion()).WillOnce(Invoke([affectedPtr]()
+    {
+        ++affectedPtr->Get().DataVersion;
+        affectedPtr->Get().State = Actor::TState::Updating;
+    }));
+    auto unaffectedPtr = unaffected.get();
+    EXPECT_CALL(*unaffectedPtr, IncreaseVersion()).Times(0);
+    EXPECT_CALL(*unaffectedPtr, SkipVersion()).WillOnce(Invoke([unaffectedPtr]()
+    {
+        ++unaffectedPtr->Get().DataVersion;
+    }));
+
+    BOOST_CHECK(container.UpdateSubscriptions(2));
+    BOOST_CHECK_EQUAL(unaffected->Get().DataVersion, 2);
+    BOOST_CHECK(unaffected->Get().IsOk());
+    /// Подписка, уже перешедшая на текущую версию, больше не обновляется.
+    BOOST_CHECK(container.UpdateSubscriptions(2));
+}
+
+BOOST_FIXTURE_TEST_CASE(KeepVersionsOfCoalescedIncrementTest, SubscriptionsContainerTests)
+{
+    SubscriptionsContainer<TCoalescingSubscriptionsContainerSetup> container(Tracer);
+
+    auto behind = MakeActor(Request1, 1);
+    behind->Get().State = Actor::TState::Ok;
+    auto current = MakeActor(Request2, 4);
+    current->Get().State = Actor::TState::Ok;
+    BOOST_CHECK(container.EmplaceSubscription(behind));
+    BOOST_CHECK(container.EmplaceSubscription(current));
+
+    auto behindPtr = behind.get();
+    EXPECT_CALL(*behindPtr, JumpToVersion(Eq(4))).WillOnce(Invoke([behindPtr](TDataVersion aVersion)
+    {
+        behindPtr->Get().OldestReadVersion = behindPtr->Get().DataVersion + 1;
+        behindPtr->Get().DataVersion = aVersion;
+        behindPtr->Get().State = Actor::TState::Updating;
+    }));
+    BOOST_CHECK(container.UpdateSubscriptions(4));
+    BOOST_CHECK_EQUAL(behind->Get().DataVersion, 4);
+
+    /// Инкремент за версии 2-4 еще не применен: строки, перезаписанные версиями 2 и 3, нужны ему.
+    auto version = container.GetOldestVersion();
+    BOOST_REQUIRE(version);
+    BOOST_CHECK_EQUAL(*version, 2);
+
+    EXPECT_CALL(*behindPtr, Process()).WillOnce(Invoke([behindPtr]()
+    {
+        behindPtr->Get().OldestReadVersion.reset();
+        behindPtr->Get().State = Actor::TState::Ok;
+        behindPtr->Get().Result = Basis::MakeSPtr<Basis::Pack<DummyTableItem>>();
+        return true;
+    }));
+    BOOST_CHECK(container.ProcessNextSubscription<DummyTableItem>(4).Processed);
+
+    version = container.GetOldestVersion();
+    BOOST_REQUIRE(version);
+    BOOST_CHECK_EQUAL(*version, 4);
+}
+
+BOOST_FIXTURE_TEST_CASE(ScheduleIncrementsBeforeSnapshotsTest, SubscriptionsContainerTests)
+{
+    SubscriptionsContainer<TScheduledSubscriptionsContainerSetup> container(Tracer);
+
+    auto update = MakeActor(Request1, 1);
+    auto snapshot = MakeActor(Request2, 1);
+    BOOST_CHECK(container.EmplaceSubscription(update));
+    BOOST_CHECK(container.EmplaceSubscription(snapshot));
+
+    EXPECT_CALL(*update, Process()).WillOnce(Invoke([&]()
+    {
+        update->Get().State = Actor::TState::Ok;
+        update->Get().Result = GenerateResult();
+        return true;
+    }));
+    BOOST_CHECK(container.ProcessNextSubscription<DummyTableItem>(1).Processed);
+
+    EXPECT_CALL(*update, IncreaseVersion()).WillOnce(Invoke([&]()
+    {
+        ++update->Get().DataVersion;
+        update->Get().State = Actor::TState::Updating;
+    }));
+    BOOST_CHECK(container.UpdateSubscriptions(2));
+
+    Basis::Vector<TUiRequestId> processed;
+    for (const auto& actor : { update, snapshot })
+    {
+        EXPECT_CALL(*actor, Process()).WillRepeatedly(Invoke([&processed, actorPtr = actor.get()]()
+        {
+            actorPtr->Get().ProcessedRows += 10;
+            processed.push_back(actorPtr->Get().RequestId);
+            return true;
+        }));
+    }
+    for (size_t i = 0; i < 10; ++i)
+    {
+        BOOST_CHECK(container.ProcessNextSubscription<DummyTableItem>(2).Processed);
+    }
+
+    /// Квота обновления - четыре вызова по 10 строк, снапшота - один.
+    const Basis::Vector<TUiRequestId> expected
+    {{
+        Request1, Request1, Request1, Request1, Request2,
+        Request1, Request1, Request1, Request1, Request2
+    }};
+    BOOST_CHECK_EQUAL_COLLECTIONS(processed.cbegin(), processed.cend(), expected.cbegin(), expected.cend());
+}
+
+BOOST_FIXTURE_TEST_CASE(ScheduleModifiedSubscriptionAsSnapshotTest, SubscriptionsContainerTests)
+{
+    SubscriptionsContainer<TScheduledSubscriptionsContainerSetup> container(Tracer);
+
+    auto modified = MakeActor(Request1, 1);
+    auto snapshot = MakeActor(Request2, 1);
+    BOOST_CHECK(container.EmplaceSubscription(modified));
+    BOOST_CHECK(container.EmplaceSubscription(snapshot));
+
+    EXPECT_CALL(*modified, Process()).WillOnce(Invoke([&]()
+    {
+        modified->Get().State = Actor::TState::Ok;
+        modified->Get().Result = GenerateResult();
+        return true;
+    }));
+    BOOST_CHECK(container.ProcessNextSubscription<DummyTableItem>(1).Processed);
+
+    /// Измененная подписка строит результат заново и делит квоту с другими первыми результатами.
+    BOOST_CHECK(container.ModifySubscription(Request1, TUiSubscription {}));
+
+    Basis::Vector<TUiRequestId> processed;
+    for (const auto& actor : { modified, snapshot })
+    {
+        EXPECT_CALL(*actor, Process()).WillRepeatedly(Invoke([&processed, actorPtr = actor.get()]()
+        {
+            actorPtr->Get().ProcessedRows += 10;
+            processed.push_back(actorPtr->Get().RequestId);
+            return true;
+        }));
+    }
+    for (size_t i = 0; i < 4; ++i)
+    {
+        BOOST_CHECK(container.ProcessNextSubscription<DummyTableItem>(1).Processed);
+    }
+
+    const Basis::Vector<TUiRequestId> expected {{ Request2, Request1, Request2, Request1 }};
+    BOOST_CHECK_EQUAL_COLLECTIONS(processed.cbegin(), processed.cend(), expected.cbegin(), expected.cend());
+}
+
+BOOST_FIXTURE_TEST_CASE(ProcessSubscriptionsInParallelTest, SubscriptionsContainerTests)
+{
+    SubscriptionsContainer<TParallelSubscriptionsContainerSetup> container(Tracer);
+    container.SetWorkerPool(std::make_shared<WorkerPool>(2));
+
+    const Basis::Vector<TUiRequestId> requests {{ Request1, Request2, Request3, Request4 }};
+    TActorPack actors;
+    for (const auto& request : requests)
+    {
+        auto actor = MakeActor(request, 1);
+        /// Process вызывается из потоков пула, результат готовится заранее.
+        EXPECT_CALL(*actor, Process()).WillOnce(Invoke([actorPtr = actor.get(), result = GenerateResult()]()
+        {
+            actorPtr->Get().State = Actor::TState::Ok;
+            actorPtr->Get().Result = result;
+            return true;
+        }));
+        BOOST_CHECK(container.EmplaceSubscription(actor));
+        actors.push_back(actor);
+    }
+
+    /// Первая пачка - три подписки, результаты отдаются по одному.
+    Basis::Vector<TUiRequestId> completed;
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        const auto result = container.ProcessNextSubscription<DummyTableItem>(1);
+        BOOST_CHECK(result.Processed);
+        BOOST_REQUIRE(result.IsOk());
+        completed.push_back(*result.SubscriptionId);
+    }
+    BOOST_CHECK_EQUAL_COLLECTIONS(completed.cbegin(), completed.cend(), requests.cbegin(), requests.cend());
+    BOOST_CHECK(!container.ProcessNextSubscription<DummyTableItem>(1).Processed);
+}
+
+BOOST_FIXTURE_TEST_CASE(EraseSubscriptionWithParallelResultTest, SubscriptionsContainerTests)
+{
+    SubscriptionsContainer<TParallelSubscriptionsContainerSetup> container(Tracer);
+    container.SetWorkerPool(std::make_shared<WorkerPool>(2));
+
+    TActorPack actors;
+    for (const auto& request : { Request1, Request2, Request3 })
+    {
+        auto actor = MakeActor(request, 1);
+        EXPECT_CALL(*actor, Process()).WillOnce(Invoke([actorPtr = actor.get(), result = GenerateResult()]()
+        {
+            actorPtr->Get().State = Actor::TState::Ok;
+            actorPtr->Get().Result = result;
+            return true;
+        }));
+        BOOST_CHECK(container.EmplaceSubscription(actor));
+        actors.push_back(actor);
+    }
+
+    auto result = container.ProcessNextSubscription<DummyTableItem>(1);
+    BOOST_CHECK(result.Processed);
+    BOOST_CHECK(*result.SubscriptionId == Request1);
+    /// Посчитанный результат отписавшейся подписки не отдается.
+    container.EraseSubscription(Request2);
+    result = container.ProcessNextSubscription<DummyTableItem>(1);
+    BOOST_CHECK(result.Processed);
+    BOOST_CHECK(*result.SubscriptionId == Request3);
+    BOOST_CHECK(!container.ProcessNextSubscription<DummyTableItem>(1).Processed);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
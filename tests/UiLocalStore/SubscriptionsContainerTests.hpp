@@ -20,6 +20,7 @@ namespace NTPro::Ecn::NewUiServer
 
 struct Actor : public Basis::GMock
 {
+    using TData = DummyTableItem;
     using TUiSubscription = TradingSerialization::Table::SubscribeBase;
     using TUiRequestId = TUiSubscription::TId;
 
@@ -27,8 +28,10 @@ struct Actor : public Basis::GMock
     using TEvent = ISubscriptionStateMachine::TableEvent;
 
     const auto& GetRequestId() const { return RequestId; }
+    void SetRequestId(const TUiRequestId& aRequestId) { RequestId = aRequestId; }
     TDataVersion GetVersion() const { return DataVersion; }
     Basis::SPtrPack<DummyTableItem> GetResult() const { return Result; }
+    const TUiSubscription& GetSubscription() const { return Subscription; }
     bool IsOk() const { return State == TState::Ok; }
     bool IsError() const { return State == TState::Error; }
 
@@ -57,6 +60,23 @@ struct Actor : public Basis::GMock
         return ISubscriptionActor::ResultState::FinalResult;
     }
 
+    size_t GetProcessedRows() const
+    {
+        return ProcessedRows;
+    }
+
+    TDataVersion GetOldestReadVersion() const
+    {
+        return OldestReadVersion.value_or(DataVersion);
+    }
+
+    bool Modify(const TUiSubscription& aSubscription)
+    {
+        Subscription = aSubscription;
+        State = TState::Initializing;
+        return true;
+    }
+
     Actor() = default;
     Actor(
         TUiRequestId aRequestId,
@@ -73,8 +93,12 @@ struct Actor : public Basis::GMock
 
     TUiRequestId RequestId;
     TDataVersion DataVersion{0};
+    /// Версия, с которой строится еще не примененный инкремент.
+    std::optional<TDataVersion> OldestReadVersion;
+    TUiSubscription Subscription;
     Basis::SPtrPack<DummyTableItem> Result;
     TState State = TState::Initializing;
+    size_t ProcessedRows = 0;
 };
 
 }
@@ -406,5 +406,52 @@ BOOST_FIXTURE_TEST_CASE(PartMergeTest, TableIncrementApplicatorTests)
         8);
 }
 
+BOOST_FIXTURE_TEST_CASE(SpliceUnchangedRunsTest, TableIncrementApplicatorTests)
+{
+    static constexpr int ItemsCount = 10'000;
+    static constexpr int PartSize = 1'000;
+
+    Basis::Vector<int> old;
+    for (int i = 0; i < ItemsCount; ++i)
+    {
+        old.push_back(2 * i);
+    }
+    const Basis::Vector<int> deleted { 0, 2'000, 19'998 };
+    const Basis::Vector<int> added { 1, 3'001, 3'003, 19'999 };
+
+    for (const bool shared : { false, true })
+    {
+        BOOST_TEST_CONTEXT("Shared old snapshot: " << shared)
+        {
+            FillOldSnapshot(old, "Value1");
+            FillDeletedIncrement(deleted, "Value1");
+            FillAddedIncrement(added, "Value2");
+            NewSnapshot.clear();
+            const auto holder = shared ? OldSnapshot : TSPtrDataPack {};
+
+            auto applicator = MakeIncrementApplicator<PartSize>();
+            int calls = 0;
+            while (applicator.Process() == TableIncrementApplicatorState::Processing)
+            {
+                ++calls;
+            }
+            BOOST_CHECK_EQUAL(TableIncrementApplicatorState::Completed, applicator.GetState());
+            /// Ограничение на вызов считается в элементах, как и при поэлементном слиянии.
+            BOOST_CHECK_EQUAL(calls, (ItemsCount + static_cast<int>(added.size())) / PartSize);
+
+            BOOST_REQUIRE_EQUAL(NewSnapshot.size(), ItemsCount - deleted.size() + added.size());
+            for (size_t i = 1; i < NewSnapshot.size(); ++i)
+            {
+                BOOST_REQUIRE_LT(NewSnapshot[i - 1]->GetId(), NewSnapshot[i]->GetId());
+            }
+            BOOST_CHECK_EQUAL(NewSnapshot[0]->GetId(), 1);
+            BOOST_CHECK_EQUAL(NewSnapshot.back()->GetId(), 19'999);
+
+            /// Старый снапшот, которым владеет кто-то ещё, не меняется.
+            BOOST_CHECK_EQUAL(static_cast<bool>((*OldSnapshot)[1]), shared);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
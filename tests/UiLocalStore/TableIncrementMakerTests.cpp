@@ -156,6 +156,7 @@ struct TableIncrementMakerTests : public BaseTestFixture
             BOOST_CHECK_EQUAL(&aInit.Map, &Increment);
             BOOST_CHECK_EQUAL(aInit.FilterExpression, FilterExpression);
             BOOST_CHECK_EQUAL(aInit.Version, 1);
+            BOOST_CHECK_EQUAL(aInit.FromVersion, 1);
             BOOST_REQUIRE(aInit.IncrementAction);
             BOOST_CHECK_EQUAL(*aInit.IncrementAction, Model::ActionType::Delete);
 
@@ -170,6 +171,7 @@ struct TableIncrementMakerTests : public BaseTestFixture
             BOOST_CHECK_EQUAL(&aInit.Map, &Increment);
             BOOST_CHECK_EQUAL(aInit.FilterExpression, FilterExpression);
             BOOST_CHECK_EQUAL(aInit.Version, 1);
+            BOOST_CHECK_EQUAL(aInit.FromVersion, 1);
             BOOST_REQUIRE(aInit.IncrementAction);
             BOOST_CHECK_EQUAL(*aInit.IncrementAction, Model::ActionType::New);
 
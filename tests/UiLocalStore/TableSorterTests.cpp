@@ -1,5 +1,6 @@
 #include "DummyTableData.hpp"
 
+#include "UiLocalStore/SortBufferPool.hpp"
 #include "UiLocalStore/TableSorter.hpp"
 #include "TradingSerialization/Table/Columns.hpp"
 
@@ -25,6 +26,12 @@ struct TSorterSetup
     using TTableSetup = DummyTableSetup;
 };
 
+template <int _MaxCount>
+struct TRadixSorterSetup : public TSorterSetup<_MaxCount>
+{
+    static constexpr bool UseRadixSort = true;
+};
+
 struct TableSorterTests : public BaseTestFixture
 {
     using TSetup = DummyTableSetup;
@@ -235,6 +242,88 @@ BOOST_FIXTURE_TEST_CASE(TestReset, TableSorterTests)
     TestSortInternal(4, sorter);
 }
 
+BOOST_FIXTURE_TEST_CASE(TmpBufferTest, TableSorterTests)
+{
+    /// Буфер из пула не перевыделяется: сортировальщик заполняет его при слиянии.
+    SortBufferPool<DummyTableItem> pool;
+    FillRandomDataAndExpectedResult(4 * 500);
+    TmpBuf = pool.Acquire(Data.size());
+    const auto* poolData = TmpBuf.data();
+    auto sorter = MakeSorter<500>();
+    TestSortInternal(4, sorter);
+    BOOST_CHECK(Data.data() == poolData || TmpBuf.data() == poolData);
+    BOOST_CHECK_EQUAL(TmpBuf.size(), Data.size());
+
+    /// Старые элементы временного буфера не попадают в результат.
+    TmpBuf.assign(3 * 500, Basis::MakeSPtr<DummyTableItem>(-1));
+    sorter.Reset();
+    FillRandomDataAndExpectedResult(2 * 500 + 99);
+    Init(sorter, TableSorterState::PartSort);
+    TestSortInternal(3, sorter);
+}
+
+BOOST_FIXTURE_TEST_CASE(RadixSortTest, TableSorterTests)
+{
+    static constexpr int PartSize = 100;
+    using TSorter = TableSorter<TRadixSorterSetup<PartSize>>;
+
+    /// Уникальные id разных знаков и порядков.
+    Data.clear();
+    for (int64_t i = -500; i < 500; ++i)
+    {
+        Data.push_back(Basis::MakeSPtr<DummyTableItem>(i * 1'000'003));
+    }
+    std::random_shuffle(Data.begin(), Data.end());
+    PrepareExpectedData();
+
+    TSorter sorter(Tracer);
+    Init(sorter, TableSorterState::KeyExtraction);
+
+    const auto partsCount = static_cast<int>(Data.size()) / PartSize;
+    for (int i = 0; i < partsCount - 1; ++i)
+    {
+        BOOST_CHECK_EQUAL(TableSorterState::KeyExtraction, sorter.Process());
+    }
+    BOOST_CHECK_EQUAL(TableSorterState::RadixSort, sorter.Process());
+
+    auto state = sorter.Process();
+    while (state == TableSorterState::RadixSort)
+    {
+        state = sorter.Process();
+    }
+    for (int i = 0; i < partsCount; ++i)
+    {
+        BOOST_CHECK_EQUAL(TableSorterState::Permutation, state);
+        state = sorter.Process();
+    }
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, state);
+    CheckResult();
+
+    BOOST_CHECK_EQUAL(TableSorterState::Error, sorter.Process());
+}
+
+BOOST_FIXTURE_TEST_CASE(RadixSortFallbackTest, TableSorterTests)
+{
+    using TSorter = TableSorter<TRadixSorterSetup<500>>;
+
+    /// Небольшой массив сортируется сравнением.
+    FillRandomDataAndExpectedResult(250);
+    {
+        TSorter sorter(Tracer);
+        Init(sorter, TableSorterState::PartSort);
+        BOOST_CHECK_EQUAL(TableSorterState::Completed, sorter.Process());
+    }
+
+    /// Строковая колонка в порядке сортировки.
+    FillRandomDataAndExpectedResult(1000);
+    SortOrder.insert(SortOrder.begin(), static_cast<TColumnType>(DummyColumnType::Value));
+    {
+        TSorter sorter(Tracer);
+        Init(sorter, TableSorterState::PartSort);
+        TestSortInternal(2, sorter);
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(LoadTest, TableSorterTests)
 {
     static constexpr int  PartSize = 500;
@@ -5,6 +5,9 @@
 #include "UiLocalStore/TableFilterman.hpp"
 #include "UiLocalStore/TableIncrementApplicator.hpp"
 #include "UiLocalStore/TableIncrementMaker.hpp"
+#include "UiLocalStore/RankedSnapshot.hpp"
+#include "UiLocalStore/ColumnarSnapshot.hpp"
+#include "UiLocalStore/MultiIndexContainer.hpp"
 #include "TradingSerialization/Table/Columns.hpp"
 
 
@@ -78,6 +81,55 @@ struct TSubscriptionActorSetup
     using TSubscriptionStateMachine = Basis::GMock;
 };
 
+struct TRankedSubscriptionActorSetup : public TSubscriptionActorSetup
+{
+    using TRankedSnapshot = RankedSnapshot<TApplicatorSetup>;
+};
+
+using TDummyColumnarSnapshot = ColumnarSnapshot<DummyTableSetup, DummyTableItem>;
+
+struct TColumnarContainerSetup : public DummyMultiIndexContainerSetup
+{
+    using TColumnarSnapshot = TDummyColumnarSnapshot;
+};
+
+class DummyColumnarMultiIndex : public BaseMultiIndexContainer<
+    DummyColumnarMultiIndex,
+    TColumnarContainerSetup,
+    TColumnarContainerSetup::ByValue>
+{
+public:
+    DummyColumnarMultiIndex(Basis::Tracer& aTracer)
+        : BaseMultiIndexContainer(aTracer)
+    {}
+};
+
+struct TColumnarRangesSetup
+{
+    using TData = DummyTableItem;
+    using TColumnarSnapshot = TDummyColumnarSnapshot;
+};
+
+using TDummyColumnarRanges = ColumnarRanges<TColumnarRangesSetup>;
+
+struct TColumnarMakerSetup : public TMakerSetup
+{
+    using TTableIndexFiltermanInit = TableFilterman<TFiltermanSetup, TDummyColumnarRanges>::TInit;
+    using TIndexedDataRangesInit = TDummyColumnarRanges::TInit;
+    using TMap = DummyColumnarMultiIndex;
+};
+
+struct TColumnarSubscriptionActorSetup : public TSubscriptionActorSetup
+{
+    using TMap = DummyColumnarMultiIndex;
+
+    using TTableIndexFilterman = TableFilterman<TFiltermanSetup, TDummyColumnarRanges>;
+    using TTableIndexFiltermanInit = TableFilterman<TFiltermanSetup, TDummyColumnarRanges>::TInit;
+    using TTableIncrementMakerInit = TableIncrementMaker<TColumnarMakerSetup>::TInit;
+    using TIndexedDataRanges = TDummyColumnarRanges;
+    using TIndexedDataRangesInit = TDummyColumnarRanges::TInit;
+};
+
 struct TableSubscriptionActorTests : public BaseTestFixture
 {
     using TSortOrder = TradingSerialization::Table::TSortOrder;
@@ -398,5 +450,277 @@ BOOST_FIXTURE_TEST_CASE(ProcessFailedIncrementApplying, TableSubscriptionActorTe
 }
 
 
+struct RankedTableSubscriptionActorTests : public BaseTestFixture
+{
+    using TDataPack = Basis::Pack<DummyTableItem>;
+    using TUiSubscription = TradingSerialization::Table::SubscribeBase;
+    using TSubscriptionActor = TableSubscriptionActor<TRankedSubscriptionActorSetup>;
+    using TMap = typename TSubscriptionActor::TMap;
+
+    TUiSubscription UiSubscription;
+
+    Basis::Tracer& Tracer;
+
+    TMap RawData;
+
+    TDataVersion Version = 50;
+    TUiSubscription::TId RequestId {
+        Basis::UniqueIdGenerator<TUiSubscription::TId> {}.GetNext() };
+
+    TSubscriptionActor Actor;
+
+    RankedTableSubscriptionActorTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+        , RawData(Tracer)
+        , Actor(
+            Tracer,
+            RequestId,
+            InitUiSubscription(),
+            RawData,
+            Version)
+    {
+    }
+
+    const TUiSubscription& InitUiSubscription()
+    {
+        UiSubscription.SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+        return UiSubscription;
+    }
+
+    static TDataPack MakePack(const Basis::Vector<int>& aIds, const std::string& aValue = "Value")
+    {
+        TDataPack result;
+        for (const auto id : aIds)
+        {
+            result.push_back(Basis::MakeSPtr<DummyTableItem>(id, aValue));
+        }
+        return result;
+    }
+
+    static Basis::Vector<int64_t> GetIds(const TSubscriptionActor::TCompletedResult& aResult)
+    {
+        Basis::Vector<int64_t> ids;
+        for (const auto& item : *aResult)
+        {
+            ids.push_back(item->GetId());
+        }
+        return ids;
+    }
+
+    void PreprocessCheckState(TSubscriptionActor::TState aState)
+    {
+        EXPECT_CALL(Actor.State, GetProcessingState())
+            .WillOnce(Return(ISubscriptionStateMachine::ProcessingState::Processing));
+        EXPECT_CALL(Actor.State, GetState())
+            .WillOnce(Return(aState));
+    }
+
+    /// Подписка фильтрует и сортирует строки aSorted.
+    void CompleteSorting(const Basis::Vector<int>& aSorted)
+    {
+        PreprocessCheckState(TSubscriptionActor::TState::Initializing);
+        EXPECT_CALL(Actor.Ranges, Init<DummyTableItemIndexRangesInit>(_)).WillOnce(Return(true));
+        EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::Initialized)));
+        BOOST_REQUIRE(Actor.Process());
+
+        PreprocessCheckState(TSubscriptionActor::TState::Filtration);
+        EXPECT_CALL(Actor.Filterman, IsInitialized()).WillOnce(Return(false));
+        EXPECT_CALL(Actor.Filterman, Init<TSubscriptionActorSetup::TTableIndexFiltermanInit>(_))
+             .WillOnce(Invoke([=](const TSubscriptionActorSetup::TTableIndexFiltermanInit& aInit)
+        {
+            aInit.Result = MakePack(aSorted);
+        }));
+        EXPECT_CALL(Actor.Filterman, Process()).WillOnce(Return(TableFiltermanState::Completed));
+        EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::FiltrationCompleted)));
+        EXPECT_CALL(Actor.Filterman, Reset());
+        BOOST_REQUIRE(Actor.Process());
+
+        PreprocessCheckState(TSubscriptionActor::TState::Sorting);
+        EXPECT_CALL(Actor.Sorter, IsInitialized()).WillOnce(Return(true));
+        EXPECT_CALL(Actor.Sorter, Process()).WillOnce(Return(TableSorterState::Completed));
+        EXPECT_CALL(Actor.Sorter, Reset());
+        EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::SortingCompleted)));
+        EXPECT_CALL(Actor.Ranges, Reset());
+        BOOST_REQUIRE(Actor.Process());
+    }
+
+    /// Подписка применяет инкремент к дереву.
+    void ApplyIncrement(const Basis::Vector<int>& aDeleted, const Basis::Vector<int>& aAdded)
+    {
+        PreprocessCheckState(TSubscriptionActor::TState::Updating);
+        EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::RawDataUpdated)));
+        BOOST_REQUIRE(Actor.Process());
+
+        PreprocessCheckState(TSubscriptionActor::TState::IncrementMaking);
+        EXPECT_CALL(Actor.IncrementMaker, IsInitialized()).WillOnce(Return(false));
+        EXPECT_CALL(Actor.IncrementMaker, Init<TSubscriptionActorSetup::TTableIncrementMakerInit>(_))
+             .WillOnce(Invoke([=](const TSubscriptionActorSetup::TTableIncrementMakerInit& aInit)
+        {
+            aInit.Deleted = MakePack(aDeleted);
+            aInit.Added = MakePack(aAdded, "Added");
+        }));
+        EXPECT_CALL(Actor.IncrementMaker, Process()).WillOnce(Return(TableIncrementMakerState::Completed));
+        EXPECT_CALL(Actor.IncrementMaker, Reset());
+        EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::IncrementMade)));
+        BOOST_REQUIRE(Actor.Process());
+
+        /// Применитель инкремента не используется.
+        PreprocessCheckState(TSubscriptionActor::TState::IncrementApplying);
+        EXPECT_CALL(Actor.IncrementApplicator, Init<TSubscriptionActorSetup::TTableIncrementApplicatorInit>(_)).Times(0);
+        EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::IncrementApplied)));
+        BOOST_REQUIRE(Actor.Process());
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(RankedIncrementIsAppliedToTree, RankedTableSubscriptionActorTests)
+{
+    CompleteSorting({ 10, 20, 30, 40, 50 });
+    ApplyIncrement({ 20 }, { 25, 40, 60 });
+
+    EXPECT_CALL(Actor.State, GetState())
+        .WillRepeatedly(Return(TSubscriptionActor::TState::Ok));
+    BOOST_CHECK(!Actor.IsRowWindowRequested());
+    BOOST_CHECK_EQUAL(Actor.GetResultSize(), 6u);
+    const auto result = Actor.GetResult();
+    BOOST_CHECK((GetIds(result) == Basis::Vector<int64_t> { 10, 25, 30, 40, 50, 60 }));
+    /// Равный по порядку сортировки элемент заменен добавленным.
+    BOOST_CHECK_EQUAL((*result)[3]->Value, "Added");
+    /// Результат не пересобирается повторно.
+    BOOST_CHECK_EQUAL(Actor.GetResult(), result);
+}
+
+BOOST_FIXTURE_TEST_CASE(RankedRowWindowIsSentWithoutProcessing, RankedTableSubscriptionActorTests)
+{
+    CompleteSorting({ 10, 20, 30, 40, 50 });
+
+    RowRange rows;
+    rows.Top = 1;
+    rows.Bottom = 2;
+    EXPECT_CALL(Actor.State, GetState())
+        .WillOnce(Return(TSubscriptionActor::TState::Ok));
+    EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::RowWindowChanged)));
+    BOOST_CHECK(Actor.SetRowWindow(rows));
+    BOOST_CHECK(Actor.IsRowWindowRequested());
+
+    /// Строки окна отправляются без сортировки.
+    PreprocessCheckState(TSubscriptionActor::TState::Sorting);
+    EXPECT_CALL(Actor.Sorter, IsInitialized()).Times(0);
+    EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::SortingCompleted)));
+    BOOST_CHECK(Actor.Process());
+
+    ApplyIncrement({ 20 }, { 15 });
+
+    EXPECT_CALL(Actor.State, GetState())
+        .WillRepeatedly(Return(TSubscriptionActor::TState::Ok));
+    BOOST_CHECK((GetIds(Actor.GetRowWindowResult()) == Basis::Vector<int64_t> { 15, 30 }));
+    BOOST_CHECK_EQUAL(Actor.GetResultSize(), 5u);
+}
+
+BOOST_FIXTURE_TEST_CASE(RankedRowWindowBeforeResult, RankedTableSubscriptionActorTests)
+{
+    RowRange rows;
+    rows.Top = 0;
+    rows.Bottom = 9;
+    EXPECT_CALL(Actor.State, GetState())
+        .WillOnce(Return(TSubscriptionActor::TState::Initializing));
+    BOOST_CHECK(!Actor.SetRowWindow(rows));
+    BOOST_CHECK(Actor.IsRowWindowRequested());
+
+    rows.Bottom = -1;
+    BOOST_CHECK(!Actor.SetRowWindow(rows));
+}
+
+struct ColumnarTableSubscriptionActorTests : public BaseTestFixture
+{
+    using TUiFilter = TradingSerialization::Table::Filter;
+    using TUiSubscription = TradingSerialization::Table::SubscribeBase;
+    using TSubscriptionActor = TableSubscriptionActor<TColumnarSubscriptionActorSetup>;
+    using TMap = typename TSubscriptionActor::TMap;
+
+    TUiSubscription UiSubscription;
+
+    Basis::Tracer& Tracer;
+
+    TMap RawData;
+
+    TDataVersion Version = 50;
+    TUiSubscription::TId RequestId {
+        Basis::UniqueIdGenerator<TUiSubscription::TId> {}.GetNext() };
+
+    TSubscriptionActor Actor;
+
+    ColumnarTableSubscriptionActorTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+        , RawData(Tracer)
+        , Actor(
+            Tracer,
+            RequestId,
+            InitUiSubscription(),
+            RawData,
+            Version)
+    {
+    }
+
+    const TUiSubscription& InitUiSubscription()
+    {
+        UiSubscription.SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+
+        TUiFilter filter;
+        filter.Column = static_cast<TColumnType>(DummyColumnType::Value);
+        filter.Operator = FilterOperator::In;
+        filter.Values.StringValues = { "Odd" };
+        UiSubscription.FilterExpression.Filters.insert(filter);
+        UiSubscription.FilterExpression.Relation = FilterRelation::And;
+
+        return UiSubscription;
+    }
+
+    void PreprocessCheckState(TSubscriptionActor::TState aState)
+    {
+        EXPECT_CALL(Actor.State, GetProcessingState())
+            .WillOnce(Return(ISubscriptionStateMachine::ProcessingState::Processing));
+        EXPECT_CALL(Actor.State, GetState())
+            .WillOnce(Return(aState));
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(FilterColumnarSnapshot, ColumnarTableSubscriptionActorTests)
+{
+    for (int64_t id = 1; id <= 10; ++id)
+    {
+        RawData.Emplace(Basis::MakeSPtr<DummyTableItem>(id, id % 2 ? "Odd" : "Even"), Version - 1);
+    }
+    RawData.Emplace(Basis::MakeSPtr<DummyTableItem>(2, "Odd"), Version);
+    /// Строка следующей версии не видна подписке.
+    RawData.Emplace(Basis::MakeSPtr<DummyTableItem>(4, "Odd"), Version + 1);
+
+    PreprocessCheckState(TSubscriptionActor::TState::Initializing);
+    EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::Initialized)));
+    BOOST_REQUIRE(Actor.Process());
+    BOOST_CHECK(Actor.Ranges.IsInitialized());
+
+    /// Фильтрация проверяет строки по колонкам снимка.
+    PreprocessCheckState(TSubscriptionActor::TState::Filtration);
+    EXPECT_CALL(Actor.State, ChangeState(Eq(TSubscriptionActor::TEvent::FiltrationCompleted)));
+    BOOST_REQUIRE(Actor.Process());
+    BOOST_CHECK_EQUAL(Actor.GetProcessedRows(), 10u);
+
+    PreprocessCheckState(TSubscriptionActor::TState::Sorting);
+    EXPECT_CALL(Actor.Sorter, IsInitialized()).WillOnce(Return(false));
+    EXPECT_CALL(Actor.Sorter, Init<TColumnarSubscriptionActorSetup::TTableSorterInit>(_))
+         .WillOnce(Invoke([](const TColumnarSubscriptionActorSetup::TTableSorterInit& aInit)
+    {
+        Basis::Vector<int64_t> ids;
+        for (const auto& item : aInit.Result)
+        {
+            BOOST_CHECK_EQUAL(item->Value, "Odd");
+            ids.push_back(item->GetId());
+        }
+        const Basis::Vector<int64_t> expected { 1, 3, 5, 7, 9, 2 };
+        BOOST_CHECK_EQUAL_COLLECTIONS(ids.cbegin(), ids.cend(), expected.cbegin(), expected.cend());
+    }));
+    BOOST_CHECK(Actor.Process());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
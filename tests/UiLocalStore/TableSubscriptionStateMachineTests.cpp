@@ -92,6 +92,8 @@ BOOST_FIXTURE_TEST_CASE(InitializingTests, TableSubscriptionStateMachineTests)
     BOOST_TEST_CONTEXT("RawDataUpdated") {TestInitializationState(TEvent::RawDataUpdated, TState::Initializing, false);}
     BOOST_TEST_CONTEXT("IncrementMade") {TestInitializationState(TEvent::IncrementMade, TState::Initializing, false);}
     BOOST_TEST_CONTEXT("IncrementApplied") {TestInitializationState(TEvent::IncrementApplied, TState::Initializing, false);}
+    BOOST_TEST_CONTEXT("SubscriptionModified") {TestInitializationState(TEvent::SubscriptionModified, TState::Initializing, false);}
+    BOOST_TEST_CONTEXT("RowWindowChanged") {TestInitializationState(TEvent::RowWindowChanged, TState::Initializing, false);}
     BOOST_TEST_CONTEXT("ErrorOccured") {TestInitializationState(TEvent::ErrorOccured, TState::Error, true);}
 }
 
@@ -104,6 +106,8 @@ BOOST_FIXTURE_TEST_CASE(FiltrationTests, TableSubscriptionStateMachineTests)
     BOOST_TEST_CONTEXT("RawDataUpdated") {TestFiltrationState(TEvent::RawDataUpdated, TState::Filtration, false);}
     BOOST_TEST_CONTEXT("IncrementMade") {TestFiltrationState(TEvent::IncrementMade, TState::Filtration, false);}
     BOOST_TEST_CONTEXT("IncrementApplied") {TestFiltrationState(TEvent::IncrementApplied, TState::Filtration, false);}
+    BOOST_TEST_CONTEXT("SubscriptionModified") {TestFiltrationState(TEvent::SubscriptionModified, TState::Filtration, false);}
+    BOOST_TEST_CONTEXT("RowWindowChanged") {TestFiltrationState(TEvent::RowWindowChanged, TState::Filtration, false);}
     BOOST_TEST_CONTEXT("ErrorOccured") {TestFiltrationState(TEvent::ErrorOccured, TState::Error, true);}
 }
 
@@ -116,6 +120,8 @@ BOOST_FIXTURE_TEST_CASE(SortingTests, TableSubscriptionStateMachineTests)
     BOOST_TEST_CONTEXT("RawDataUpdated") {TestSortingState(TEvent::RawDataUpdated, TState::Sorting, false);}
     BOOST_TEST_CONTEXT("IncrementMade") {TestSortingState(TEvent::IncrementMade, TState::Sorting, false);}
     BOOST_TEST_CONTEXT("IncrementApplied") {TestSortingState(TEvent::IncrementApplied, TState::Sorting, false);}
+    BOOST_TEST_CONTEXT("SubscriptionModified") {TestSortingState(TEvent::SubscriptionModified, TState::Sorting, false);}
+    BOOST_TEST_CONTEXT("RowWindowChanged") {TestSortingState(TEvent::RowWindowChanged, TState::Sorting, false);}
     BOOST_TEST_CONTEXT("ErrorOccured") {TestSortingState(TEvent::ErrorOccured, TState::Error, true);}
 }
 
@@ -128,6 +134,8 @@ BOOST_FIXTURE_TEST_CASE(OkTests, TableSubscriptionStateMachineTests)
     BOOST_TEST_CONTEXT("RawDataUpdated") {TestOkState(TEvent::RawDataUpdated, TState::Ok, false);}
     BOOST_TEST_CONTEXT("IncrementMade") {TestOkState(TEvent::IncrementMade, TState::Ok, false);}
     BOOST_TEST_CONTEXT("IncrementApplied") {TestOkState(TEvent::IncrementApplied, TState::Ok, false);}
+    BOOST_TEST_CONTEXT("SubscriptionModified") {TestOkState(TEvent::SubscriptionModified, TState::Initializing, true);}
+    BOOST_TEST_CONTEXT("RowWindowChanged") {TestOkState(TEvent::RowWindowChanged, TState::Sorting, true);}
     BOOST_TEST_CONTEXT("ErrorOccured") {TestOkState(TEvent::ErrorOccured, TState::Error, true);}
 }
 
@@ -140,6 +148,8 @@ BOOST_FIXTURE_TEST_CASE(UpdatingTests, TableSubscriptionStateMachineTests)
     BOOST_TEST_CONTEXT("RawDataUpdated") {TestUpdatingState(TEvent::RawDataUpdated, TState::IncrementMaking, true);}
     BOOST_TEST_CONTEXT("IncrementMade") {TestUpdatingState(TEvent::IncrementMade, TState::Updating, false);}
     BOOST_TEST_CONTEXT("IncrementApplied") {TestUpdatingState(TEvent::IncrementApplied, TState::Updating, false);}
+    BOOST_TEST_CONTEXT("SubscriptionModified") {TestUpdatingState(TEvent::SubscriptionModified, TState::Updating, false);}
+    BOOST_TEST_CONTEXT("RowWindowChanged") {TestUpdatingState(TEvent::RowWindowChanged, TState::Updating, false);}
     BOOST_TEST_CONTEXT("ErrorOccured") {TestUpdatingState(TEvent::ErrorOccured, TState::Error, true);}
 }
 
@@ -152,6 +162,8 @@ BOOST_FIXTURE_TEST_CASE(IncrementMakingTests, TableSubscriptionStateMachineTests
     BOOST_TEST_CONTEXT("RawDataUpdated") {TestIncrementMakingState(TEvent::RawDataUpdated, TState::IncrementMaking, false);}
     BOOST_TEST_CONTEXT("IncrementMade") {TestIncrementMakingState(TEvent::IncrementMade, TState::IncrementApplying, true);}
     BOOST_TEST_CONTEXT("IncrementApplied") {TestIncrementMakingState(TEvent::IncrementApplied, TState::IncrementMaking, false);}
+    BOOST_TEST_CONTEXT("SubscriptionModified") {TestIncrementMakingState(TEvent::SubscriptionModified, TState::IncrementMaking, false);}
+    BOOST_TEST_CONTEXT("RowWindowChanged") {TestIncrementMakingState(TEvent::RowWindowChanged, TState::IncrementMaking, false);}
     BOOST_TEST_CONTEXT("ErrorOccured") {TestIncrementMakingState(TEvent::ErrorOccured, TState::Error, true);}
 }
 
@@ -164,6 +176,8 @@ BOOST_FIXTURE_TEST_CASE(IncrementApplyingTests, TableSubscriptionStateMachineTes
     BOOST_TEST_CONTEXT("RawDataUpdated") {TestIncrementApplyingState(TEvent::RawDataUpdated, TState::IncrementApplying, false);}
     BOOST_TEST_CONTEXT("IncrementMade") {TestIncrementApplyingState(TEvent::IncrementMade, TState::IncrementApplying, false);}
     BOOST_TEST_CONTEXT("IncrementApplied") {TestIncrementApplyingState(TEvent::IncrementApplied, TState::Ok, true);}
+    BOOST_TEST_CONTEXT("SubscriptionModified") {TestIncrementApplyingState(TEvent::SubscriptionModified, TState::IncrementApplying, false);}
+    BOOST_TEST_CONTEXT("RowWindowChanged") {TestIncrementApplyingState(TEvent::RowWindowChanged, TState::IncrementApplying, false);}
     BOOST_TEST_CONTEXT("ErrorOccured") {TestIncrementApplyingState(TEvent::ErrorOccured, TState::Error, true);}
 }
 
@@ -176,6 +190,8 @@ BOOST_FIXTURE_TEST_CASE(ErrorTests, TableSubscriptionStateMachineTests)
     BOOST_TEST_CONTEXT("RawDataUpdated") {TestErrorState(TEvent::RawDataUpdated, TState::Error, false);}
     BOOST_TEST_CONTEXT("IncrementMade") {TestErrorState(TEvent::IncrementMade, TState::Error, false);}
     BOOST_TEST_CONTEXT("IncrementApplied") {TestErrorState(TEvent::IncrementApplied, TState::Error, false);}
+    BOOST_TEST_CONTEXT("SubscriptionModified") {TestErrorState(TEvent::SubscriptionModified, TState::Error, false);}
+    BOOST_TEST_CONTEXT("RowWindowChanged") {TestErrorState(TEvent::RowWindowChanged, TState::Error, false);}
     BOOST_TEST_CONTEXT("ErrorOccured") {TestErrorState(TEvent::ErrorOccured, TState::Error, true);}
 }
 
@@ -180,6 +180,18 @@ BOOST_FIXTURE_TEST_CASE(ProcessUnsubscription, UiChunkCacheComponentTests)
     Component.ProcessUnsubscription(requestId);
 }
 
+BOOST_FIXTURE_TEST_CASE(ProcessRowWindow, UiTableCacheComponentTests)
+{
+    auto requestId = MakeRequestId();
+    TradingSerialization::Table::RowRange rows;
+    rows.Top = 100;
+    rows.Bottom = 199;
+    EXPECT_CALL(Component.Logic, ProcessRowWindow(Truly(UiRequestsComparer {requestId}), _));
+    ManageRecalls();
+
+    Component.ProcessRowWindow(requestId, rows);
+}
+
 BOOST_FIXTURE_TEST_CASE(ProcessChunkGetNext, UiChunkCacheComponentTests)
 {
     auto requestId = MakeRequestId();
@@ -213,6 +225,28 @@ BOOST_FIXTURE_TEST_CASE(ProcessTableGetNext, UiTableCacheComponentTests)
     Component.ProcessGetNext(requestId);
 }
 
+BOOST_FIXTURE_TEST_CASE(ProcessTableGetNextRowWindow, UiTableCacheComponentTests)
+{
+    auto requestId = MakeRequestId();
+    TResult expectedResult;
+    expectedResult.Processed = true;
+    expectedResult.ResultState = ISubscriptionActor::ResultState::FinalResult;
+    expectedResult.SubscriptionId = requestId;
+    expectedResult.Result = Basis::MakeSPtrPack<DummyTableItem>();
+    expectedResult.Rows = TradingSerialization::Table::RowRange {};
+    expectedResult.Rows->Top = 100;
+    expectedResult.Rows->Bottom = 199;
+    expectedResult.RowCount = 1000;
+
+    EXPECT_CALL(Component.Logic, ProcessGetNext(Truly(UiRequestsComparer {requestId})))
+        .WillOnce(Return(expectedResult));
+    EXPECT_CALL(Component.TableProcessor, SendRowWindowSnapshot(Truly(UiRequestsComparer {requestId}), _, Eq(1000), _));
+    EXPECT_CALL(Component.TableProcessor, SendDataSnapshot(_, _)).Times(0);
+    ManageRecalls();
+
+    Component.ProcessGetNext(requestId);
+}
+
 BOOST_FIXTURE_TEST_CASE(ProcessRecall, UiChunkCacheComponentTests)
 {
     auto requestId = MakeRequestId();
@@ -9,6 +9,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+
 namespace NTPro::Ecn::NewUiServer
 {
 
@@ -117,6 +119,88 @@ BOOST_FIXTURE_TEST_CASE(ProcesUnsubscription, UiCacheLogicTests)
     ProcessUnsubscription(requestId);
 }
 
+BOOST_FIXTURE_TEST_CASE(ModifySubscriptionInPlace, UiCacheLogicTests)
+{
+    const auto requestId = MakeRequestId();
+    TradingSerialization::Table::SubscribeBase subscription;
+
+    ExpectGetState(ILocalStoreStateMachine::State::Idle);
+    EXPECT_CALL(Logic.Subscriptions, ModifySubscription(Truly(UiRequestsComparer {requestId}), _))
+        .WillOnce(Return(true));
+    ExpectChangeState(ILocalStoreStateMachine::Event::NewRequestReceived);
+
+    const auto result = Logic.ModifySubscription(requestId, subscription);
+    BOOST_CHECK(!result.has_value());
+}
+
+BOOST_FIXTURE_TEST_CASE(ModifySubscriptionByResubscription, UiCacheLogicTests)
+{
+    const auto requestId = MakeRequestId();
+    TradingSerialization::Table::SubscribeBase subscription;
+
+    EXPECT_CALL(Logic.StateMachine, GetState())
+        .WillRepeatedly(Return(ILocalStoreStateMachine::State::Idle));
+    EXPECT_CALL(Logic.Subscriptions, ModifySubscription(Truly(UiRequestsComparer {requestId}), _))
+        .WillOnce(Return(false));
+    EXPECT_CALL(Logic.Subscriptions, TransferOwnership(Truly(UiRequestsComparer {requestId})))
+        .WillOnce(Return(false));
+    ExpectEraseSubscription(requestId);
+    ExpectEmplaceSubscription(true);
+    ExpectChangeState(ILocalStoreStateMachine::Event::NewRequestReceived);
+
+    const auto result = Logic.ModifySubscription(requestId, subscription);
+    BOOST_CHECK(!result.has_value());
+}
+
+BOOST_FIXTURE_TEST_CASE(ModifySharedSubscriptionByResubscription, UiCacheLogicTests)
+{
+    const auto requestId = MakeRequestId();
+    TradingSerialization::Table::SubscribeBase subscription;
+
+    /// Обработчик остается у присоединенной подписки, поэтому подписка не удаляется.
+    EXPECT_CALL(Logic.StateMachine, GetState())
+        .WillRepeatedly(Return(ILocalStoreStateMachine::State::Idle));
+    EXPECT_CALL(Logic.Subscriptions, ModifySubscription(Truly(UiRequestsComparer {requestId}), _))
+        .WillOnce(Return(false));
+    EXPECT_CALL(Logic.Subscriptions, TransferOwnership(Truly(UiRequestsComparer {requestId})))
+        .WillOnce(Return(true));
+    ExpectEmplaceSubscription(true);
+    ExpectChangeState(ILocalStoreStateMachine::Event::NewRequestReceived);
+
+    const auto result = Logic.ModifySubscription(requestId, subscription);
+    BOOST_CHECK(!result.has_value());
+}
+
+BOOST_FIXTURE_TEST_CASE(ProcessRowWindow, UiCacheLogicTests)
+{
+    const auto requestId = MakeRequestId();
+    TradingSerialization::Table::RowRange rows;
+    rows.Top = 100;
+    rows.Bottom = 199;
+
+    ExpectGetState(ILocalStoreStateMachine::State::Idle);
+    EXPECT_CALL(Logic.Subscriptions, SetRowWindow(Truly(UiRequestsComparer {requestId}), _))
+        .WillOnce(Return(true));
+    ExpectChangeState(ILocalStoreStateMachine::Event::NewRequestReceived);
+
+    Logic.ProcessRowWindow(requestId, rows);
+}
+
+BOOST_FIXTURE_TEST_CASE(ProcessSortedRowWindow, UiCacheLogicTests)
+{
+    const auto requestId = MakeRequestId();
+    TradingSerialization::Table::RowRange rows;
+    rows.Top = 0;
+    rows.Bottom = 99;
+
+    ExpectGetState(ILocalStoreStateMachine::State::Idle);
+    EXPECT_CALL(Logic.Subscriptions, SetRowWindow(Truly(UiRequestsComparer {requestId}), _))
+        .WillOnce(Return(false));
+    EXPECT_CALL(Logic.StateMachine, ChangeState(_)).Times(0);
+
+    Logic.ProcessRowWindow(requestId, rows);
+}
+
 BOOST_FIXTURE_TEST_CASE(ProcesClear, UiCacheLogicTests)
 {
     const auto requestId = MakeRequestId();
@@ -164,6 +248,113 @@ BOOST_FIXTURE_TEST_CASE(ProcesUpdateData, UiCacheLogicTests)
     Logic.ProcessDataUpdate(Basis::MakeSPtr<TPack>(modelDataPack));
 }
 
+BOOST_FIXTURE_TEST_CASE(ProcessInitialPackWithinTimeBudget, UiCacheLogicTests)
+{
+    using TModelData = Basis::SPtr<Model::DataWithAction<Data>>;
+    using TPack = Basis::Pack<Model::DataWithAction<Data>>;
+    constexpr int ItemsCount = 1000;
+
+    Basis::Vector<TModelData> items;
+    for (int i = 0; i < ItemsCount; ++i)
+    {
+        items.push_back(Basis::MakeSPtr<Model::DataWithAction<Data>>(i, Model::ActionType::New));
+    }
+    TPack modelDataPack { items };
+
+    int64_t id = 0;
+    EXPECT_CALL(Logic.Data.ItemBuilder, CreateItem<TModelData>(_))
+        .Times(ItemsCount)
+        .WillRepeatedly(Invoke([&id](const TModelData&)
+        {
+            ++id;
+            return Basis::MakeSPtr<TData>(id, std::to_string(id));
+        }));
+
+    /// С бюджетом времени весь пакет применяется за один вызов, а не порциями по MaxIncomingChunkSize.
+    Logic.Data.SetIncomingTimeBudget(std::chrono::seconds(10));
+    ExpectChangeState(ILocalStoreStateMachine::Event::UpdatesReceived);
+    Logic.ProcessDataUpdate(Basis::MakeSPtr<TPack>(modelDataPack));
+
+    BOOST_CHECK(!Logic.Data.HasPendingIncomingData());
+    BOOST_CHECK_EQUAL(Logic.Data.GetCurrentVersion(), 1);
+    BOOST_CHECK_EQUAL(Logic.Data.GetData().Size(), ItemsCount);
+}
+
+BOOST_FIXTURE_TEST_CASE(ProcessLargePackOnWorkerPool, UiCacheLogicTests)
+{
+    using TModelData = Basis::SPtr<Model::DataWithAction<Data>>;
+    using TPack = Basis::Pack<Model::DataWithAction<Data>>;
+    constexpr int ItemsCount = 10000;
+
+    Basis::Vector<TModelData> items;
+    for (int i = 0; i < ItemsCount; ++i)
+    {
+        items.push_back(Basis::MakeSPtr<Model::DataWithAction<Data>>(i, Model::ActionType::New));
+    }
+    TPack modelDataPack { items };
+
+    std::atomic<int64_t> id { 0 };
+    EXPECT_CALL(Logic.Data.ItemBuilder, CreateItem<TModelData>(_))
+        .Times(ItemsCount)
+        .WillRepeatedly(Invoke([&id](const TModelData&)
+        {
+            const auto itemId = ++id;
+            return Basis::MakeSPtr<TData>(itemId, std::to_string(itemId));
+        }));
+
+    Logic.Data.SetWorkerPool(std::make_shared<WorkerPool>(2));
+    Logic.Data.SetIncomingTimeBudget(std::chrono::seconds(10));
+    ExpectChangeState(ILocalStoreStateMachine::Event::UpdatesReceived);
+    Logic.ProcessDataUpdate(Basis::MakeSPtr<TPack>(modelDataPack));
+
+    BOOST_CHECK(!Logic.Data.HasPendingIncomingData());
+    BOOST_CHECK_EQUAL(Logic.Data.GetCurrentVersion(), 1);
+    BOOST_CHECK_EQUAL(Logic.Data.GetData().Size(), ItemsCount);
+}
+
+BOOST_FIXTURE_TEST_CASE(RetryFailedBatchSerially, UiCacheLogicTests)
+{
+    using TModelData = Basis::SPtr<Model::DataWithAction<Data>>;
+    using TPack = Basis::Pack<Model::DataWithAction<Data>>;
+    constexpr int ItemsCount = 10000;
+
+    Basis::Vector<TModelData> items;
+    for (int i = 0; i < ItemsCount; ++i)
+    {
+        items.push_back(Basis::MakeSPtr<Model::DataWithAction<Data>>(i, Model::ActionType::New));
+    }
+    TPack modelDataPack { items };
+
+    /// Первая строка не создается в пуле и при первом повторе на реакторе.
+    const auto* failed = &*items.front();
+    std::atomic<int> failures { 2 };
+    std::atomic<int64_t> id { 0 };
+    EXPECT_CALL(Logic.Data.ItemBuilder, CreateItem<TModelData>(_))
+        .Times(ItemsCount + 2)
+        .WillRepeatedly(Invoke([&id, &failures, failed](const TModelData& aModelData)
+        {
+            if (&*aModelData == failed && failures-- > 0)
+            {
+                throw std::runtime_error("CreateItem failed");
+            }
+            const auto itemId = ++id;
+            return Basis::MakeSPtr<TData>(itemId, std::to_string(itemId));
+        }));
+
+    Logic.Data.SetWorkerPool(std::make_shared<WorkerPool>(2));
+    Logic.Data.SetIncomingTimeBudget(std::chrono::seconds(10));
+    BOOST_CHECK_THROW(Logic.ProcessDataUpdate(Basis::MakeSPtr<TPack>(modelDataPack)), std::runtime_error);
+    BOOST_CHECK(Logic.Data.HasPendingIncomingData());
+    BOOST_CHECK_EQUAL(Logic.Data.GetData().Size(), 0);
+
+    /// Пачка создается на реакторе с упавшей строки, строки не теряются.
+    ExpectChangeState(ILocalStoreStateMachine::Event::UpdatesReceived);
+    Logic.ProcessDefferedTasks();
+    BOOST_CHECK(!Logic.Data.HasPendingIncomingData());
+    BOOST_CHECK_EQUAL(Logic.Data.GetCurrentVersion(), 1);
+    BOOST_CHECK_EQUAL(Logic.Data.GetData().Size(), ItemsCount);
+}
+
 BOOST_FIXTURE_TEST_CASE(CheckIsRecallNeeded, UiCacheLogicTests)
 {
     ExpectGetState(ILocalStoreStateMachine::State::Processing);
@@ -0,0 +1,208 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/IteratorRanges.hpp"
+#include "UiLocalStore/MultiIndexContainer.hpp"
+#include "UiLocalStore/VersionDeltaCache.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_VersionDeltaCacheTests)
+
+using namespace TradingSerialization::Table;
+
+struct DeltaContainerSetup : public DummyMultiIndexContainerSetup
+{
+    using TVersionDeltaCache = VersionDeltaCache<DummyTableItem>;
+};
+
+template <typename TContainerSetup>
+class DeltaMultiIndex : public BaseMultiIndexContainer<
+    DeltaMultiIndex<TContainerSetup>,
+    TContainerSetup,
+    typename TContainerSetup::ByValue>
+{
+    using TBaseContainer = BaseMultiIndexContainer<
+        DeltaMultiIndex<TContainerSetup>,
+        TContainerSetup,
+        typename TContainerSetup::ByValue>;
+
+public:
+    DeltaMultiIndex(Basis::Tracer& aTracer)
+        : TBaseContainer(aTracer)
+    {}
+
+    template <typename TSetup>
+    class IndexRanges : public TBaseContainer::template BaseIndexRanges<TSetup, IndexRanges<TSetup>>
+    {
+        using TBase = typename TBaseContainer::template BaseIndexRanges<TSetup, IndexRanges<TSetup>>;
+
+    public:
+        IndexRanges(Basis::Tracer& aTracer)
+            : TBase(aTracer, this)
+        {}
+
+        std::optional<bool> InitCustom()
+        {
+            return std::nullopt;
+        }
+
+        Basis::SPtr<DummyTableItem> CustomGetNext()
+        {
+            return nullptr;
+        }
+
+        void ResetCustom()
+        {
+        }
+    };
+};
+
+template <typename TMap>
+struct DeltaRangesSetup
+{
+    using TData = DummyTableItem;
+    using TIdRanges = IteratorRanges<typename TMap::TIdConstIterator>;
+    using TAddedRanges = IteratorRanges<typename TMap::TVersionConstIterator>;
+    using TDeletedRanges = IteratorRanges<typename TMap::TRewritedConstIterator>;
+};
+
+using TCachedMap = DeltaMultiIndex<DeltaContainerSetup>;
+using TReferenceMap = DeltaMultiIndex<DummyMultiIndexContainerSetup>;
+
+struct VersionDeltaCacheTests : public BaseTestFixture
+{
+    Basis::Tracer& Tracer;
+    FilterGroup Filters;
+
+    TCachedMap Map;
+    TReferenceMap Reference;
+
+    VersionDeltaCacheTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+        , Map(Tracer)
+        , Reference(Tracer)
+    {
+        Filters.Relation = FilterRelation::And;
+
+        for (int64_t i = 0; i < 20; ++i)
+        {
+            Apply(Model::ActionType::New, i, "V1", 1);
+        }
+        Commit(1);
+
+        Apply(Model::ActionType::Change, 3, "V2", 2);
+        Apply(Model::ActionType::Delete, 7, "", 2);
+        Apply(Model::ActionType::New, 25, "V2", 2);
+        Commit(2);
+
+        Apply(Model::ActionType::Change, 3, "V3", 3);
+        Apply(Model::ActionType::Delete, 11, "", 3);
+        Commit(3);
+    }
+
+    void Apply(Model::ActionType aAction, int64_t aId, const std::string& aValue, TDataVersion aVersion)
+    {
+        if (aAction == Model::ActionType::Delete)
+        {
+            Map.Erase(aId, aVersion);
+            Reference.Erase(aId, aVersion);
+            return;
+        }
+        const auto item = Basis::MakeSPtr<DummyTableItem>(aId, aValue);
+        Map.Emplace(item, aVersion);
+        Reference.Emplace(item, aVersion);
+    }
+
+    void Commit(TDataVersion aVersion)
+    {
+        Map.CommitVersion(aVersion);
+        Reference.CommitVersion(aVersion);
+    }
+
+    template <typename TMap>
+    Basis::Vector<std::string> GetRows(const TMap& aMap, Model::ActionType aAction, TDataVersion aVersion)
+    {
+        using TRanges = typename TMap::template IndexRanges<DeltaRangesSetup<TMap>>;
+        TRanges ranges(Tracer);
+        BOOST_CHECK(ranges.Init(typename TRanges::TInit { aMap, Filters, aAction, aVersion }));
+
+        Basis::Vector<std::string> result;
+        while (auto item = ranges.GetNext())
+        {
+            result.push_back(std::to_string(item->GetId()) + ":" + item->Value);
+        }
+        return result;
+    }
+
+    void CheckSameRows(Model::ActionType aAction, TDataVersion aVersion)
+    {
+        const auto rows = GetRows(Map, aAction, aVersion);
+        const auto expected = GetRows(Reference, aAction, aVersion);
+        BOOST_CHECK_EQUAL_COLLECTIONS(rows.cbegin(), rows.cend(), expected.cbegin(), expected.cend());
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestDeltaMatchesIndexes, VersionDeltaCacheTests)
+{
+    /// Первая версия в кэш не попадает.
+    BOOST_CHECK(!Map.GetVersionDeltas().Find(1));
+    BOOST_REQUIRE(Map.GetVersionDeltas().Find(2));
+    BOOST_CHECK_EQUAL(Map.GetVersionDeltas().Size(), 2u);
+    BOOST_CHECK_EQUAL(Reference.GetVersionDeltas().Size(), 0u);
+
+    const auto delta = Map.GetVersionDeltas().Find(2);
+    BOOST_CHECK_EQUAL(delta->Added.size(), 2u);
+    BOOST_CHECK_EQUAL(delta->Deleted.size(), 2u);
+
+    for (TDataVersion version = 1; version <= 3; ++version)
+    {
+        BOOST_TEST_CONTEXT("Version " << version)
+        {
+            CheckSameRows(Model::ActionType::New, version);
+            CheckSameRows(Model::ActionType::Delete, version);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestErasePrevious, VersionDeltaCacheTests)
+{
+    const auto delta = Map.GetVersionDeltas().Find(2);
+
+    Map.ErasePrevious(3);
+    Reference.ErasePrevious(3);
+    BOOST_CHECK(!Map.GetVersionDeltas().Find(2));
+    BOOST_CHECK(Map.GetVersionDeltas().Find(3));
+
+    /// Полученные изменения остаются доступны.
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK_EQUAL(delta->Added.size(), 2u);
+
+    CheckSameRows(Model::ActionType::New, 3);
+    CheckSameRows(Model::ActionType::Delete, 3);
+
+    Map.Clear();
+    BOOST_CHECK_EQUAL(Map.GetVersionDeltas().Size(), 0u);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestVersionGap, VersionDeltaCacheTests)
+{
+    VersionDeltaCache<DummyTableItem> cache(Tracer);
+    cache.Commit(2, {}, {});
+    cache.Commit(3, {}, {});
+    BOOST_CHECK_EQUAL(cache.Size(), 2u);
+
+    /// Пропуск версии: старые изменения отбрасываются.
+    cache.Commit(5, {}, {});
+    BOOST_CHECK_EQUAL(cache.Size(), 1u);
+    BOOST_CHECK(!cache.Find(3));
+    BOOST_CHECK(cache.Find(5));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,247 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/IteratorRanges.hpp"
+#include "UiLocalStore/MultiIndexContainer.hpp"
+#include "UiLocalStore/VersionEpochArena.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+#include <numeric>
+#include <random>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_VersionEpochArenaTests)
+
+using namespace TradingSerialization::Table;
+
+struct ArenaContainerSetup : public DummyMultiIndexContainerSetup
+{
+    template <typename T>
+    using TNodeAllocator = EpochAllocator<T>;
+};
+
+class ArenaMultiIndex : public BaseMultiIndexContainer<
+    ArenaMultiIndex,
+    ArenaContainerSetup,
+    ArenaContainerSetup::ByValue>
+{
+public:
+    ArenaMultiIndex(Basis::Tracer& aTracer)
+        : BaseMultiIndexContainer(aTracer)
+    {}
+
+    template <typename TSetup>
+    class IndexRanges : public BaseIndexRanges<TSetup, IndexRanges<TSetup>>
+    {
+        using TBase = BaseIndexRanges<TSetup, IndexRanges<TSetup>>;
+
+    public:
+        IndexRanges(Basis::Tracer& aTracer)
+            : TBase(aTracer, this)
+        {}
+
+        std::optional<bool> InitCustom()
+        {
+            return std::nullopt;
+        }
+
+        Basis::SPtr<DummyTableItem> CustomGetNext()
+        {
+            return nullptr;
+        }
+
+        void ResetCustom()
+        {
+        }
+    };
+};
+
+struct ArenaRangesSetup
+{
+    using TData = DummyTableItem;
+    using TIdRanges = IteratorRanges<ArenaMultiIndex::TIdConstIterator>;
+    using TAddedRanges = IteratorRanges<ArenaMultiIndex::TVersionConstIterator>;
+    using TDeletedRanges = IteratorRanges<ArenaMultiIndex::TRewritedConstIterator>;
+};
+
+using TArenaRanges = ArenaMultiIndex::IndexRanges<ArenaRangesSetup>;
+
+struct VersionEpochArenaTests : public BaseTestFixture
+{
+    Basis::Tracer& Tracer;
+    FilterGroup Filters;
+
+    VersionEpochArenaTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+    {
+        Filters.Relation = FilterRelation::And;
+    }
+
+    Basis::Vector<std::string> GetValues(const ArenaMultiIndex& aMap, TDataVersion aVersion)
+    {
+        TArenaRanges ranges(Tracer);
+        BOOST_CHECK(ranges.Init(TArenaRanges::TInit { aMap, Filters, std::nullopt, aVersion }));
+
+        Basis::Vector<std::string> result;
+        while (auto item = ranges.GetNext())
+        {
+            result.push_back(item->Value);
+        }
+        return result;
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestChunksAreReusedByEpoch, VersionEpochArenaTests)
+{
+    constexpr size_t BlockSize = 64;
+    constexpr size_t BlocksPerEpoch = 3 * VersionEpochArena::ChunkSize / BlockSize;
+
+    VersionEpochArena arena;
+    Basis::Vector<void*> first;
+    Basis::Vector<void*> second;
+
+    arena.BeginEpoch(1);
+    for (size_t i = 0; i < BlocksPerEpoch; ++i)
+    {
+        first.push_back(arena.Allocate(BlockSize, 8));
+    }
+    arena.BeginEpoch(2);
+    for (size_t i = 0; i < BlocksPerEpoch; ++i)
+    {
+        second.push_back(arena.Allocate(BlockSize, 8));
+    }
+
+    const auto chunksCount = arena.GetChunksCount();
+    BOOST_CHECK_GE(chunksCount, 6);
+    BOOST_CHECK_EQUAL(arena.GetSpareChunksCount(), 0);
+
+    /// Блоки первой версии не пересекаются с блоками второй.
+    for (auto* ptr : first)
+    {
+        arena.Deallocate(ptr, BlockSize, 8);
+    }
+    BOOST_CHECK_EQUAL(arena.GetSpareChunksCount(), chunksCount / 2);
+
+    /// Освобожденные блоки переиспользуются следующей версией.
+    arena.BeginEpoch(3);
+    for (size_t i = 0; i < BlocksPerEpoch; ++i)
+    {
+        first[i] = arena.Allocate(BlockSize, 8);
+    }
+    BOOST_CHECK_EQUAL(arena.GetChunksCount(), chunksCount);
+
+    /// Крупные выделения идут мимо арены.
+    auto* large = arena.Allocate(VersionEpochArena::MaxBlockSize + 1, 8);
+    BOOST_CHECK_EQUAL(arena.GetChunksCount(), chunksCount);
+    arena.Deallocate(large, VersionEpochArena::MaxBlockSize + 1, 8);
+
+    for (auto* ptr : first)
+    {
+        arena.Deallocate(ptr, BlockSize, 8);
+    }
+    for (auto* ptr : second)
+    {
+        arena.Deallocate(ptr, BlockSize, 8);
+    }
+    BOOST_CHECK_LE(arena.GetSpareChunksCount(), VersionEpochArena::MaxSpareChunks);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestContainerOnArena, VersionEpochArenaTests)
+{
+    constexpr int64_t ItemsCount = 5000;
+
+    ArenaMultiIndex map(Tracer);
+    for (int64_t i = 0; i < ItemsCount; ++i)
+    {
+        map.Emplace(Basis::MakeSPtr<DummyTableItem>(i, "First"), 1);
+    }
+    for (int64_t i = 0; i < ItemsCount; ++i)
+    {
+        map.Emplace(Basis::MakeSPtr<DummyTableItem>(i, "Second"), 2);
+    }
+    BOOST_CHECK_EQUAL(map.Size(), 2 * ItemsCount);
+
+    const auto chunksCount = map.GetArena().GetChunksCount();
+    BOOST_CHECK_EQUAL(map.GetArena().GetSpareChunksCount(), 0);
+
+    map.ErasePrevious(3);
+    BOOST_CHECK_EQUAL(map.Size(), ItemsCount);
+    /// Все блоки первой версии освобождены целиком.
+    BOOST_CHECK_GT(map.GetArena().GetSpareChunksCount(), 0);
+
+    const auto values = GetValues(map, 2);
+    BOOST_CHECK_EQUAL(values.size(), ItemsCount);
+    BOOST_CHECK(std::all_of(values.cbegin(), values.cend(), [](const auto& aValue) { return aValue == "Second"; }));
+
+    for (int64_t i = 0; i < ItemsCount; ++i)
+    {
+        map.Emplace(Basis::MakeSPtr<DummyTableItem>(i, "Third"), 3);
+    }
+    /// Новых блоков нужно не больше, чем блоков, которые делят соседние версии.
+    BOOST_CHECK_LE(map.GetArena().GetChunksCount(), chunksCount + 2);
+
+    map.Clear();
+    BOOST_CHECK_EQUAL(map.Size(), 0);
+    BOOST_CHECK(GetValues(map, 3).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestSmallVersionsShareChunks, VersionEpochArenaTests)
+{
+    constexpr int64_t VersionsCount = 2000;
+    constexpr int64_t HotId = -1;
+
+    /// В каждой версии одна новая долгоживущая строка и перезапись часто меняющейся строки.
+    ArenaMultiIndex map(Tracer);
+    for (int64_t version = 1; version <= VersionsCount; ++version)
+    {
+        map.Emplace(Basis::MakeSPtr<DummyTableItem>(version, "Long"), version);
+        map.Emplace(Basis::MakeSPtr<DummyTableItem>(HotId, "Hot"), version);
+        map.ErasePrevious(version);
+    }
+    /// Блоки заполняются подряд, а не по блоку на версию.
+    BOOST_CHECK_LE(map.GetArena().GetChunksCount(), 32);
+    BOOST_CHECK_EQUAL(GetValues(map, VersionsCount).size(), VersionsCount + 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestRandomRewritesReleaseChunks, VersionEpochArenaTests)
+{
+    constexpr int64_t ItemsCount = 5000;
+    constexpr int64_t VersionsCount = 1000;
+    constexpr int64_t RewritesCount = 100;
+
+    ArenaMultiIndex map(Tracer);
+    for (int64_t i = 0; i < ItemsCount; ++i)
+    {
+        map.Emplace(Basis::MakeSPtr<DummyTableItem>(i, "Initial"), 1);
+    }
+    const auto initialChunksCount = map.GetArena().GetChunksCount();
+
+    /// Каждая версия перезаписывает случайные строки, долгоживущие узлы остаются во всех блоках.
+    std::mt19937 random(42);
+    Basis::Vector<int64_t> ids(ItemsCount);
+    std::iota(ids.begin(), ids.end(), 0);
+    size_t maxChunksCount = 0;
+    for (int64_t version = 2; version <= VersionsCount; ++version)
+    {
+        std::shuffle(ids.begin(), ids.end(), random);
+        for (int64_t i = 0; i < RewritesCount; ++i)
+        {
+            map.Emplace(Basis::MakeSPtr<DummyTableItem>(ids[i], "Rewrited"), version);
+        }
+        map.ErasePrevious(version);
+        maxChunksCount = std::max(maxChunksCount, map.GetArena().GetChunksCount());
+    }
+    /// Строки, перезаписанные последней версией, еще хранятся.
+    BOOST_CHECK_EQUAL(map.Size(), ItemsCount + RewritesCount);
+    BOOST_CHECK_EQUAL(GetValues(map, VersionsCount).size(), ItemsCount);
+
+    /// Освобожденные узлы переиспользуются, блоков нужно не больше, чем для живых узлов и запаса.
+    BOOST_CHECK_LE(maxChunksCount, initialChunksCount + VersionEpochArena::MaxSpareChunks);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
@@ -0,0 +1,152 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/WindowedIncrementApplicator.hpp"
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+#include <random>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_WindowedIncrementApplicatorTests)
+
+using namespace TradingSerialization::Table;
+
+struct TWindowedApplicatorSetup
+{
+    static constexpr int MaxCount = 100;
+    using TData = DummyTableItem;
+    using TTableSetup = DummyTableSetup;
+};
+
+using TApplicator = WindowedIncrementApplicator<TWindowedApplicatorSetup>;
+
+struct WindowedIncrementApplicatorTests : public BaseTestFixture
+{
+    using TSortOrder = TradingSerialization::Table::TSortOrder;
+    using TDataPack = Basis::Pack<DummyTableItem>;
+    using TSPtrDataPack = Basis::SPtr<TDataPack>;
+
+    TSortOrder SortOrder;
+
+    TSPtrDataPack OldSnapshot;
+    TDataPack NewSnapshot;
+    TDataPack DeletedIncrement;
+    TDataPack AddedIncrement;
+
+    std::mt19937 Random { 17 };
+    Basis::Tracer& Tracer;
+
+    WindowedIncrementApplicatorTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+    {
+        SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+    }
+
+    /// Старый снапшот из идентификаторов [0, aCount) в случайном порядке.
+    void FillOldSnapshot(int aCount)
+    {
+        auto snapshot = Basis::MakeShared<TDataPack>();
+        for (int i = 0; i < aCount; ++i)
+        {
+            snapshot->push_back(Basis::MakeSPtr<DummyTableItem>(i, "Old"));
+        }
+        std::shuffle(snapshot->begin(), snapshot->end(), Random);
+        OldSnapshot = snapshot;
+    }
+
+    TableIncrementApplicatorState Complete(TApplicator& aApplicator, int& outCalls)
+    {
+        outCalls = 0;
+        auto state = aApplicator.GetState();
+        while (state == TableIncrementApplicatorState::Processing)
+        {
+            state = aApplicator.Process();
+            BOOST_CHECK_LE(aApplicator.GetSliceRows(), TWindowedApplicatorSetup::MaxCount);
+            ++outCalls;
+        }
+        return state;
+    }
+
+    Basis::Vector<int64_t> GetIds(const TDataPack& aPack)
+    {
+        Basis::Vector<int64_t> ids;
+        for (const auto& item : aPack)
+        {
+            ids.push_back(item->GetId());
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestApplyIncrement, WindowedIncrementApplicatorTests)
+{
+    FillOldSnapshot(1000);
+    /// Удаляются четные идентификаторы меньше 500, каждый десятый заменяется, добавляются [1000, 1100).
+    Basis::Vector<int64_t> expectedIds;
+    for (int i = 0; i < 1100; ++i)
+    {
+        if (i < 500 && i % 2 == 0)
+        {
+            DeletedIncrement.push_back(Basis::MakeSPtr<DummyTableItem>(i, "Old"));
+            continue;
+        }
+        if (i >= 1000 || i % 10 == 5)
+        {
+            AddedIncrement.push_back(Basis::MakeSPtr<DummyTableItem>(i, "New"));
+        }
+        expectedIds.push_back(i);
+    }
+
+    TApplicator applicator(Tracer);
+    applicator.Init(TApplicator::TInit { SortOrder, OldSnapshot, DeletedIncrement, AddedIncrement, NewSnapshot });
+
+    int calls = 0;
+    BOOST_CHECK_EQUAL(TableIncrementApplicatorState::Completed, Complete(applicator, calls));
+    BOOST_CHECK_LE(calls, (1000 + 100) / TWindowedApplicatorSetup::MaxCount + 1);
+    BOOST_CHECK(GetIds(NewSnapshot) == expectedIds);
+
+    /// Замененные элементы берутся из инкремента.
+    for (const auto& item : NewSnapshot)
+    {
+        BOOST_CHECK_EQUAL(item->Value, item->GetId() >= 1000 || item->GetId() % 10 == 5 ? "New" : "Old");
+    }
+
+    applicator.Reset();
+    BOOST_CHECK(!applicator.IsInitialized());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestSharedSnapshotIsNotMoved, WindowedIncrementApplicatorTests)
+{
+    FillOldSnapshot(250);
+    const auto sharedSnapshot = OldSnapshot;
+
+    TApplicator applicator(Tracer);
+    applicator.Init(TApplicator::TInit { SortOrder, OldSnapshot, DeletedIncrement, AddedIncrement, NewSnapshot });
+
+    int calls = 0;
+    BOOST_CHECK_EQUAL(TableIncrementApplicatorState::Completed, Complete(applicator, calls));
+    BOOST_CHECK_EQUAL(NewSnapshot.size(), 250u);
+    for (const auto& item : *sharedSnapshot)
+    {
+        BOOST_CHECK(item);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestInvalidSortOrder, WindowedIncrementApplicatorTests)
+{
+    FillOldSnapshot(10);
+    SortOrder.clear();
+
+    TApplicator applicator(Tracer);
+    applicator.Init(TApplicator::TInit { SortOrder, OldSnapshot, DeletedIncrement, AddedIncrement, NewSnapshot });
+    BOOST_CHECK_EQUAL(TableIncrementApplicatorState::Error, applicator.GetState());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
@@ -0,0 +1,182 @@
+#include "DummyTableData.hpp"
+
+#include "UiLocalStore/SortOrderComparator.hpp"
+#include "UiLocalStore/WindowedTableSorter.hpp"
+#include "TradingSerialization/Table/Columns.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+#include <Common/Fake.hpp>
+#include <Common/Pack.hpp>
+
+#include <random>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_WindowedTableSorterTests)
+
+using namespace TradingSerialization::Table;
+
+struct TWindowedSorterSetup
+{
+    static constexpr int MaxCount = 100;
+    using TData = DummyTableItem;
+    using TTableSetup = DummyTableSetup;
+};
+
+using TSorter = WindowedTableSorter<TWindowedSorterSetup>;
+
+struct WindowedTableSorterTests : public BaseTestFixture
+{
+    using TSortOrder = TradingSerialization::Table::TSortOrder;
+    using TDataPack = Basis::Pack<DummyTableItem>;
+
+    TSortOrder SortOrder;
+    TDataPack Data;
+    TDataPack ExpectedData;
+    TDataPack TmpBuf;
+
+    std::mt19937 Random { 13 };
+    Basis::Tracer& Tracer;
+
+    WindowedTableSorterTests()
+        : Tracer(Basis::Tracing::GetTracer(CreateTestPart()))
+    {
+        SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Value));
+        SortOrder.push_back(static_cast<TColumnType>(DummyColumnType::Id));
+    }
+
+    void FillRandomData(int aCount)
+    {
+        Data.clear();
+        for (int i = 0; i < aCount; ++i)
+        {
+            Data.push_back(Basis::MakeSPtr<DummyTableItem>(i, "Value" + std::to_string(Random() % 50)));
+        }
+        std::shuffle(Data.begin(), Data.end(), Random);
+
+        ExpectedData = Data;
+        bool ok = true;
+        std::sort(ExpectedData.begin(), ExpectedData.end(), SortOrderComparator<DummyTableItem, DummyColumnType>(SortOrder, ok));
+        BOOST_REQUIRE(ok);
+    }
+
+    TableSorterState Complete(TSorter& aSorter, int& outCalls)
+    {
+        outCalls = 0;
+        auto state = aSorter.GetState();
+        while (state != TableSorterState::Completed && state != TableSorterState::Error)
+        {
+            state = aSorter.Process();
+            ++outCalls;
+        }
+        return state;
+    }
+
+    void CheckPrefix(size_t aCount)
+    {
+        BOOST_REQUIRE_EQUAL(Data.size(), ExpectedData.size());
+        for (size_t i = 0; i < aCount; ++i)
+        {
+            BOOST_REQUIRE_EQUAL(Data[i]->GetId(), ExpectedData[i]->GetId());
+        }
+
+        /// Хвост содержит все остальные строки.
+        Basis::Vector<int64_t> tail;
+        for (size_t i = aCount; i < Data.size(); ++i)
+        {
+            tail.push_back(Data[i]->GetId());
+        }
+        Basis::Vector<int64_t> expectedTail;
+        for (size_t i = aCount; i < ExpectedData.size(); ++i)
+        {
+            expectedTail.push_back(ExpectedData[i]->GetId());
+        }
+        std::sort(tail.begin(), tail.end());
+        std::sort(expectedTail.begin(), expectedTail.end());
+        BOOST_CHECK(tail == expectedTail);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(TestWindowIsSorted, WindowedTableSorterTests)
+{
+    for (int count : { 0, 1, 49, 50, 1000 })
+    {
+        BOOST_TEST_CONTEXT("Items count: " << count)
+        {
+            FillRandomData(count);
+            TSorter sorter(Tracer);
+            sorter.Init(TSorter::TInit { SortOrder, Data, TmpBuf, 49 });
+
+            int calls = 0;
+            BOOST_CHECK_EQUAL(TableSorterState::Completed, Complete(sorter, calls));
+            BOOST_CHECK_EQUAL(sorter.GetSortedCount(), std::min(count, 50));
+            CheckPrefix(sorter.GetSortedCount());
+            /// Каждый вызов обрабатывает не больше MaxCount строк: отбор и перестановка.
+            BOOST_CHECK_LE(calls, 2 * (count / TWindowedSorterSetup::MaxCount + 1));
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestExtendWindow, WindowedTableSorterTests)
+{
+    FillRandomData(1000);
+    TSorter sorter(Tracer);
+    sorter.Init(TSorter::TInit { SortOrder, Data, TmpBuf, 49 });
+
+    int calls = 0;
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Complete(sorter, calls));
+    BOOST_CHECK(!sorter.IsFullySorted());
+
+    /// Окно меньше уже упорядоченного не требует работы.
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, sorter.ExtendWindow(10));
+    BOOST_CHECK_EQUAL(sorter.GetSortedCount(), 50);
+
+    BOOST_CHECK_EQUAL(TableSorterState::PartSort, sorter.ExtendWindow(149));
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Complete(sorter, calls));
+    BOOST_CHECK_EQUAL(sorter.GetSortedCount(), 150);
+    CheckPrefix(150);
+
+    sorter.ExtendWindow(5000);
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Complete(sorter, calls));
+    BOOST_CHECK(sorter.IsFullySorted());
+    CheckPrefix(Data.size());
+
+    sorter.Reset();
+    BOOST_CHECK(!sorter.IsInitialized());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestInitWithSortedPrefix, WindowedTableSorterTests)
+{
+    FillRandomData(1000);
+    TSorter sorter(Tracer);
+    sorter.Init(TSorter::TInit { SortOrder, Data, TmpBuf, 49 });
+
+    int calls = 0;
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Complete(sorter, calls));
+
+    /// Уже упорядоченный префикс не пересортировывается при повторной инициализации.
+    TSorter extended(Tracer);
+    extended.Init(TSorter::TInit { SortOrder, Data, TmpBuf, 149, sorter.GetSortedCount() });
+    BOOST_CHECK_EQUAL(extended.GetSortedCount(), 50);
+    BOOST_CHECK_EQUAL(TableSorterState::Completed, Complete(extended, calls));
+    BOOST_CHECK_EQUAL(extended.GetSortedCount(), 150);
+    CheckPrefix(150);
+
+    /// Префикс больше данных ограничивается их размером.
+    TSorter whole(Tracer);
+    whole.Init(TSorter::TInit { SortOrder, Data, TmpBuf, 5000, 5000 });
+    BOOST_CHECK_EQUAL(whole.GetSortedCount(), Data.size());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestInvalidSortOrder, WindowedTableSorterTests)
+{
+    TSorter sorter(Tracer);
+    SortOrder.clear();
+    sorter.Init(TSorter::TInit { SortOrder, Data, TmpBuf, 49 });
+    BOOST_CHECK_EQUAL(TableSorterState::Error, sorter.GetState());
+    BOOST_CHECK_EQUAL(TableSorterState::Error, sorter.ExtendWindow(99));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
@@ -0,0 +1,40 @@
+#include "UiLocalStore/WorkerPool.hpp"
+
+#include <Basis/BaseTestFixture.hpp>
+
+#include <atomic>
+#include <future>
+
+namespace NTPro::Ecn::NewUiServer
+{
+
+BOOST_AUTO_TEST_SUITE(UiServer_WorkerPoolTests)
+
+BOOST_AUTO_TEST_CASE(TestAllTasksAreExecuted)
+{
+    constexpr int TasksCount = 1000;
+    std::atomic<int> counter { 0 };
+    {
+        WorkerPool pool(4);
+        BOOST_CHECK_EQUAL(pool.GetThreadsCount(), 4);
+        for (int i = 0; i < TasksCount; ++i)
+        {
+            pool.Post([&counter]() { ++counter; });
+        }
+    }
+    /// Пул дожидается всех задач при удалении.
+    BOOST_CHECK_EQUAL(counter.load(), TasksCount);
+}
+
+BOOST_AUTO_TEST_CASE(TestTasksRunOutsideCaller)
+{
+    WorkerPool pool(0);
+    BOOST_CHECK_EQUAL(pool.GetThreadsCount(), 1);
+
+    std::promise<std::thread::id> threadId;
+    pool.Post([&threadId]() { threadId.set_value(std::this_thread::get_id()); });
+    BOOST_CHECK(threadId.get_future().get() != std::this_thread::get_id());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}